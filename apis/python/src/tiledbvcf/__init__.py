@@ -9,7 +9,14 @@ import sys
 import tiledbvcf.libtiledbvcf
 
 # Load basic modules first
-from .dataset import ReadConfig, TileDBVCFDataset, Dataset, config_logging
+from .dataset import (
+    ReadConfig,
+    TileDBVCFDataset,
+    Dataset,
+    config_logging,
+    enable_metrics,
+    reset_metrics,
+)
 
 from .version import version
 from .allele_frequency import read_allele_frequency
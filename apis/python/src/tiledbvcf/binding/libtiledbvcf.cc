@@ -48,6 +48,8 @@ PYBIND11_MODULE(libtiledbvcf, m) {
 
   // C API bindings
   m.def("config_logging", &config_logging);
+  m.def("metrics_enable", &tiledb_vcf_metrics_enable);
+  m.def("metrics_reset", &tiledb_vcf_metrics_reset);
 
   py::class_<Reader>(m, "Reader")
       .def(py::init())
@@ -57,7 +59,9 @@ PYBIND11_MODULE(libtiledbvcf, m) {
       .def("set_samples_file", &Reader::set_samples_file)
       .def("set_regions", &Reader::set_regions)
       .def("set_bed_file", &Reader::set_bed_file)
+      .def("set_region_index_cache", &Reader::set_region_index_cache)
       .def("set_sort_regions", &Reader::set_sort_regions)
+      .def("set_balance_partitions", &Reader::set_balance_partitions)
       .def("set_region_partition", &Reader::set_region_partition)
       .def("set_sample_partition", &Reader::set_sample_partition)
       .def("set_memory_budget", &Reader::set_memory_budget)
@@ -72,6 +76,8 @@ PYBIND11_MODULE(libtiledbvcf, m) {
       .def("set_output_path", &Reader::set_output_path)
       .def("set_output_dir", &Reader::set_output_dir)
       .def("set_af_filter", &Reader::set_af_filter)
+      .def("set_record_filter", &Reader::set_record_filter)
+      .def("set_variants_only", &Reader::set_variants_only)
       .def("set_scan_all_samples", &Reader::set_scan_all_samples)
       .def("read", &Reader::read, py::arg("release_buffs") = true)
       .def("get_results_arrow", &Reader::get_results_arrow)
@@ -79,6 +85,7 @@ PYBIND11_MODULE(libtiledbvcf, m) {
       .def("result_num_records", &Reader::result_num_records)
       .def("get_tiledb_stats_enabled", &Reader::get_tiledb_stats_enabled)
       .def("get_tiledb_stats", &Reader::get_tiledb_stats)
+      .def("get_metrics", &Reader::get_metrics)
       .def("get_schema_version", &Reader::get_schema_version)
       .def("get_fmt_attributes", &Reader::get_fmt_attributes)
       .def("get_info_attributes", &Reader::get_info_attributes)
@@ -123,6 +130,10 @@ PYBIND11_MODULE(libtiledbvcf, m) {
       .def("set_avg_vcf_record_size", &Writer::set_avg_vcf_record_size)
       .def("set_ratio_task_size", &Writer::set_ratio_task_size)
       .def("set_ratio_output_flush", &Writer::set_ratio_output_flush)
+      .def("set_decompression_threads", &Writer::set_decompression_threads)
+      .def("set_huge_pages", &Writer::set_huge_pages)
+      .def("set_merge_ref_blocks", &Writer::set_merge_ref_blocks)
+      .def("set_ref_block_gq_band", &Writer::set_ref_block_gq_band)
       .def("set_thread_task_size", &Writer::set_thread_task_size)
       .def("set_memory_budget", &Writer::set_memory_budget)
       .def("set_scratch_space", &Writer::set_scratch_space)
@@ -143,8 +154,11 @@ PYBIND11_MODULE(libtiledbvcf, m) {
       .def("set_sample_batch_size", &Writer::set_sample_batch_size)
       .def("get_tiledb_stats_enabled", &Writer::get_tiledb_stats_enabled)
       .def("get_tiledb_stats", &Writer::get_tiledb_stats)
+      .def("get_metrics", &Writer::get_metrics)
       .def("version", &Writer::version)
       .def("set_resume", &Writer::set_resume)
+      .def("set_checkpoint_uri", &Writer::set_checkpoint_uri)
+      .def("set_checkpoint_records", &Writer::set_checkpoint_records)
       .def("set_contig_fragment_merging", &Writer::set_contig_fragment_merging)
       .def(
           "set_contigs_to_keep_separate", &Writer::set_contigs_to_keep_separate)
@@ -155,6 +169,10 @@ PYBIND11_MODULE(libtiledbvcf, m) {
       .def("set_enable_variant_stats", &Writer::set_enable_variant_stats)
       .def("set_enable_sample_stats", &Writer::set_enable_sample_stats)
       .def("set_compress_sample_dim", &Writer::set_compress_sample_dim)
+      .def("set_ref_block_flag", &Writer::set_ref_block_flag)
+      .def("set_compact_gt", &Writer::set_compact_gt)
+      .def("set_dictionary_encoding", &Writer::set_dictionary_encoding)
+      .def("set_adaptive_anchor_gap", &Writer::set_adaptive_anchor_gap)
       .def("set_compression_level", &Writer::set_compression_level)
       .def("set_variant_stats_version", &Writer::set_variant_stats_version);
 }
@@ -108,6 +108,12 @@ void Reader::set_bed_file(const std::string& uri) {
   check_error(reader, tiledb_vcf_reader_set_bed_file(reader, uri.c_str()));
 }
 
+void Reader::set_region_index_cache(const std::string& uri) {
+  auto reader = ptr.get();
+  check_error(
+      reader, tiledb_vcf_reader_set_region_index_cache(reader, uri.c_str()));
+}
+
 void Reader::set_region_partition(int32_t partition, int32_t num_partitions) {
   auto reader = ptr.get();
   check_error(
@@ -142,6 +148,13 @@ void Reader::set_sort_regions(bool sort_regions) {
       reader, tiledb_vcf_reader_set_sort_regions(reader, sort_regions ? 1 : 0));
 }
 
+void Reader::set_balance_partitions(bool balance_partitions) {
+  auto reader = ptr.get();
+  check_error(
+      reader,
+      tiledb_vcf_reader_set_balance_partitions(reader, balance_partitions));
+}
+
 void Reader::set_max_num_records(int64_t max_num_records) {
   auto reader = ptr.get();
   check_error(
@@ -195,6 +208,19 @@ void Reader::set_af_filter(const std::string& af_filter) {
       reader, tiledb_vcf_reader_set_af_filter(reader, af_filter.c_str()));
 }
 
+void Reader::set_record_filter(const std::string& record_filter) {
+  auto reader = ptr.get();
+  check_error(
+      reader,
+      tiledb_vcf_reader_set_record_filter(reader, record_filter.c_str()));
+}
+
+void Reader::set_variants_only(const bool variants_only) {
+  auto reader = ptr.get();
+  check_error(
+      reader, tiledb_vcf_reader_set_variants_only(reader, variants_only));
+}
+
 void Reader::set_scan_all_samples(const bool scan_all_samples) {
   auto reader = ptr.get();
   check_error(
@@ -398,6 +424,13 @@ std::string Reader::get_tiledb_stats() {
   return std::string(stats);
 }
 
+std::string Reader::get_metrics() {
+  auto reader = ptr.get();
+  const char* metrics;
+  check_error(reader, tiledb_vcf_reader_get_metrics(reader, &metrics));
+  return std::string(metrics);
+}
+
 int32_t Reader::get_schema_version() {
   auto reader = ptr.get();
   int32_t version;
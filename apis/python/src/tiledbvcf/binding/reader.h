@@ -67,6 +67,9 @@ class Reader {
   /** Sets a URI of a BED file containing regions to include in the read. */
   void set_bed_file(const std::string& uri);
 
+  /** Sets a URI of a directory where parsed BED files are cached. */
+  void set_region_index_cache(const std::string& uri);
+
   /** Sets the region partition of this reader. */
   void set_region_partition(int32_t partition, int32_t num_partitions);
 
@@ -76,6 +79,9 @@ class Reader {
   /** Sets the sort regions parameter of this reader. */
   void set_sort_regions(bool sort_regions);
 
+  /** Sets whether partitions are balanced by estimated data volume. */
+  void set_balance_partitions(bool balance_partitions);
+
   /** Sets the internal memory budget for the TileDB-VCF library. */
   void set_memory_budget(int32_t memory_mb);
 
@@ -109,6 +115,9 @@ class Reader {
   /** Fetches TileDB statistics */
   std::string get_tiledb_stats();
 
+  /** Fetches TileDB-VCF metrics as JSON */
+  std::string get_metrics();
+
   /** Returns schema version number of the TileDB VCF dataset */
   int32_t get_schema_version();
 
@@ -157,6 +166,12 @@ class Reader {
   /** Set internal allele frequency filtering expression */
   void set_af_filter(const std::string& af_filter);
 
+  /** Set record filtering expression */
+  void set_record_filter(const std::string& record_filter);
+
+  /** Set whether to skip gVCF reference blocks */
+  void set_variants_only(const bool variants_only);
+
   /** Set whether to scan all samples in the dataset when computing frequency */
   void set_scan_all_samples(const bool scan_all_samples);
 
@@ -190,6 +190,27 @@ void Writer::set_ratio_output_flush(const float ratio_output_flush) {
       tiledb_vcf_writer_set_ratio_output_flush(writer, ratio_output_flush));
 }
 
+void Writer::set_decompression_threads(const uint32_t threads) {
+  auto writer = ptr.get();
+  check_error(
+      writer, tiledb_vcf_writer_set_decompression_threads(writer, threads));
+}
+
+void Writer::set_huge_pages(bool enable) {
+  auto writer = ptr.get();
+  check_error(writer, tiledb_vcf_writer_set_huge_pages(writer, enable));
+}
+
+void Writer::set_merge_ref_blocks(bool enable) {
+  auto writer = ptr.get();
+  check_error(writer, tiledb_vcf_writer_set_merge_ref_blocks(writer, enable));
+}
+
+void Writer::set_ref_block_gq_band(const uint32_t band) {
+  auto writer = ptr.get();
+  check_error(writer, tiledb_vcf_writer_set_ref_block_gq_band(writer, band));
+}
+
 void Writer::set_thread_task_size(const uint32_t size) {
   auto writer = ptr.get();
   check_error(writer, tiledb_vcf_writer_set_thread_task_size(writer, size));
@@ -282,6 +303,13 @@ std::string Writer::get_tiledb_stats() {
   return std::string(stats);
 }
 
+std::string Writer::get_metrics() {
+  auto writer = ptr.get();
+  const char* metrics;
+  check_error(writer, tiledb_vcf_writer_get_metrics(writer, &metrics));
+  return std::string(metrics);
+}
+
 std::string Writer::version() {
   const char* version_str;
   tiledb_vcf_version(&version_str);
@@ -295,6 +323,18 @@ void Writer::set_resume(const bool resume) {
       tiledb_vcf_writer_set_resume_sample_partial_ingestion(writer, resume));
 }
 
+void Writer::set_checkpoint_uri(const std::string& uri) {
+  auto writer = ptr.get();
+  check_error(
+      writer, tiledb_vcf_writer_set_checkpoint_uri(writer, uri.c_str()));
+}
+
+void Writer::set_checkpoint_records(const uint64_t records) {
+  auto writer = ptr.get();
+  check_error(
+      writer, tiledb_vcf_writer_set_checkpoint_records(writer, records));
+}
+
 void Writer::set_contig_fragment_merging(const bool contig_fragment_merging) {
   auto writer = ptr.get();
   check_error(
@@ -365,6 +405,28 @@ void Writer::set_compress_sample_dim(bool enable) {
       writer, tiledb_vcf_writer_set_compress_sample_dim(writer, enable));
 }
 
+void Writer::set_ref_block_flag(bool enable) {
+  auto writer = ptr.get();
+  check_error(writer, tiledb_vcf_writer_set_ref_block_flag(writer, enable));
+}
+
+void Writer::set_compact_gt(bool enable) {
+  auto writer = ptr.get();
+  check_error(writer, tiledb_vcf_writer_set_compact_gt(writer, enable));
+}
+
+void Writer::set_dictionary_encoding(bool enable) {
+  auto writer = ptr.get();
+  check_error(
+      writer, tiledb_vcf_writer_set_dictionary_encoding(writer, enable));
+}
+
+void Writer::set_adaptive_anchor_gap(bool enable) {
+  auto writer = ptr.get();
+  check_error(
+      writer, tiledb_vcf_writer_set_adaptive_anchor_gap(writer, enable));
+}
+
 void Writer::set_compression_level(int level) {
   auto writer = ptr.get();
   check_error(writer, tiledb_vcf_writer_set_compression_level(writer, level));
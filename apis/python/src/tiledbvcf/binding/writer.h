@@ -136,6 +136,27 @@ class Writer {
   */
   void set_ratio_output_flush(const float ratio_output_flush);
 
+  /**
+    [Store only] Set the number of threads used to decompress the input VCF
+    files.
+  */
+  void set_decompression_threads(const uint32_t threads);
+
+  /**
+    [Store only] Back the large worker buffers with transparent huge pages.
+  */
+  void set_huge_pages(bool enable);
+
+  /**
+    [Store only] Merge consecutive compatible gVCF reference blocks.
+  */
+  void set_merge_ref_blocks(bool enable);
+
+  /**
+    [Store only] Set the width of the GQ bands of mergeable reference blocks.
+  */
+  void set_ref_block_gq_band(const uint32_t band);
+
   /**
     [Store only] Set the max size of an ingestion task.
   */
@@ -192,6 +213,9 @@ class Writer {
   */
   std::string get_tiledb_stats();
 
+  /** Fetches TileDB-VCF metrics as JSON */
+  std::string get_metrics();
+
   /** Get Version info for TileDB VCF and TileDB. */
   std::string version();
 
@@ -200,6 +224,16 @@ class Writer {
   */
   void set_resume(const bool resume);
 
+  /**
+    [Store only] Sets the directory of ingestion checkpoints
+  */
+  void set_checkpoint_uri(const std::string& uri);
+
+  /**
+    [Store only] Sets the number of records between ingestion checkpoints
+  */
+  void set_checkpoint_records(const uint64_t records);
+
   /**
     [Store only] Sets whether to enable merging of contigs into super fragments
   */
@@ -242,6 +276,26 @@ class Writer {
   */
   void set_compress_sample_dim(bool enable);
 
+  /**
+    Enable the attribute flagging gVCF reference blocks
+  */
+  void set_ref_block_flag(bool enable);
+
+  /**
+    Enable the attribute storing GT packed into a fixed-width value
+  */
+  void set_compact_gt(bool enable);
+
+  /**
+    Enable dictionary encoding of the alleles and id attributes
+  */
+  void set_dictionary_encoding(bool enable);
+
+  /**
+    Enable choosing the anchor gap of each contig from its record lengths
+  */
+  void set_adaptive_anchor_gap(bool enable);
+
   /**
     Set zstd compression level
   */
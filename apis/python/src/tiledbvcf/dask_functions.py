@@ -71,6 +71,7 @@ def map_dask(
     regions=None,
     samples_file=None,
     bed_file=None,
+    balance_partitions=None,
 ):
     """Maps a function on a Dask dataframe obtained by reading from the dataset.
 
@@ -82,6 +83,8 @@ def map_dask(
     :return: Dask DataFrame with results
     """
     cfg = self.cfg if self.cfg is not None else ReadConfig()
+    if balance_partitions is not None:
+        cfg = cfg._replace(balance_partitions=balance_partitions)
     partitions = []
     for r in range(0, region_partitions):
         for s in range(0, sample_partitions):
@@ -121,6 +124,7 @@ def read_dask(
     regions=None,
     samples_file=None,
     bed_file=None,
+    balance_partitions=None,
 ):
     """Reads data from a TileDB-VCF into a Dask DataFrame.
 
@@ -135,6 +139,9 @@ def read_dask(
     :param int region_partition: Number of partitions over regions
     :param int sample_partition: Number of partitions over samples
     :param int limit_partitions: Maximum number of partitions to read (for testing/debugging)
+    :param bool balance_partitions: Balance partitions by the number of records
+        estimated from the fragment metadata instead of by the number of regions
+        or samples (defaults to the dataset's ReadConfig)
 
     :return: Dask DataFrame with results
     """
@@ -150,4 +157,5 @@ def read_dask(
         regions,
         samples_file,
         bed_file,
+        balance_partitions,
     )
@@ -1,3 +1,4 @@
+import json
 import os
 import shutil
 import warnings
@@ -36,6 +37,10 @@ ReadConfig = namedtuple(
         "buffer_percentage",
         # Percentage of memory to dedicate to TileDB Tile Cache (default: 10)
         "tiledb_tile_cache_percentage",
+        # Whether to balance partitions by estimated records (default False)
+        "balance_partitions",
+        # Directory where parsed BED files are cached (default None)
+        "region_index_cache",
     ],
 )
 """
@@ -59,8 +64,15 @@ buffer_percentage : int
     Percentage of memory to dedicate to TileDB Query Buffers, default 25
 tiledb_tile_cache_percentage : int
     Percentage of memory to dedicate to TileDB Tile Cache, default 10
+balance_partitions : bool
+    Whether to balance region and sample partitions by the number of records
+    estimated from the fragment metadata instead of by the number of regions or
+    samples, default False
+region_index_cache : str
+    URI of a directory where the regions parsed from BED files are cached, so
+    that partitions reading the same BED file do not each parse it, default None
 """
-ReadConfig.__new__.__defaults__ = (None,) * 8  # len(ReadConfig._fields)
+ReadConfig.__new__.__defaults__ = (None,) * 10  # len(ReadConfig._fields)
 
 
 def config_logging(level: str = "fatal", log_file: str = ""):
@@ -80,6 +92,26 @@ def config_logging(level: str = "fatal", log_file: str = ""):
     libtiledbvcf.config_logging(level, log_file)
 
 
+def enable_metrics(enabled: bool = True):
+    """
+    Enable or disable the collection of TileDB-VCF metrics. Metrics are global
+    to the process, so they cover every dataset read or written while enabled.
+
+    Parameters
+    ----------
+    enabled
+        Whether to collect metrics.
+    """
+    libtiledbvcf.metrics_enable(enabled)
+
+
+def reset_metrics():
+    """
+    Reset every TileDB-VCF metric of the process to zero.
+    """
+    libtiledbvcf.metrics_reset()
+
+
 class Dataset(object):
     """
     A class that provides read/write access to a TileDB-VCF dataset.
@@ -158,6 +190,10 @@ class Dataset(object):
             self.reader.set_sample_partition(*cfg.sample_partition)
         if cfg.sort_regions is not None:
             self.reader.set_sort_regions(cfg.sort_regions)
+        if cfg.balance_partitions is not None:
+            self.reader.set_balance_partitions(cfg.balance_partitions)
+        if cfg.region_index_cache is not None:
+            self.reader.set_region_index_cache(cfg.region_index_cache)
         if cfg.memory_budget_mb is not None:
             self.reader.set_memory_budget(cfg.memory_budget_mb)
         if cfg.buffer_percentage is not None:
@@ -230,6 +266,8 @@ class Dataset(object):
         set_af_filter: str = "",
         scan_all_samples: bool = False,
         enable_progress_estimation: bool = False,
+        filter: str = "",
+        variants_only: bool = False,
     ) -> pa.Table:
         """
         Read data from the dataset into a PyArrow Table.
@@ -260,6 +298,14 @@ class Dataset(object):
             Scan all samples when computing internal allele frequency.
         enable_progress_estimation
             **DEPRECATED** - This parameter will be removed in a future release.
+        filter
+            Filter records with predicates joined by `&&`, for example
+            "qual > 30 && filters == PASS && fmt_GQ >= 20". Predicates on
+            `qual`, `pos_start` and `pos_end` are evaluated by TileDB, the
+            others on the query results. Requires a v4 dataset.
+        variants_only
+            Skip gVCF reference blocks, i.e. records whose only ALT allele is
+            `<NON_REF>` or `<*>`. Requires a v4 dataset.
 
         Returns
         -------
@@ -283,6 +329,8 @@ class Dataset(object):
         self.reader.set_attributes(attrs)
         self.reader.set_check_samples_exist(not skip_check_samples)
         self.reader.set_af_filter(set_af_filter)
+        self.reader.set_record_filter(filter)
+        self.reader.set_variants_only(variants_only)
         self.reader.set_scan_all_samples(scan_all_samples)
         self.reader.set_enable_progress_estimation(enable_progress_estimation)
 
@@ -336,6 +384,8 @@ class Dataset(object):
         set_af_filter: str = "",
         scan_all_samples: bool = False,
         enable_progress_estimation: bool = False,
+        filter: str = "",
+        variants_only: bool = False,
     ) -> pd.DataFrame:
         """
         Read data from the dataset into a Pandas DataFrame.
@@ -366,6 +416,14 @@ class Dataset(object):
             variants with AF > 0.1, set this to ">0.1".
         enable_progress_estimation
             **DEPRECATED** - This parameter will be removed in a future release.
+        filter
+            Filter records with predicates joined by `&&`, for example
+            "qual > 30 && filters == PASS && fmt_GQ >= 20". Predicates on
+            `qual`, `pos_start` and `pos_end` are evaluated by TileDB, the
+            others on the query results. Requires a v4 dataset.
+        variants_only
+            Skip gVCF reference blocks, i.e. records whose only ALT allele is
+            `<NON_REF>` or `<*>`. Requires a v4 dataset.
 
         Returns
         -------
@@ -389,6 +447,8 @@ class Dataset(object):
         self.reader.set_attributes(attrs)
         self.reader.set_check_samples_exist(not skip_check_samples)
         self.reader.set_af_filter(set_af_filter)
+        self.reader.set_record_filter(filter)
+        self.reader.set_variants_only(variants_only)
         self.reader.set_scan_all_samples(scan_all_samples)
         self.reader.set_enable_progress_estimation(enable_progress_estimation)
 
@@ -622,6 +682,10 @@ class Dataset(object):
         enable_variant_stats: bool = True,
         enable_sample_stats: bool = True,
         compress_sample_dim: bool = True,
+        ref_block_flag: bool = True,
+        compact_gt: bool = False,
+        dictionary_encoding: bool = False,
+        adaptive_anchor_gap: bool = False,
         compression_level: int = 4,
         variant_stats_version: int = 2,
     ):
@@ -650,6 +714,21 @@ class Dataset(object):
             Enable the sample stats ingestion task.
         compress_sample_dim
             Enable compression on the sample dimension.
+        ref_block_flag
+            Store an attribute flagging gVCF reference blocks, so that
+            `variants_only` reads skip them in TileDB.
+        compact_gt
+            Store GT in a fixed-width attribute, read instead of `fmt_GT` and
+            by the AF filter. Supports a ploidy of at most 2.
+        dictionary_encoding
+            Dictionary-encode the alleles and id attributes, which repeat
+            across the samples of a site.
+        adaptive_anchor_gap
+            Choose the anchor gap of each contig from the lengths of its records
+            at each ingestion, instead of using `anchor_gap` for all contigs.
+            Contigs of long records get a large gap, which writes fewer
+            anchors, and contigs of short records a small gap, down to a
+            tenth of `anchor_gap`, which widens queries less.
         compression_level
             Compression level for zstd compression.
         variant_stats_version
@@ -693,6 +772,18 @@ class Dataset(object):
         if compress_sample_dim is not None:
             self.writer.set_compress_sample_dim(compress_sample_dim)
 
+        if ref_block_flag is not None:
+            self.writer.set_ref_block_flag(ref_block_flag)
+
+        if compact_gt is not None:
+            self.writer.set_compact_gt(compact_gt)
+
+        if dictionary_encoding is not None:
+            self.writer.set_dictionary_encoding(dictionary_encoding)
+
+        if adaptive_anchor_gap is not None:
+            self.writer.set_adaptive_anchor_gap(adaptive_anchor_gap)
+
         if compression_level is not None:
             self.writer.set_compression_level(compression_level)
 
@@ -714,10 +805,16 @@ class Dataset(object):
         avg_vcf_record_size: int = None,
         ratio_task_size: float = None,
         ratio_output_flush: float = None,
+        decompression_threads: int = None,
+        huge_pages: bool = False,
+        merge_ref_blocks: bool = False,
+        ref_block_gq_band: int = None,
         scratch_space_path: str = None,
         scratch_space_size: int = None,
         sample_batch_size: int = None,
         resume: bool = False,
+        checkpoint_uri: str = None,
+        checkpoint_records: int = None,
         contig_fragment_merging: bool = True,
         contigs_to_keep_separate: List[str] = None,
         contigs_to_allow_merging: List[str] = None,
@@ -752,6 +849,17 @@ class Dataset(object):
             Ratio of worker task size to computed task size.
         ratio_output_flush
             Ratio of output buffer capacity that triggers a flush to TileDB.
+        decompression_threads
+            Number of threads shared by all input VCF files for BGZF
+            decompression (0 = decompress on the ingestion threads).
+        huge_pages
+            Back the large attribute buffers of the ingestion threads with
+            transparent huge pages (Linux only).
+        merge_ref_blocks
+            Merge the consecutive gVCF reference blocks of a sample that have
+            the same GT and GQ band into a single record.
+        ref_block_gq_band
+            Width of the GQ bands of mergeable reference blocks (default 10).
         scratch_space_path
             Directory used for local storage of downloaded remote samples.
         scratch_space_size
@@ -761,6 +869,13 @@ class Dataset(object):
             Number of samples per batch for ingestion (default 10).
         resume
             Whether to check and attempt to resume a partial completed ingestion.
+        checkpoint_uri
+            Directory of ingestion checkpoints. Data fragments are committed
+            every `checkpoint_records` records and a resumed ingestion skips
+            exactly the committed regions.
+        checkpoint_records
+            Number of records between ingestion checkpoints (default
+            10,000,000).
         contig_fragment_merging
             Whether to enable merging of contigs into fragments. This
             overrides the contigs-to-keep-separate/contigs-to-allow-
@@ -819,6 +934,18 @@ class Dataset(object):
         if ratio_output_flush is not None:
             self.writer.set_ratio_output_flush(ratio_output_flush)
 
+        if decompression_threads is not None:
+            self.writer.set_decompression_threads(decompression_threads)
+
+        if huge_pages is not None:
+            self.writer.set_huge_pages(huge_pages)
+
+        if merge_ref_blocks is not None:
+            self.writer.set_merge_ref_blocks(merge_ref_blocks)
+
+        if ref_block_gq_band is not None:
+            self.writer.set_ref_block_gq_band(ref_block_gq_band)
+
         if thread_task_size is not None:
             self.writer.set_thread_task_size(thread_task_size)
 
@@ -841,6 +968,12 @@ class Dataset(object):
         # set whether to attempt partial sample ingestion resumption
         self.writer.set_resume(resume)
 
+        if checkpoint_uri is not None:
+            self.writer.set_checkpoint_uri(checkpoint_uri)
+
+        if checkpoint_records is not None:
+            self.writer.set_checkpoint_records(checkpoint_records)
+
         self.writer.set_contig_fragment_merging(contig_fragment_merging)
 
         if contigs_to_keep_separate is not None:
@@ -896,6 +1029,23 @@ class Dataset(object):
                 raise Exception("TileDB write stats not enabled")
             return self.writer.get_tiledb_stats()
 
+    def metrics(self) -> dict:
+        """
+        Get the TileDB-VCF metrics of the process: counters and latency
+        histograms of the ingestion and export phases. Metrics are collected
+        once enabled with ``tiledbvcf.enable_metrics()``.
+
+        Returns
+        -------
+        :
+            Metrics as a dictionary with ``counters`` and ``histograms`` keys.
+        """
+        if self.mode == "r":
+            return json.loads(self.reader.get_metrics())
+
+        if self.mode == "w":
+            return json.loads(self.writer.get_metrics())
+
     def schema_version(self) -> int:
         """
         Get the VCF schema version of the dataset.
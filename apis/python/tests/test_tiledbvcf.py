@@ -1,3 +1,4 @@
+import base64
 import math
 import numpy as np
 import subprocess
@@ -447,6 +448,229 @@ def test_read_filters(test_ds):
     )
 
 
+def test_metrics(test_ds):
+    tiledbvcf.enable_metrics()
+    tiledbvcf.reset_metrics()
+    try:
+        test_ds.read(attrs=["sample_name"], regions=["1:12700-13400"])
+        submit = test_ds.metrics()["histograms"]["export.tiledb_submit"]
+        assert submit["count"] > 0
+
+        # Reads neither reset nor disable the metrics of the process
+        test_ds.read(attrs=["sample_name"], regions=["1:12700-13400"])
+        resubmit = test_ds.metrics()["histograms"]["export.tiledb_submit"]
+        assert resubmit["count"] > submit["count"]
+    finally:
+        tiledbvcf.enable_metrics(False)
+        tiledbvcf.reset_metrics()
+
+
+def test_read_record_filter(test_ds_v4):
+    df = test_ds_v4.read(
+        attrs=["sample_name", "pos_start", "filters"],
+        regions=["1:12700-13400"],
+        filter="filters == LowQual",
+    )
+    assert list(df["sample_name"]) == ["HG00280"]
+    assert list(df["pos_start"]) == [13354]
+
+    df = test_ds_v4.read(
+        attrs=["sample_name", "pos_start"],
+        regions=["1:12700-13400"],
+        filter="filters != LowQual && pos_end > 13380",
+    ).sort_values(ignore_index=True, by=["sample_name", "pos_start"])
+    assert list(df["sample_name"]) == ["HG00280", "HG00280", "HG01762"]
+    assert list(df["pos_start"]) == [13375, 13396, 13354]
+
+    # The filter is reset by the next read
+    assert len(test_ds_v4.read(regions=["1:12700-13400"])) == 6
+
+    with pytest.raises(RuntimeError):
+        test_ds_v4.read(regions=["1:12700-13400"], filter="qual >")
+
+
+@pytest.mark.parametrize("ref_block_flag", [True, False])
+def test_read_variants_only(tmp_path, ref_block_flag):
+    uri = os.path.join(tmp_path, "dataset")
+    ds = tiledbvcf.Dataset(uri, mode="w")
+    samples = [os.path.join(TESTS_INPUT_DIR, s) for s in ["small3.bcf", "small.bcf"]]
+    ds.create_dataset(ref_block_flag=ref_block_flag)
+    ds.ingest_samples(samples)
+
+    ds = tiledbvcf.Dataset(uri, mode="r")
+    df = ds.read(attrs=["sample_name", "pos_start", "alleles"], variants_only=True)
+    assert list(df["sample_name"].unique()) == ["HG00280"]
+    assert sorted(df["pos_start"]) == [69270, 69511, 69761, 69897, 866511, 1289367]
+
+    # Reference blocks are returned by default
+    assert len(ds.read(attrs=["pos_start"])) > len(df)
+
+
+def test_read_variants_only_ref_blocks(test_ds_v4):
+    # The dataset predates the is_ref_block attribute and only has ref blocks
+    assert len(test_ds_v4.read(regions=["1:12700-13400"])) == 6
+    df = test_ds_v4.read(regions=["1:12700-13400"], variants_only=True)
+    assert len(df) == 0
+
+
+def test_ingest_merge_ref_blocks(tmp_path):
+    samples = [os.path.join(TESTS_INPUT_DIR, "small3.bcf")]
+    attrs = ["sample_name", "pos_start", "pos_end", "alleles", "fmt_GQ"]
+
+    def read(merge_ref_blocks):
+        uri = os.path.join(tmp_path, f"dataset_{merge_ref_blocks}")
+        ds = tiledbvcf.Dataset(uri, mode="w")
+        ds.create_dataset()
+        ds.ingest_samples(
+            samples, merge_ref_blocks=merge_ref_blocks, ref_block_gq_band=100
+        )
+        ds = tiledbvcf.Dataset(uri, mode="r")
+        df = ds.read(attrs=attrs)
+        df["is_ref_block"] = df["alleles"].map(
+            lambda a: list(a[1:]) == ["<NON_REF>"]
+        )
+        return df.sort_values(ignore_index=True, by=["sample_name", "pos_start"])
+
+    def coverage(df):
+        intervals = []
+        for start, end in zip(df["pos_start"], df["pos_end"]):
+            if intervals and start <= intervals[-1][1] + 1:
+                intervals[-1][1] = max(intervals[-1][1], end)
+            else:
+                intervals.append([start, end])
+        return intervals
+
+    expected = read(False)
+    actual = read(True)
+    assert len(actual) < len(expected)
+
+    # Variants are unchanged and the merged blocks cover the same positions
+    variants = ["sample_name", "pos_start", "pos_end"]
+    _check_dfs(
+        expected[~expected["is_ref_block"]][variants].reset_index(drop=True),
+        actual[~actual["is_ref_block"]][variants].reset_index(drop=True),
+    )
+    assert coverage(actual) == coverage(expected)
+
+    # The merged block keeps the minimum GQ of its blocks
+    block = actual[actual["pos_start"] == 13354]
+    assert list(block["pos_end"]) == [13689]
+    assert list(block["fmt_GQ"]) == [0]
+
+
+def _check_option_preserves_reads(tmp_path, option, ingestions, read, **create_args):
+    """
+    Ingests each list of `ingestions` in turn into a dataset created without
+    `option` and into one created with it. Checks that every data frame
+    returned by `read` is non-empty and the same for both datasets, and
+    returns the URIs of their data arrays, without the option first.
+    """
+    uris, results = [], []
+    for enabled in [False, True]:
+        uri = os.path.join(tmp_path, f"{option}_{enabled}")
+        ds = tiledbvcf.Dataset(uri, mode="w")
+        ds.create_dataset(**create_args, **{option: enabled})
+        for samples in ingestions:
+            ds.ingest_samples([os.path.join(TESTS_INPUT_DIR, s) for s in samples])
+
+        results.append(read(tiledbvcf.Dataset(uri, mode="r")))
+        uris.append(os.path.join(uri, "data"))
+
+    check_if_compatible(uris[0])
+    for expected, actual in zip(*results):
+        assert len(actual) > 0
+        _check_dfs(expected, actual)
+    return uris
+
+
+def _csv_metadata(array, key):
+    """Decodes a base64 encoded CSV list from the metadata of an array."""
+    return [v for v in base64.b64decode(array.meta[key]).decode().split(",") if v]
+
+
+def test_read_compact_gt(tmp_path):
+    attrs = ["sample_name", "pos_start", "fmt_GT"]
+
+    def read(ds):
+        dfs = [ds.read(attrs=attrs), ds.read(attrs=attrs, set_af_filter="<0.8")]
+        for df in dfs:
+            df["fmt_GT"] = df["fmt_GT"].map(list)
+        return [df.sort_values(ignore_index=True, by=attrs[:2]) for df in dfs]
+
+    uris = _check_option_preserves_reads(
+        tmp_path, "compact_gt", [["small.bcf", "small2.bcf"]], read
+    )
+
+    # GT is packed into the genotype attribute instead of being materialized
+    for uri, compact_gt in zip(uris, [False, True]):
+        with tiledb.open(uri) as A:
+            assert A.schema.has_attr("genotype") == compact_gt
+            extra_attrs = _csv_metadata(A, "extra_attributes")
+            assert ("fmt_GT" in extra_attrs) != compact_gt
+
+
+def test_read_dictionary_encoding(tmp_path):
+    attrs = ["sample_name", "pos_start", "alleles", "id", "fmt_GT"]
+
+    def read(ds):
+        dfs = [ds.read(attrs=attrs), ds.read(attrs=attrs, set_af_filter="<0.8")]
+        for df in dfs:
+            for attr in ["alleles", "fmt_GT"]:
+                df[attr] = df[attr].map(list)
+        return [df.sort_values(ignore_index=True, by=attrs[:2]) for df in dfs]
+
+    uris = _check_option_preserves_reads(
+        tmp_path, "dictionary_encoding", [["small.bcf", "small2.bcf"]], read
+    )
+
+    for uri, dictionary_encoding in zip(uris, [False, True]):
+        with tiledb.open(uri) as A:
+            for attr in ["alleles", "id"]:
+                filters = A.schema.attr(attr).filters
+                found = any("Dictionary" in str(f) for f in filters)
+                assert found == dictionary_encoding
+
+
+def test_read_adaptive_anchor_gap(tmp_path):
+    attrs = ["sample_name", "pos_start", "pos_end"]
+    regions = ["1:12200-12300", "1:13500-13600", "1:69100-69200", "1:70000-71000"]
+    # Narrow regions at the ends of records a few hundred bases long
+    narrow_regions = ["1:12765-12770", "1:35525-35530", "1:69755-69760"]
+
+    def read(ds):
+        dfs = [
+            ds.read(attrs=attrs),
+            ds.read(attrs=attrs, regions=regions),
+            ds.read(attrs=attrs, regions=narrow_regions),
+        ]
+        return [df.sort_values(ignore_index=True, by=attrs) for df in dfs]
+
+    anchor_gap = 10
+    uris = _check_option_preserves_reads(
+        tmp_path,
+        "adaptive_anchor_gap",
+        [["small3.bcf"], ["small.bcf"]],
+        read,
+        anchor_gap=anchor_gap,
+    )
+
+    # Each ingestion records the gaps it chose for its own records, under its
+    # own key; readers use the largest gap of each contig.
+    with tiledb.open(uris[1]) as A:
+        keys = [k for k in A.meta.keys() if k.startswith("contig_anchor_gaps")]
+        assert len(keys) > 0
+        gaps = {}
+        for key in keys:
+            for pair in _csv_metadata(A, key):
+                contig, gap = pair.split("\t")
+                gaps[contig] = max(gaps.get(contig, 0), int(gap))
+    assert gaps["1"] != anchor_gap
+
+    # The long records are found from regions far from their start
+    df = read(tiledbvcf.Dataset(os.path.dirname(uris[1]), mode="r"))[2]
+    assert {12546, 35227, 69512}.issubset(set(df["pos_start"]))
+
+
 def test_read_var_length_filters(tmp_path):
     uri = os.path.join(tmp_path, "dataset")
     ds = tiledbvcf.Dataset(uri, mode="w")
@@ -1182,6 +1406,22 @@ def test_ingest_merging_separate(tmp_path):
     assert ds.count(regions=["chrX:9032893-9032893"]) == 1
 
 
+def test_ingest_decompression_threads(tmp_path):
+    # Create the dataset
+    uri = os.path.join(tmp_path, "dataset_decompression_threads")
+    ds = tiledbvcf.Dataset(uri, mode="w")
+    samples = [
+        os.path.join(TESTS_INPUT_DIR, s) for s in ["v2-DjrIAzkP-downsampled.vcf.gz"]
+    ]
+    ds.create_dataset()
+    ds.ingest_samples(samples, decompression_threads=2)
+
+    # Open it back in read mode and check some queries
+    ds = tiledbvcf.Dataset(uri, mode="r")
+    assert ds.count() == 246
+    assert ds.count(regions=["chrX:9032893-9032893"]) == 1
+
+
 def test_ingest_merging(tmp_path):
     # Create the dataset
     uri = os.path.join(tmp_path, "dataset_merging")
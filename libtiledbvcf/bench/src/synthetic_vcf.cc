@@ -0,0 +1,243 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
+#include <iterator>
+#include <stdexcept>
+
+#include "src/synthetic_vcf.h"
+#include "utils/logger_public.h"
+#include "utils/utils.h"
+
+namespace tiledb {
+namespace vcf {
+namespace bench {
+
+namespace {
+
+/** SplitMix64: small, fast and identical on every platform. */
+class Random {
+ public:
+  explicit Random(uint64_t seed)
+      : state_(seed) {
+  }
+
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  /** Returns an integer in [0, n). */
+  uint64_t below(uint64_t n) {
+    return next() % n;
+  }
+
+  /** Returns a double in [0, 1). */
+  double uniform() {
+    return (next() >> 11) * (1.0 / (1ULL << 53));
+  }
+
+ private:
+  uint64_t state_;
+};
+
+const char bases[] = {'A', 'C', 'G', 'T'};
+
+}  // namespace
+
+SyntheticVCF::SyntheticVCF(const SyntheticVCFParams& params)
+    : params_(params) {
+  if (params_.num_samples == 0 || params_.num_contigs == 0 ||
+      params_.records_per_contig == 0)
+    throw std::invalid_argument(
+        "Error generating synthetic VCF; samples, contigs and records per "
+        "contig must be greater than 0");
+  if (params_.records_per_contig * slot_size >= UINT32_MAX)
+    throw std::invalid_argument(
+        "Error generating synthetic VCF; too many records per contig");
+}
+
+std::vector<std::string> SyntheticVCF::contigs() const {
+  std::vector<std::string> result;
+  for (unsigned i = 0; i < params_.num_contigs; i++)
+    result.push_back("chr" + std::to_string(i + 1));
+  return result;
+}
+
+uint32_t SyntheticVCF::contig_length() const {
+  return params_.records_per_contig * slot_size;
+}
+
+std::string SyntheticVCF::sample_name(unsigned sample) {
+  return fmt::format("S{:06}", sample);
+}
+
+uint64_t SyntheticVCF::num_records() const {
+  return params_.num_samples * params_.num_contigs *
+         params_.records_per_contig;
+}
+
+std::vector<std::string> SyntheticVCF::write(const std::string& dir) const {
+  std::vector<std::string> result;
+  for (unsigned i = 0; i < params_.num_samples; i++) {
+    const std::string path =
+        utils::uri_join(dir, sample_name(i) + ".vcf.gz");
+    write_sample(i, path);
+    result.push_back(path);
+  }
+  return result;
+}
+
+std::string SyntheticVCF::header(unsigned sample) const {
+  std::string result = "##fileformat=VCFv4.2\n";
+  result += "##FILTER=<ID=PASS,Description=\"All filters passed\">\n";
+  for (const auto& contig : contigs())
+    result +=
+        fmt::format("##contig=<ID={},length={}>\n", contig, contig_length());
+  if (params_.ref_block_ratio > 0)
+    result +=
+        "##ALT=<ID=NON_REF,Description=\"Represents any possible "
+        "alternative allele\">\n";
+  result +=
+      "##INFO=<ID=END,Number=1,Type=Integer,Description=\"End position of "
+      "the reference block\">\n";
+  for (unsigned i = 0; i < params_.info_fields; i++)
+    result += fmt::format(
+        "##INFO=<ID=I{},Number=1,Type=Integer,Description=\"Synthetic\">\n", i);
+  result +=
+      "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+      "##FORMAT=<ID=DP,Number=1,Type=Integer,Description=\"Depth\">\n"
+      "##FORMAT=<ID=GQ,Number=1,Type=Integer,Description=\"Genotype "
+      "quality\">\n"
+      "##FORMAT=<ID=MIN_DP,Number=1,Type=Integer,Description=\"Minimum "
+      "depth of the reference block\">\n";
+  for (unsigned i = 0; i < params_.fmt_fields; i++)
+    result += fmt::format(
+        "##FORMAT=<ID=F{},Number=1,Type=Integer,Description=\"Synthetic\">\n",
+        i);
+  result += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" +
+            sample_name(sample) + "\n";
+  return result;
+}
+
+void SyntheticVCF::write_sample(unsigned sample, const std::string& path)
+    const {
+  // Each sample has its own stream, so files can be generated in any order
+  Random random(params_.seed * 0x100000001b3ULL + sample);
+  const bool gvcf = params_.ref_block_ratio > 0;
+
+  BGZF* fp = bgzf_open(path.c_str(), "w");
+  if (fp == nullptr)
+    throw std::runtime_error(
+        "Error generating synthetic VCF; cannot open '" + path + "'");
+
+  std::string buffer = header(sample);
+  auto flush = [&]() {
+    if (bgzf_write(fp, buffer.data(), buffer.size()) < 0) {
+      bgzf_close(fp);
+      throw std::runtime_error(
+          "Error generating synthetic VCF; write to '" + path + "' failed");
+    }
+    buffer.clear();
+  };
+
+  std::string format = "GT:DP:GQ:MIN_DP";
+  for (unsigned i = 0; i < params_.fmt_fields; i++)
+    format += ":F" + std::to_string(i);
+
+  for (const auto& contig : contigs()) {
+    for (uint64_t r = 0; r < params_.records_per_contig; r++) {
+      const uint64_t pos = r * slot_size + 1;
+      const uint64_t ref = random.below(4);
+      const bool ref_block = random.uniform() < params_.ref_block_ratio;
+      const uint64_t dp = 10 + random.below(50);
+      const uint64_t gq = random.below(100);
+
+      std::string info, gt, alt, min_dp = ".";
+      if (ref_block) {
+        const uint64_t end = pos + random.below(slot_size);
+        alt = "<NON_REF>";
+        info = "END=" + std::to_string(end);
+        gt = "0/0";
+        min_dp = std::to_string(dp - random.below(10));
+      } else {
+        // Non-zero, distinct shifts keep the ALTs apart from REF and each other
+        const uint64_t shift = 1 + random.below(3);
+        alt = bases[(ref + shift) % 4];
+        if (random.uniform() < params_.multiallelic_rate) {
+          alt += ',';
+          alt += bases[(ref + shift % 3 + 1) % 4];
+          gt = "1/2";
+        } else {
+          gt = random.below(2) ? "0/1" : "1/1";
+        }
+        if (gvcf)
+          alt += ",<NON_REF>";
+      }
+
+      for (unsigned i = 0; i < params_.info_fields; i++) {
+        if (!info.empty())
+          info += ';';
+        info += fmt::format("I{}={}", i, random.below(1000));
+      }
+      if (info.empty())
+        info = ".";
+
+      std::string values = fmt::format("{}:{}:{}:{}", gt, dp, gq, min_dp);
+      for (unsigned i = 0; i < params_.fmt_fields; i++)
+        values += ":" + std::to_string(random.below(1000));
+
+      fmt::format_to(
+          std::back_inserter(buffer),
+          "{}\t{}\t.\t{}\t{}\t{}\tPASS\t{}\t{}\t{}\n",
+          contig,
+          pos,
+          bases[ref],
+          alt,
+          ref_block ? std::string(".") : std::to_string(random.below(1000)),
+          info,
+          format,
+          values);
+      if (buffer.size() > (1 << 20))
+        flush();
+    }
+  }
+  flush();
+
+  if (bgzf_close(fp) < 0)
+    throw std::runtime_error(
+        "Error generating synthetic VCF; cannot close '" + path + "'");
+  if (tbx_index_build(path.c_str(), 0, &tbx_conf_vcf) < 0)
+    throw std::runtime_error(
+        "Error generating synthetic VCF; cannot index '" + path + "'");
+}
+
+}  // namespace bench
+}  // namespace vcf
+}  // namespace tiledb
@@ -0,0 +1,109 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_BENCH_SYNTHETIC_VCF_H
+#define TILEDB_VCF_BENCH_SYNTHETIC_VCF_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tiledb {
+namespace vcf {
+namespace bench {
+
+/** Shape of the synthetic VCF files. */
+struct SyntheticVCFParams {
+  /** Number of single-sample files */
+  unsigned num_samples = 10;
+  /** Number of contigs in each file */
+  unsigned num_contigs = 2;
+  /** Number of records in each contig of each file */
+  uint64_t records_per_contig = 10000;
+  /** Fraction of records that are gVCF reference blocks (0 = plain VCF) */
+  double ref_block_ratio = 0;
+  /** Number of extra integer INFO fields */
+  unsigned info_fields = 2;
+  /** Number of extra integer FORMAT fields */
+  unsigned fmt_fields = 2;
+  /** Fraction of variant records with two ALT alleles */
+  double multiallelic_rate = 0.1;
+  /** Seed of the generator. The same seed gives the same files. */
+  uint64_t seed = 1;
+};
+
+/**
+ * Deterministic generator of bgzipped, tabix-indexed single-sample VCF files.
+ *
+ * Each contig is cut into slots of a fixed number of positions and each
+ * record starts a slot: reference blocks span part of their slot through
+ * INFO/END, variants have a single base REF. Random draws use only the raw
+ * output of a fixed PRNG, so the files do not depend on the standard library
+ * implementation.
+ */
+class SyntheticVCF {
+ public:
+  /** Positions per record slot */
+  static const uint32_t slot_size = 100;
+
+  explicit SyntheticVCF(const SyntheticVCFParams& params);
+
+  /** Returns the contig names. */
+  std::vector<std::string> contigs() const;
+
+  /** Returns the length of every contig. */
+  uint32_t contig_length() const;
+
+  /** Returns the name of the sample in the file with the given index. */
+  static std::string sample_name(unsigned sample);
+
+  /**
+   * Writes the files to `dir`, which must exist, as `<sample>.vcf.gz` with a
+   * `.tbi` index.
+   *
+   * @param dir Local output directory
+   * @return Paths of the files, in sample order
+   */
+  std::vector<std::string> write(const std::string& dir) const;
+
+  /** Returns the total number of records in the files. */
+  uint64_t num_records() const;
+
+ private:
+  SyntheticVCFParams params_;
+
+  /** Writes the file of one sample. */
+  void write_sample(unsigned sample, const std::string& path) const;
+
+  /** Returns the VCF header of one sample. */
+  std::string header(unsigned sample) const;
+};
+
+}  // namespace bench
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_BENCH_SYNTHETIC_VCF_H
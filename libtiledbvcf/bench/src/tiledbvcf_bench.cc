@@ -0,0 +1,355 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <tiledb/tiledb>
+
+#if !defined _MSC_VER
+#include <sys/resource.h>
+#endif
+
+#include "dataset/tiledbvcfdataset.h"
+#include "read/reader.h"
+#include "src/synthetic_vcf.h"
+#include "utils/logger_public.h"
+#include "utils/utils.h"
+#include "write/writer.h"
+
+using namespace tiledb::vcf;
+using namespace tiledb::vcf::bench;
+
+namespace {
+
+/** Benchmark options. */
+struct BenchParams {
+  std::string dir = "tiledbvcf-bench";
+  std::string output;
+  std::string log_level = "warn";
+  SyntheticVCFParams vcf;
+  unsigned threads = std::thread::hardware_concurrency();
+  unsigned sample_batch_size = 10;
+  unsigned num_regions = 100;
+  uint32_t region_size = 10000;
+  unsigned buffer_mb = 64;
+  bool keep = false;
+};
+
+/** Timing of one phase. */
+struct Phase {
+  std::string name;
+  double seconds;
+  uint64_t records;
+  double peak_rss_mb;
+};
+
+/** Returns the peak resident set size of the process in MiB. */
+double peak_rss_mb() {
+#if defined _MSC_VER
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+  return usage.ru_maxrss / 1024.0;  // KiB
+#endif
+#endif
+}
+
+/** Runs `fn`, which returns a record count, and records it as a phase. */
+template <typename F>
+void run_phase(const std::string& name, F fn, std::vector<Phase>* phases) {
+  LOG_INFO("[bench] Starting phase '{}'", name);
+  auto start = std::chrono::steady_clock::now();
+  const uint64_t records = fn();
+  phases->push_back(
+      {name, utils::chrono_duration(start), records, peak_rss_mb()});
+  LOG_INFO(
+      "[bench] Finished phase '{}': {} records in {:.3f} sec",
+      name,
+      records,
+      phases->back().seconds);
+}
+
+/** Exports the given regions of all samples, returns the record count. */
+uint64_t export_regions(
+    const BenchParams& params,
+    const std::string& dataset_uri,
+    const std::vector<std::string>& regions) {
+  // Split the buffer budget between the exported attributes
+  const size_t buffer_bytes = params.buffer_mb * 1024 * 1024 / 5;
+  std::vector<char> sample_name(buffer_bytes), contig(buffer_bytes),
+      gt(buffer_bytes);
+  std::vector<uint32_t> start(buffer_bytes / sizeof(uint32_t)),
+      end(buffer_bytes / sizeof(uint32_t));
+  std::vector<int32_t> sample_name_offsets(start.size() + 1),
+      contig_offsets(start.size() + 1), gt_offsets(start.size() + 1);
+
+  Reader reader;
+  auto set_var = [&reader](
+                     const std::string& name,
+                     std::vector<char>& values,
+                     std::vector<int32_t>& offsets) {
+    reader.set_buffer_values(name, values.data(), values.size());
+    reader.set_buffer_offsets(
+        name, offsets.data(), offsets.size() * sizeof(int32_t));
+  };
+  set_var("sample_name", sample_name, sample_name_offsets);
+  set_var("contig", contig, contig_offsets);
+  set_var("fmt_GT", gt, gt_offsets);
+  reader.set_buffer_values(
+      "pos_start", start.data(), start.size() * sizeof(uint32_t));
+  reader.set_buffer_values(
+      "pos_end", end.data(), end.size() * sizeof(uint32_t));
+
+  ExportParams export_params;
+  export_params.uri = dataset_uri;
+  export_params.regions = regions;
+  export_params.log_level = params.log_level;
+  reader.set_all_params(export_params);
+  reader.open_dataset(dataset_uri);
+
+  uint64_t records = 0;
+  do {
+    reader.read();
+    records += reader.num_records_exported();
+  } while (reader.read_status() == ReadStatus::INCOMPLETE);
+  if (reader.read_status() != ReadStatus::COMPLETED)
+    throw std::runtime_error("Error exporting benchmark regions");
+  return records;
+}
+
+/** Returns the benchmark results as JSON. */
+std::string to_json(
+    const BenchParams& params,
+    const SyntheticVCF& vcf,
+    const std::vector<Phase>& phases) {
+  std::string result = "{\n";
+  result += fmt::format(
+      "  \"version\": \"{}\",\n", utils::split(utils::version_info(), "\n")[0]);
+  result += fmt::format(
+      "  \"config\": {{\"samples\": {}, \"contigs\": {}, "
+      "\"records_per_contig\": {}, \"ref_block_ratio\": {}, "
+      "\"info_fields\": {}, \"fmt_fields\": {}, \"multiallelic_rate\": {}, "
+      "\"seed\": {}, \"threads\": {}, \"sample_batch_size\": {}, "
+      "\"regions\": {}, \"region_size\": {}, \"buffer_mb\": {}}},\n",
+      params.vcf.num_samples,
+      params.vcf.num_contigs,
+      params.vcf.records_per_contig,
+      params.vcf.ref_block_ratio,
+      params.vcf.info_fields,
+      params.vcf.fmt_fields,
+      params.vcf.multiallelic_rate,
+      params.vcf.seed,
+      params.threads,
+      params.sample_batch_size,
+      params.num_regions,
+      params.region_size,
+      params.buffer_mb);
+  result += fmt::format("  \"vcf_records\": {},\n", vcf.num_records());
+  result += "  \"phases\": [\n";
+  for (size_t i = 0; i < phases.size(); i++) {
+    const auto& phase = phases[i];
+    result += fmt::format(
+        "    {{\"name\": \"{}\", \"seconds\": {:.6f}, \"records\": {}, "
+        "\"records_per_sec\": {:.1f}, \"peak_rss_mb\": {:.1f}}}{}\n",
+        phase.name,
+        phase.seconds,
+        phase.records,
+        phase.seconds > 0 ? phase.records / phase.seconds : 0,
+        phase.peak_rss_mb,
+        i + 1 < phases.size() ? "," : "");
+  }
+  result += "  ],\n";
+  result += fmt::format("  \"peak_rss_mb\": {:.1f}\n", peak_rss_mb());
+  result += "}\n";
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchParams params;
+  CLI::App app{
+      "tiledbvcf-bench -- Ingestion and export benchmark on synthetic VCF "
+      "files.\n\n"
+      "  Generates deterministic single-sample VCF files, ingests them into a "
+      "new\n"
+      "  dataset, exports it and prints the timing of each phase as JSON."};
+  app.option_defaults()->always_capture_default();
+
+  app.option_defaults()->group("Synthetic VCF options");
+  app.add_option("--samples", params.vcf.num_samples, "Number of samples");
+  app.add_option("--contigs", params.vcf.num_contigs, "Number of contigs");
+  app.add_option(
+      "--records-per-contig",
+      params.vcf.records_per_contig,
+      "Number of records per contig and sample");
+  app.add_option(
+         "--ref-block-ratio",
+         params.vcf.ref_block_ratio,
+         "Fraction of gVCF reference block records (0 = plain VCF)")
+      ->check(CLI::Range(0.0, 1.0));
+  app.add_option(
+      "--info-fields",
+      params.vcf.info_fields,
+      "Number of extra INFO fields per record");
+  app.add_option(
+      "--fmt-fields",
+      params.vcf.fmt_fields,
+      "Number of extra FORMAT fields per record");
+  app.add_option(
+         "--multiallelic-rate",
+         params.vcf.multiallelic_rate,
+         "Fraction of variant records with two ALT alleles")
+      ->check(CLI::Range(0.0, 1.0));
+  app.add_option("--seed", params.vcf.seed, "Seed of the generator");
+
+  app.option_defaults()->group("Benchmark options");
+  app.add_option(
+      "-d,--dir", params.dir, "Local working directory, replaced if present");
+  app.add_option("-t,--threads", params.threads, "Number of ingestion threads");
+  app.add_option(
+      "-e,--sample-batch-size",
+      params.sample_batch_size,
+      "Number of samples per ingestion batch");
+  app.add_option(
+      "--regions",
+      params.num_regions,
+      "Number of random regions in the region export phase");
+  app.add_option(
+      "--region-size", params.region_size, "Size of the exported regions");
+  app.add_option(
+      "--buffer-mb", params.buffer_mb, "Size of the export buffers (MiB)");
+  app.add_option(
+      "-o,--output", params.output, "Write the JSON results to this file");
+  app.add_option("--log-level", params.log_level, "Log level");
+  app.add_flag("--keep", params.keep, "Keep the VCF files and the dataset");
+
+  CLI11_PARSE(app, argc, argv);
+  LOG_CONFIG(params.log_level);
+
+  try {
+    tiledb::Context ctx;
+    tiledb::VFS vfs(ctx);
+    if (vfs.is_dir(params.dir))
+      vfs.remove_dir(params.dir);
+    const std::string vcf_dir = utils::uri_join(params.dir, "vcf");
+    const std::string dataset_uri = utils::uri_join(params.dir, "dataset");
+    vfs.create_dir(params.dir);
+    vfs.create_dir(vcf_dir);
+
+    SyntheticVCF vcf(params.vcf);
+    std::vector<Phase> phases;
+    std::vector<std::string> sample_uris;
+
+    run_phase(
+        "generate",
+        [&]() {
+          sample_uris = vcf.write(vcf_dir);
+          return vcf.num_records();
+        },
+        &phases);
+
+    run_phase(
+        "ingest",
+        [&]() {
+          CreationParams create_params;
+          create_params.uri = dataset_uri;
+          create_params.log_level = params.log_level;
+          TileDBVCFDataset::create(create_params);
+
+          Writer writer;
+          IngestionParams ingest_params;
+          ingest_params.uri = dataset_uri;
+          ingest_params.log_level = params.log_level;
+          ingest_params.sample_uris = sample_uris;
+          ingest_params.num_threads = params.threads;
+          ingest_params.sample_batch_size = params.sample_batch_size;
+          writer.set_all_params(ingest_params);
+          writer.ingest_samples();
+          return vcf.num_records();
+        },
+        &phases);
+
+    run_phase(
+        "export_all",
+        [&]() {
+          std::vector<std::string> regions;
+          for (const auto& contig : vcf.contigs())
+            regions.push_back(
+                fmt::format("{}:1-{}", contig, vcf.contig_length()));
+          return export_regions(params, dataset_uri, regions);
+        },
+        &phases);
+
+    run_phase(
+        "export_regions",
+        [&]() {
+          // Same seed, same regions
+          std::mt19937_64 random(params.vcf.seed);
+          const auto contigs = vcf.contigs();
+          const uint32_t size =
+              std::min(params.region_size, vcf.contig_length());
+          std::vector<std::string> regions;
+          for (unsigned i = 0; i < params.num_regions; i++) {
+            const auto& contig = contigs[random() % contigs.size()];
+            const uint32_t start =
+                1 + random() % (vcf.contig_length() - size + 1);
+            regions.push_back(
+                fmt::format("{}:{}-{}", contig, start, start + size - 1));
+          }
+          return export_regions(params, dataset_uri, regions);
+        },
+        &phases);
+
+    const std::string json = to_json(params, vcf, phases);
+    if (params.output.empty()) {
+      std::cout << json;
+    } else {
+      std::ofstream os(params.output);
+      os << json;
+      if (!os.good())
+        throw std::runtime_error(
+            "Error writing benchmark results to '" + params.output + "'");
+    }
+
+    if (!params.keep)
+      vfs.remove_dir(params.dir);
+  } catch (const std::exception& e) {
+    LOG_FATAL("[bench] {}", e.what());
+  }
+
+  return 0;
+}
@@ -33,6 +33,7 @@
 #include "c_api/tiledbvcf.h"
 #include "read/reader.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/utils.h"
 #include "vcf/bed_file.h"
 #include "write/writer.h"
@@ -66,6 +67,11 @@ struct tiledb_vcf_bed_file_t {
   std::string saved_errmsg_;
 };
 
+struct tiledb_vcf_dataset_handle_t {
+  std::shared_ptr<tiledb::vcf::DatasetHandle> handle_;
+  std::string saved_errmsg_;
+};
+
 /* ********************************* */
 /*             HELPERS               */
 /* ********************************* */
@@ -86,6 +92,12 @@ static void save_error(tiledb_vcf_writer_t* writer, const std::string& error) {
   writer->saved_errmsg_ = error;
 }
 
+static void save_error(
+    tiledb_vcf_dataset_handle_t* handle, const std::string& error) {
+  LOG_ERROR(error);
+  handle->saved_errmsg_ = error;
+}
+
 /**
  * Helper macro that executes the given statement, catching all exceptions and
  * saving the error message.
@@ -125,6 +137,15 @@ inline int32_t sanity_check(const tiledb_vcf_bed_file_t* bed_file) {
   return TILEDB_VCF_OK;
 }
 
+inline int32_t sanity_check(const tiledb_vcf_dataset_handle_t* handle) {
+  if (handle == nullptr) {
+    std::string err = "Invalid TileDB VCF dataset handle object";
+    LOG_ERROR(err);
+    return TILEDB_VCF_ERR;
+  }
+  return TILEDB_VCF_OK;
+}
+
 inline int32_t sanity_check(const tiledb_vcf_writer_t* writer) {
   if (writer == nullptr || writer->writer_ == nullptr) {
     std::string err = "Invalid TileDB VCF writer object";
@@ -147,6 +168,14 @@ void tiledb_vcf_config_logging(const char* level, const char* logfile) {
   LOG_CONFIG(level, logfile);
 }
 
+void tiledb_vcf_metrics_enable(bool enabled) {
+  tiledb::vcf::metrics::enable(enabled);
+}
+
+void tiledb_vcf_metrics_reset() {
+  tiledb::vcf::metrics::reset();
+}
+
 /* ********************************* */
 /*              READER               */
 /* ********************************* */
@@ -206,6 +235,19 @@ int32_t tiledb_vcf_reader_init(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_init_from_handle(
+    tiledb_vcf_reader_t* reader, tiledb_vcf_dataset_handle_t* handle) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR ||
+      sanity_check(handle) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->open_dataset(handle->handle_)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_reader_set_samples_file(
     tiledb_vcf_reader_t* reader, const char* uri) {
   if (sanity_check(reader) == TILEDB_VCF_ERR || uri == nullptr)
@@ -228,6 +270,17 @@ int32_t tiledb_vcf_reader_set_bed_file(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_set_region_index_cache(
+    tiledb_vcf_reader_t* reader, const char* uri) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR || uri == nullptr)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(reader, reader->reader_->set_region_index_cache(uri)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_reader_set_samples(
     tiledb_vcf_reader_t* reader, const char* samples) {
   if (sanity_check(reader) == TILEDB_VCF_ERR || samples == nullptr)
@@ -262,6 +315,18 @@ int32_t tiledb_vcf_reader_set_sort_regions(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_set_balance_partitions(
+    tiledb_vcf_reader_t* reader, bool balance_partitions) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->set_balance_partitions(balance_partitions)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_reader_set_region_partition(
     tiledb_vcf_reader_t* reader, int32_t partition, int32_t num_partitions) {
   if (sanity_check(reader) == TILEDB_VCF_ERR)
@@ -448,6 +513,17 @@ int32_t tiledb_vcf_reader_get_tiledb_stats(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_get_metrics(
+    tiledb_vcf_reader_t* reader, const char** metrics) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(reader, reader->reader_->metrics(metrics)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_get_af_filter_exists(
     tiledb_vcf_reader_t* reader, bool* present) {
   if (sanity_check(reader) == TILEDB_VCF_ERR || present == nullptr)
@@ -468,12 +544,50 @@ int32_t tiledb_vcf_reader_read(tiledb_vcf_reader_t* reader) {
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_read_arrow(
+    tiledb_vcf_reader_t* reader,
+    const char** attributes,
+    int32_t num_attributes,
+    struct ArrowArray* array,
+    struct ArrowSchema* schema) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR || attributes == nullptr ||
+      num_attributes < 0)
+    return TILEDB_VCF_ERR;
+
+  std::vector<std::string> attrs(attributes, attributes + num_attributes);
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->read_arrow(attrs, array, schema)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_reader_next_batch(
+    tiledb_vcf_reader_t* reader,
+    const char** attributes,
+    int32_t num_attributes,
+    struct ArrowArray* array,
+    struct ArrowSchema* schema) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR || attributes == nullptr ||
+      num_attributes < 0)
+    return TILEDB_VCF_ERR;
+
+  std::vector<std::string> attrs(attributes, attributes + num_attributes);
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->next_batch(attrs, array, schema)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_reader_get_status(
     tiledb_vcf_reader_t* reader, tiledb_vcf_read_status_t* status) {
   if (sanity_check(reader) == TILEDB_VCF_ERR || status == nullptr)
     return TILEDB_VCF_ERR;
 
-  tiledb::vcf::ReadStatus st = reader->reader_->read_status();
+  tiledb::vcf::ReadStatus st = tiledb::vcf::ReadStatus::FAILED;
+  if (SAVE_ERROR_CATCH(reader, st = reader->reader_->read_status()))
+    return TILEDB_VCF_ERR;
   *status = static_cast<tiledb_vcf_read_status_t>(st);
 
   return TILEDB_VCF_OK;
@@ -484,7 +598,9 @@ int32_t tiledb_vcf_reader_get_result_num_records(
   if (sanity_check(reader) == TILEDB_VCF_ERR || num_records == nullptr)
     return TILEDB_VCF_ERR;
 
-  *num_records = reader->reader_->num_records_exported();
+  if (SAVE_ERROR_CATCH(
+          reader, *num_records = reader->reader_->num_records_exported()))
+    return TILEDB_VCF_ERR;
 
   return TILEDB_VCF_OK;
 }
@@ -809,6 +925,41 @@ int32_t tiledb_vcf_reader_set_buffer_percentage(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_set_buffer_autotune(
+    tiledb_vcf_reader_t* reader, const bool buffer_autotune) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->set_buffer_autotune(buffer_autotune)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_reader_set_batch_queue_depth(
+    tiledb_vcf_reader_t* reader, int32_t queue_depth) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->set_batch_queue_depth(queue_depth)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_reader_get_buffer_autotune_stats(
+    tiledb_vcf_reader_t* reader, const char** stats) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR || stats == nullptr)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(reader, reader->reader_->buffer_autotune_stats(stats)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_reader_set_tiledb_tile_cache_percentage(
     tiledb_vcf_reader_t* reader, const float tile_percentage) {
   if (sanity_check(reader) == TILEDB_VCF_ERR)
@@ -942,6 +1093,30 @@ int32_t tiledb_vcf_reader_set_af_filter(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_reader_set_record_filter(
+    tiledb_vcf_reader_t* reader, const char* record_filter) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->set_record_filter(record_filter)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_reader_set_variants_only(
+    tiledb_vcf_reader_t* reader, bool variants_only) {
+  if (sanity_check(reader) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          reader, reader->reader_->set_variants_only(variants_only)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_reader_set_scan_all_samples(
     tiledb_vcf_reader_t* reader, bool scan_all_samples) {
   if (sanity_check(reader) == TILEDB_VCF_ERR)
@@ -1079,6 +1254,88 @@ int32_t tiledb_vcf_reader_read_from_allele_count(
   return TILEDB_VCF_OK;
 }
 
+/* ********************************* */
+/*          DATASET HANDLE           */
+/* ********************************* */
+
+int32_t tiledb_vcf_dataset_handle_alloc(tiledb_vcf_dataset_handle_t** handle) {
+  if (handle == nullptr) {
+    std::string err("Null pointer given for TileDB-VCF dataset handle object");
+    LOG_ERROR(err);
+    return TILEDB_VCF_ERR;
+  }
+
+  *handle = new (std::nothrow) tiledb_vcf_dataset_handle_t;
+  if (*handle == nullptr) {
+    std::string err("Failed to allocate TileDB-VCF dataset handle object");
+    LOG_ERROR(err);
+    return TILEDB_VCF_ERR;
+  }
+
+  return TILEDB_VCF_OK;
+}
+
+void tiledb_vcf_dataset_handle_free(tiledb_vcf_dataset_handle_t** handle) {
+  if (handle != nullptr && *handle != nullptr) {
+    (*handle)->handle_.reset();
+    delete (*handle);
+    *handle = nullptr;
+  }
+}
+
+int32_t tiledb_vcf_dataset_handle_open(
+    tiledb_vcf_dataset_handle_t* handle,
+    const char* dataset_uri,
+    const char* tiledb_config,
+    uint64_t header_cache_bytes) {
+  if (sanity_check(handle) == TILEDB_VCF_ERR || dataset_uri == nullptr)
+    return TILEDB_VCF_ERR;
+
+  std::vector<std::string> config;
+  if (tiledb_config != nullptr)
+    config = utils::split(tiledb_config, ',');
+  if (SAVE_ERROR_CATCH(
+          handle,
+          handle->handle_ =
+              DatasetHandle::open(dataset_uri, config, header_cache_bytes)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_dataset_handle_refresh(
+    tiledb_vcf_dataset_handle_t* handle, bool* refreshed) {
+  if (sanity_check(handle) == TILEDB_VCF_ERR || refreshed == nullptr)
+    return TILEDB_VCF_ERR;
+
+  if (handle->handle_ == nullptr) {
+    save_error(handle, "Cannot refresh dataset handle; it is not open");
+    return TILEDB_VCF_ERR;
+  }
+
+  if (SAVE_ERROR_CATCH(handle, *refreshed = handle->handle_->refresh()))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_dataset_handle_get_last_error(
+    tiledb_vcf_dataset_handle_t* handle, tiledb_vcf_error_t** error) {
+  if (sanity_check(handle) == TILEDB_VCF_ERR || error == nullptr)
+    return TILEDB_VCF_ERR;
+
+  *error = new (std::nothrow) tiledb_vcf_error_t;
+  if (*error == nullptr) {
+    std::string err("Failed to allocate TileDB-VCF error object");
+    LOG_ERROR(err);
+    return TILEDB_VCF_ERR;
+  }
+
+  (*error)->errmsg_ = handle->saved_errmsg_;
+
+  return TILEDB_VCF_OK;
+}
+
 /* ********************************* */
 /*             BED FILE              */
 /* ********************************* */
@@ -1531,6 +1788,51 @@ int32_t tiledb_vcf_writer_set_ratio_output_flush(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_writer_set_decompression_threads(
+    tiledb_vcf_writer_t* writer, uint32_t threads) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          writer, writer->writer_->set_decompression_threads(threads)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_huge_pages(
+    tiledb_vcf_writer_t* writer, bool enable) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->set_huge_pages(enable)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_merge_ref_blocks(
+    tiledb_vcf_writer_t* writer, bool enable) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->set_merge_ref_blocks(enable)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_ref_block_gq_band(
+    tiledb_vcf_writer_t* writer, uint32_t band) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->set_ref_block_gq_band(band)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_writer_set_thread_task_size(
     tiledb_vcf_writer_t* writer, uint32_t size) {
   if (sanity_check(writer) == TILEDB_VCF_ERR)
@@ -1648,6 +1950,17 @@ int32_t tiledb_vcf_writer_get_tiledb_stats(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_writer_get_metrics(
+    tiledb_vcf_writer_t* writer, const char** metrics) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->metrics(metrics)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_writer_get_dataset_version(
     tiledb_vcf_writer_t* writer, int32_t* version) {
   if (sanity_check(writer) == TILEDB_VCF_ERR || version == nullptr)
@@ -1693,6 +2006,29 @@ int32_t tiledb_vcf_writer_set_resume_sample_partial_ingestion(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_writer_set_checkpoint_uri(
+    tiledb_vcf_writer_t* writer, const char* uri) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR || uri == nullptr)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->set_checkpoint_uri(uri)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_checkpoint_records(
+    tiledb_vcf_writer_t* writer, uint64_t records) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          writer, writer->writer_->set_checkpoint_records(records)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_writer_set_contig_fragment_merging(
     tiledb_vcf_writer_t* writer, const bool contig_fragment_merging) {
   if (sanity_check(writer) == TILEDB_VCF_ERR)
@@ -1800,6 +2136,52 @@ int32_t tiledb_vcf_writer_set_compress_sample_dim(
   return TILEDB_VCF_OK;
 }
 
+int32_t tiledb_vcf_writer_set_ref_block_flag(
+    tiledb_vcf_writer_t* writer, bool enable) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->set_ref_block_flag(enable)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_compact_gt(
+    tiledb_vcf_writer_t* writer, bool enable) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(writer, writer->writer_->set_compact_gt(enable)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_dictionary_encoding(
+    tiledb_vcf_writer_t* writer, bool enable) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          writer, writer->writer_->set_dictionary_encoding(enable)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
+int32_t tiledb_vcf_writer_set_adaptive_anchor_gap(
+    tiledb_vcf_writer_t* writer, bool enable) {
+  if (sanity_check(writer) == TILEDB_VCF_ERR)
+    return TILEDB_VCF_ERR;
+
+  if (SAVE_ERROR_CATCH(
+          writer, writer->writer_->set_adaptive_anchor_gap(enable)))
+    return TILEDB_VCF_ERR;
+
+  return TILEDB_VCF_OK;
+}
+
 int32_t tiledb_vcf_writer_set_compression_level(
     tiledb_vcf_writer_t* writer, int level) {
   if (sanity_check(writer) == TILEDB_VCF_ERR)
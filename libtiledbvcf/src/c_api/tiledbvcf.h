@@ -97,6 +97,13 @@ typedef struct tiledb_vcf_error_t tiledb_vcf_error_t;
 /** Bed file object. */
 typedef struct tiledb_vcf_bed_file_t tiledb_vcf_bed_file_t;
 
+/** Dataset opened once and shared by many readers. */
+typedef struct tiledb_vcf_dataset_handle_t tiledb_vcf_dataset_handle_t;
+
+/** Arrow C data interface structs, defined by the consumer. */
+struct ArrowArray;
+struct ArrowSchema;
+
 /* ********************************* */
 /*              MISC                 */
 /* ********************************* */
@@ -111,6 +118,18 @@ TILEDBVCF_EXPORT void tiledb_vcf_version(const char** version);
 TILEDBVCF_EXPORT void tiledb_vcf_config_logging(
     const char* level, const char* logfile);
 
+/**
+ * Enables or disables the collection of TileDB-VCF metrics. Metrics are
+ * global to the process and are not enabled by readers or writers, so the
+ * application enables them before the reads or ingestions to measure.
+ *
+ * @param enabled Whether to collect metrics
+ */
+TILEDBVCF_EXPORT void tiledb_vcf_metrics_enable(bool enabled);
+
+/** Resets every TileDB-VCF metric of the process to zero. */
+TILEDBVCF_EXPORT void tiledb_vcf_metrics_reset();
+
 /* ********************************* */
 /*              READER               */
 /* ********************************* */
@@ -145,6 +164,20 @@ TILEDBVCF_EXPORT void tiledb_vcf_reader_free(tiledb_vcf_reader_t** reader);
 TILEDBVCF_EXPORT int32_t
 tiledb_vcf_reader_init(tiledb_vcf_reader_t* reader, const char* dataset_uri);
 
+/**
+ * Initializes the reader for reading from a dataset opened with
+ * `tiledb_vcf_dataset_handle_open`. The reader shares the TileDB context,
+ * arrays and caches of the handle, and uses its TileDB config instead of the
+ * one set on the reader. The handle may be shared by readers on different
+ * threads, and may be freed before the readers.
+ *
+ * @param reader VCF reader object
+ * @param handle Opened dataset handle
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_init_from_handle(
+    tiledb_vcf_reader_t* reader, tiledb_vcf_dataset_handle_t* handle);
+
 /**
  * Sets the URI of a file containing sample names to read. The file should
  * contain, one per line, the names of samples in the dataset to be read.
@@ -182,6 +215,23 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_samples_file(
 TILEDBVCF_EXPORT int32_t
 tiledb_vcf_reader_set_bed_file(tiledb_vcf_reader_t* reader, const char* uri);
 
+/**
+ * Sets a directory used to cache the regions parsed from BED files.
+ *
+ * The first reader of a BED file parses it and writes a compact binary index
+ * of its regions (interned contig names and packed intervals) to this
+ * directory. Later readers of the same BED file, e.g. the other partitions of
+ * a partitioned export, load the index instead of parsing the file. Indexes
+ * are keyed by the BED file URI, size and contents, so a modified BED file is
+ * parsed again. BED arrays are not cached.
+ *
+ * @param reader VCF reader object
+ * @param uri URI of the cache directory (local or object store)
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_region_index_cache(
+    tiledb_vcf_reader_t* reader, const char* uri);
+
 /**
  * Given a CSV string of sample names, sets the samples to be read.
  *
@@ -235,6 +285,25 @@ tiledb_vcf_reader_set_regions(tiledb_vcf_reader_t* reader, const char* regions);
 TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_sort_regions(
     tiledb_vcf_reader_t* reader, int32_t sort_regions);
 
+/**
+ * Sets whether region and sample partitions are balanced by data volume.
+ *
+ * By default, partitioning gives each partition the same number of regions
+ * (or samples). When enabled, the number of records in each region and
+ * sample is estimated from the fragment metadata (non-empty domains and cell
+ * counts), and partitions are cut so they hold about the same number of
+ * records. Regions are never split, so a single dense region still ends up
+ * in one partition.
+ *
+ * All readers of a partitioned export must use the same setting.
+ *
+ * @param reader VCF reader object
+ * @param balance_partitions If true, balance partitions by data volume
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_balance_partitions(
+    tiledb_vcf_reader_t* reader, bool balance_partitions);
+
 /**
  * Sets the region partitioning info for the reader. The partitioning divides
  * the reader genomic regions (e.g. the BED ranges) according to a simple block
@@ -617,6 +686,20 @@ tiledb_vcf_reader_get_tiledb_stats_enabled_vcf_header_array(
 TILEDBVCF_EXPORT int32_t
 tiledb_vcf_reader_get_tiledb_stats(tiledb_vcf_reader_t* reader, char** stats);
 
+/**
+ * Gets the TileDB-VCF metrics as a JSON string: a counter or latency
+ * histogram per export phase (region intersection, AF filter, TileDB query
+ * submit, record copy, ...). Metrics are global to the process and are
+ * collected once enabled with `tiledb_vcf_metrics_enable`.
+ *
+ * @param reader VCF reader object
+ * @param metrics Set to the JSON string, which is owned by the reader and
+ *     valid until the next call
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_get_metrics(
+    tiledb_vcf_reader_t* reader, const char** metrics);
+
 /**
  * Gets whether a VCF reader has an AF filter set.
  *
@@ -645,6 +728,94 @@ tiledb_vcf_reader_get_samples(tiledb_vcf_reader_t* reader, const char* samples);
  */
 TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_read(tiledb_vcf_reader_t* reader);
 
+/**
+ * Performs a blocking read operation into buffers owned by the reader, and
+ * exports the results as an Arrow struct array with one child per attribute,
+ * without copying. No buffers need to be set on the reader.
+ *
+ * The buffers grow as needed to hold at least one record. They are reused for
+ * the next batch once the consumer has released all arrays of the previous
+ * batch. As with `tiledb_vcf_reader_read`, resubmit while the read status is
+ * 'incomplete'. The attributes must not change while the read is incomplete.
+ *
+ * **Example:**
+ *
+ * @code{.c}
+ * const char* attrs[] = {"sample_name", "pos_start", "alleles"};
+ * struct ArrowArray array;
+ * struct ArrowSchema schema;
+ * tiledb_vcf_reader_read_arrow(reader, attrs, 3, &array, &schema);
+ * // ... consume the batch
+ * array.release(&array);
+ * schema.release(&schema);
+ * @endcode
+ *
+ * @param reader VCF reader object
+ * @param attributes Names of the attributes to export
+ * @param num_attributes Number of attributes
+ * @param array Set to the batch; the caller must call its release callback
+ * @param schema Set to the batch schema; the caller must call its release
+ *    callback
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_read_arrow(
+    tiledb_vcf_reader_t* reader,
+    const char** attributes,
+    int32_t num_attributes,
+    struct ArrowArray* array,
+    struct ArrowSchema* schema);
+
+/**
+ * Gets the next batch of a streaming export as an Arrow struct array with one
+ * child per attribute. No buffers need to be set on the reader.
+ *
+ * The first call starts a producer thread that reads batches into buffers
+ * owned by the reader, ahead of the consumer, up to the batch queue depth
+ * (see `tiledb_vcf_reader_set_batch_queue_depth`). The producer waits while
+ * the queue is full. Each batch is capped to an equal share of the buffer
+ * memory budget, and its buffers are reused once the consumer releases the
+ * batch, so memory use stays bounded for exports of any size.
+ *
+ * Once the export is exhausted, the release callbacks of `array` and
+ * `schema` are set to NULL. The stream stays open until the reader is reset;
+ * no other read operation may be run on the reader while it is open.
+ * `tiledb_vcf_reader_read`, `tiledb_vcf_reader_read_arrow`,
+ * `tiledb_vcf_reader_get_status` and
+ * `tiledb_vcf_reader_get_result_num_records` return `TILEDB_VCF_ERR` until
+ * then, and the result buffers of the reader must not be accessed.
+ *
+ * **Example:**
+ *
+ * @code{.c}
+ * const char* attrs[] = {"sample_name", "pos_start", "alleles"};
+ * while (1) {
+ *   struct ArrowArray array;
+ *   struct ArrowSchema schema;
+ *   tiledb_vcf_reader_next_batch(reader, attrs, 3, &array, &schema);
+ *   if (array.release == NULL)
+ *     break;
+ *   // ... consume the batch
+ *   array.release(&array);
+ *   schema.release(&schema);
+ * }
+ * @endcode
+ *
+ * @param reader VCF reader object
+ * @param attributes Names of the attributes to export, which must be the same
+ *    for every call
+ * @param num_attributes Number of attributes
+ * @param array Set to the batch; the caller must call its release callback
+ * @param schema Set to the batch schema; the caller must call its release
+ *    callback
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_next_batch(
+    tiledb_vcf_reader_t* reader,
+    const char** attributes,
+    int32_t num_attributes,
+    struct ArrowArray* array,
+    struct ArrowSchema* schema);
+
 /**
  * Get the read status of the given reader.
  *
@@ -919,6 +1090,30 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_output_path(
 TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_af_filter(
     tiledb_vcf_reader_t* reader, const char* af_filter);
 
+/**
+ * Sets the record filter, a conjunction of predicates such as
+ * "qual > 30 && filters == PASS && fmt_GQ >= 20". Predicates on qual,
+ * pos_start and pos_end are evaluated by TileDB; the others on the query
+ * results, before export. An empty filter disables filtering. Only supported
+ * on v4 datasets.
+ *
+ * @param reader VCF reader object
+ * @param record_filter setting
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_record_filter(
+    tiledb_vcf_reader_t* reader, const char* record_filter);
+
+/**
+ * Sets whether to skip gVCF reference blocks, i.e. records whose only ALT
+ * allele is <NON_REF> or <*>. On datasets created with the reference block
+ * flag they are skipped by TileDB. Only supported on v4 datasets.
+ *
+ * @param reader VCF reader object
+ * @param variants_only setting
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_variants_only(
+    tiledb_vcf_reader_t* reader, bool variants_only);
+
 /**
  * Sets whether to scan all samples for IAF computation
  *
@@ -1029,6 +1224,37 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_enable_progress_estimation(
 TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_buffer_percentage(
     tiledb_vcf_reader_t* reader, float buffer_percentage);
 
+/**
+ * Sets whether the query buffers are re-apportioned between submits based
+ * on the observed bytes per cell of each attribute (default true)
+ * @param reader VCF reader object
+ * @param buffer_autotune setting
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_buffer_autotune(
+    tiledb_vcf_reader_t* reader, bool buffer_autotune);
+
+/**
+ * Gets a JSON summary of the query buffer autotuning: number of rebalances,
+ * observed cells and the bytes per cell and allocation of each buffer. The
+ * string is owned by the reader.
+ * @param reader VCF reader object
+ * @param stats Set to the summary
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_get_buffer_autotune_stats(
+    tiledb_vcf_reader_t* reader, const char** stats);
+
+/**
+ * Sets the number of batches `tiledb_vcf_reader_next_batch` reads ahead of
+ * the consumer (default 2). The buffer memory budget is split evenly between
+ * the queued batches, the batch being read and the batch being consumed.
+ * @param reader VCF reader object
+ * @param queue_depth setting, at least 1
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_batch_queue_depth(
+    tiledb_vcf_reader_t* reader, int32_t queue_depth);
+
 /**
  * Sets the percentage of tiledb tile cache size to overal memory budget
  * @param reader VCF reader object
@@ -1113,6 +1339,81 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_set_debug_print_tiledb_query_ranges(
 TILEDBVCF_EXPORT int32_t tiledb_vcf_reader_get_last_error(
     tiledb_vcf_reader_t* reader, tiledb_vcf_error_t** error);
 
+/* ********************************* */
+/*          DATASET HANDLE           */
+/* ********************************* */
+
+/**
+ * Allocate a dataset handle object.
+ *
+ * @param handle Will be set to point at the allocated handle object.
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t
+tiledb_vcf_dataset_handle_alloc(tiledb_vcf_dataset_handle_t** handle);
+
+/**
+ * Free the given dataset handle object. Readers initialized from the handle
+ * keep the dataset open until they are freed.
+ *
+ * @param handle Pointer to handle object to free.
+ */
+TILEDBVCF_EXPORT void tiledb_vcf_dataset_handle_free(
+    tiledb_vcf_dataset_handle_t** handle);
+
+/**
+ * Opens the dataset at the given URI, loading its metadata, sample names and
+ * fragment domains once for all readers initialized from the handle.
+ *
+ * **Example:**
+ *
+ * @code{.c}
+ * tiledb_vcf_dataset_handle_t* handle;
+ * tiledb_vcf_dataset_handle_alloc(&handle);
+ * // Cache up to 64 MiB of VCF header text for the readers
+ * tiledb_vcf_dataset_handle_open(handle, "my_dataset", "", 64 << 20);
+ * // For each query, possibly on another thread:
+ * tiledb_vcf_reader_t* reader;
+ * tiledb_vcf_reader_alloc(&reader);
+ * tiledb_vcf_reader_init_from_handle(reader, handle);
+ * @endcode
+ *
+ * @param handle Dataset handle object
+ * @param dataset_uri URI of TileDB VCF dataset
+ * @param tiledb_config Comma-separated TileDB config options ("key=value")
+ * @param header_cache_bytes Maximum size of the VCF header text cached for
+ *    the readers of the handle; 0 disables the cache
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_dataset_handle_open(
+    tiledb_vcf_dataset_handle_t* handle,
+    const char* dataset_uri,
+    const char* tiledb_config,
+    uint64_t header_cache_bytes);
+
+/**
+ * Reopens the dataset if fragments were added to or removed from it since it
+ * was opened. Readers initialized before the refresh keep reading the
+ * previous snapshot. Thread-safe.
+ *
+ * @param handle Dataset handle object
+ * @param refreshed Set to true if the dataset was reopened
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_dataset_handle_refresh(
+    tiledb_vcf_dataset_handle_t* handle, bool* refreshed);
+
+/**
+ * Gets the last error from the handle object. Don't forget to free the error
+ * object.
+ *
+ * @param handle Dataset handle object
+ * @param error Set to a newly allocated error object holding the last error.
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_dataset_handle_get_last_error(
+    tiledb_vcf_dataset_handle_t* handle, tiledb_vcf_error_t** error);
+
 /* ********************************* */
 /*             BED FILE              */
 /* ********************************* */
@@ -1453,6 +1754,51 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_ratio_task_size(
 TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_ratio_output_flush(
     tiledb_vcf_writer_t* writer, float ratio_output_flush);
 
+/**
+ * Set the number of threads shared by all input VCF files for BGZF
+ * decompression. Zero (the default) decompresses on the ingestion threads.
+ *
+ * @param writer VCF writer object
+ * @param threads The number of decompression threads.
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_decompression_threads(
+    tiledb_vcf_writer_t* writer, uint32_t threads);
+
+/**
+ * Set whether to back the large attribute buffers of the ingestion workers
+ * with transparent huge pages (Linux only). Disabled by default.
+ *
+ * @param writer VCF writer object
+ * @param enable enable/disable
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_huge_pages(
+    tiledb_vcf_writer_t* writer, bool enable);
+
+/**
+ * Set whether to merge the consecutive gVCF reference blocks of a sample that
+ * have the same GT and GQ band into a single record. Disabled by default.
+ *
+ * @param writer VCF writer object
+ * @param enable enable/disable
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_merge_ref_blocks(
+    tiledb_vcf_writer_t* writer, bool enable);
+
+/**
+ * Set the width of the GQ bands of mergeable gVCF reference blocks. Defaults
+ * to 10.
+ *
+ * @param writer VCF writer object
+ * @param band GQ band width
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_ref_block_gq_band(
+    tiledb_vcf_writer_t* writer, uint32_t band);
+
 /**
  * Set max length (# columns) of an ingestion task. Affects load balancing of
  * ingestion work across threads, and total memory consumption.
@@ -1539,6 +1885,20 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_get_tiledb_stats_enabled(
 TILEDBVCF_EXPORT int32_t
 tiledb_vcf_writer_get_tiledb_stats(tiledb_vcf_writer_t* writer, char** stats);
 
+/**
+ * Gets the TileDB-VCF metrics as a JSON string: a counter or latency
+ * histogram per ingestion phase (VCF parsing, record heap, buffering, TileDB
+ * query submit and finalize, ...). Metrics are global to the process and are
+ * collected once enabled with `tiledb_vcf_metrics_enable`.
+ *
+ * @param writer VCF writer object
+ * @param metrics Set to the JSON string, which is owned by the writer and
+ *     valid until the next call
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_get_metrics(
+    tiledb_vcf_writer_t* writer, const char** metrics);
+
 /**
  * Sets whether TileDB internal statistics should be enabled or not for vcf
  * header array access.
@@ -1607,6 +1967,28 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_sample_batch_size(
 TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_resume_sample_partial_ingestion(
     tiledb_vcf_writer_t* writer, const bool resume);
 
+/**
+ * Set the directory of ingestion checkpoints. With checkpoints, data
+ * fragments are committed at bounded region sizes and a resumed ingestion
+ * skips exactly the committed regions.
+ *
+ * @param writer VCF writer object
+ * @param uri URI of the checkpoint directory, or empty to disable
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_checkpoint_uri(
+    tiledb_vcf_writer_t* writer, const char* uri);
+
+/**
+ * Set the number of records written between ingestion checkpoints
+ *
+ * @param writer VCF writer object
+ * @param records number of records (default: 10,000,000)
+ * @return `TILEDB_VCF_OK` for success or `TILEDB_VCF_ERR` for error.
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_checkpoint_records(
+    tiledb_vcf_writer_t* writer, uint64_t records);
+
 /**
  * Set contig fragment merging enabled or not
  *
@@ -1690,6 +2072,52 @@ TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_enable_sample_stats(
 TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_compress_sample_dim(
     tiledb_vcf_writer_t* writer, bool enable);
 
+/**
+ * Sets enable for the is_ref_block attribute, which flags gVCF reference
+ * blocks so that variant-only reads can skip them in TileDB. Enabled by
+ * default.
+ *
+ * @param writer VCF writer object
+ * @param enable enable/disable
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_ref_block_flag(
+    tiledb_vcf_writer_t* writer, bool enable);
+
+/**
+ * Sets enable for the genotype attribute, which stores GT packed into a
+ * fixed-width uint32 so that reads of fmt_GT and AF filtering do not decode
+ * the FMT data. Supports a ploidy of at most 2. Disabled by default.
+ *
+ * @param writer VCF writer object
+ * @param enable enable/disable
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_compact_gt(
+    tiledb_vcf_writer_t* writer, bool enable);
+
+/**
+ * Sets enable for dictionary encoding of the alleles and id attributes, which
+ * stores each distinct value once per tile since the records of a site repeat
+ * them across samples. Disabled by default.
+ *
+ * @param writer VCF writer object
+ * @param enable enable/disable
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_dictionary_encoding(
+    tiledb_vcf_writer_t* writer, bool enable);
+
+/**
+ * Sets enable for adaptive anchor gaps: the anchor gap of each contig is
+ * chosen from the lengths of its records at each ingestion, down to a tenth
+ * of the anchor gap of the dataset, which then only applies to contigs
+ * without one. Readers use the largest gap chosen for a contig. Disabled by
+ * default.
+ *
+ * @param writer VCF writer object
+ * @param enable enable/disable
+ */
+TILEDBVCF_EXPORT int32_t tiledb_vcf_writer_set_adaptive_anchor_gap(
+    tiledb_vcf_writer_t* writer, bool enable);
+
 /**
  * Sets zstd compression level
  * @param writer VCF writer object
@@ -31,6 +31,7 @@
 #include "read/export_format.h"
 #include "read/reader.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/utils.h"
 #include "vcf/region.h"
 #include "write/writer.h"
@@ -93,6 +94,9 @@ void do_store(const IngestionParams& args, const CLI::App& cmd) {
   LOG_TRACE("Starting store command.");
   config_to_log(cmd);
 
+  // The CLI runs a single ingestion, so the process-wide metrics follow it.
+  metrics::enable(args.tiledb_stats_enabled);
+
   Writer writer;
   writer.set_all_params(args);
   writer.ingest_samples();
@@ -102,6 +106,11 @@ void do_store(const IngestionParams& args, const CLI::App& cmd) {
     writer.tiledb_stats(&stats);
     std::cout << "TileDB Internal Statistics:" << std::endl;
     std::cout << stats << std::endl;
+
+    const char* metrics;
+    writer.metrics(&metrics);
+    std::cout << "TileDB-VCF Metrics:" << std::endl;
+    std::cout << metrics << std::endl;
   }
   LOG_TRACE("Finished store command.");
 }
@@ -133,6 +142,9 @@ void do_export(ExportParams& args, const CLI::App& cmd) {
 
   args.export_to_disk = !args.cli_count_only;
 
+  // The CLI runs a single export, so the process-wide metrics follow it.
+  metrics::enable(args.tiledb_stats_enabled);
+
   Reader reader;
   reader.set_all_params(args);
   reader.open_dataset(args.uri);
@@ -143,6 +155,11 @@ void do_export(ExportParams& args, const CLI::App& cmd) {
     reader.tiledb_stats(&stats);
     std::cout << "TileDB Internal Statistics:" << std::endl;
     std::cout << stats << std::endl;
+
+    const char* metrics;
+    reader.metrics(&metrics);
+    std::cout << "TileDB-VCF Metrics:" << std::endl;
+    std::cout << metrics << std::endl;
   }
   LOG_TRACE("Finished export command.");
 }
@@ -256,6 +273,20 @@ void do_utils_vacuum_fragment_metadata(
   LOG_TRACE("Finished utils vacuum fragment metadata command.");
 }
 
+void do_utils_extract_attributes(
+    const UtilsParams& args, const CLI::App& cmd) {
+  LOG_TRACE("Starting utils extract attributes command.");
+  config_to_log(cmd);
+  utils::set_htslib_tiledb_context(args.tiledb_config);
+  tiledb::Config cfg;
+  utils::set_tiledb_config(args.tiledb_config, &cfg);
+  TileDBVCFDataset dataset(cfg);
+  dataset.open(args.uri, args.tiledb_config);
+  LOG_DEBUG("Extract attributes.");
+  dataset.extract_attributes(args);
+  LOG_TRACE("Finished utils extract attributes command.");
+}
+
 //==================================================================
 // cli parser helpers
 //==================================================================
@@ -441,6 +472,27 @@ void add_create(CLI::App& app) {
       args->compress_sample_dim,
       "Enable/disable compression of the sample dimension. Enabled by "
       "default.");
+  cmd->add_flag(
+      "--ref-block-flag,!--no-ref-block-flag",
+      args->ref_block_flag,
+      "Enable/disable the is_ref_block attribute flagging gVCF reference "
+      "blocks, used by variant-only exports. Enabled by default.");
+  cmd->add_flag(
+      "--compact-gt",
+      args->compact_gt,
+      "Store GT in a fixed-width genotype attribute, read instead of fmt_GT. "
+      "Supports a ploidy of at most 2.");
+  cmd->add_flag(
+      "--dictionary-encoding",
+      args->dictionary_encoding,
+      "Dictionary-encode the alleles and id attributes, which repeat across "
+      "the samples of a site.");
+  cmd->add_flag(
+      "--adaptive-anchor-gap",
+      args->adaptive_anchor_gap,
+      "Choose the anchor gap of each contig from the lengths of its records "
+      "at each ingestion, down to a tenth of --anchor-gap. --anchor-gap then "
+      "only applies to contigs without one.");
   cmd->add_option(
       "--compression-level",
       args->compression_level,
@@ -541,6 +593,16 @@ void add_store(CLI::App& app) {
       "--resume",
       args->resume_sample_partial_ingestion,
       "Resume incomplete ingestion of sample batch");
+  cmd->add_option(
+      "--checkpoint-uri",
+      args->checkpoint_uri,
+      "Directory of ingestion checkpoints. Data fragments are committed every "
+      "'--checkpoint-records' records and '--resume' skips exactly the "
+      "committed regions");
+  cmd->add_option(
+      "--checkpoint-records",
+      args->checkpoint_records,
+      "Number of records between ingestion checkpoints");
 
   cmd->option_defaults()->group("Sample options");
   cmd->add_option(
@@ -612,6 +674,28 @@ void add_store(CLI::App& app) {
          args->ratio_output_flush,
          "Ratio of output buffer capacity that triggers a flush to TileDB")
       ->check(CLI::Range(0.01, 1.0));
+  cmd->add_option(
+      "--decompression-threads",
+      args->decompression_threads,
+      "Number of threads shared by all input VCF files for BGZF "
+      "decompression (0 = decompress on the ingestion threads)");
+  cmd->add_flag(
+      "--huge-pages",
+      args->huge_pages,
+      "Back the large attribute buffers of the ingestion threads with "
+      "transparent huge pages (Linux only)");
+
+  cmd->option_defaults()->group("gVCF options");
+  cmd->add_flag(
+      "--merge-ref-blocks",
+      args->merge_ref_blocks,
+      "Merge the consecutive reference blocks of a sample that have the same "
+      "GT and GQ band into a single record");
+  cmd->add_option(
+         "--ref-block-gq-band",
+         args->ref_block_gq_band,
+         "Width of the GQ bands of mergeable reference blocks")
+      ->check(CLI::Range(1, 100));
 
   cmd->option_defaults()->group("Contig options");
   cmd->add_flag(
@@ -754,6 +838,11 @@ void add_export(CLI::App& app) {
          args->af_filter,
          "If set, only export data that passes the AF filter.")
       ->excludes("--count-only");
+  cmd->add_flag(
+      "--variants-only",
+      args->variants_only,
+      "Skip gVCF reference blocks (records whose only ALT allele is <NON_REF> "
+      "or <*>). Only supported on v4 datasets.");
 
   cmd->option_defaults()->group("Region options");
   cmd->add_option(
@@ -777,6 +866,18 @@ void add_export(CLI::App& app) {
       "export to export only a specific partition of them. Specify in "
       "the format I:N where I is the partition index and N is the "
       "total number of partitions. Useful for batch exports.");
+  cmd->add_flag(
+      "--balance-partitions",
+      args->balance_partitions,
+      "Balance region and sample partitions by the number of records "
+      "estimated from the fragment metadata, instead of by the number of "
+      "regions or samples. All partitions must use the same setting.");
+  cmd->add_option(
+      "--region-index-cache",
+      args->region_index_cache_uri,
+      "Directory where the regions parsed from the regions file are cached, "
+      "so that other partitions reading the same file load them instead of "
+      "parsing it");
 
   cmd->option_defaults()->group("Sample options");
   cmd->add_option(
@@ -909,6 +1010,29 @@ void add_utils(CLI::App& app) {
   auto c_f_cmd = c_cmd->add_subcommand(
       "fragments", "Consolidate TileDB-VCF dataset fragments");
   add_util_options(c_f_cmd, *args);
+  c_f_cmd->option_defaults()->group("Contig consolidation options");
+  c_f_cmd->add_flag(
+      "--by-contig",
+      args->consolidate_by_contig,
+      "Merge adjacent sample batches of each contig range into fragments of "
+      "about --target-fragment-mb, instead of the whole data array.");
+  c_f_cmd->add_option(
+      "--target-fragment-mb",
+      args->consolidation_target_mb,
+      "Target size (MB) of a consolidated fragment. Defaults to 1024.");
+  c_f_cmd->add_option(
+      "--threads",
+      args->consolidation_threads,
+      "Number of contig ranges consolidated in parallel. Defaults to 1.");
+  c_f_cmd->add_option(
+      "--memory-budget-mb",
+      args->consolidation_memory_budget_mb,
+      "Memory budget (MB) shared by the parallel consolidations. Defaults to "
+      "2048.");
+  c_f_cmd->add_flag(
+      "--dry-run",
+      args->consolidation_dry_run,
+      "Only log the consolidation plan and its write amplification.");
   c_f_cmd->callback(
       [args, cmd]() { do_utils_consolidate_fragments(*args, *cmd); });
 
@@ -936,6 +1060,22 @@ void add_utils(CLI::App& app) {
   add_util_options(v_m_cmd, *args);
   v_m_cmd->callback(
       [args, cmd]() { do_utils_vacuum_fragment_metadata(*args, *cmd); });
+
+  auto e_cmd = cmd->add_subcommand(
+      "extract_attributes",
+      "Extract INFO/FMT fields of a TileDB-VCF dataset as separate "
+      "attributes; existing fragments are backfilled by the next "
+      "'utils consolidate fragments'");
+  add_util_options(e_cmd, *args);
+  e_cmd
+      ->add_option(
+          "-a,--attributes",
+          args->extract_attributes,
+          "Comma-separated list of INFO/FMT fields to extract, in the form "
+          "'info_*' or 'fmt_*'")
+      ->delimiter(',')
+      ->required();
+  e_cmd->callback([args, cmd]() { do_utils_extract_attributes(*args, *cmd); });
 }
 
 //==================================================================
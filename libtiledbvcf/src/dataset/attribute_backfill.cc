@@ -0,0 +1,458 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <tuple>
+
+#include "dataset/attribute_backfill.h"
+#include "utils/logger_public.h"
+#include "utils/utils.h"
+
+namespace tiledb {
+namespace vcf {
+
+namespace {
+
+/**
+ * Metadata key prefix of the fragment swaps in progress. A swap is recorded
+ * before its rewritten fragment is committed and cleared once the original
+ * fragments are deleted.
+ */
+const std::string pending_swap_prefix = "backfill_pending/";
+
+/** Returns the name of a fragment from its URI. */
+std::string fragment_name(const std::string& uri) {
+  return uri.substr(uri.find_last_of('/') + 1);
+}
+
+}  // namespace
+
+AttributeBackfill::AttributeBackfill(
+    std::shared_ptr<Context> ctx,
+    const std::string& uri,
+    const std::vector<std::string>& attrs,
+    uint64_t memory_budget)
+    : ctx_(ctx)
+    , uri_(uri)
+    , attrs_(attrs)
+    , memory_budget_(memory_budget) {
+}
+
+uint64_t AttributeBackfill::run() {
+  FragmentInfo fragment_info(*ctx_, uri_);
+  fragment_info.load();
+
+  // A fragment is stale if its schema lacks one of the attributes
+  std::map<std::string, bool> stale_schemas;
+  std::vector<Fragment> fragments;
+  for (uint32_t i = 0; i < fragment_info.fragment_num(); i++) {
+    const std::string schema_name = fragment_info.array_schema_name(i);
+    auto it = stale_schemas.find(schema_name);
+    if (it == stale_schemas.end()) {
+      const ArraySchema schema = fragment_info.array_schema(i);
+      bool stale = false;
+      for (const auto& attr : attrs_)
+        stale = stale || !schema.has_attribute(attr);
+      it = stale_schemas.emplace(schema_name, stale).first;
+    }
+    const auto timestamps = fragment_info.timestamp_range(i);
+    fragments.emplace_back(
+        timestamps.first,
+        timestamps.second,
+        fragment_info.fragment_uri(i),
+        it->second);
+  }
+
+  finish_pending_swaps(&fragments);
+
+  // Group the fragments with overlapping timestamp ranges
+  std::sort(fragments.begin(), fragments.end());
+  std::vector<FragmentGroup> groups;
+  for (const auto& [start, end, uri, stale] : fragments) {
+    if (groups.empty() || start > groups.back().timestamps.second) {
+      groups.emplace_back();
+      groups.back().timestamps = {start, end};
+    }
+    FragmentGroup& group = groups.back();
+    group.uris.push_back(uri);
+    group.timestamps.second = std::max(group.timestamps.second, end);
+    group.stale = group.stale || stale;
+  }
+
+  uint64_t num_rewritten = 0;
+  for (const auto& group : groups) {
+    if (!group.stale)
+      continue;
+    auto start = std::chrono::steady_clock::now();
+    rewrite(group);
+    num_rewritten += group.uris.size();
+    LOG_INFO(
+        "[AttributeBackfill] Rewrote {} fragments of timestamps [{}, {}] in "
+        "{:.3f} seconds",
+        group.uris.size(),
+        group.timestamps.first,
+        group.timestamps.second,
+        utils::chrono_duration(start));
+  }
+  return num_rewritten;
+}
+
+void AttributeBackfill::finish_pending_swaps(
+    std::vector<Fragment>* fragments) {
+  std::map<std::string, std::string> swaps;
+  {
+    Array array(*ctx_, uri_, TILEDB_READ);
+    for (uint64_t i = 0; i < array.metadata_num(); i++) {
+      std::string key;
+      tiledb_datatype_t dtype;
+      uint32_t value_num = 0;
+      const void* value = nullptr;
+      array.get_metadata_from_index(i, &key, &dtype, &value_num, &value);
+      if (utils::starts_with(key, pending_swap_prefix) && value != nullptr)
+        swaps[key].assign(static_cast<const char*>(value), value_num);
+    }
+  }
+
+  for (const auto& [key, value] : swaps) {
+    // The timestamp of the rewritten fragment, then the original fragments
+    const auto names = utils::split(value, ',');
+    const uint64_t timestamp = std::stoull(names.at(0));
+    std::vector<std::string> originals;
+    bool committed = false;
+    for (const auto& [start, end, uri, stale] : *fragments) {
+      if (std::find(names.begin() + 1, names.end(), fragment_name(uri)) !=
+          names.end())
+        originals.push_back(uri);
+      else if (!stale && start == timestamp && end == timestamp)
+        committed = true;
+    }
+
+    // Without the rewritten fragment the originals are intact, and are
+    // rewritten again like any other stale fragment
+    if (committed && !originals.empty()) {
+      LOG_INFO(
+          "[AttributeBackfill] Deleting {} fragments of an interrupted "
+          "rewrite",
+          originals.size());
+      delete_fragments(originals);
+      fragments->erase(
+          std::remove_if(
+              fragments->begin(),
+              fragments->end(),
+              [&originals](const Fragment& fragment) {
+                return std::find(
+                           originals.begin(),
+                           originals.end(),
+                           std::get<2>(fragment)) != originals.end();
+              }),
+          fragments->end());
+    }
+
+    Array array(*ctx_, uri_, TILEDB_WRITE);
+    array.delete_metadata(key);
+  }
+}
+
+void AttributeBackfill::delete_fragments(
+    const std::vector<std::string>& uris) const {
+  std::vector<const char*> c_uris;
+  for (const auto& uri : uris)
+    c_uris.push_back(uri.c_str());
+  Array::delete_fragments_list(*ctx_, uri_, c_uris.data(), c_uris.size());
+}
+
+void AttributeBackfill::rewrite(const FragmentGroup& group) {
+  Array read_array(
+      *ctx_,
+      uri_,
+      TILEDB_READ,
+      TemporalPolicy(
+          TimestampStartEnd, group.timestamps.first, group.timestamps.second));
+  // The rewritten fragment takes the place of the group in time. Writes use
+  // the latest schema, with the extracted attributes, while the read uses
+  // the schema current at the end of the group, which may lack them.
+  Array write_array(
+      *ctx_,
+      uri_,
+      TILEDB_WRITE,
+      TemporalPolicy(TimeTravel, group.timestamps.second));
+
+  const ArraySchema read_schema = read_array.schema();
+  const ArraySchema schema = write_array.schema();
+  for (const auto& attr : attrs_) {
+    if (!schema.has_attribute(attr))
+      throw std::runtime_error(
+          "Error backfilling attributes of '" + uri_ + "'; no attribute '" +
+          attr + "'.");
+  }
+
+  std::vector<Column> columns;
+  auto add_column = [&columns](
+                        const std::string& name,
+                        tiledb_datatype_t type,
+                        uint32_t cell_val_num,
+                        bool read) {
+    Column column;
+    column.name = name;
+    column.type_size = tiledb_datatype_size(type);
+    column.var_len = cell_val_num == TILEDB_VAR_NUM;
+    column.cell_size = column.var_len ? 0 : column.type_size * cell_val_num;
+    column.read = read;
+    columns.push_back(std::move(column));
+  };
+  for (const auto& dim : schema.domain().dimensions())
+    add_column(dim.name(), dim.type(), dim.cell_val_num(), true);
+  for (const auto& [name, attr] : schema.attributes()) {
+    const bool read = read_schema.has_attribute(name);
+    if (!read && !attr.variable_sized())
+      throw std::runtime_error(
+          "Error backfilling attributes of '" + uri_ +
+          "'; cannot fill fixed-length attribute '" + name + "'.");
+    add_column(name, attr.type(), attr.cell_val_num(), read);
+  }
+
+  // Every buffer gets the same share of the budget
+  uint64_t num_buffers = 0;
+  for (const auto& column : columns) {
+    if (column.read)
+      num_buffers += column.var_len ? 2 : 1;
+  }
+  uint64_t buffer_size = std::max<uint64_t>(memory_budget_ / num_buffers, 1024);
+
+  Query read_query(*ctx_, read_array);
+  read_query.set_layout(TILEDB_GLOBAL_ORDER);
+  Query write_query(*ctx_, write_array);
+  write_query.set_layout(TILEDB_GLOBAL_ORDER);
+
+  Query::Status status;
+  bool written = false;
+  do {
+    for (auto& column : columns) {
+      if (!column.read)
+        continue;
+      column.data.resize(buffer_size);
+      read_query.set_data_buffer(
+          column.name,
+          static_cast<void*>(column.data.data()),
+          column.data.size() / column.type_size);
+      if (column.var_len) {
+        column.offsets.resize(buffer_size / sizeof(uint64_t));
+        read_query.set_offsets_buffer(
+            column.name, column.offsets.data(), column.offsets.size());
+      }
+    }
+    status = read_query.submit();
+
+    auto results = read_query.result_buffer_elements();
+    uint64_t num_cells = 0;
+    for (auto& column : columns) {
+      if (!column.read)
+        continue;
+      const auto& elements = results[column.name];
+      column.data_size = elements.second * column.type_size;
+      column.num_cells = column.var_len ? elements.first :
+                                          column.data_size / column.cell_size;
+      num_cells = std::max(num_cells, column.num_cells);
+    }
+    if (num_cells == 0) {
+      if (status == Query::Status::INCOMPLETE) {
+        // A cell does not fit the buffers
+        buffer_size *= 2;
+        continue;
+      }
+      break;
+    }
+
+    // Attributes missing from the schema of the group hold their fill
+    // value, a single null byte, as they would when read with the latest
+    // schema
+    for (auto& column : columns) {
+      if (column.read)
+        continue;
+      column.data.assign(num_cells, '\0');
+      column.offsets.resize(num_cells);
+      std::iota(column.offsets.begin(), column.offsets.end(), 0);
+      column.data_size = num_cells;
+      column.num_cells = num_cells;
+    }
+
+    backfill_cells(&columns);
+
+    for (auto& column : columns) {
+      write_query.set_data_buffer(
+          column.name,
+          static_cast<void*>(column.data.data()),
+          column.data_size / column.type_size);
+      if (column.var_len)
+        write_query.set_offsets_buffer(
+            column.name, column.offsets.data(), column.num_cells);
+    }
+    write_query.submit();
+    written = true;
+  } while (status == Query::Status::INCOMPLETE);
+
+  if (status != Query::Status::COMPLETE)
+    throw std::runtime_error(
+        "Error backfilling attributes of '" + uri_ + "'; read query failed.");
+
+  // Record the swap before committing the rewritten fragment, so that a
+  // rerun after a crash between the commit and the delete deletes the
+  // originals instead of rewriting them into duplicates
+  const std::string key =
+      pending_swap_prefix + fragment_name(group.uris.front());
+  if (written) {
+    std::string value = std::to_string(group.timestamps.second);
+    for (const auto& uri : group.uris)
+      value += ',' + fragment_name(uri);
+    {
+      Array array(*ctx_, uri_, TILEDB_WRITE);
+      array.put_metadata(key, TILEDB_CHAR, value.size(), value.data());
+    }
+    write_query.finalize();
+  }
+
+  // The rewritten cells are committed; drop the originals
+  delete_fragments(group.uris);
+
+  if (written) {
+    Array array(*ctx_, uri_, TILEDB_WRITE);
+    array.delete_metadata(key);
+  }
+}
+
+void AttributeBackfill::backfill_cells(std::vector<Column>* columns) const {
+  auto find_column = [columns](const std::string& name) -> Column& {
+    for (auto& column : *columns) {
+      if (column.name == name)
+        return column;
+    }
+    throw std::runtime_error(
+        "Error backfilling attributes; no attribute '" + name + "'.");
+  };
+  Column& info = find_column("info");
+  Column& fmt = find_column("fmt");
+
+  // Cell `i` of a var-len column
+  auto cell = [](const Column& column, uint64_t i) {
+    const uint64_t begin = column.offsets[i];
+    const uint64_t end = i + 1 < column.num_cells ? column.offsets[i + 1] :
+                                                    column.data_size;
+    return std::vector<char>(
+        column.data.data() + begin, column.data.data() + end);
+  };
+
+  // Rewritten info, fmt and attribute cells
+  const uint64_t num_cells = info.num_cells;
+  std::vector<std::vector<char>> info_cells(num_cells), fmt_cells(num_cells);
+  std::vector<std::vector<std::vector<char>>> attr_cells(attrs_.size());
+  for (uint64_t i = 0; i < num_cells; i++) {
+    info_cells[i] = cell(info, i);
+    fmt_cells[i] = cell(fmt, i);
+  }
+  for (size_t a = 0; a < attrs_.size(); a++) {
+    const Column& column = find_column(attrs_[a]);
+    const bool is_info = utils::starts_with(attrs_[a], "info_");
+    const std::string key = attrs_[a].substr(is_info ? 5 : 4);
+    attr_cells[a].resize(num_cells);
+    for (uint64_t i = 0; i < num_cells; i++) {
+      std::vector<char>& value = attr_cells[a][i];
+      value = cell(column, i);
+      // A single null byte is a missing value, and the fill value of the
+      // attribute in fragments written without it.
+      if (value.size() == 1 && value[0] == '\0') {
+        std::vector<char> extracted;
+        if (extract_field(
+                key, is_info ? &info_cells[i] : &fmt_cells[i], &extracted))
+          value = std::move(extracted);
+      }
+    }
+  }
+
+  auto replace = [num_cells](
+                     Column* column,
+                     const std::vector<std::vector<char>>& cells) {
+    column->data.clear();
+    for (uint64_t i = 0; i < num_cells; i++) {
+      column->offsets[i] = column->data.size();
+      column->data.insert(column->data.end(), cells[i].begin(), cells[i].end());
+    }
+    column->data_size = column->data.size();
+  };
+  replace(&info, info_cells);
+  replace(&fmt, fmt_cells);
+  for (size_t a = 0; a < attrs_.size(); a++)
+    replace(&find_column(attrs_[a]), attr_cells[a]);
+}
+
+bool AttributeBackfill::extract_field(
+    const std::string& key, std::vector<char>* blob, std::vector<char>* value) {
+  if (blob->size() < sizeof(uint32_t))
+    return false;
+
+  auto malformed = []() {
+    return std::runtime_error(
+        "Error backfilling attributes; malformed INFO/FMT value.");
+  };
+
+  uint64_t pos = sizeof(uint32_t);
+  while (pos < blob->size()) {
+    const uint64_t field_start = pos;
+    const char* name = blob->data() + pos;
+    const uint64_t name_size = strnlen(name, blob->size() - pos);
+    pos += name_size + 1;
+
+    int type = 0, num_values = 0;
+    if (pos + 2 * sizeof(int) > blob->size())
+      throw malformed();
+    std::memcpy(&type, blob->data() + pos, sizeof(int));
+    std::memcpy(&num_values, blob->data() + pos + sizeof(int), sizeof(int));
+    if (num_values < 0)
+      throw malformed();
+    const uint64_t value_start = pos;
+    pos += 2 * sizeof(int) + uint64_t(num_values) * utils::bcf_type_size(type);
+    if (pos > blob->size())
+      throw malformed();
+
+    if (key.compare(0, std::string::npos, name, name_size) == 0) {
+      value->assign(blob->begin() + value_start, blob->begin() + pos);
+      blob->erase(blob->begin() + field_start, blob->begin() + pos);
+
+      uint32_t num_fields = 0;
+      std::memcpy(&num_fields, blob->data(), sizeof(uint32_t));
+      num_fields--;
+      std::memcpy(blob->data(), &num_fields, sizeof(uint32_t));
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace vcf
+}  // namespace tiledb
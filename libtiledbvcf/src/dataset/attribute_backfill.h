@@ -0,0 +1,147 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_ATTRIBUTE_BACKFILL_H
+#define TILEDB_VCF_ATTRIBUTE_BACKFILL_H
+
+#include <memory>
+#include <string>
+#include <tiledb/tiledb>
+#include <tiledb/tiledb_experimental>
+#include <tuple>
+#include <vector>
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * Backfills INFO/FMT attributes added to a v4 data array after it was
+ * written to (see `TileDBVCFDataset::extract_attributes`).
+ *
+ * Cells written before an attribute existed read as null and keep the field
+ * in the info/fmt blob. The backfill rewrites every fragment written with a
+ * schema lacking one of the attributes: the field is moved out of the blob
+ * into its attribute, in the encoding used at ingestion, and the rewritten
+ * fragment replaces the original one. Fragments with overlapping timestamp
+ * ranges are rewritten together, since a read at a timestamp range cannot
+ * tell them apart. A run interrupted between committing a rewritten
+ * fragment and deleting the originals is finished by the next run.
+ */
+class AttributeBackfill {
+ public:
+  /**
+   * @param ctx TileDB context
+   * @param uri URI of the data array
+   * @param attrs Extracted attributes to backfill ('info_X' or 'fmt_X')
+   * @param memory_budget Memory budget (bytes) of the read buffers
+   */
+  AttributeBackfill(
+      std::shared_ptr<Context> ctx,
+      const std::string& uri,
+      const std::vector<std::string>& attrs,
+      uint64_t memory_budget);
+
+  /**
+   * Rewrites the fragments lacking one of the attributes.
+   *
+   * @return Number of fragments rewritten
+   */
+  uint64_t run();
+
+  /**
+   * Moves a field out of a cell of the info/fmt blob attribute.
+   *
+   * @param key Name of the field
+   * @param blob Blob cell: the number of fields followed by the key, type,
+   *     number of values and values of each field. The field is removed.
+   * @param value Set to the type, number of values and values of the field,
+   *     the encoding of extracted attributes
+   * @return True if the blob held the field
+   */
+  static bool extract_field(
+      const std::string& key,
+      std::vector<char>* blob,
+      std::vector<char>* value);
+
+ private:
+  /** Query buffers of a dimension or attribute. */
+  struct Column {
+    std::string name;
+    uint64_t type_size;
+    /** Size of a fixed-len cell in bytes */
+    uint64_t cell_size;
+    bool var_len;
+    std::vector<char> data;
+    std::vector<uint64_t> offsets;
+    /** Number of result bytes and cells of the last read */
+    uint64_t data_size;
+    uint64_t num_cells;
+    /** False if the column is not in the schema of the read fragments */
+    bool read;
+  };
+
+  /** Start and end timestamps, URI and staleness of a fragment. */
+  using Fragment = std::tuple<uint64_t, uint64_t, std::string, bool>;
+
+  /** A set of fragments with overlapping timestamp ranges. */
+  struct FragmentGroup {
+    std::vector<std::string> uris;
+    std::pair<uint64_t, uint64_t> timestamps;
+    bool stale = false;
+  };
+
+  std::shared_ptr<Context> ctx_;
+  std::string uri_;
+  std::vector<std::string> attrs_;
+  uint64_t memory_budget_;
+
+  /**
+   * Finishes the swaps of a previous run that committed their rewritten
+   * fragment but did not delete the originals, and removes the deleted
+   * fragments from `fragments`.
+   */
+  void finish_pending_swaps(std::vector<Fragment>* fragments);
+
+  /** Deletes the given fragments of the array. */
+  void delete_fragments(const std::vector<std::string>& uris) const;
+
+  /**
+   * Rewrites the fragments of `group` as one fragment on the latest schema.
+   * The swap is recorded in the array metadata while it is in progress.
+   */
+  void rewrite(const FragmentGroup& group);
+
+  /**
+   * Moves the fields of the read cells out of the blobs into the attributes.
+   * Blob and attribute columns are replaced by the rewritten cells.
+   */
+  void backfill_cells(std::vector<Column>* columns) const;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_ATTRIBUTE_BACKFILL_H
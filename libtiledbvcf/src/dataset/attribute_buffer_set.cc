@@ -1,13 +1,22 @@
+#include <algorithm>
+#include <array>
+#include <sstream>
+
 #include "dataset/attribute_buffer_set.h"
 #include "read/in_memory_exporter.h"
+#include "utils/buffer_pool.h"
 #include "utils/logger_public.h"
+#include "vcf/vcf_utils.h"
 
 namespace tiledb {
 namespace vcf {
 
 AttributeBufferSet::AttributeBufferSet(bool verbose)
     : verbose_(verbose)
-    , number_of_buffers_(0){};
+    , number_of_buffers_(0)
+    , memory_budget_(0)
+    , observed_cells_(0)
+    , num_rebalances_(0){};
 
 AttributeBufferSet::BufferSizeByType AttributeBufferSet::compute_buffer_size(
     const std::unordered_set<std::string>& attr_names,
@@ -106,6 +115,7 @@ void AttributeBufferSet::allocate_fixed(
   clear();
   fixed_alloc_.clear();
   auto version = dataset->metadata().version;
+  memory_budget_ = memory_budget;
 
   buffer_size_by_type_ =
       compute_buffer_size(attr_names, memory_budget, dataset);
@@ -221,6 +231,11 @@ void AttributeBufferSet::allocate_fixed(
         s == attrNamesV2::qual) {
       qual_.resize(buffer_size_by_type_.float32_buffer_size);
       fixed_alloc_.emplace_back(false, s, &qual_, sizeof(float));
+    } else if (
+        s == attrNamesV4::genotype &&
+        version == TileDBVCFDataset::Version::V4) {
+      genotype_.resize(buffer_size_by_type_.int32_buffer_size);
+      fixed_alloc_.emplace_back(false, s, &genotype_, sizeof(uint32_t));
     } else if (
         s == attrNamesV4::alleles || s == attrNamesV3::alleles ||
         s == attrNamesV2::alleles) {
@@ -257,6 +272,10 @@ void AttributeBufferSet::allocate_fixed(
       fixed_alloc_.emplace_back(true, s, &buff, sizeof(char));
     }
   }
+
+  observed_bytes_.assign(fixed_alloc_.size(), 0);
+  observed_cells_ = 0;
+  estimated_bytes_per_cell_.clear();
 }
 
 uint64_t AttributeBufferSet::total_size() const {
@@ -270,6 +289,8 @@ uint64_t AttributeBufferSet::total_size() const {
   total_size += pos_.size();
   total_size += real_end_.size();
   total_size += qual_.size();
+  total_size += is_ref_block_.size();
+  total_size += genotype_.size();
 
   // Var-len attributes
   total_size += sample_name_.size();
@@ -306,6 +327,8 @@ void AttributeBufferSet::clear() {
   pos_.clear();
   real_end_.clear();
   qual_.clear();
+  is_ref_block_.clear();
+  genotype_.clear();
 
   // Var-len attributes
   sample_name_.clear();
@@ -407,6 +430,19 @@ void AttributeBufferSet::set_buffers(
           TileDBVCFDataset::AttrNames::V4::fmt,
           (uint64_t*)fmt_.offsets().data(),
           fmt_.offsets().size());
+      // Only buffered for datasets with the attribute.
+      if (is_ref_block_.size() > 0) {
+        query->set_data_buffer(
+            TileDBVCFDataset::AttrNames::V4::is_ref_block,
+            is_ref_block_.data<void>(),
+            is_ref_block_.nelts<uint8_t>());
+      }
+      if (genotype_.size() > 0) {
+        query->set_data_buffer(
+            TileDBVCFDataset::AttrNames::V4::genotype,
+            genotype_.data<void>(),
+            genotype_.nelts<uint32_t>());
+      }
     } else if (version == TileDBVCFDataset::Version::V3) {
       query->set_data_buffer(
           TileDBVCFDataset::DimensionNames::V3::sample,
@@ -626,6 +662,18 @@ void AttributeBufferSet::clear_query_buffers(
           TileDBVCFDataset::AttrNames::V4::fmt,
           (uint64_t*)fmt_.offsets().data(),
           0);
+      if (is_ref_block_.size() > 0) {
+        query->set_data_buffer(
+            TileDBVCFDataset::AttrNames::V4::is_ref_block,
+            is_ref_block_.data<void>(),
+            0);
+      }
+      if (genotype_.size() > 0) {
+        query->set_data_buffer(
+            TileDBVCFDataset::AttrNames::V4::genotype,
+            genotype_.data<void>(),
+            0);
+      }
     } else if (version == TileDBVCFDataset::Version::V3) {
       query->set_data_buffer(
           TileDBVCFDataset::DimensionNames::V3::sample,
@@ -819,6 +867,22 @@ Buffer& AttributeBufferSet::qual() {
   return qual_;
 }
 
+const Buffer& AttributeBufferSet::is_ref_block() const {
+  return is_ref_block_;
+}
+
+Buffer& AttributeBufferSet::is_ref_block() {
+  return is_ref_block_;
+}
+
+const Buffer& AttributeBufferSet::genotype() const {
+  return genotype_;
+}
+
+Buffer& AttributeBufferSet::genotype() {
+  return genotype_;
+}
+
 const Buffer& AttributeBufferSet::alleles() const {
   return alleles_;
 }
@@ -859,7 +923,19 @@ Buffer& AttributeBufferSet::fmt() {
   return fmt_;
 }
 
-std::vector<int> AttributeBufferSet::gt(int index) const {
+void AttributeBufferSet::gt(int index, std::vector<int>* result) const {
+  result->clear();
+
+  // Fast path: fixed-width packed genotype
+  if (genotype_.size() > 0) {
+    int32_t values[2];
+    const int ploidy =
+        VCFUtils::decode_compact_gt(genotype_.value<uint32_t>(index), values);
+    for (int i = 0; i < ploidy; i++)
+      result->push_back(bcf_gt_allele(values[i]));
+    return;
+  }
+
   const Buffer* src = nullptr;
   if (!extra_attr("fmt_GT", &src)) {
     throw std::runtime_error("fmt_GT must be an extracted attribute.");
@@ -871,11 +947,9 @@ std::vector<int> AttributeBufferSet::gt(int index) const {
   ptr++;  // skip type
   int num_values = *ptr++;
 
-  std::vector<int> result;
   while (num_values--) {
-    result.push_back(bcf_gt_allele(*ptr++));
+    result->push_back(bcf_gt_allele(*ptr++));
   }
-  return result;
 }
 
 const std::unordered_map<std::string, Buffer>& AttributeBufferSet::extra_attrs()
@@ -919,5 +993,169 @@ uint64_t AttributeBufferSet::nbuffers() const {
   return number_of_buffers_;
 }
 
+void AttributeBufferSet::record_usage(
+    const tiledb::Query& query, uint64_t num_cells) {
+  if (num_cells == 0 || fixed_alloc_.empty())
+    return;
+
+  auto result_el = query.result_buffer_elements();
+  for (size_t i = 0; i < fixed_alloc_.size(); i++) {
+    const std::string& name = std::get<1>(fixed_alloc_[i]);
+    unsigned datatype_size = std::get<3>(fixed_alloc_[i]);
+    observed_bytes_[i] += result_el[name].second * datatype_size;
+  }
+  observed_cells_ += num_cells;
+}
+
+void AttributeBufferSet::estimate_usage(const tiledb::Query& query) {
+  // Estimate the number of result cells from a fixed-length buffer.
+  uint64_t est_cells = 0;
+  for (const auto& p : fixed_alloc_) {
+    if (!std::get<0>(p)) {
+      est_cells = query.est_result_size(std::get<1>(p)) / std::get<3>(p);
+      break;
+    }
+  }
+  if (est_cells == 0)
+    return;
+
+  estimated_bytes_per_cell_.assign(fixed_alloc_.size(), 0);
+  for (size_t i = 0; i < fixed_alloc_.size(); i++) {
+    bool var_num = std::get<0>(fixed_alloc_[i]);
+    const std::string& name = std::get<1>(fixed_alloc_[i]);
+    unsigned datatype_size = std::get<3>(fixed_alloc_[i]);
+    if (var_num) {
+      std::array<uint64_t, 2> est_size = query.est_result_size_var(name);
+      estimated_bytes_per_cell_[i] =
+          static_cast<double>(est_size[1]) / est_cells;
+    } else {
+      estimated_bytes_per_cell_[i] = datatype_size;
+    }
+  }
+}
+
+bool AttributeBufferSet::has_usage() const {
+  return observed_cells_ > 0 || !estimated_bytes_per_cell_.empty();
+}
+
+double AttributeBufferSet::bytes_per_cell(size_t index) const {
+  double bytes = observed_cells_ > 0 ?
+                     static_cast<double>(observed_bytes_[index]) /
+                         observed_cells_ :
+                     estimated_bytes_per_cell_[index];
+
+  // Keep at least one element per cell so empty values still fit.
+  return std::max<double>(bytes, std::get<3>(fixed_alloc_[index]));
+}
+
+bool AttributeBufferSet::rebalance() {
+  // A zero budget is used by the tests to force small, incomplete reads.
+  if (memory_budget_ == 0 || fixed_alloc_.empty() || !has_usage())
+    return false;
+
+  // Number of cells that fit in the budget if every buffer is sized to its
+  // bytes per cell, counting the offsets of var-length buffers.
+  double cell_bytes = 0;
+  for (size_t i = 0; i < fixed_alloc_.size(); i++) {
+    cell_bytes += bytes_per_cell(i);
+    if (std::get<0>(fixed_alloc_[i]))
+      cell_bytes += sizeof(uint64_t);
+  }
+  const uint64_t ncells = memory_budget_ / cell_bytes;
+  if (ncells == 0)
+    return false;
+
+  // Only reallocate if a buffer is more than 25% away from its share.
+  std::vector<uint64_t> sizes(fixed_alloc_.size());
+  bool changed = false;
+  for (size_t i = 0; i < fixed_alloc_.size(); i++) {
+    const Buffer* buff = std::get<2>(fixed_alloc_[i]);
+    unsigned datatype_size = std::get<3>(fixed_alloc_[i]);
+    sizes[i] = static_cast<uint64_t>(ncells * bytes_per_cell(i)) /
+               datatype_size * datatype_size;
+    const double ratio = static_cast<double>(sizes[i]) / buff->size();
+    changed |= ratio < 0.75 || ratio > 1.25;
+  }
+  if (!changed)
+    return false;
+
+  for (size_t i = 0; i < fixed_alloc_.size(); i++) {
+    Buffer* buff = std::get<2>(fixed_alloc_[i]);
+
+    // Swap in a new allocation so shrunk buffers release their memory.
+    Buffer resized;
+    resized.resize(sizes[i]);
+    if (std::get<0>(fixed_alloc_[i]))
+      resized.offsets().resize(ncells);
+    buff->swap(resized);
+  }
+  num_rebalances_++;
+
+  if (verbose_) {
+    LOG_DEBUG(
+        "Rebalanced {} buffers for {} cells: {}",
+        fixed_alloc_.size(),
+        ncells,
+        autotune_stats());
+  }
+  return true;
+}
+
+std::string AttributeBufferSet::autotune_stats() const {
+  std::stringstream ss;
+  ss << "{\"rebalances\": " << num_rebalances_
+     << ", \"observed_cells\": " << observed_cells_ << ", \"buffers\": {";
+  for (size_t i = 0; i < fixed_alloc_.size(); i++) {
+    const Buffer* buff = std::get<2>(fixed_alloc_[i]);
+    double bytes = has_usage() ? bytes_per_cell(i) : 0;
+    ss << (i > 0 ? ", " : "") << "\"" << std::get<1>(fixed_alloc_[i])
+       << "\": {\"bytes_per_cell\": " << bytes
+       << ", \"data_bytes\": " << buff->size()
+       << ", \"offsets\": " << buff->offsets().size() << "}";
+  }
+  ss << "}}";
+  return ss.str();
+}
+
+void AttributeBufferSet::reserve_high_water() {
+  for (auto& named : named_buffers()) {
+    named.second->reserve(buffer_pool::high_water(named.first));
+    named.second->reserve_offsets(
+        buffer_pool::high_water(named.first + ".offsets"));
+  }
+}
+
+void AttributeBufferSet::update_high_water() {
+  for (auto& named : named_buffers()) {
+    buffer_pool::update_high_water(named.first, named.second->alloced_size());
+    buffer_pool::update_high_water(
+        named.first + ".offsets", named.second->offsets().capacity());
+  }
+}
+
+std::vector<std::pair<std::string, Buffer*>>
+AttributeBufferSet::named_buffers() {
+  std::vector<std::pair<std::string, Buffer*>> result = {
+      {"sample_name", &sample_name_},
+      {"sample", &sample_},
+      {"contig", &contig_},
+      {"start_pos", &start_pos_},
+      {"pos", &pos_},
+      {"real_end", &real_end_},
+      {"real_start_pos", &real_start_pos_},
+      {"end_pos", &end_pos_},
+      {"qual", &qual_},
+      {"is_ref_block", &is_ref_block_},
+      {"genotype", &genotype_},
+      {"alleles", &alleles_},
+      {"id", &id_},
+      {"filter_ids", &filter_ids_},
+      {"info", &info_},
+      {"fmt", &fmt_}};
+  for (auto& it : extra_attrs_)
+    result.emplace_back(it.first, &it.second);
+  return result;
+}
+
 }  // namespace vcf
 }  // namespace tiledb
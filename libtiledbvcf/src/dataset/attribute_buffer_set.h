@@ -172,6 +172,18 @@ class AttributeBufferSet {
   /** qual buffer. */
   Buffer& qual();
 
+  /** is_ref_block buffer. */
+  const Buffer& is_ref_block() const;
+
+  /** is_ref_block buffer. */
+  Buffer& is_ref_block();
+
+  /** genotype buffer. */
+  const Buffer& genotype() const;
+
+  /** genotype buffer. */
+  Buffer& genotype();
+
   /** id buffer. */
   const Buffer& id() const;
 
@@ -202,8 +214,14 @@ class AttributeBufferSet {
   /** fmt buffer. */
   Buffer& fmt();
 
-  /** Get GT at the provided index. */
-  std::vector<int> gt(int index) const;
+  /**
+   * Get the allele indexes of the GT at the provided index (-1 if missing),
+   * from the compact genotype attribute if it was read, else from fmt_GT.
+   *
+   * @param index Cell index
+   * @param result Set to the allele indexes
+   */
+  void gt(int index, std::vector<int>* result) const;
 
   /** Set of buffers for optional "extracted"/"extra" info/fmt attributes. */
   const std::unordered_map<std::string, Buffer>& extra_attrs() const;
@@ -236,7 +254,54 @@ class AttributeBufferSet {
    */
   uint64_t nbuffers() const;
 
+  /**
+   * Records the bytes per cell of each fixed-alloced buffer from the results
+   * of a submitted read query.
+   *
+   * @param query Submitted query using these buffers
+   * @param num_cells Number of cells in the query results
+   */
+  void record_usage(const tiledb::Query& query, uint64_t num_cells);
+
+  /**
+   * Estimates the bytes per cell of each fixed-alloced buffer from the
+   * estimated result sizes of a read query, which TileDB computes from the
+   * fragment metadata. Only used until results have been recorded.
+   *
+   * @param query Read query with its subarray set
+   */
+  void estimate_usage(const tiledb::Query& query);
+
+  /** Returns true if there are observed or estimated bytes per cell. */
+  bool has_usage() const;
+
+  /**
+   * Re-apportions the memory budget given to `allocate_fixed` between the
+   * fixed-alloced buffers in proportion to their bytes per cell, so that all
+   * buffers fill at about the same number of cells. Buffers are only
+   * reallocated if their share changed significantly.
+   *
+   * @return True if the buffers were reallocated
+   */
+  bool rebalance();
+
+  /** Returns a JSON summary of the buffer autotuning decisions. */
+  std::string autotune_stats() const;
+
+  /**
+   * Reserves each buffer and its offsets to the high water mark recorded for
+   * it in the buffer pool, so that the buffers of a new worker are allocated
+   * once instead of growing through copies.
+   */
+  void reserve_high_water();
+
+  /** Records the allocated size of each buffer in the buffer pool. */
+  void update_high_water();
+
  private:
+  /** Returns (name, buffer) for all buffers, keyed in the buffer pool. */
+  std::vector<std::pair<std::string, Buffer*>> named_buffers();
+
   /** sample_name v4 dimension (string) */
   Buffer sample_name_;
 
@@ -264,6 +329,12 @@ class AttributeBufferSet {
   /** qual v3/v2 attribute (float) */
   Buffer qual_;
 
+  /** Optional is_ref_block v4 attribute (uint8_t) */
+  Buffer is_ref_block_;
+
+  /** Optional genotype v4 attribute (uint32_t) */
+  Buffer genotype_;
+
   /** CSV alleles v3/v2 attribute list (var-len char) */
   Buffer alleles_;
 
@@ -296,6 +367,25 @@ class AttributeBufferSet {
 
   /** Total number of buffers allocated */
   uint64_t number_of_buffers_;
+
+  /** Memory budget given to `allocate_fixed`, in bytes. */
+  uint64_t memory_budget_;
+
+  /** Observed data bytes per fixed-alloced buffer, parallel to
+   * `fixed_alloc_`. */
+  std::vector<uint64_t> observed_bytes_;
+
+  /** Total cells observed by `record_usage`. */
+  uint64_t observed_cells_;
+
+  /** Estimated data bytes per cell, parallel to `fixed_alloc_`. */
+  std::vector<double> estimated_bytes_per_cell_;
+
+  /** Number of times the buffers were reallocated by `rebalance`. */
+  uint64_t num_rebalances_;
+
+  /** Returns the bytes per cell of the fixed-alloced buffer at `index`. */
+  double bytes_per_cell(size_t index) const;
 };
 
 }  // namespace vcf
@@ -0,0 +1,217 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include "dataset/consolidation_planner.h"
+#include "utils/logger_public.h"
+
+namespace tiledb {
+namespace vcf {
+
+namespace {
+
+template <typename T>
+bool ranges_overlap(const std::pair<T, T>& a, const std::pair<T, T>& b) {
+  return a.first <= b.second && b.first <= a.second;
+}
+
+template <typename T>
+void extend_range(std::pair<T, T>* range, const std::pair<T, T>& other) {
+  range->first = std::min(range->first, other.first);
+  range->second = std::max(range->second, other.second);
+}
+
+}  // namespace
+
+ConsolidationPlanner::ConsolidationPlanner(
+    std::vector<Fragment> fragments, uint64_t target_bytes)
+    : fragments_(std::move(fragments)) {
+  // Group the fragments by contig range
+  std::map<std::pair<std::string, std::string>, std::vector<size_t>> by_contig;
+  for (size_t i = 0; i < fragments_.size(); i++)
+    by_contig[fragments_[i].contigs].push_back(i);
+
+  for (auto& entry : by_contig) {
+    auto& indexes = entry.second;
+    if (indexes.size() < 2)
+      continue;
+
+    // Adjacent sample batches are next to each other in sample order
+    std::sort(indexes.begin(), indexes.end(), [this](size_t a, size_t b) {
+      return fragments_[a].samples < fragments_[b].samples;
+    });
+
+    Group group;
+    group.contigs = entry.first;
+    Merge merge;
+    for (size_t i : indexes) {
+      // Fragments already at the target size are left alone
+      if (fragments_[i].size >= target_bytes) {
+        add_merge(merge, &group);
+        merge = Merge();
+        continue;
+      }
+      if (merge.bytes + fragments_[i].size > target_bytes) {
+        add_merge(merge, &group);
+        merge = Merge();
+      }
+      merge.fragments.push_back(i);
+      merge.bytes += fragments_[i].size;
+    }
+    add_merge(merge, &group);
+
+    if (!group.merges.empty())
+      groups_.push_back(std::move(group));
+  }
+
+  std::sort(groups_.begin(), groups_.end(), [](const Group& a, const Group& b) {
+    return a.bytes > b.bytes;
+  });
+}
+
+bool ConsolidationPlanner::conflicts(const Merge& merge) const {
+  const Fragment& first = fragments_[merge.fragments.front()];
+  auto timestamps = first.timestamps;
+  auto contigs = first.contigs;
+  auto start_pos = first.start_pos;
+  auto samples = first.samples;
+  for (size_t i : merge.fragments) {
+    extend_range(&timestamps, fragments_[i].timestamps);
+    extend_range(&contigs, fragments_[i].contigs);
+    extend_range(&start_pos, fragments_[i].start_pos);
+    extend_range(&samples, fragments_[i].samples);
+  }
+
+  for (size_t i = 0; i < fragments_.size(); i++) {
+    if (std::find(merge.fragments.begin(), merge.fragments.end(), i) !=
+        merge.fragments.end())
+      continue;
+    const Fragment& other = fragments_[i];
+    if (ranges_overlap(other.timestamps, timestamps) &&
+        ranges_overlap(other.contigs, contigs) &&
+        ranges_overlap(other.start_pos, start_pos) &&
+        ranges_overlap(other.samples, samples))
+      return true;
+  }
+  return false;
+}
+
+void ConsolidationPlanner::add_merge(const Merge& merge, Group* group) const {
+  if (merge.fragments.size() < 2)
+    return;
+
+  if (conflicts(merge)) {
+    LOG_DEBUG(
+        "[ConsolidationPlanner] Splitting merge of {} fragments of contigs "
+        "[{}, {}]; it overlaps another fragment",
+        merge.fragments.size(),
+        group->contigs.first,
+        group->contigs.second);
+    const size_t half = merge.fragments.size() / 2;
+    Merge left, right;
+    for (size_t j = 0; j < merge.fragments.size(); j++) {
+      Merge& side = j < half ? left : right;
+      side.fragments.push_back(merge.fragments[j]);
+      side.bytes += fragments_[merge.fragments[j]].size;
+    }
+    add_merge(left, group);
+    add_merge(right, group);
+    return;
+  }
+
+  Merge sorted = merge;
+  std::sort(
+      sorted.fragments.begin(),
+      sorted.fragments.end(),
+      [this](size_t a, size_t b) {
+        return fragments_[a].timestamps < fragments_[b].timestamps;
+      });
+  group->bytes += sorted.bytes;
+  group->merges.push_back(std::move(sorted));
+}
+
+const std::vector<ConsolidationPlanner::Fragment>&
+ConsolidationPlanner::fragments() const {
+  return fragments_;
+}
+
+const std::vector<ConsolidationPlanner::Group>& ConsolidationPlanner::groups()
+    const {
+  return groups_;
+}
+
+uint64_t ConsolidationPlanner::num_merges() const {
+  uint64_t result = 0;
+  for (const auto& group : groups_)
+    result += group.merges.size();
+  return result;
+}
+
+uint64_t ConsolidationPlanner::num_fragments_after() const {
+  uint64_t result = fragments_.size();
+  for (const auto& group : groups_) {
+    for (const auto& merge : group.merges)
+      result -= merge.fragments.size() - 1;
+  }
+  return result;
+}
+
+uint64_t ConsolidationPlanner::bytes_rewritten() const {
+  uint64_t result = 0;
+  for (const auto& group : groups_)
+    result += group.bytes;
+  return result;
+}
+
+uint64_t ConsolidationPlanner::total_bytes() const {
+  uint64_t result = 0;
+  for (const auto& fragment : fragments_)
+    result += fragment.size;
+  return result;
+}
+
+double ConsolidationPlanner::write_amplification() const {
+  const uint64_t total = total_bytes();
+  return total == 0 ? 0 : static_cast<double>(bytes_rewritten()) / total;
+}
+
+std::string ConsolidationPlanner::to_str() const {
+  return fmt::format(
+      "{} merges in {} contig groups: {} -> {} fragments, {:.1f} of {:.1f} MiB "
+      "rewritten (write amplification {:.2f})",
+      num_merges(),
+      groups_.size(),
+      fragments_.size(),
+      num_fragments_after(),
+      bytes_rewritten() / (1024.0 * 1024.0),
+      total_bytes() / (1024.0 * 1024.0),
+      write_amplification());
+}
+
+}  // namespace vcf
+}  // namespace tiledb
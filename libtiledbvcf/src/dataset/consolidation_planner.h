@@ -0,0 +1,146 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_CONSOLIDATION_PLANNER_H
+#define TILEDB_VCF_CONSOLIDATION_PLANNER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * Plans the consolidation of v4 data array fragments along the layout the
+ * ingestion writes them in: one fragment per (sample batch, contig group).
+ *
+ * Fragments are grouped by contig range. Within a group, fragments are
+ * ordered by sample range and runs of adjacent sample batches are merged into
+ * fragments of about the target size. A merge is only planned if TileDB can
+ * perform it: no fragment outside the merge may overlap both its timestamp
+ * range and the union of its non-empty domains.
+ */
+class ConsolidationPlanner {
+ public:
+  /** A data array fragment, as described by its fragment metadata. */
+  struct Fragment {
+    /** Fragment URI */
+    std::string uri;
+    /** Range of contigs in the fragment */
+    std::pair<std::string, std::string> contigs;
+    /** Range of start positions in the fragment */
+    std::pair<uint32_t, uint32_t> start_pos;
+    /** Range of sample names in the fragment */
+    std::pair<std::string, std::string> samples;
+    /** Timestamp range of the fragment */
+    std::pair<uint64_t, uint64_t> timestamps;
+    /** Size of the fragment in bytes */
+    uint64_t size;
+  };
+
+  /** A set of fragments consolidated into one. */
+  struct Merge {
+    /** Indexes of the merged fragments, in timestamp order */
+    std::vector<size_t> fragments;
+    /** Total size of the merged fragments in bytes */
+    uint64_t bytes = 0;
+  };
+
+  /** The merges of one contig range. They run one after the other. */
+  struct Group {
+    /** Range of contigs of the group */
+    std::pair<std::string, std::string> contigs;
+    /** Merges, in sample order */
+    std::vector<Merge> merges;
+    /** Total size of the merged fragments in bytes */
+    uint64_t bytes = 0;
+  };
+
+  /**
+   * Plans the consolidation of the given fragments.
+   *
+   * @param fragments All fragments of the data array
+   * @param target_bytes Target size of a consolidated fragment
+   */
+  ConsolidationPlanner(std::vector<Fragment> fragments, uint64_t target_bytes);
+
+  /** Returns the fragments the plan was made for. */
+  const std::vector<Fragment>& fragments() const;
+
+  /**
+   * Returns the groups with at least one merge, largest first, so that
+   * running them on a pool of workers keeps the longest group from starting
+   * last.
+   */
+  const std::vector<Group>& groups() const;
+
+  /** Returns the number of planned merges. */
+  uint64_t num_merges() const;
+
+  /** Returns the number of fragments once every merge has run. */
+  uint64_t num_fragments_after() const;
+
+  /** Returns the number of bytes rewritten by the merges. */
+  uint64_t bytes_rewritten() const;
+
+  /** Returns the total size of the fragments in bytes. */
+  uint64_t total_bytes() const;
+
+  /**
+   * Returns the write amplification of the plan: the bytes rewritten divided
+   * by the total size of the data array.
+   */
+  double write_amplification() const;
+
+  /** Returns a one line summary of the plan. */
+  std::string to_str() const;
+
+ private:
+  /** All fragments of the data array */
+  std::vector<Fragment> fragments_;
+
+  /** Planned groups, largest first */
+  std::vector<Group> groups_;
+
+  /**
+   * Returns true if a fragment outside `merge` overlaps both the timestamp
+   * range and the non-empty domain of the merged fragments.
+   */
+  bool conflicts(const Merge& merge) const;
+
+  /**
+   * Appends `merge` to `group` if it merges at least two fragments. A merge
+   * TileDB would reject is split in two, recursively.
+   */
+  void add_merge(const Merge& merge, Group* group) const;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_CONSOLIDATION_PLANNER_H
@@ -0,0 +1,138 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "dataset/dataset_handle.h"
+#include "utils/logger_public.h"
+#include "utils/utils.h"
+
+namespace tiledb {
+namespace vcf {
+
+std::shared_ptr<DatasetHandle> DatasetHandle::open(
+    const std::string& uri,
+    const std::vector<std::string>& tiledb_config,
+    uint64_t header_cache_bytes) {
+  return std::shared_ptr<DatasetHandle>(
+      new DatasetHandle(uri, tiledb_config, header_cache_bytes));
+}
+
+DatasetHandle::DatasetHandle(
+    const std::string& uri,
+    const std::vector<std::string>& tiledb_config,
+    uint64_t header_cache_bytes)
+    : uri_(uri)
+    , tiledb_config_(tiledb_config)
+    , header_cache_bytes_(header_cache_bytes) {
+  // Same defaults as a reader's own context
+  tiledb::Config cfg;
+  cfg["sm.compute_concurrency_level"] =
+      uint64_t(std::thread::hardware_concurrency() * 1.5f);
+  cfg.set("sm.skip_est_size_partitioning", "true");
+  utils::set_tiledb_config(tiledb_config_, &cfg);
+  ctx_ = std::make_shared<tiledb::Context>(cfg);
+  utils::set_htslib_tiledb_context(tiledb_config_);
+
+  auto start = std::chrono::steady_clock::now();
+  dataset_ = open_snapshot();
+  data_uri_ = dataset_->data_uri();
+  version_ = data_array_version();
+  LOG_DEBUG(
+      "[DatasetHandle] Opened '{}' ({} fragments) in {:.3f} seconds",
+      uri_,
+      version_.first,
+      utils::chrono_duration(start));
+}
+
+const std::string& DatasetHandle::uri() const {
+  return uri_;
+}
+
+const std::vector<std::string>& DatasetHandle::tiledb_config() const {
+  return tiledb_config_;
+}
+
+std::shared_ptr<tiledb::Context> DatasetHandle::ctx() const {
+  return ctx_;
+}
+
+std::shared_ptr<TileDBVCFDataset> DatasetHandle::dataset() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return dataset_;
+}
+
+bool DatasetHandle::refresh() {
+  // Readers keep using the current snapshot while a new one opens.
+  std::lock_guard<std::mutex> refresh_lock(refresh_mtx_);
+  const Version version = data_array_version();
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (version == version_)
+      return false;
+  }
+
+  auto dataset = open_snapshot();
+  LOG_DEBUG(
+      "[DatasetHandle] Refreshed '{}': {} -> {} fragments",
+      uri_,
+      version_.first,
+      version.first);
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  dataset_ = std::move(dataset);
+  version_ = version;
+  return true;
+}
+
+DatasetHandle::Version DatasetHandle::data_array_version() const {
+  tiledb::FragmentInfo fragment_info(*ctx_, data_uri_);
+  fragment_info.load();
+
+  Version version(fragment_info.fragment_num(), 0);
+  for (uint32_t i = 0; i < version.first; i++)
+    version.second =
+        std::max(version.second, fragment_info.timestamp_range(i).second);
+  return version;
+}
+
+std::shared_ptr<TileDBVCFDataset> DatasetHandle::open_snapshot() const {
+  auto dataset = std::make_shared<TileDBVCFDataset>(ctx_);
+  dataset->open(uri_, tiledb_config_, true);
+  dataset->set_vcf_header_cache_size(header_cache_bytes_);
+
+  // Load the state every reader needs up front, instead of in the first
+  // query that happens to use it.
+  if (dataset->metadata().version == TileDBVCFDataset::Version::V4) {
+    dataset->load_sample_names_v4();
+    dataset->fragment_domains_v4();
+  }
+  return dataset;
+}
+
+}  // namespace vcf
+}  // namespace tiledb
@@ -0,0 +1,137 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_DATASET_HANDLE_H
+#define TILEDB_VCF_DATASET_HANDLE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tiledb/tiledb>
+#include <utility>
+#include <vector>
+
+#include "dataset/tiledbvcfdataset.h"
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * An opened dataset shared read-only by many readers in one process.
+ *
+ * Opening a dataset reopens its group and arrays and reloads its metadata,
+ * sample names and fragment domains. A handle pays that cost once: readers
+ * opened on it share the TileDB context (and so its tile cache), the open
+ * arrays, the lazily loaded dataset state and a cache of VCF header text.
+ *
+ * Readers hold on to the dataset snapshot they were opened on. `refresh`
+ * opens a new snapshot when fragments were added to or removed from the data
+ * array; readers opened afterwards see the new data.
+ */
+class DatasetHandle {
+ public:
+  /**
+   * Opens the dataset at `uri`.
+   *
+   * @param uri Dataset URI
+   * @param tiledb_config TileDB config options ("key=value")
+   * @param header_cache_bytes Maximum size of the cached VCF header text
+   */
+  static std::shared_ptr<DatasetHandle> open(
+      const std::string& uri,
+      const std::vector<std::string>& tiledb_config = {},
+      uint64_t header_cache_bytes = 64 * 1024 * 1024);
+
+  DatasetHandle(const DatasetHandle&) = delete;
+  DatasetHandle& operator=(const DatasetHandle&) = delete;
+
+  /** Returns the dataset URI. */
+  const std::string& uri() const;
+
+  /** Returns the TileDB config options the dataset was opened with. */
+  const std::vector<std::string>& tiledb_config() const;
+
+  /** Returns the TileDB context shared by the readers of the handle. */
+  std::shared_ptr<tiledb::Context> ctx() const;
+
+  /** Returns the current dataset snapshot. */
+  std::shared_ptr<TileDBVCFDataset> dataset() const;
+
+  /**
+   * Opens a new snapshot if the fragments of the data array changed since
+   * the current one was opened. Thread-safe.
+   *
+   * @return True if a new snapshot was opened
+   */
+  bool refresh();
+
+ private:
+  /** Number of fragments and last write timestamp of the data array. */
+  typedef std::pair<uint32_t, uint64_t> Version;
+
+  DatasetHandle(
+      const std::string& uri,
+      const std::vector<std::string>& tiledb_config,
+      uint64_t header_cache_bytes);
+
+  /** Dataset URI */
+  const std::string uri_;
+
+  /** TileDB config options */
+  const std::vector<std::string> tiledb_config_;
+
+  /** Maximum size of the cached VCF header text of a snapshot */
+  const uint64_t header_cache_bytes_;
+
+  /** Shared TileDB context */
+  std::shared_ptr<tiledb::Context> ctx_;
+
+  /** URI of the data array */
+  std::string data_uri_;
+
+  /** Serializes refreshes */
+  std::mutex refresh_mtx_;
+
+  /** Protects `dataset_` and `version_` */
+  mutable std::mutex mtx_;
+
+  /** Current snapshot */
+  std::shared_ptr<TileDBVCFDataset> dataset_;
+
+  /** Data array version of the current snapshot */
+  Version version_;
+
+  /** Returns the current version of the data array. */
+  Version data_array_version() const;
+
+  /** Opens a snapshot of the dataset and preloads its shared state. */
+  std::shared_ptr<TileDBVCFDataset> open_snapshot() const;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_DATASET_HANDLE_H
@@ -25,12 +25,18 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <future>
 #include <map>
+#include <random>
 #include <string>
 #include <vector>
 
+#include <fmt/ranges.h>
+
 #include "base64/base64.h"
+#include "dataset/attribute_backfill.h"
+#include "dataset/consolidation_planner.h"
 #include "dataset/tiledbvcfdataset.h"
 #include "read/export_format.h"
 #include "read/reader.h"
@@ -38,6 +44,7 @@
 #include "stats/sample_stats.h"
 #include "stats/variant_stats.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/sample_utils.h"
 #include "utils/unique_rwlock.h"
 #include "utils/utils.h"
@@ -68,6 +75,8 @@ const std::string attrNamesV4::id = "id";
 const std::string attrNamesV4::filter_ids = "filter_ids";
 const std::string attrNamesV4::info = "info";
 const std::string attrNamesV4::fmt = "fmt";
+const std::string attrNamesV4::is_ref_block = "is_ref_block";
+const std::string attrNamesV4::genotype = "genotype";
 
 using attrNamesV3 = TileDBVCFDataset::AttrNames::V3;
 const std::string attrNamesV3::real_start_pos = "real_start_pos";
@@ -102,11 +111,129 @@ FilterList default_offsets_filter_list(const Context& ctx) {
       .add_filter({ctx, TILEDB_FILTER_ZSTD});
   return offsets_filters;
 }
+
+/** Parses a header from the vcf_headers array and adds its sample. */
+SafeBCFHdr parse_vcf_header(
+    const std::string& hdr_str, const std::string& sample) {
+  SafeBCFHdr hdr(bcf_hdr_init("r"), bcf_hdr_destroy);
+  if (!hdr) {
+    throw std::runtime_error(
+        "Error fetching VCF header data; error allocating VCF header.");
+  }
+
+  if (0 != bcf_hdr_parse(hdr.get(), const_cast<char*>(hdr_str.c_str()))) {
+    throw std::runtime_error(
+        "TileDBVCFDataset::fetch_vcf_headers_v4: Error parsing the BCF "
+        "header for sample " +
+        sample + ".");
+  }
+
+  if (!sample.empty()) {
+    if (0 != bcf_hdr_add_sample(hdr.get(), sample.c_str())) {
+      throw std::runtime_error(
+          "TileDBVCFDataset::fetch_vcf_headers_v4: Error adding sample to "
+          "BCF header for sample " +
+          sample + ".");
+    }
+  }
+
+  if (bcf_hdr_sync(hdr.get()) < 0) {
+    throw std::runtime_error("Error in bcftools: failed to update VCF header.");
+  }
+  return hdr;
+}
+
+/** Reads a base64 encoded CSV list from the metadata of an array. */
+std::vector<std::string> get_csv_metadata(
+    const Array& array, const std::string& name) {
+  const void* ptr = nullptr;
+  tiledb_datatype_t dtype;
+  uint32_t value_num = 0;
+  array.get_metadata(name, &dtype, &value_num, &ptr);
+  if (ptr == nullptr)
+    return {};
+  if (dtype != TILEDB_CHAR)
+    throw std::runtime_error(
+        "Error loading metadata; '" + name + "' field has invalid value.");
+  std::string b64_str(static_cast<const char*>(ptr), value_num);
+  return utils::split(base64_decode(b64_str), ',');
+}
+
+/** Stores a list as a base64 encoded CSV string in the metadata of an array. */
+void put_csv_metadata(
+    Array& array,
+    const std::string& name,
+    const std::vector<std::string>& values) {
+  std::stringstream val_strstr;
+  for (unsigned i = 0; i < values.size(); i++) {
+    val_strstr << values[i];
+    if (i < values.size() - 1)
+      val_strstr << ',';
+  }
+  std::string val_str = val_strstr.str();
+  std::string b64_str = base64_encode(val_str.c_str(), val_str.size());
+  array.put_metadata(name, TILEDB_CHAR, b64_str.size(), b64_str.data());
+}
+
+/** Reads a base64 encoded CSV list of pairs from the metadata of an array. */
+std::map<std::string, uint32_t> get_csv_pairs_metadata(
+    const Array& array, const std::string& name) {
+  std::map<std::string, uint32_t> result;
+  for (const auto& p : get_csv_metadata(array, name)) {
+    auto pair = utils::split(p, '\t');
+    result[pair[0]] = (uint32_t)std::stoul(pair[1]);
+  }
+  return result;
+}
+
+/** Stores pairs as a base64 encoded CSV string in the metadata of an array. */
+void put_csv_pairs_metadata(
+    Array& array,
+    const std::string& name,
+    const std::map<std::string, uint32_t>& values) {
+  std::vector<std::string> pairs;
+  for (const auto& s : values)
+    pairs.push_back(s.first + '\t' + std::to_string(s.second));
+  put_csv_metadata(array, name, pairs);
+}
+
+/**
+ * Metadata key of the contig anchor gaps. Each ingestion that grows some
+ * gaps stores them under its own key with this prefix, so concurrent
+ * ingestions never overwrite each other.
+ */
+const std::string contig_anchor_gaps_key = "contig_anchor_gaps";
+
+/**
+ * Reads the contig anchor gaps recorded by all ingestions, keeping the
+ * largest gap of each contig.
+ */
+std::map<std::string, uint32_t> get_contig_anchor_gaps(const Array& array) {
+  std::map<std::string, uint32_t> result;
+  for (uint64_t i = 0; i < array.metadata_num(); i++) {
+    std::string key;
+    tiledb_datatype_t dtype;
+    uint32_t value_num = 0;
+    const void* value = nullptr;
+    array.get_metadata_from_index(i, &key, &dtype, &value_num, &value);
+    if (key != contig_anchor_gaps_key &&
+        !utils::starts_with(key, contig_anchor_gaps_key + "/"))
+      continue;
+    for (const auto& contig_gap : get_csv_pairs_metadata(array, key)) {
+      auto& gap = result[contig_gap.first];
+      gap = std::max(gap, contig_gap.second);
+    }
+  }
+  return result;
+}
 }  // namespace
 
 TileDBVCFDataset::TileDBVCFDataset(std::shared_ptr<Context> ctx)
     : open_(false)
+    , ref_block_flag_(false)
+    , compact_gt_(false)
     , data_array_fragment_info_loaded_(false)
+    , fragment_domains_loaded_(false)
     , ctx_(ctx)
     , tiledb_stats_enabled_(true)
     , tiledb_stats_enabled_vcf_header_(true)
@@ -223,11 +350,13 @@ void TileDBVCFDataset::create(const CreationParams& params) {
   Metadata metadata;
   metadata.tile_capacity = params.tile_capacity;
   metadata.anchor_gap = params.anchor_gap;
+  metadata.adaptive_anchor_gap = params.adaptive_anchor_gap;
   metadata.extra_attributes = params.extra_attributes;
   metadata.free_sample_id = 0;
 
-  // Materialize fmt_GT if variant stats is enabled for AF filtering
-  if (params.enable_variant_stats) {
+  // Materialize fmt_GT if variant stats is enabled for AF filtering, unless
+  // the compact genotype attribute serves it
+  if (params.enable_variant_stats && !params.compact_gt) {
     bool found_gt = false;
     for (auto& attr : metadata.extra_attributes) {
       found_gt |= attr.compare("fmt_GT");
@@ -253,7 +382,10 @@ void TileDBVCFDataset::create(const CreationParams& params) {
       params.checksum,
       params.allow_duplicates,
       params.compress_sample_dim,
-      params.compression_level);
+      params.compression_level,
+      params.ref_block_flag,
+      params.compact_gt,
+      params.dictionary_encoding);
 
   if (params.enable_allele_count) {
     AlleleCount::create(ctx, params.uri, params.checksum);
@@ -346,7 +478,10 @@ void TileDBVCFDataset::create_empty_data_array(
     const tiledb_filter_type_t& checksum,
     const bool allow_duplicates,
     const bool compress_sample_dim,
-    const int compression_level) {
+    const int compression_level,
+    const bool ref_block_flag,
+    const bool compact_gt,
+    const bool dictionary_encoding) {
   ArraySchema schema(ctx, TILEDB_SPARSE);
   schema.set_capacity(metadata.tile_capacity);
   schema.set_order({{TILEDB_ROW_MAJOR, TILEDB_ROW_MAJOR}});
@@ -360,12 +495,14 @@ void TileDBVCFDataset::create_empty_data_array(
   FilterList int_attr_filters(ctx);
   FilterList float_attr_filters(ctx);
   FilterList byte_attr_filters(ctx);
+  FilterList dict_attr_filters(ctx);
 
   // Use tile level filtering
   str_attr_filters.set_max_chunk_size(0);
   int_attr_filters.set_max_chunk_size(0);
   float_attr_filters.set_max_chunk_size(0);
   byte_attr_filters.set_max_chunk_size(0);
+  dict_attr_filters.set_max_chunk_size(0);
 
   Filter compression(ctx, TILEDB_FILTER_ZSTD);
   compression.set_option(TILEDB_COMPRESSION_LEVEL, compression_level);
@@ -383,6 +520,8 @@ void TileDBVCFDataset::create_empty_data_array(
       .add_filter(compression);
   float_attr_filters.add_filter(compression);
   byte_attr_filters.add_filter(compression);
+  dict_attr_filters.add_filter({ctx, TILEDB_FILTER_DICTIONARY})
+      .add_filter(compression);
 
   auto offsets_filters = pos_coord_filters;
 
@@ -396,6 +535,7 @@ void TileDBVCFDataset::create_empty_data_array(
     int_attr_filters.add_filter(checksum_filter);
     float_attr_filters.add_filter(checksum_filter);
     byte_attr_filters.add_filter(checksum_filter);
+    dict_attr_filters.add_filter(checksum_filter);
   }
   schema.set_offsets_filter_list(offsets_filters);
 
@@ -430,10 +570,19 @@ void TileDBVCFDataset::create_empty_data_array(
       ctx, AttrNames::V4::end_pos, int_attr_filters);  // a1
   auto qual = Attribute::create<float>(
       ctx, AttrNames::V4::qual, float_attr_filters);  // a2
-  auto alleles = Attribute::create<std::vector<char>>(
-      ctx, AttrNames::V4::alleles, byte_attr_filters);  // a3
-  auto id = Attribute::create<std::vector<char>>(
-      ctx, AttrNames::V4::id, byte_attr_filters);  // a4
+  // The alleles and IDs of a site repeat across its samples, which are
+  // adjacent in a tile: dictionary encoding stores each value once per tile.
+  const auto string_attribute = [&](const std::string& name) {
+    if (!dictionary_encoding)
+      return Attribute::create<std::vector<char>>(
+          ctx, name, byte_attr_filters);
+    Attribute attr(ctx, name, TILEDB_STRING_ASCII);
+    attr.set_cell_val_num(TILEDB_VAR_NUM);
+    attr.set_filter_list(dict_attr_filters);
+    return attr;
+  };
+  auto alleles = string_attribute(AttrNames::V4::alleles);  // a3
+  auto id = string_attribute(AttrNames::V4::id);            // a4
   auto filters_ids = Attribute::create<std::vector<int32_t>>(
       ctx, AttrNames::V4::filter_ids, int_attr_filters);  // a5
   auto info = Attribute::create<std::vector<uint8_t>>(
@@ -443,6 +592,19 @@ void TileDBVCFDataset::create_empty_data_array(
   schema.add_attributes(
       real_start_pos, end_pos, qual, alleles, id, filters_ids, info, fmt);
 
+  // Flag of gVCF reference blocks, so variant-only reads can skip them with a
+  // query condition.
+  if (ref_block_flag) {
+    schema.add_attribute(Attribute::create<uint8_t>(
+        ctx, AttrNames::V4::is_ref_block, int_attr_filters));
+  }
+
+  // GT packed into a fixed-width value, read instead of the fmt_GT blob
+  if (compact_gt) {
+    schema.add_attribute(Attribute::create<uint32_t>(
+        ctx, AttrNames::V4::genotype, int_attr_filters));
+  }
+
   // Remaining INFO/FMT fields extracted as separate attributes:
   std::set<std::string> used;
   for (auto& attr : metadata.extra_attributes) {
@@ -538,6 +700,11 @@ void TileDBVCFDataset::open(
   TRY_CATCH_THROW(vcf_header_array_async.get());
   TRY_CATCH_THROW(data_array_async.get());
   read_metadata();
+  ref_block_flag_ =
+      metadata_.version == Version::V4 &&
+      data_array_->schema().has_attribute(AttrNames::V4::is_ref_block);
+  compact_gt_ = metadata_.version == Version::V4 &&
+                data_array_->schema().has_attribute(AttrNames::V4::genotype);
 
   // We support V2, V3 and V4 (current) formats.
   if (metadata_.version != Version::V2 && metadata_.version != Version::V3 &&
@@ -910,6 +1077,19 @@ void TileDBVCFDataset::print_dataset_stats() {
               << std::endl;
   std::cout << "- Tile capacity: " << metadata_.tile_capacity << std::endl;
   std::cout << "- Anchor gap: " << metadata_.anchor_gap << std::endl;
+  if (metadata_.adaptive_anchor_gap) {
+    std::cout << "- Contig anchor gaps: ";
+    if (metadata_.contig_anchor_gaps.empty())
+      std::cout << "none";
+    for (auto it = metadata_.contig_anchor_gaps.begin();
+         it != metadata_.contig_anchor_gaps.end();
+         ++it) {
+      if (it != metadata_.contig_anchor_gaps.begin())
+        std::cout << ", ";
+      std::cout << it->first << "=" << it->second;
+    }
+    std::cout << std::endl;
+  }
   std::cout << "- Number of samples: " << sample_names().size() << std::endl;
 
   std::cout << "- Extracted attributes: ";
@@ -1085,6 +1265,8 @@ std::unordered_map<uint32_t, SafeBCFHdr> TileDBVCFDataset::fetch_vcf_headers_v4(
     std::unordered_map<std::string, size_t>* lookup_map,
     bool all_samples,
     bool first_sample) const {
+  static auto& fetch_time = metrics::histogram("dataset.header_fetch");
+  metrics::ScopedTimer timer(fetch_time);
   LOG_DEBUG(
       "[fetch_vcf_headers_v4] start all_samples={} first_sample={} "
       "(VmRSS = {})",
@@ -1096,6 +1278,42 @@ std::unordered_map<uint32_t, SafeBCFHdr> TileDBVCFDataset::fetch_vcf_headers_v4(
   utils::UniqueReadLock lck_(
       const_cast<utils::RWLock*>(&vcf_header_array_lock_));
 
+  std::unordered_map<uint32_t, SafeBCFHdr> result;
+  uint32_t sample_idx = 0;
+
+  // Serve the requested samples from the header cache, and only query the
+  // vcf_headers array for the ones it misses.
+  const bool use_cache = vcf_header_cache_max_bytes_ > 0;
+  std::vector<SampleAndId> missing_samples;
+  const std::vector<SampleAndId>* query_samples = &samples;
+  if (use_cache && !samples.empty()) {
+    std::vector<std::pair<std::string, std::string>> hits;
+    {
+      std::lock_guard<std::mutex> lock(vcf_header_cache_mtx_);
+      for (const auto& sample : samples) {
+        auto it = vcf_header_cache_.find(sample.sample_name);
+        if (it == vcf_header_cache_.end())
+          missing_samples.push_back(sample);
+        else
+          hits.emplace_back(sample.sample_name, it->second);
+      }
+    }
+
+    for (const auto& hit : hits) {
+      result.emplace(sample_idx, parse_vcf_header(hit.second, hit.first));
+      if (lookup_map != nullptr)
+        (*lookup_map)[hit.first] = sample_idx;
+      ++sample_idx;
+    }
+    LOG_DEBUG(
+        "[fetch_vcf_headers_v4] {} of {} headers cached",
+        hits.size(),
+        samples.size());
+    if (missing_samples.empty())
+      return result;
+    query_samples = &missing_samples;
+  }
+
   if (!tiledb_stats_enabled_vcf_header_)
     tiledb::Stats::disable();
 
@@ -1109,8 +1327,6 @@ std::unordered_map<uint32_t, SafeBCFHdr> TileDBVCFDataset::fetch_vcf_headers_v4(
         "Cannot set first_sample and samples list in same fetch vcf headers "
         "request");
 
-  std::unordered_map<uint32_t, SafeBCFHdr> result;
-
   if (vcf_header_array_ == nullptr)
     throw std::runtime_error(
         "Cannot fetch TileDB-VCF vcf headers; Array object unexpectedly null");
@@ -1125,9 +1341,9 @@ std::unordered_map<uint32_t, SafeBCFHdr> TileDBVCFDataset::fetch_vcf_headers_v4(
   mq->select_columns({"sample", "header"});
 
   // By default all samples are read.
-  if (!samples.empty()) {
+  if (!query_samples->empty()) {
     // If samples are provided, only read those samples
-    for (const auto& sample : samples) {
+    for (const auto& sample : *query_samples) {
       mq->select_point("sample", sample.sample_name);
     }
   } else if (first_sample) {
@@ -1145,7 +1361,6 @@ std::unordered_map<uint32_t, SafeBCFHdr> TileDBVCFDataset::fetch_vcf_headers_v4(
     }
   }
 
-  uint32_t sample_idx = 0;
   while (!mq->is_complete()) {
     mq->submit();
     auto num_rows = mq->results()->num_rows();
@@ -1168,40 +1383,19 @@ std::unordered_map<uint32_t, SafeBCFHdr> TileDBVCFDataset::fetch_vcf_headers_v4(
       auto hdr_str = std::string(mq->string_view("header", i));
       auto sample = std::string(mq->string_view("sample", i));
 
-      bcf_hdr_t* hdr = bcf_hdr_init("r");
-      if (!hdr) {
-        throw std::runtime_error(
-            "Error fetching VCF header data; error allocating VCF header.");
-      }
-
-      if (0 != bcf_hdr_parse(hdr, const_cast<char*>(hdr_str.c_str()))) {
-        throw std::runtime_error(
-            "TileDBVCFDataset::fetch_vcf_headers_v4: Error parsing the BCF "
-            "header for sample " +
-            sample + ".");
-      }
-
-      if (!sample.empty()) {
-        if (0 != bcf_hdr_add_sample(hdr, sample.c_str())) {
-          throw std::runtime_error(
-              "TileDBVCFDataset::fetch_vcf_headers_v4: Error adding sample "
-              "to "
-              "BCF header for sample " +
-              sample + ".");
-        }
-      }
-
-      if (bcf_hdr_sync(hdr) < 0) {
-        throw std::runtime_error(
-            "Error in bcftools: failed to update VCF header.");
-      }
-
-      result.emplace(
-          std::make_pair(sample_idx, SafeBCFHdr(hdr, bcf_hdr_destroy)));
+      result.emplace(sample_idx, parse_vcf_header(hdr_str, sample));
       if (lookup_map != nullptr) {
         (*lookup_map)[sample] = sample_idx;
       }
 
+      if (use_cache) {
+        std::lock_guard<std::mutex> lock(vcf_header_cache_mtx_);
+        if (vcf_header_cache_bytes_ + hdr_str.size() <=
+                vcf_header_cache_max_bytes_ &&
+            vcf_header_cache_.emplace(sample, hdr_str).second)
+          vcf_header_cache_bytes_ += hdr_str.size();
+      }
+
       ++sample_idx;
 
       // Exit the query loop if we only want the first sample.
@@ -1514,7 +1708,18 @@ void TileDBVCFDataset::read_metadata_v4() {
   get_md_value("tile_capacity", TILEDB_UINT64, &metadata.tile_capacity);
   get_md_value("anchor_gap", TILEDB_UINT32, &metadata.anchor_gap);
 
+  // Datasets created before adaptive anchor gaps do not have the flag
+  tiledb_datatype_t adaptive_dtype;
+  if (data_array->has_metadata("adaptive_anchor_gap", &adaptive_dtype)) {
+    uint8_t adaptive_anchor_gap = 0;
+    get_md_value("adaptive_anchor_gap", TILEDB_UINT8, &adaptive_anchor_gap);
+    metadata.adaptive_anchor_gap = adaptive_anchor_gap != 0;
+  }
+  if (metadata.adaptive_anchor_gap)
+    metadata.contig_anchor_gaps = get_contig_anchor_gaps(*data_array);
+
   get_csv_md_value("extra_attributes", &metadata.extra_attributes);
+  get_csv_md_value("backfill_attributes", &metadata.backfill_attributes);
 
   // Set ingestion_sample_batch_size default to 10
   metadata.ingestion_sample_batch_size = 10;
@@ -1715,9 +1920,16 @@ void TileDBVCFDataset::write_metadata_v4(
   data_array.put_metadata(
       "tile_capacity", TILEDB_UINT64, 1, &metadata.tile_capacity);
   data_array.put_metadata("anchor_gap", TILEDB_UINT32, 1, &metadata.anchor_gap);
+  const uint8_t adaptive_anchor_gap = metadata.adaptive_anchor_gap;
+  data_array.put_metadata(
+      "adaptive_anchor_gap", TILEDB_UINT8, 1, &adaptive_anchor_gap);
 
   // Base64 encoded CSV strings
   put_csv_metadata("extra_attributes", metadata.extra_attributes);
+  put_csv_metadata("backfill_attributes", metadata.backfill_attributes);
+
+  // The contig anchor gaps are only written by record_contig_anchor_gaps,
+  // under a key of their own for each ingestion.
 }
 
 void TileDBVCFDataset::write_vcf_headers_v4(
@@ -1906,6 +2118,7 @@ bool TileDBVCFDataset::attribute_is_fixed_len(const std::string& attr) {
          attr == DimensionNames::V2::end_pos ||
          attr == AttrNames::V4::real_start_pos ||
          attr == AttrNames::V4::end_pos || attr == AttrNames::V4::qual ||
+         attr == AttrNames::V4::genotype ||
          attr == AttrNames::V3::real_start_pos ||
          attr == AttrNames::V3::end_pos || attr == AttrNames::V3::qual ||
          attr == AttrNames::V2::pos || attr == AttrNames::V2::real_end ||
@@ -2057,6 +2270,19 @@ bool TileDBVCFDataset::is_attribute_materialized(
   return false;
 }
 
+bool TileDBVCFDataset::has_ref_block_flag() const {
+  return ref_block_flag_;
+}
+
+bool TileDBVCFDataset::has_compact_gt() const {
+  return compact_gt_;
+}
+
+bool TileDBVCFDataset::attribute_needs_backfill(const std::string& attr) const {
+  const auto& attrs = metadata_.backfill_attributes;
+  return std::find(attrs.begin(), attrs.end(), attr) != attrs.end();
+}
+
 const char* TileDBVCFDataset::sample_name(const int32_t index) const {
   if (!sample_names_loaded_ && metadata_.version == Version::V4)
     load_sample_names_v4();
@@ -2242,6 +2468,15 @@ void TileDBVCFDataset::set_tiledb_stats_enabled_vcf_header(
   tiledb_stats_enabled_vcf_header_ = stats_enabled;
 }
 
+void TileDBVCFDataset::set_vcf_header_cache_size(uint64_t max_bytes) {
+  std::lock_guard<std::mutex> lock(vcf_header_cache_mtx_);
+  vcf_header_cache_max_bytes_ = max_bytes;
+  if (vcf_header_cache_bytes_ > max_bytes) {
+    vcf_header_cache_.clear();
+    vcf_header_cache_bytes_ = 0;
+  }
+}
+
 void TileDBVCFDataset::consolidate_vcf_header_array_commits(
     const UtilsParams& params) {
   Config cfg;
@@ -2311,14 +2546,240 @@ void TileDBVCFDataset::consolidate_vcf_header_array_fragments(
   tiledb::Array::consolidate(*ctx_, vcf_headers_uri(params.uri), &cfg);
 }
 
+uint32_t TileDBVCFDataset::anchor_gap(const std::string& contig) const {
+  if (metadata_.adaptive_anchor_gap) {
+    auto it = metadata_.contig_anchor_gaps.find(contig);
+    if (it != metadata_.contig_anchor_gaps.end())
+      return it->second;
+  }
+  return metadata_.anchor_gap;
+}
+
+void TileDBVCFDataset::record_contig_anchor_gaps(
+    const std::map<std::string, uint32_t>& anchor_gaps) {
+  // Readers use the largest gap recorded for a contig, so only the gaps that
+  // grow need a record. Repeated ingestions of similar samples then add no
+  // metadata at all.
+  std::map<std::string, uint32_t> grown_gaps;
+  for (const auto& contig_gap : anchor_gaps) {
+    auto it = metadata_.contig_anchor_gaps.find(contig_gap.first);
+    if (it == metadata_.contig_anchor_gaps.end() ||
+        contig_gap.second > it->second)
+      grown_gaps.insert(contig_gap);
+  }
+  if (grown_gaps.empty())
+    return;
+
+  std::random_device rd;
+  const std::string key =
+      fmt::format("{}/{:08x}{:08x}", contig_anchor_gaps_key, rd(), rd());
+  {
+    Array array(*ctx_, data_array_uri(root_uri_), TILEDB_WRITE);
+    put_csv_pairs_metadata(array, key, grown_gaps);
+  }
+  for (const auto& contig_gap : grown_gaps) {
+    metadata_.contig_anchor_gaps[contig_gap.first] = contig_gap.second;
+    LOG_DEBUG(
+        "Anchor gap of contig {} is {}", contig_gap.first, contig_gap.second);
+  }
+}
+
+uint32_t TileDBVCFDataset::choose_anchor_gap(
+    std::vector<uint32_t>* lengths, uint32_t min_anchor_gap) {
+  // Bound the gap, which is the widening of every query region of the contig
+  const uint32_t max_anchor_gap = 1 << 20;
+  min_anchor_gap =
+      std::min(std::max<uint32_t>(min_anchor_gap, 1), max_anchor_gap);
+  if (lengths->empty())
+    return min_anchor_gap;
+
+  auto percentile = lengths->begin() + (lengths->size() - 1) * 99 / 100;
+  std::nth_element(lengths->begin(), percentile, lengths->end());
+  return std::min(std::max(*percentile, min_anchor_gap), max_anchor_gap);
+}
+
+void TileDBVCFDataset::extract_attributes(const UtilsParams& params) {
+  if (!open_)
+    throw std::runtime_error("Cannot extract attributes; dataset is not open.");
+  if (metadata_.version != Version::V4)
+    throw std::runtime_error(
+        "Cannot extract attributes; only v4 datasets are supported.");
+  check_attribute_names(params.extract_attributes);
+
+  std::vector<std::string> added;
+  ArraySchemaEvolution evolution(*ctx_);
+  {
+    utils::UniqueReadLock lck_(&data_array_lock_);
+    const ArraySchema schema = data_array_->schema();
+    const FilterList filters =
+        schema.attribute(AttrNames::V4::info).filter_list();
+    for (const auto& attr : params.extract_attributes) {
+      if (schema.has_attribute(attr) ||
+          std::find(added.begin(), added.end(), attr) != added.end()) {
+        LOG_WARN("Attribute '{}' is already extracted; skipping it.", attr);
+        continue;
+      }
+      // Cells written before the attribute hold the null value of the
+      // extracted attributes until they are backfilled
+      auto attribute =
+          Attribute::create<std::vector<uint8_t>>(*ctx_, attr, filters);
+      const uint8_t null_value = 0;
+      attribute.set_fill_value(&null_value, sizeof(null_value));
+      evolution.add_attribute(attribute);
+      added.push_back(attr);
+    }
+  }
+  if (added.empty())
+    return;
+
+  evolution.array_evolve(data_array_uri(root_uri_));
+
+  Metadata metadata = metadata_;
+  for (const auto& attr : added) {
+    metadata.extra_attributes.push_back(attr);
+    metadata.backfill_attributes.push_back(attr);
+  }
+  write_metadata_v4(*ctx_, root_uri_, metadata);
+  LOG_INFO(
+      "Extracted attributes {}; they are backfilled in existing fragments by "
+      "the next consolidation of the data array fragments. Reopen the dataset "
+      "to read them.",
+      fmt::join(added, ","));
+}
+
+uint64_t TileDBVCFDataset::backfill_extracted_attributes(
+    const UtilsParams& params) {
+  const std::string key = "backfill_attributes";
+  const std::string uri = data_array_uri(params.uri);
+  std::vector<std::string> attrs;
+  {
+    Array array(*ctx_, uri, TILEDB_READ);
+    attrs = get_csv_metadata(array, key);
+  }
+  if (attrs.empty())
+    return 0;
+
+  AttributeBackfill backfill(
+      ctx_, uri, attrs, params.consolidation_memory_budget_mb * 1024 * 1024);
+  const uint64_t num_rewritten = backfill.run();
+  LOG_INFO(
+      "Backfilled extracted attributes {} in {} fragments.",
+      fmt::join(attrs, ","),
+      num_rewritten);
+
+  // Attributes extracted while the backfill ran stay pending
+  std::vector<std::string> pending;
+  {
+    Array array(*ctx_, uri, TILEDB_READ);
+    for (const auto& attr : get_csv_metadata(array, key)) {
+      if (std::find(attrs.begin(), attrs.end(), attr) == attrs.end())
+        pending.push_back(attr);
+    }
+  }
+  Array array(*ctx_, uri, TILEDB_WRITE);
+  put_csv_metadata(array, key, pending);
+  return num_rewritten;
+}
+
 void TileDBVCFDataset::consolidate_data_array_fragments(
     const UtilsParams& params) {
+  // Fragments written before extracted attributes were added are rewritten
+  // first, so that the consolidated fragments hold the attributes
+  if (!params.consolidation_dry_run)
+    backfill_extracted_attributes(params);
+
+  if (params.consolidate_by_contig) {
+    LOG_INFO(
+        "Consolidated data array fragments by contig: {}",
+        consolidate_data_array_fragments_by_contig(params));
+    return;
+  }
+
   Config cfg;
   utils::set_tiledb_config(params.tiledb_config, &cfg);
   cfg["sm.consolidation.mode"] = "fragments";
   tiledb::Array::consolidate(*ctx_, data_array_uri(params.uri), &cfg);
 }
 
+std::string TileDBVCFDataset::consolidate_data_array_fragments_by_contig(
+    const UtilsParams& params) {
+  const std::string uri = data_array_uri(params.uri);
+  FragmentInfo fragment_info(*ctx_, uri);
+  fragment_info.load();
+
+  std::vector<ConsolidationPlanner::Fragment> fragments;
+  for (uint32_t i = 0; i < fragment_info.fragment_num(); i++) {
+    ConsolidationPlanner::Fragment fragment;
+    fragment.uri = fragment_info.fragment_uri(i);
+    fragment.contigs = fragment_info.non_empty_domain_var(i, 0);
+    uint32_t start_pos[2];
+    fragment_info.get_non_empty_domain(i, 1, start_pos);
+    fragment.start_pos = {start_pos[0], start_pos[1]};
+    fragment.samples = fragment_info.non_empty_domain_var(i, 2);
+    fragment.timestamps = fragment_info.timestamp_range(i);
+    fragment.size = fragment_info.fragment_size(i);
+    fragments.push_back(std::move(fragment));
+  }
+
+  const ConsolidationPlanner plan(
+      std::move(fragments), params.consolidation_target_mb * 1024 * 1024);
+  LOG_INFO("Consolidation plan: {}", plan.to_str());
+  if (params.consolidation_dry_run || plan.groups().empty())
+    return plan.to_str();
+
+  // Each running consolidation gets an even share of the memory budget
+  const unsigned num_threads = std::max(
+      1u,
+      std::min<unsigned>(params.consolidation_threads, plan.groups().size()));
+  Config cfg;
+  utils::set_tiledb_config(params.tiledb_config, &cfg);
+  cfg["sm.consolidation.mode"] = "fragments";
+  cfg["sm.mem.total_budget"] = std::to_string(
+      params.consolidation_memory_budget_mb * 1024 * 1024 / num_threads);
+
+  // Workers take the groups largest first
+  std::atomic<size_t> next_group(0);
+  std::atomic<uint64_t> num_failed(0);
+  auto worker = [&]() {
+    for (size_t g = next_group++; g < plan.groups().size(); g = next_group++) {
+      const auto& group = plan.groups()[g];
+      for (const auto& merge : group.merges) {
+        std::vector<const char*> fragment_uris;
+        for (size_t i : merge.fragments)
+          fragment_uris.push_back(plan.fragments()[i].uri.c_str());
+        try {
+          Config merge_cfg = cfg;
+          tiledb::Array::consolidate(
+              *ctx_,
+              uri,
+              fragment_uris.data(),
+              fragment_uris.size(),
+              &merge_cfg);
+        } catch (const tiledb::TileDBError& e) {
+          // Leave the fragments as they are; the dataset stays valid
+          LOG_WARN(
+              "Failed to consolidate {} fragments of contigs [{}, {}]: {}",
+              fragment_uris.size(),
+              group.contigs.first,
+              group.contigs.second,
+              e.what());
+          num_failed++;
+        }
+      }
+    }
+  };
+  std::vector<std::future<void>> workers;
+  for (unsigned i = 0; i < num_threads; i++)
+    workers.push_back(std::async(std::launch::async, worker));
+  for (auto& w : workers)
+    w.get();
+
+  if (num_failed > 0)
+    return fmt::format(
+        "{} ({} merges failed)", plan.to_str(), num_failed.load());
+  return plan.to_str();
+}
+
 void TileDBVCFDataset::consolidate_fragments(const UtilsParams& params) {
   consolidate_data_array_fragments(params);
   consolidate_vcf_header_array_fragments(params);
@@ -2593,5 +3054,42 @@ TileDBVCFDataset::fragment_sample_contig_list_v4() {
 
   return results;
 }
+
+const std::vector<TileDBVCFDataset::FragmentDomain>&
+TileDBVCFDataset::fragment_domains_v4() {
+  if (metadata_.version != Version::V4)
+    throw std::runtime_error(
+        "Fragment domains are only supported for v4 datasets");
+
+  const auto fragment_info = data_array_fragment_info();
+  std::unique_lock<std::mutex> lck(fragment_domains_mtx_);
+  if (fragment_domains_loaded_)
+    return fragment_domains_;
+
+  const uint32_t fragment_num = fragment_info->fragment_num();
+  fragment_domains_.resize(fragment_num);
+  for (uint32_t i = 0; i < fragment_num; i++) {
+    FragmentDomain& domain = fragment_domains_[i];
+    domain.contigs = fragment_info->non_empty_domain_var(i, 0);
+    uint32_t start_pos[2];
+    fragment_info->get_non_empty_domain(i, 1, start_pos);
+    domain.start_pos = {start_pos[0], start_pos[1]};
+    domain.samples = fragment_info->non_empty_domain_var(i, 2);
+    domain.num_cells = fragment_info->cell_num(i);
+    domain.timestamps = fragment_info->timestamp_range(i);
+  }
+  fragment_domains_loaded_ = true;
+
+  return fragment_domains_;
+}
+
+std::shared_ptr<tiledb::Array> TileDBVCFDataset::open_data_array_between(
+    uint64_t timestamp_start, uint64_t timestamp_end) const {
+  return std::make_shared<Array>(
+      *ctx_,
+      data_array_->uri(),
+      TILEDB_READ,
+      TemporalPolicy(TimestampStartEnd, timestamp_start, timestamp_end));
+}
 }  // namespace vcf
 }  // namespace tiledb
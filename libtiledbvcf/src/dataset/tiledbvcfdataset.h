@@ -27,10 +27,13 @@
 #ifndef TILEDB_VCF_TILEVCFDATASET_H
 #define TILEDB_VCF_TILEVCFDATASET_H
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -69,6 +72,10 @@ struct CreationParams {
   bool compress_sample_dim = true;
   int compression_level = 4;
   uint8_t variant_stats_array_version = 2;
+  bool ref_block_flag = true;
+  bool compact_gt = false;
+  bool dictionary_encoding = false;
+  bool adaptive_anchor_gap = false;
 };
 
 /** Arguments/params for dataset registration. */
@@ -112,6 +119,21 @@ struct UtilsParams {
   std::string log_level;
   std::string log_file;
   std::vector<std::string> tiledb_config;
+
+  // Should data array fragments be consolidated by the VCF-aware planner,
+  // merging adjacent sample batches per contig, instead of by TileDB?
+  bool consolidate_by_contig = false;
+  // Target size (MB) of a fragment consolidated by the planner
+  uint64_t consolidation_target_mb = 1024;
+  // Number of contig groups consolidated in parallel by the planner
+  unsigned consolidation_threads = 1;
+  // Memory budget (MB) shared by the parallel consolidations
+  uint64_t consolidation_memory_budget_mb = 2048;
+  // Only print the consolidation plan
+  bool consolidation_dry_run = false;
+
+  // INFO/FMT fields to add as extracted attributes to an existing dataset
+  std::vector<std::string> extract_attributes;
 };
 
 // Only for pairs of std::hash-able types for simplicity.
@@ -172,6 +194,8 @@ class TileDBVCFDataset {
       static const std::string filter_ids;
       static const std::string info;
       static const std::string fmt;
+      static const std::string is_ref_block;
+      static const std::string genotype;
     };
 
     struct V3 {
@@ -206,6 +230,23 @@ class TileDBVCFDataset {
    */
   enum Version { V2 = 2, V3, V4 };
 
+  /**
+   * Non-empty domain and cell count of a single v4 data array fragment, as
+   * recorded in its fragment metadata.
+   */
+  struct FragmentDomain {
+    /** Range of contigs in the fragment */
+    std::pair<std::string, std::string> contigs;
+    /** Range of start positions in the fragment */
+    std::pair<uint32_t, uint32_t> start_pos;
+    /** Range of sample names in the fragment */
+    std::pair<std::string, std::string> samples;
+    /** Number of cells in the fragment */
+    uint64_t num_cells;
+    /** Timestamp range of the fragment */
+    std::pair<uint64_t, uint64_t> timestamps;
+  };
+
   /**
    * General metadata for a dataset. This should be kept relatively small.
    */
@@ -214,6 +255,7 @@ class TileDBVCFDataset {
         : tile_capacity(0)
         , ingestion_sample_batch_size(0)
         , anchor_gap(0)
+        , adaptive_anchor_gap(false)
         , free_sample_id(0)
         , total_contig_length(0) {
     }
@@ -224,7 +266,10 @@ class TileDBVCFDataset {
       tile_capacity = metadata.tile_capacity;
       ingestion_sample_batch_size = metadata.ingestion_sample_batch_size;
       anchor_gap = metadata.anchor_gap;
+      adaptive_anchor_gap = metadata.adaptive_anchor_gap;
+      contig_anchor_gaps = metadata.contig_anchor_gaps;
       extra_attributes = metadata.extra_attributes;
+      backfill_attributes = metadata.backfill_attributes;
       free_sample_id = metadata.free_sample_id;
       all_samples = metadata.all_samples;
       sample_ids = metadata.sample_ids;
@@ -240,7 +285,10 @@ class TileDBVCFDataset {
       tile_capacity = metadata.tile_capacity;
       ingestion_sample_batch_size = metadata.ingestion_sample_batch_size;
       anchor_gap = metadata.anchor_gap;
+      adaptive_anchor_gap = metadata.adaptive_anchor_gap;
+      contig_anchor_gaps = metadata.contig_anchor_gaps;
       extra_attributes = metadata.extra_attributes;
+      backfill_attributes = metadata.backfill_attributes;
       free_sample_id = metadata.free_sample_id;
       all_samples = metadata.all_samples;
       sample_ids = metadata.sample_ids;
@@ -256,7 +304,10 @@ class TileDBVCFDataset {
       tile_capacity = metadata.tile_capacity;
       ingestion_sample_batch_size = metadata.ingestion_sample_batch_size;
       anchor_gap = metadata.anchor_gap;
+      adaptive_anchor_gap = metadata.adaptive_anchor_gap;
+      contig_anchor_gaps = metadata.contig_anchor_gaps;
       extra_attributes = metadata.extra_attributes;
+      backfill_attributes = metadata.backfill_attributes;
       free_sample_id = metadata.free_sample_id;
       all_samples = metadata.all_samples;
       sample_ids = metadata.sample_ids;
@@ -272,8 +323,29 @@ class TileDBVCFDataset {
     uint64_t tile_capacity;
     uint32_t ingestion_sample_batch_size;
     uint32_t anchor_gap;
+
+    /**
+     * True if the anchor gap of each contig is chosen from the lengths of its
+     * records at every ingestion. `anchor_gap` is then only the gap of
+     * contigs without one in `contig_anchor_gaps`.
+     */
+    bool adaptive_anchor_gap;
+
+    /**
+     * Mapping of contig name -> largest anchor gap recorded by any
+     * ingestion, for adaptive anchor gaps.
+     */
+    std::map<std::string, uint32_t> contig_anchor_gaps;
+
     std::vector<std::string> extra_attributes;
 
+    /**
+     * Extracted attributes added to the data array after cells were written,
+     * which are null in these cells until the next consolidation of the data
+     * array fragments backfills them from the info/fmt blobs.
+     */
+    std::vector<std::string> backfill_attributes;
+
     uint32_t free_sample_id;
     mutable std::vector<std::string> all_samples;
 
@@ -470,6 +542,77 @@ class TileDBVCFDataset {
 
   bool is_attribute_materialized(const std::string& attr) const;
 
+  /**
+   * Returns true if the data array has the `is_ref_block` attribute, which
+   * flags gVCF reference blocks at ingestion (v4 datasets created with
+   * `CreationParams::ref_block_flag`).
+   */
+  bool has_ref_block_flag() const;
+
+  /**
+   * Returns true if the data array has the `genotype` attribute, which holds
+   * the GT of each record packed into a uint32 (v4 datasets created with
+   * `CreationParams::compact_gt`). See `VCFUtils::encode_compact_gt`.
+   */
+  bool has_compact_gt() const;
+
+  /**
+   * Returns true if the given extracted attribute was added to the data array
+   * after cells were written, and is not backfilled in these cells yet. Where
+   * it is null, readers must look the field up in the info/fmt blob.
+   */
+  bool attribute_needs_backfill(const std::string& attr) const;
+
+  /**
+   * Returns the anchor gap of the given contig: the gap recorded for it when
+   * the dataset has adaptive anchor gaps, else the dataset anchor gap.
+   */
+  uint32_t anchor_gap(const std::string& contig) const;
+
+  /**
+   * Records the anchor gaps chosen by an ingestion into a dataset with
+   * adaptive anchor gaps, under a metadata key of its own. Readers use the
+   * largest gap recorded for a contig, so that they widen their regions
+   * enough for the anchors of every ingestion, including concurrent ones.
+   * Only gaps larger than the ones already recorded are written, and
+   * nothing is written if there are none.
+   *
+   * @param anchor_gaps Mapping of contig name -> anchor gap
+   */
+  void record_contig_anchor_gaps(
+      const std::map<std::string, uint32_t>& anchor_gaps);
+
+  /**
+   * Chooses the anchor gap of a contig from a sample of the lengths
+   * (END - POS) of its records: the gap is the 99th percentile of the
+   * lengths, so that about 1% of the records are split into anchors.
+   *
+   * @param lengths Record lengths, reordered by the call
+   * @param min_anchor_gap Smallest gap to choose, bounding the number of
+   *    anchors of records longer than the sample suggests
+   * @return Anchor gap, at least 1
+   */
+  static uint32_t choose_anchor_gap(
+      std::vector<uint32_t>* lengths, uint32_t min_anchor_gap);
+
+  /**
+   * Adds extracted attributes for INFO/FMT fields to an open v4 dataset with
+   * schema evolution. Records ingested from then on store the fields in the
+   * new attributes; older records keep them in the info/fmt blobs until
+   * the next consolidation of the data array fragments backfills them.
+   * @param params
+   */
+  void extract_attributes(const UtilsParams& params);
+
+  /**
+   * Backfills the attributes added by `extract_attributes` in the fragments
+   * written before them (see AttributeBackfill). Runs as the first step of
+   * the consolidation of the data array fragments.
+   * @param params
+   * @return Number of fragments rewritten
+   */
+  uint64_t backfill_extracted_attributes(const UtilsParams& params);
+
   /**
    * Get sample name by index
    * @param index
@@ -534,6 +677,17 @@ class TileDBVCFDataset {
    */
   void set_tiledb_stats_enabled_vcf_header(const bool stats_enabled);
 
+  /**
+   * Enables caching the VCF header text of the samples fetched by
+   * `fetch_vcf_headers_v4`, so that later fetches of the same samples skip
+   * the vcf_headers array query. Headers are cached until `max_bytes` of
+   * header text is held. Thread-safe.
+   *
+   * @param max_bytes Maximum size of the cached header text; 0 disables the
+   *     cache
+   */
+  void set_vcf_header_cache_size(uint64_t max_bytes);
+
   /**
    * Consolidate commits of the vcf header array
    * @param params
@@ -585,6 +739,16 @@ class TileDBVCFDataset {
    */
   void consolidate_data_array_fragments(const UtilsParams& params);
 
+  /**
+   * Consolidate fragments of the data array with the VCF-aware planner (see
+   * ConsolidationPlanner). Contig groups run in parallel; the merges of a
+   * group run in sample order and share the memory budget evenly.
+   * @param params
+   * @return Summary of the plan, with its write amplification
+   */
+  std::string consolidate_data_array_fragments_by_contig(
+      const UtilsParams& params);
+
   /**
    * Consolidate fragments of all arrays (vcf header array and data array)
    * @param params
@@ -727,6 +891,25 @@ class TileDBVCFDataset {
       tiledb::vcf::pair_hash>
   fragment_sample_contig_list_v4();
 
+  /**
+   * Returns the non-empty domain and cell count of every data array fragment.
+   * Only fragment metadata is read, and the result is cached.
+   *
+   * @return Fragment domains, in fragment info order
+   */
+  const std::vector<FragmentDomain>& fragment_domains_v4();
+
+  /**
+   * Opens a separate read handle on the data array that only sees the
+   * fragments written between the given timestamps.
+   *
+   * @param timestamp_start Start of the timestamp range (inclusive)
+   * @param timestamp_end End of the timestamp range (inclusive)
+   * @return Opened data array
+   */
+  std::shared_ptr<tiledb::Array> open_data_array_between(
+      uint64_t timestamp_start, uint64_t timestamp_end) const;
+
  private:
   /* ********************************* */
   /*          PRIVATE ATTRIBUTES       */
@@ -742,6 +925,12 @@ class TileDBVCFDataset {
   /** Set to true when the dataset is opened. */
   bool open_;
 
+  /** Set to true if the data array has the `is_ref_block` attribute. */
+  bool ref_block_flag_;
+
+  /** Set to true if the data array has the `genotype` attribute. */
+  bool compact_gt_;
+
   /** The dataset's general metadata (does not contain sample header data). */
   Metadata metadata_;
 
@@ -778,6 +967,15 @@ class TileDBVCFDataset {
   /** Mutex for loading data array fragment info */
   std::mutex data_array_fragment_info_mtx_;
 
+  /** Cached fragment domains, see `fragment_domains_v4` */
+  std::vector<FragmentDomain> fragment_domains_;
+
+  /** Are the fragment domains loaded */
+  bool fragment_domains_loaded_;
+
+  /** Mutex for loading the fragment domains */
+  std::mutex fragment_domains_mtx_;
+
   /** TileDB config used for open dataset */
   tiledb::Config cfg_;
 
@@ -785,10 +983,22 @@ class TileDBVCFDataset {
   std::shared_ptr<tiledb::Context> ctx_;
 
   /** TileDB stats enablement */
-  bool tiledb_stats_enabled_;
+  std::atomic<bool> tiledb_stats_enabled_;
 
   /** TileDB stats enablement for vcf header array */
-  bool tiledb_stats_enabled_vcf_header_;
+  std::atomic<bool> tiledb_stats_enabled_vcf_header_;
+
+  /** Header text by sample name, see `set_vcf_header_cache_size` */
+  mutable std::unordered_map<std::string, std::string> vcf_header_cache_;
+
+  /** Size of the header text in `vcf_header_cache_` */
+  mutable uint64_t vcf_header_cache_bytes_ = 0;
+
+  /** Maximum size of the header text in `vcf_header_cache_` */
+  std::atomic<uint64_t> vcf_header_cache_max_bytes_{0};
+
+  /** Protects `vcf_header_cache_` */
+  mutable std::mutex vcf_header_cache_mtx_;
 
   /** Are sample names loaded */
   mutable bool sample_names_loaded_;
@@ -868,6 +1078,10 @@ class TileDBVCFDataset {
    * @param root_uri Root URI of the dataset
    * @param metadata Dataset metadata containing tile capacity etc. to use
    * @param checksum optional checksum filter
+   * @param ref_block_flag add the `is_ref_block` attribute
+   * @param compact_gt add the `genotype` attribute
+   * @param dictionary_encoding dictionary-encode the `alleles` and `id`
+   *     attributes
    */
   static void create_empty_data_array(
       const Context& ctx,
@@ -876,7 +1090,10 @@ class TileDBVCFDataset {
       const tiledb_filter_type_t& checksum,
       const bool allow_duplicates,
       const bool compress_sample_dim,
-      const int compression_level);
+      const int compression_level,
+      const bool ref_block_flag,
+      const bool compact_gt,
+      const bool dictionary_encoding);
 
   /**
    * Creates the empty sample header array for a new dataset.
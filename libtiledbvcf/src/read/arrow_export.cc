@@ -0,0 +1,361 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "read/arrow_export.h"
+#include "read/in_memory_exporter.h"
+
+namespace tiledb {
+namespace vcf {
+
+namespace {
+
+/** Smallest size of a single buffer, in bytes. */
+const uint64_t min_buffer_bytes = 1024;
+
+/** Producer-private data of an exported array. */
+struct ArrowPrivate {
+  /** Keeps the buffers the array points into alive. */
+  std::shared_ptr<ArrowExportBuffers> buffers;
+};
+
+void release_schema(ArrowSchema* schema) {
+  for (int64_t i = 0; i < schema->n_children; i++) {
+    ArrowSchema* child = schema->children[i];
+    if (child->release != nullptr)
+      child->release(child);
+    delete child;
+  }
+  delete[] schema->children;
+  free((void*)schema->name);
+  schema->release = nullptr;
+}
+
+void release_array(ArrowArray* array) {
+  for (int64_t i = 0; i < array->n_children; i++) {
+    ArrowArray* child = array->children[i];
+    if (child->release != nullptr)
+      child->release(child);
+    delete child;
+  }
+  delete[] array->children;
+  delete[] array->buffers;
+
+  // Drop the reference on the buffers, possibly freeing them.
+  delete static_cast<ArrowPrivate*>(array->private_data);
+  array->release = nullptr;
+}
+
+void init_schema(
+    ArrowSchema* schema,
+    const char* format,
+    const std::string& name,
+    bool nullable,
+    const std::vector<ArrowSchema*>& children) {
+  schema->format = format;
+  schema->name = strdup(name.c_str());
+  schema->metadata = nullptr;
+  schema->flags = nullable ? ARROW_FLAG_NULLABLE : 0;
+  schema->n_children = children.size();
+  schema->children = nullptr;
+  if (!children.empty()) {
+    schema->children = new ArrowSchema*[children.size()];
+    std::copy(children.begin(), children.end(), schema->children);
+  }
+  schema->dictionary = nullptr;
+  schema->release = &release_schema;
+  schema->private_data = nullptr;
+}
+
+void init_array(
+    ArrowArray* array,
+    const std::shared_ptr<ArrowExportBuffers>& buffers,
+    int64_t length,
+    const std::vector<const void*>& arrow_buffers,
+    const std::vector<ArrowArray*>& children) {
+  array->length = length;
+  // A validity bitmap is passed without counting its nulls.
+  array->null_count =
+      !arrow_buffers.empty() && arrow_buffers[0] != nullptr ? -1 : 0;
+  array->offset = 0;
+  array->n_buffers = arrow_buffers.size();
+  array->buffers = new const void*[arrow_buffers.size()];
+  std::copy(arrow_buffers.begin(), arrow_buffers.end(), array->buffers);
+  array->n_children = children.size();
+  array->children = nullptr;
+  if (!children.empty()) {
+    array->children = new ArrowArray*[children.size()];
+    std::copy(children.begin(), children.end(), array->children);
+  }
+  array->dictionary = nullptr;
+  array->release = &release_array;
+  array->private_data = new ArrowPrivate{buffers};
+}
+
+/** Returns the Arrow format of the values of an attribute. */
+const char* arrow_format(AttrDatatype datatype) {
+  switch (datatype) {
+    case AttrDatatype::CHAR:
+      return "u";  // string with 32 bit offsets
+    case AttrDatatype::UINT8:
+      return "C";
+    case AttrDatatype::INT32:
+      return "i";
+    case AttrDatatype::FLOAT32:
+      return "f";
+    default:
+      throw std::runtime_error(
+          "Error exporting Arrow array; unsupported datatype " +
+          attr_datatype_str(datatype));
+  }
+}
+
+/** Wraps `child` in a list array with 32 bit offsets. */
+std::pair<ArrowArray*, ArrowSchema*> list_of(
+    const std::shared_ptr<ArrowExportBuffers>& buffers,
+    const std::string& name,
+    int64_t length,
+    const int32_t* offsets,
+    const uint8_t* bitmap,
+    std::pair<ArrowArray*, ArrowSchema*> child,
+    ArrowArray* array = nullptr,
+    ArrowSchema* schema = nullptr) {
+  if (array == nullptr) {
+    array = new ArrowArray;
+    schema = new ArrowSchema;
+  }
+  init_array(array, buffers, length, {bitmap, offsets}, {child.first});
+  init_schema(schema, "+l", name, bitmap != nullptr, {child.second});
+  return {array, schema};
+}
+
+/**
+ * Builds the Arrow array of one column into `array` and `schema`, following
+ * the layout of the InMemoryExporter buffers.
+ */
+void export_column(
+    const std::shared_ptr<ArrowExportBuffers>& buffers,
+    const ArrowExportBuffers::Column& column,
+    const InMemoryExporter& exporter,
+    int64_t num_records,
+    ArrowArray* array,
+    ArrowSchema* schema) {
+  int64_t num_offsets = 0, num_data_elements = 0, num_data_bytes = 0;
+  exporter.result_size(
+      column.name, &num_offsets, &num_data_elements, &num_data_bytes);
+  const int64_t num_values = std::max<int64_t>(num_offsets - 1, 0);
+
+  const uint8_t* bitmap = column.nullable ? column.bitmap.data() : nullptr;
+  const char* format = arrow_format(column.datatype);
+  const std::string item = "item";
+
+  if (column.datatype == AttrDatatype::CHAR) {
+    if (column.list) {
+      // List of strings
+      auto values = std::make_pair(new ArrowArray, new ArrowSchema);
+      init_array(
+          values.first,
+          buffers,
+          num_values,
+          {nullptr, column.offsets.data(), column.data.data()},
+          {});
+      init_schema(values.second, format, item, false, {});
+      list_of(
+          buffers,
+          column.name,
+          num_records,
+          column.list_offsets.data(),
+          bitmap,
+          values,
+          array,
+          schema);
+    } else {
+      // Strings
+      init_array(
+          array,
+          buffers,
+          num_records,
+          {bitmap, column.offsets.data(), column.data.data()},
+          {});
+      init_schema(schema, format, column.name, bitmap != nullptr, {});
+    }
+    return;
+  }
+
+  if (!column.var_len && !column.list) {
+    // Primitives
+    init_array(
+        array, buffers, num_data_elements, {bitmap, column.data.data()}, {});
+    init_schema(schema, format, column.name, bitmap != nullptr, {});
+    return;
+  }
+
+  auto values = std::make_pair(new ArrowArray, new ArrowSchema);
+  init_array(
+      values.first,
+      buffers,
+      num_data_elements,
+      {nullptr, column.data.data()},
+      {});
+  init_schema(values.second, format, item, false, {});
+
+  if (column.list) {
+    if (column.var_len) {
+      // List of lists of primitives
+      values = list_of(
+          buffers, item, num_values, column.offsets.data(), nullptr, values);
+    }
+    list_of(
+        buffers,
+        column.name,
+        num_records,
+        column.list_offsets.data(),
+        bitmap,
+        values,
+        array,
+        schema);
+  } else {
+    // List of primitives
+    list_of(
+        buffers,
+        column.name,
+        num_records,
+        column.offsets.data(),
+        bitmap,
+        values,
+        array,
+        schema);
+  }
+}
+
+}  // namespace
+
+ArrowExportBuffers::ArrowExportBuffers(
+    const TileDBVCFDataset* dataset,
+    const std::vector<std::string>& attributes,
+    bool add_iaf,
+    uint64_t budget_bytes)
+    : attributes_(attributes) {
+  columns_.resize(attributes_.size());
+  int num_buffers = 0;
+  for (size_t i = 0; i < attributes_.size(); i++) {
+    Column& column = columns_[i];
+    column.name = attributes_[i];
+    InMemoryExporter::attribute_datatype(
+        dataset,
+        column.name,
+        &column.datatype,
+        &column.var_len,
+        &column.nullable,
+        &column.list,
+        add_iaf);
+    num_buffers += 1;
+    num_buffers += column.var_len ? 1 : 0;
+    num_buffers += column.nullable ? 1 : 0;
+    num_buffers += column.list ? 1 : 0;
+  }
+  if (num_buffers == 0)
+    return;
+
+  // Split the budget evenly across the buffers, as the Python API does.
+  const uint64_t buffer_bytes =
+      std::max(budget_bytes / num_buffers, min_buffer_bytes);
+  for (auto& column : columns_) {
+    const uint64_t num_rows =
+        buffer_bytes / attr_datatype_size(column.datatype);
+    column.data.resize(buffer_bytes);
+    if (column.var_len)
+      column.offsets.resize(num_rows + 1);
+    if (column.list)
+      column.list_offsets.resize(num_rows + 1);
+    if (column.nullable)
+      column.bitmap.resize(num_rows / 8 + 1);
+  }
+}
+
+const std::vector<std::string>& ArrowExportBuffers::attributes() const {
+  return attributes_;
+}
+
+std::vector<ArrowExportBuffers::Column>& ArrowExportBuffers::columns() {
+  return columns_;
+}
+
+void ArrowExportBuffers::grow() {
+  for (auto& column : columns_) {
+    column.data.resize(2 * column.data.size());
+    column.offsets.resize(2 * column.offsets.size());
+    column.list_offsets.resize(2 * column.list_offsets.size());
+    column.bitmap.resize(2 * column.bitmap.size());
+  }
+}
+
+void ArrowExportBuffers::export_batch(
+    const std::shared_ptr<ArrowExportBuffers>& buffers,
+    const InMemoryExporter& exporter,
+    int64_t num_records,
+    ArrowArray* array,
+    ArrowSchema* schema) {
+  std::vector<ArrowArray*> child_arrays;
+  std::vector<ArrowSchema*> child_schemas;
+  try {
+    for (const auto& column : buffers->columns_) {
+      child_arrays.push_back(new ArrowArray);
+      child_schemas.push_back(new ArrowSchema);
+      child_arrays.back()->release = nullptr;
+      child_schemas.back()->release = nullptr;
+      export_column(
+          buffers,
+          column,
+          exporter,
+          num_records,
+          child_arrays.back(),
+          child_schemas.back());
+    }
+  } catch (...) {
+    for (auto child : child_arrays) {
+      if (child->release != nullptr)
+        child->release(child);
+      delete child;
+    }
+    for (auto child : child_schemas) {
+      if (child->release != nullptr)
+        child->release(child);
+      delete child;
+    }
+    throw;
+  }
+
+  init_array(array, buffers, num_records, {nullptr}, child_arrays);
+  init_schema(schema, "+s", "", false, child_schemas);
+}
+
+}  // namespace vcf
+}  // namespace tiledb
@@ -0,0 +1,139 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_ARROW_EXPORT_H
+#define TILEDB_VCF_ARROW_EXPORT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "enums/attr_datatype.h"
+#include "stats/carrow.h"
+
+namespace tiledb {
+namespace vcf {
+
+class InMemoryExporter;
+class TileDBVCFDataset;
+
+/**
+ * Library-owned buffers backing the Arrow batches returned by
+ * `Reader::read_arrow`.
+ *
+ * The buffers are set on the InMemoryExporter as if they were user buffers.
+ * Exported Arrow arrays point directly into them and hold a reference on the
+ * set, so the set is only reused for the next batch once the consumer has
+ * released every array of the previous one.
+ */
+class ArrowExportBuffers {
+ public:
+  /** Buffers of one exportable attribute. */
+  struct Column {
+    /** Exportable attribute name */
+    std::string name;
+
+    /** Attribute datatype, as reported by the InMemoryExporter */
+    AttrDatatype datatype;
+
+    /** True if the attribute is variable-length */
+    bool var_len;
+
+    /** True if the attribute is nullable */
+    bool nullable;
+
+    /** True if the attribute is a var-len list */
+    bool list;
+
+    /** Values */
+    std::vector<char> data;
+
+    /** Arrow offsets into `data` (var-len only) */
+    std::vector<int32_t> offsets;
+
+    /** Arrow offsets into `offsets` (list only) */
+    std::vector<int32_t> list_offsets;
+
+    /** Validity bitmap (nullable only) */
+    std::vector<uint8_t> bitmap;
+  };
+
+  /**
+   * Allocates buffers for the given exportable attributes.
+   *
+   * @param dataset Dataset (for attribute datatypes)
+   * @param attributes Exportable attribute names
+   * @param add_iaf True if the internal allele frequency is computed
+   * @param budget_bytes Initial size of all buffers together
+   */
+  ArrowExportBuffers(
+      const TileDBVCFDataset* dataset,
+      const std::vector<std::string>& attributes,
+      bool add_iaf,
+      uint64_t budget_bytes);
+
+  ArrowExportBuffers(const ArrowExportBuffers&) = delete;
+  ArrowExportBuffers& operator=(const ArrowExportBuffers&) = delete;
+
+  /** Returns the exportable attribute names, in column order. */
+  const std::vector<std::string>& attributes() const;
+
+  /** Returns the columns. */
+  std::vector<Column>& columns();
+
+  /** Doubles the size of every buffer. */
+  void grow();
+
+  /**
+   * Wraps the results copied into `buffers` as an Arrow struct array with one
+   * child per attribute. No data is copied; the arrays keep `buffers` alive
+   * until they are released.
+   *
+   * @param buffers Buffers the exporter copied the results into
+   * @param exporter Exporter holding the result sizes
+   * @param num_records Number of records in the results
+   * @param array Set to the struct array
+   * @param schema Set to the struct schema
+   */
+  static void export_batch(
+      const std::shared_ptr<ArrowExportBuffers>& buffers,
+      const InMemoryExporter& exporter,
+      int64_t num_records,
+      ArrowArray* array,
+      ArrowSchema* schema);
+
+ private:
+  /** Exportable attribute names */
+  std::vector<std::string> attributes_;
+
+  /** Buffers, parallel to `attributes_` */
+  std::vector<Column> columns_;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_ARROW_EXPORT_H
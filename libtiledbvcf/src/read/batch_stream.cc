@@ -0,0 +1,116 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "read/batch_stream.h"
+#include "utils/logger_public.h"
+
+namespace tiledb {
+namespace vcf {
+
+BatchStream::BatchStream(Producer producer, unsigned queue_depth)
+    : queue_depth_(std::max(queue_depth, 1u)) {
+  thread_ = std::thread([this, producer]() { run(producer); });
+}
+
+BatchStream::~BatchStream() {
+  cancel();
+  if (thread_.joinable())
+    thread_.join();
+
+  for (auto& batch : queue_) {
+    if (batch.array.release != nullptr)
+      batch.array.release(&batch.array);
+    if (batch.schema.release != nullptr)
+      batch.schema.release(&batch.schema);
+  }
+}
+
+void BatchStream::cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  cv_.notify_all();
+}
+
+void BatchStream::next(ArrowArray* array, ArrowSchema* schema) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return !queue_.empty() || done_; });
+
+  if (queue_.empty()) {
+    if (error_ != nullptr)
+      std::rethrow_exception(error_);
+    array->release = nullptr;
+    schema->release = nullptr;
+    return;
+  }
+
+  // Moving an Arrow struct is a plain copy; the queue gives up ownership.
+  *array = queue_.front().array;
+  *schema = queue_.front().schema;
+  queue_.pop_front();
+  cv_.notify_all();
+}
+
+void BatchStream::run(const Producer& producer) {
+  try {
+    bool more = true;
+    while (more) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() {
+          return queue_.size() < queue_depth_ || cancelled_;
+        });
+        if (cancelled_)
+          break;
+      }
+
+      Batch batch;
+      more = producer(&batch.array, &batch.schema);
+
+      if (batch.array.length == 0) {
+        batch.array.release(&batch.array);
+        batch.schema.release(&batch.schema);
+        continue;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(batch);
+      cv_.notify_all();
+    }
+  } catch (...) {
+    LOG_DEBUG("[BatchStream] Producer failed; ending the stream.");
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = std::current_exception();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  done_ = true;
+  cv_.notify_all();
+}
+
+}  // namespace vcf
+}  // namespace tiledb
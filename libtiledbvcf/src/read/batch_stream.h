@@ -0,0 +1,126 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_BATCH_STREAM_H
+#define TILEDB_VCF_BATCH_STREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "stats/carrow.h"
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * Bounded queue of Arrow batches filled by a producer thread.
+ *
+ * The producer runs ahead of the consumer by at most `queue_depth` batches
+ * and then blocks until the consumer takes one, so the number of batches in
+ * flight (and the buffers backing them) stays bounded however slowly the
+ * consumer drains the stream.
+ */
+class BatchStream {
+ public:
+  /**
+   * Produces the next batch into `array` and `schema`. Returns false if the
+   * batch is the last one. A batch of zero records is dropped.
+   */
+  typedef std::function<bool(ArrowArray* array, ArrowSchema* schema)>
+      Producer;
+
+  /**
+   * Starts the producer thread.
+   *
+   * @param producer Called on the producer thread for each batch
+   * @param queue_depth Maximum number of produced batches not yet consumed
+   */
+  BatchStream(Producer producer, unsigned queue_depth);
+
+  /** Stops the producer and releases the batches not yet consumed. */
+  ~BatchStream();
+
+  BatchStream(const BatchStream&) = delete;
+  BatchStream& operator=(const BatchStream&) = delete;
+
+  /**
+   * Moves the next batch into `array` and `schema`, blocking until one is
+   * produced. Once the stream is exhausted, the release callbacks of `array`
+   * and `schema` are set to null, as in the Arrow C stream interface. If the
+   * producer failed, its exception is rethrown after the batches produced
+   * before the failure have been consumed.
+   */
+  void next(ArrowArray* array, ArrowSchema* schema);
+
+  /**
+   * Asks the producer to stop after its current batch, without waiting for
+   * it. Used to stop a stream before cancelling the queries it waits on.
+   */
+  void cancel();
+
+ private:
+  /** A produced batch. */
+  struct Batch {
+    ArrowArray array;
+    ArrowSchema schema;
+  };
+
+  /** Maximum number of batches in `queue_` */
+  const unsigned queue_depth_;
+
+  /** Produced batches, oldest first */
+  std::deque<Batch> queue_;
+
+  /** True once the producer has returned its last batch or failed */
+  bool done_ = false;
+
+  /** True once the stream is being cancelled */
+  bool cancelled_ = false;
+
+  /** Exception thrown by the producer, if any */
+  std::exception_ptr error_;
+
+  /** Protects the queue and the flags */
+  std::mutex mutex_;
+
+  /** Signalled when a batch is pushed or popped, or the state changes */
+  std::condition_variable cv_;
+
+  /** Producer thread */
+  std::thread thread_;
+
+  /** Body of the producer thread. */
+  void run(const Producer& producer);
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_BATCH_STREAM_H
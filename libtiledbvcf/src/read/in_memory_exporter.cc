@@ -27,6 +27,7 @@
 #include "read/in_memory_exporter.h"
 #include <stdexcept>
 #include "enums/attr_datatype.h"
+#include "vcf/vcf_utils.h"
 
 namespace tiledb {
 namespace vcf {
@@ -238,8 +239,17 @@ std::set<std::string> InMemoryExporter::array_attributes_required() const {
         }
         break;
       case ExportableAttribute::InfoOrFmt:
-        if (extracted.count(it.first)) {
+        if (it.first == "fmt_GT" && dataset_->has_compact_gt()) {
+          result.insert(TileDBVCFDataset::AttrNames::V4::genotype);
+        } else if (extracted.count(it.first)) {
           result.insert(it.first);
+          // Cells not backfilled yet hold the value in the info/fmt blob
+          if (dataset_->attribute_needs_backfill(it.first)) {
+            auto p = TileDBVCFDataset::split_info_fmt_attr_name(it.first);
+            result.insert(
+                p.first == "info" ? TileDBVCFDataset::AttrNames::V4::info :
+                                    TileDBVCFDataset::AttrNames::V4::fmt);
+          }
         } else {
           auto p = TileDBVCFDataset::split_info_fmt_attr_name(it.first);
           if (p.first == "info") {
@@ -980,6 +990,20 @@ bool InMemoryExporter::copy_info_fmt_value(
   const bool is_iac = field_name == "TILEDB_IAC";
   const bool is_ian = field_name == "TILEDB_IAN";
 
+  // Compact genotype: decoded from the fixed-width attribute.
+  const Buffer& genotype = curr_query_results_->buffers()->genotype();
+  if (is_gt && genotype.size() > 0) {
+    int32_t values[2];
+    const int ploidy =
+        VCFUtils::decode_compact_gt(genotype.value<uint32_t>(cell_idx), values);
+    if (ploidy == 0)
+      return copy_cell(dest, nullptr, 0, 0, hdr);
+    int decoded[2];
+    for (int i = 0; i < ploidy; i++)
+      decoded[i] = bcf_gt_allele(values[i]);
+    return copy_cell(dest, decoded, ploidy * sizeof(int), ploidy, hdr);
+  }
+
   const void* src = nullptr;
   uint64_t nbytes = 0, nelts = 0;
   auto& af_values = curr_query_results_->af_values;
@@ -1066,13 +1090,30 @@ void InMemoryExporter::get_info_fmt_value(
         "Error copying attribute '" + attr_name + "'; no source buffer.");
 
   const uint64_t num_cells = curr_query_results_->num_cells();
-  const auto& offsets = src->offsets();
-  uint64_t offset = offsets[cell_idx];
-  uint64_t next_offset =
-      cell_idx == num_cells - 1 ? src_size.second : offsets[cell_idx + 1];
+  uint64_t offset = src->offsets()[cell_idx];
+  uint64_t next_offset = cell_idx == num_cells - 1 ?
+                             src_size.second :
+                             src->offsets()[cell_idx + 1];
   uint64_t tot_nbytes = next_offset - offset;
   const char* ptr = src->data<char>() + offset;
 
+  // An extracted attribute added to the dataset after this cell was written
+  // is null until it is backfilled, but the blob still holds the value.
+  if (is_extracted_attr && tot_nbytes == 1 && *ptr == '\0') {
+    src_size = is_info ? curr_query_results_->info_size() :
+                         curr_query_results_->fmt_size();
+    if (src_size.first > 0) {
+      is_extracted_attr = false;
+      src = is_info ? &curr_query_results_->buffers()->info() :
+                      &curr_query_results_->buffers()->fmt();
+      offset = src->offsets()[cell_idx];
+      next_offset = cell_idx == num_cells - 1 ? src_size.second :
+                                                src->offsets()[cell_idx + 1];
+      tot_nbytes = next_offset - offset;
+      ptr = src->data<char>() + offset;
+    }
+  }
+
   // Check for null (dummy byte).
   if (tot_nbytes == 1 && *ptr == '\0') {
     *data = nullptr;
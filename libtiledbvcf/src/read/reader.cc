@@ -27,7 +27,7 @@
 #include <future>
 #include <iomanip>
 #include <random>
-#include <span>
+#include <set>
 #include <thread>
 #include <tiledb/tiledb>
 #include <vector>
@@ -41,22 +41,54 @@
 #include "read/reader.h"
 #include "read/tsv_exporter.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/normalize.h"
 #include "utils/utils.h"
+#include "vcf/region_index.h"
 
 namespace tiledb {
 namespace vcf {
 
+namespace {
+
+/**
+ * Returns true if [min, max] intersects one of the given sorted, disjoint
+ * ranges.
+ */
+bool intersects_any(
+    const std::vector<std::pair<uint32_t, uint32_t>>& ranges,
+    uint32_t min,
+    uint32_t max) {
+  // Only the last range starting at or before max can intersect.
+  auto it = std::upper_bound(
+      ranges.begin(),
+      ranges.end(),
+      max,
+      [](uint32_t value, const std::pair<uint32_t, uint32_t>& range) {
+        return value < range.first;
+      });
+  return it != ranges.begin() && std::prev(it)->second >= min;
+}
+
+}  // namespace
+
 Reader::Reader() {
 }
 
 Reader::~Reader() {
-  if (ctx_ != nullptr) {
+  // Keep the producer of a batch stream from starting another read, and let
+  // the task cancellation below interrupt its current one.
+  if (batch_stream_ != nullptr)
+    batch_stream_->cancel();
+
+  // A shared context also runs the queries of other readers.
+  if (ctx_ != nullptr && dataset_handle_ == nullptr) {
     // We must wait for the inflight query to finish before we destroy
     // everything. If we don't its possible to delete the buffers in the middle
     // of an active query
     ctx_->cancel_tasks();
   }
+  batch_stream_.reset();
 
   utils::free_htslib_tiledb_context();
 }
@@ -66,25 +98,48 @@ void Reader::open_dataset(const std::string& dataset_uri) {
 
   dataset_.reset(new TileDBVCFDataset(ctx_));
   dataset_->open(dataset_uri, params_.tiledb_config);
+  dataset_handle_.reset();
+  read_state_.array = dataset_->data_array();
+}
+
+void Reader::open_dataset(std::shared_ptr<DatasetHandle> handle) {
+  if (handle == nullptr)
+    throw std::runtime_error("Error opening dataset; null dataset handle.");
+
+  compute_memory_budget_details();
+  params_.tiledb_config = handle->tiledb_config();
+  utils::set_tiledb_config_map(
+      params_.tiledb_config, &params_.tiledb_config_map);
+
+  ctx_ = handle->ctx();
+  vfs_.reset(new tiledb::VFS(*ctx_));
+  dataset_handle_ = handle;
+  dataset_ = handle->dataset();
   read_state_.array = dataset_->data_array();
 }
 
 void Reader::reset() {
+  batch_stream_.reset();
+  batch_stream_attributes_.clear();
   read_state_ = ReadState();
   read_state_.array = dataset_->data_array();
   if (exporter_ != nullptr) {
     exporter_->reset();
     read_state_.need_headers = exporter_->need_headers();
   }
+  if (record_filter_ != nullptr && record_filter_->need_headers())
+    read_state_.need_headers = true;
 }
 
 void Reader::reset_buffers() {
   auto exp = set_in_memory_exporter();
   exp->reset_buffers();
+  arrow_buffers_.clear();
 }
 
 void Reader::set_all_params(const ExportParams& params) {
   params_ = params;
+  set_record_filter(params_.record_filter);
 }
 
 void Reader::set_samples(const std::string& samples) {
@@ -99,6 +154,10 @@ void Reader::set_sort_regions(bool sort_regions) {
   params_.sort_regions = sort_regions;
 }
 
+void Reader::set_balance_partitions(bool balance_partitions) {
+  params_.balance_partitions = balance_partitions;
+}
+
 void Reader::set_samples_file(const std::string& uri) {
   if (vfs_ == nullptr)
     init_tiledb();
@@ -113,6 +172,10 @@ void Reader::set_bed_file(const std::string& uri) {
   params_.regions_file_uri = uri;
 }
 
+void Reader::set_region_index_cache(const std::string& uri) {
+  params_.region_index_cache_uri = uri;
+}
+
 void Reader::set_region_partition(
     uint64_t partition_idx, uint64_t num_partitions) {
   check_partitioning(partition_idx, num_partitions);
@@ -234,10 +297,17 @@ void Reader::set_tiledb_config(const std::string& config_str) {
 }
 
 ReadStatus Reader::read_status() const {
+  if (batch_stream_ != nullptr)
+    throw std::runtime_error(
+        "Error getting read status; a batch stream is open on the reader.");
   return read_state_.status;
 }
 
 uint64_t Reader::num_records_exported() const {
+  if (batch_stream_ != nullptr)
+    throw std::runtime_error(
+        "Error getting exported records; a batch stream is open on the "
+        "reader.");
   return read_state_.last_num_records_exported;
 }
 
@@ -263,6 +333,11 @@ void Reader::tiledb_stats(char** stats) {
     throw std::runtime_error("Error dumping tiledb statistics");
 }
 
+void Reader::metrics(const char** metrics) {
+  metrics_json_ = metrics::to_json();
+  *metrics = metrics_json_.c_str();
+}
+
 void Reader::dataset_version(int32_t* version) const {
   if (dataset_ == nullptr)
     throw std::runtime_error("Error getting dataset version");
@@ -344,6 +419,13 @@ void Reader::get_buffer_validity_bitmap(
 }
 
 void Reader::read() {
+  if (batch_stream_ != nullptr)
+    throw std::runtime_error(
+        "Error exporting records; a batch stream is open on the reader.");
+  read_records();
+}
+
+void Reader::read_records() {
   dataset_->set_tiledb_stats_enabled(params_.tiledb_stats_enabled);
   dataset_->set_tiledb_stats_enabled_vcf_header(
       params_.tiledb_stats_enabled_vcf_header_array);
@@ -364,6 +446,14 @@ void Reader::read() {
   if (dataset_ == nullptr)
     throw std::runtime_error(
         "Error exporting records; reader has not been initialized.");
+  if (record_filter_ != nullptr &&
+      dataset_->metadata().version != TileDBVCFDataset::Version::V4)
+    throw std::runtime_error(
+        "Error exporting records; record filters require a v4 dataset.");
+  if (params_.variants_only &&
+      dataset_->metadata().version != TileDBVCFDataset::Version::V4)
+    throw std::runtime_error(
+        "Error exporting records; variant-only reads require a v4 dataset.");
 
   bool pending_work = true;
   switch (read_state_.status) {
@@ -418,6 +508,146 @@ void Reader::read() {
   }
 }
 
+void Reader::read_arrow(
+    const std::vector<std::string>& attributes,
+    ArrowArray* array,
+    ArrowSchema* schema) {
+  if (batch_stream_ != nullptr)
+    throw std::runtime_error(
+        "Error exporting Arrow batch; a batch stream is open on the reader.");
+  read_arrow_batch(
+      attributes, params_.memory_budget_breakdown.buffers, array, schema);
+}
+
+void Reader::next_batch(
+    const std::vector<std::string>& attributes,
+    ArrowArray* array,
+    ArrowSchema* schema) {
+  if (dataset_ == nullptr)
+    throw std::runtime_error(
+        "Error reading next batch; reader has not been initialized.");
+  if (array == nullptr || schema == nullptr)
+    throw std::runtime_error(
+        "Error reading next batch; null array or schema provided.");
+
+  if (batch_stream_ == nullptr) {
+    if (read_state_.status == ReadStatus::INCOMPLETE)
+      throw std::runtime_error(
+          "Error reading next batch; a read is already in progress.");
+
+    // One buffer set per queued batch, plus the one being filled and the one
+    // held by the consumer.
+    const unsigned queue_depth = params_.batch_queue_depth;
+    const uint64_t batch_bytes =
+        params_.memory_budget_breakdown.buffers / (queue_depth + 2);
+    LOG_DEBUG(
+        "Starting batch stream: queue depth {}, {} MiB per batch",
+        queue_depth,
+        batch_bytes >> 20);
+
+    batch_stream_attributes_ = attributes;
+    batch_stream_ = std::make_unique<BatchStream>(
+        [this, batch_bytes](ArrowArray* array, ArrowSchema* schema) {
+          read_arrow_batch(
+              batch_stream_attributes_, batch_bytes, array, schema);
+          if (read_state_.status == ReadStatus::FAILED)
+            throw std::runtime_error(
+                "Error reading next batch; read failed.");
+          return read_state_.status == ReadStatus::INCOMPLETE;
+        },
+        queue_depth);
+  } else if (attributes != batch_stream_attributes_) {
+    throw std::runtime_error(
+        "Error reading next batch; attributes cannot change while a batch "
+        "stream is open.");
+  }
+
+  batch_stream_->next(array, schema);
+}
+
+void Reader::read_arrow_batch(
+    const std::vector<std::string>& attributes,
+    uint64_t budget_bytes,
+    ArrowArray* array,
+    ArrowSchema* schema) {
+  if (dataset_ == nullptr)
+    throw std::runtime_error(
+        "Error exporting Arrow batch; reader has not been initialized.");
+  if (array == nullptr || schema == nullptr)
+    throw std::runtime_error(
+        "Error exporting Arrow batch; null array or schema provided.");
+
+  const bool same_attributes = !arrow_buffers_.empty() &&
+                               arrow_buffers_.front()->attributes() ==
+                                   attributes;
+  if (read_state_.status == ReadStatus::INCOMPLETE && !same_attributes)
+    throw std::runtime_error(
+        "Error exporting Arrow batch; attributes cannot change while a read "
+        "is incomplete.");
+
+  auto exp = set_in_memory_exporter();
+  if (!same_attributes) {
+    exp->reset_buffers();
+    arrow_buffers_.clear();
+  }
+
+  // Recycle a buffer set once the consumer has released every array of its
+  // last batch, i.e. only the pool still references it. The pool holds one
+  // set per queued batch plus the one being filled and the one held by the
+  // consumer; beyond that, sets are allocated for a single batch.
+  std::shared_ptr<ArrowExportBuffers> buffers;
+  for (const auto& pooled : arrow_buffers_) {
+    if (pooled.use_count() == 1) {
+      buffers = pooled;
+      break;
+    }
+  }
+  if (buffers == nullptr) {
+    buffers = std::make_shared<ArrowExportBuffers>(
+        dataset_.get(), attributes, !params_.af_filter.empty(), budget_bytes);
+    if (arrow_buffers_.size() < params_.batch_queue_depth + 2)
+      arrow_buffers_.push_back(buffers);
+    else
+      LOG_DEBUG("Arrow export buffer pool exhausted; allocated a new set.");
+  }
+
+  while (true) {
+    for (auto& column : buffers->columns()) {
+      set_buffer_values(column.name, column.data.data(), column.data.size());
+      if (column.var_len)
+        set_buffer_offsets(
+            column.name,
+            column.offsets.data(),
+            column.offsets.size() * sizeof(int32_t));
+      if (column.list)
+        set_buffer_list_offsets(
+            column.name,
+            column.list_offsets.data(),
+            column.list_offsets.size() * sizeof(int32_t));
+      if (column.nullable)
+        set_buffer_validity_bitmap(
+            column.name, column.bitmap.data(), column.bitmap.size());
+    }
+
+    read_records();
+
+    if (read_state_.status != ReadStatus::INCOMPLETE ||
+        read_state_.last_num_records_exported > 0)
+      break;
+
+    // Not even a single record fit in the buffers.
+    buffers->grow();
+    LOG_DEBUG("Arrow export buffers too small for one record; doubled them.");
+  }
+
+  ArrowExportBuffers::export_batch(
+      buffers,
+      *exp,
+      read_state_.last_num_records_exported,
+      array,
+      schema);
+}
+
 void Reader::init_for_reads() {
   if (dataset_->metadata().version == TileDBVCFDataset::Version::V2) {
     return init_for_reads_v2();
@@ -535,6 +765,8 @@ void Reader::init_for_reads_v4() {
   read_state_.sample_batches =
       prepare_sample_batches_v4(&read_state_.all_samples);
   read_state_.last_intersecting_region_idx_ = 0;
+  prepare_fragment_pruning_v4();
+  prepare_data_array_v4();
 
   init_exporter();
 
@@ -816,6 +1048,7 @@ bool Reader::next_read_batch_v4() {
   Subarray subarray =
       Subarray(read_state_.array->schema().context(), *read_state_.array);
   set_tiledb_query_config();
+  set_query_condition();
 
   // Set ranges
   std::stringstream debug_ranges;
@@ -861,6 +1094,8 @@ bool Reader::next_read_batch_v4() {
     // If we are not exporting all samples add the current partition/batch's
     // list
     for (const auto& sample : read_state_.current_sample_batches) {
+      if (read_state_.uncovered_samples.count(sample.sample_name))
+        continue;
       subarray.add_range(2, sample.sample_name, sample.sample_name);
       if (params_.debug_params.print_tiledb_query_ranges &&
           LOG_DEBUG_ENABLED()) {
@@ -1056,6 +1291,10 @@ void Reader::init_exporter() {
   // requested by an info/fmt field
   if (!read_state_.need_headers && exporter_ != nullptr)
     read_state_.need_headers = exporter_->need_headers();
+
+  // Filter names other than PASS are mapped to IDs with the headers
+  if (record_filter_ != nullptr && record_filter_->need_headers())
+    read_state_.need_headers = true;
 }
 
 bool Reader::read_current_batch() {
@@ -1095,6 +1334,18 @@ bool Reader::read_current_batch() {
     }
   }
 
+  if (params_.buffer_autotune) {
+    // Size the buffers from the fragment metadata before the first submit,
+    // then from the observed results.
+    if (!buffers_a->has_usage()) {
+      try {
+        buffers_a->estimate_usage(*query);
+      } catch (const tiledb::TileDBError& e) {
+        LOG_DEBUG("Buffer autotuning: no result size estimate: {}", e.what());
+      }
+    }
+    buffers_a->rebalance();
+  }
   buffers_a->set_buffers(query, dataset_->metadata().version);
 
   do {
@@ -1104,13 +1355,19 @@ bool Reader::read_current_batch() {
       af_filter_->compute_af();
     }
     LOG_INFO("TileDB query started. (VmRSS = {})", utils::memory_usage_str());
-    auto query_status = query->submit();
+    tiledb::Query::Status query_status;
+    {
+      static auto& submit_time = metrics::histogram("export.tiledb_submit");
+      metrics::ScopedTimer timer(submit_time);
+      query_status = query->submit();
+    }
     LOG_INFO(
         "TileDB query completed in {:.3f} sec. (VmRSS = {})",
         utils::chrono_duration(query_start_timer),
         utils::memory_usage_str());
 
     read_state_.query_results.set_results(*dataset_, buffers_a.get(), *query);
+    buffers_a->record_usage(*query, read_state_.query_results.num_cells());
 
     if (dataset_->metadata().version == TileDBVCFDataset::Version::V4) {
       buffers_a->contig().effective_size(
@@ -1177,6 +1434,8 @@ bool Reader::read_current_batch() {
     if (query_status ==
         tiledb::Query::Status::INCOMPLETE) {  // resubmit existing buffers_a if
                                               // not double buffering
+      if (params_.buffer_autotune)
+        buffers_a->rebalance();
       buffers_a->set_buffers(query, dataset_->metadata().version);
     }
   } while (read_state_.query_results.query_status() ==
@@ -1299,24 +1558,24 @@ bool Reader::process_query_results_v4() {
   // NOTE: Records with the same real_start_pos may cross a query batch, so we
   // buffer records in VCFMerger and only process records with the same
   // real_start_pos when we see a record with a different real_start_pos.
-  std::vector<size_t> sorted_indexes;
-  if (params_.sort_real_start_pos) {
-    std::span<uint32_t> real_start_pos(
-        results.buffers()->real_start_pos().data<uint32_t>(), num_cells);
-
-    auto sample_names = results.buffers()->sample_name().data();
-
-    sorted_indexes = utils::
-        sort_indexes_pvcf<std::span<uint32_t>, std::vector<std::string_view>>(
-            real_start_pos, sample_names);
+  // The order is computed once per query results, not on every resume.
+  auto& sorted_indexes = read_state_.sorted_indexes;
+  if (params_.sort_real_start_pos &&
+      (read_state_.cell_idx == 0 || sorted_indexes.size() != num_cells)) {
+    static auto& sort_time = metrics::histogram("export.sort_results");
+    metrics::ScopedTimer timer(sort_time);
+    utils::sort_indexes_pvcf(
+        results.buffers()->real_start_pos().data<uint32_t>(),
+        results.buffers()->sample_name(),
+        num_cells,
+        &sorted_indexes);
   }
 
-  const uint32_t anchor_gap = dataset_->metadata().anchor_gap;
-
   // V4 querys are run on a single contig at a time, so we can grab it from
   // the batch
   std::string query_contig =
       read_state_.query_regions_v4[read_state_.query_contig_batch_idx].first;
+  const uint32_t anchor_gap = dataset_->anchor_gap(query_contig);
 
   // This lets us limit the scope of intersections to only regions for this
   // query's contig
@@ -1337,16 +1596,70 @@ bool Reader::process_query_results_v4() {
   const auto& regions = regions_indexes->second;
 
   bool apply_af_filter = af_filter_enabled();
+  std::vector<int> gt;
+  // AF filter results of the alleles of the last site, reused by the cells of
+  // the other samples at the same site
+  uint32_t af_site_start = 0;
+  std::string af_site_alleles;
+  std::vector<std::tuple<bool, float, uint32_t, uint32_t>> af_site_results;
   size_t num_samples = 0;
   if (params_.scan_all_samples) {
     num_samples = dataset_->sample_names().size();
   }
+
+  static auto& intersection_time =
+      metrics::histogram("export.region_intersection");
+  static auto& af_filter_time = metrics::histogram("export.af_filter");
+  static auto& af_filtered = metrics::counter("export.af_filtered");
+
+  // Evaluate the record filter predicates TileDB could not, once per batch of
+  // results. An incomplete read resumes with the results it was exporting.
+  const bool apply_record_filter =
+      record_filter_ != nullptr && record_filter_->has_post_filter();
+  static auto& record_filtered = metrics::counter("export.record_filtered");
+  const bool skip_ref_blocks = skip_ref_blocks_by_alleles();
+  static auto& ref_blocks_skipped =
+      metrics::counter("export.ref_blocks_skipped");
+  if (apply_record_filter &&
+      (read_state_.cell_idx == 0 ||
+       read_state_.record_filter_pass.size() != num_cells)) {
+    static auto& record_filter_time =
+        metrics::histogram("export.record_filter");
+    metrics::ScopedTimer timer(record_filter_time);
+    auto hdr_lookup = [this, &results](uint64_t cell_idx) -> const bcf_hdr_t* {
+      uint64_t size = 0;
+      const char* sample_name =
+          results.buffers()->sample_name().value<char>(cell_idx, &size);
+      auto it = read_state_.current_hdrs_lookup.find(
+          std::string(sample_name, size));
+      if (it == read_state_.current_hdrs_lookup.end())
+        return nullptr;
+      auto hdr = read_state_.current_hdrs.find(it->second);
+      if (hdr == read_state_.current_hdrs.end())
+        return nullptr;
+      return hdr->second.get();
+    };
+    record_filter_->evaluate(
+        results, hdr_lookup, &read_state_.record_filter_pass);
+  }
+
   for (; read_state_.cell_idx < num_cells; read_state_.cell_idx++) {
     // For easy reference
     const uint64_t i = params_.sort_real_start_pos ?
                            sorted_indexes[read_state_.cell_idx] :
                            read_state_.cell_idx;
 
+    if (apply_record_filter && !read_state_.record_filter_pass[i]) {
+      record_filtered.add();
+      continue;
+    }
+
+    if (skip_ref_blocks &&
+        VCFUtils::is_ref_block(results.buffers()->alleles().value(i))) {
+      ref_blocks_skipped.add();
+      continue;
+    }
+
     // Get the start, real_start and end. We don't need the contig because we
     // know the query is limited to a single contig
     const uint32_t start = results.buffers()->start_pos().value<uint32_t>(i);
@@ -1356,8 +1669,14 @@ bool Reader::process_query_results_v4() {
     const uint32_t end = results.buffers()->end_pos().value<uint32_t>(i);
 
     // Search for the first intersecting region
-    bool found = first_intersecting_region(
-        query_contig, real_start, read_state_.last_intersecting_region_idx_);
+    bool found;
+    {
+      metrics::ScopedTimer timer(intersection_time);
+      found = first_intersecting_region(
+          query_contig,
+          real_start,
+          read_state_.last_intersecting_region_idx_);
+    }
 
     // Continue to the next record if no intersecting regions are found
     if (!found) {
@@ -1365,13 +1684,34 @@ bool Reader::process_query_results_v4() {
     }
 
     if (apply_af_filter) {
+      metrics::ScopedTimer timer(af_filter_time);
       af_filter_->wait();
 
       auto csv_alleles = results.buffers()->alleles().value(i);
-      auto alleles = utils::split(std::string(csv_alleles));
       LOG_TRACE("alleles = {}", csv_alleles);
+      if (af_site_results.empty() || real_start != af_site_start ||
+          af_site_alleles != csv_alleles) {
+        af_site_start = real_start;
+        af_site_alleles = csv_alleles;
+        af_site_results.clear();
+        auto alleles = utils::split(af_site_alleles);
+        bool is_ref = true;
+        for (auto&& allele : alleles) {
+          std::string normalized_ref = alleles[0];
+          std::string normalized_allele = allele;
+          if (af_filter_->array_version() > 2) {
+            normalize(normalized_ref, normalized_allele);
+          }
+          af_site_results.push_back(af_filter_->pass(
+              real_start,
+              is_ref ? "ref" : normalized_ref + "," + normalized_allele,
+              params_.scan_all_samples,
+              num_samples));
+          is_ref = false;
+        }
+      }
 
-      auto gt = results.buffers()->gt(i);
+      results.buffers()->gt(i, &gt);
 
       // If all GT are missing, then pass the record, otherwise check
       // if any of the alleles in GT pass the AF filter.
@@ -1385,20 +1725,8 @@ bool Reader::process_query_results_v4() {
       read_state_.query_results.ac_values.clear();
       read_state_.query_results.an_value = 0;
       int allele_index = 0;
-      bool is_ref = true;
       uint32_t an = 0;
-      for (auto&& allele : alleles) {
-        std::string normalized_ref = alleles[0];
-        std::string normalized_allele = allele;
-        if (af_filter_->array_version() > 2) {
-          normalize(normalized_ref, normalized_allele);
-        }
-        auto [allele_passes, af, ac, allele_an] = af_filter_->pass(
-            real_start,
-            is_ref ? "ref" : normalized_ref + "," + normalized_allele,
-            params_.scan_all_samples,
-            num_samples);
-
+      for (const auto& [allele_passes, af, ac, allele_an] : af_site_results) {
         // If the allele is in GT, consider it in the pass computation
         {
           bool matches_any_allele = false;
@@ -1421,12 +1749,12 @@ bool Reader::process_query_results_v4() {
         an = allele_an;
 
         LOG_TRACE("  pass = {}", pass);
-        is_ref = false;
       }
       read_state_.query_results.an_value = an;
 
       // If all alleles do not pass the af filter, continue
       if (!pass) {
+        af_filtered.add();
         continue;
       }
     }
@@ -1746,11 +2074,17 @@ bool Reader::report_cell(
     const auto& hdr = read_state_.current_hdrs.at(hdr_index);
     hdr_ptr = hdr.get();
   }
-  if (!exporter_->export_record(
-          sample, hdr_ptr, region, contig_offset, results, cell_idx))
-    return false;
+  {
+    static auto& copy_time = metrics::histogram("export.copy");
+    metrics::ScopedTimer timer(copy_time);
+    if (!exporter_->export_record(
+            sample, hdr_ptr, region, contig_offset, results, cell_idx))
+      return false;
+  }
 
   // If no overflow, increment num records count.
+  static auto& records = metrics::counter("export.records");
+  records.add();
   read_state_.last_num_records_exported++;
   read_state_.total_num_records_exported++;
   return true;
@@ -1810,14 +2144,53 @@ std::vector<std::vector<SampleAndId>> Reader::prepare_sample_batches_v4(
       });
 
   // Apply sample partitioning
-  utils::partition_vector(
-      params_.sample_partitioning.partition_index,
-      params_.sample_partitioning.num_partitions,
-      &samples);
+  if (params_.balance_partitions &&
+      params_.sample_partitioning.num_partitions > 1) {
+    utils::partition_vector_weighted(
+        params_.sample_partitioning.partition_index,
+        params_.sample_partitioning.num_partitions,
+        estimate_sample_records_v4(samples),
+        &samples);
+  } else {
+    utils::partition_vector(
+        params_.sample_partitioning.partition_index,
+        params_.sample_partitioning.num_partitions,
+        &samples);
+  }
 
   return {samples};
 }
 
+std::vector<double> Reader::estimate_sample_records_v4(
+    const std::vector<SampleAndId>& samples) const {
+  // Spread the cells of each fragment over the samples in its sample range
+  // with a difference array, then integrate.
+  std::vector<double> records(samples.size() + 1, 0);
+  auto by_name = [](const SampleAndId& s, const std::string& name) {
+    return s.sample_name < name;
+  };
+  auto name_before = [](const std::string& name, const SampleAndId& s) {
+    return name < s.sample_name;
+  };
+  for (const auto& fragment : dataset_->fragment_domains_v4()) {
+    auto first = std::lower_bound(
+        samples.begin(), samples.end(), fragment.samples.first, by_name);
+    auto last = std::upper_bound(
+        first, samples.end(), fragment.samples.second, name_before);
+    if (first == last)
+      continue;
+    const double per_sample =
+        static_cast<double>(fragment.num_cells) / (last - first);
+    records[first - samples.begin()] += per_sample;
+    records[last - samples.begin()] -= per_sample;
+  }
+
+  for (size_t i = 1; i < samples.size(); i++)
+    records[i] += records[i - 1];
+  records.pop_back();
+  return records;
+}
+
 std::vector<SampleAndId> Reader::prepare_sample_names() const {
   std::vector<SampleAndId> result;
 
@@ -1935,6 +2308,156 @@ std::vector<SampleAndId> Reader::prepare_sample_names_v4(
   return result;
 }
 
+void Reader::prepare_fragment_pruning_v4() {
+  read_state_.fragment_pruning = false;
+  read_state_.sample_fragments.clear();
+  read_state_.uncovered_samples.clear();
+
+  const std::vector<TileDBVCFDataset::FragmentDomain>* fragments = nullptr;
+  try {
+    fragments = &dataset_->fragment_domains_v4();
+  } catch (const std::exception& e) {
+    LOG_DEBUG("[Reader] Fragment pruning disabled: {}", e.what());
+    return;
+  }
+  // Without fragment info, fall back on the array non-empty domain alone
+  if (fragments->empty())
+    return;
+  read_state_.fragment_pruning = true;
+
+  // Reading all samples without partitioning has no sample batch
+  if (read_state_.sample_batches.empty()) {
+    for (const auto& fragment : *fragments)
+      read_state_.sample_fragments.push_back(&fragment);
+    return;
+  }
+
+  // The single v4 sample batch is sorted by sample name
+  const auto& samples = read_state_.sample_batches[0];
+  std::vector<std::pair<std::string, std::string>> sample_ranges;
+  for (const auto& fragment : *fragments) {
+    auto it = std::lower_bound(
+        samples.begin(),
+        samples.end(),
+        fragment.samples.first,
+        [](const SampleAndId& s, const std::string& name) {
+          return s.sample_name < name;
+        });
+    if (it != samples.end() && it->sample_name <= fragment.samples.second) {
+      read_state_.sample_fragments.push_back(&fragment);
+      sample_ranges.push_back(fragment.samples);
+    }
+  }
+
+  // Merge the sample ranges, then sweep the sorted samples over them
+  std::sort(sample_ranges.begin(), sample_ranges.end());
+  std::vector<std::pair<std::string, std::string>> merged;
+  for (auto& range : sample_ranges) {
+    if (!merged.empty() && range.first <= merged.back().second)
+      merged.back().second = std::max(merged.back().second, range.second);
+    else
+      merged.push_back(std::move(range));
+  }
+  size_t range_idx = 0;
+  for (const auto& s : samples) {
+    while (range_idx < merged.size() &&
+           merged[range_idx].second < s.sample_name)
+      range_idx++;
+    if (range_idx == merged.size() ||
+        s.sample_name < merged[range_idx].first)
+      read_state_.uncovered_samples.insert(s.sample_name);
+  }
+
+  LOG_DEBUG(
+      "[Reader] {} of {} fragments hold data of the {} queried samples; {} "
+      "samples have no data",
+      read_state_.sample_fragments.size(),
+      fragments->size(),
+      samples.size(),
+      read_state_.uncovered_samples.size());
+}
+
+void Reader::prepare_data_array_v4() {
+  read_state_.array = dataset_->data_array();
+  if (!read_state_.fragment_pruning || read_state_.sample_fragments.empty())
+    return;
+
+  // Only fragments entirely inside the open timestamp range are visible
+  const uint64_t open_start = read_state_.array->open_timestamp_start();
+  const uint64_t open_end = read_state_.array->open_timestamp_end();
+  auto visible = [open_start, open_end](
+                     const TileDBVCFDataset::FragmentDomain& fragment) {
+    return fragment.timestamps.first >= open_start &&
+           fragment.timestamps.second <= open_end;
+  };
+
+  uint64_t start = std::numeric_limits<uint64_t>::max();
+  for (const auto* fragment : read_state_.sample_fragments) {
+    if (visible(*fragment))
+      start = std::min(start, fragment->timestamps.first);
+  }
+  if (start == std::numeric_limits<uint64_t>::max() || start <= open_start)
+    return;
+
+  uint64_t num_skipped = 0;
+  for (const auto& fragment : dataset_->fragment_domains_v4()) {
+    if (visible(fragment) && fragment.timestamps.first < start)
+      num_skipped++;
+  }
+  if (num_skipped == 0)
+    return;
+
+  read_state_.array = dataset_->open_data_array_between(start, open_end);
+  LOG_DEBUG(
+      "[Reader] Skipping {} fragments written before {} that hold none of the "
+      "queried samples",
+      num_skipped,
+      start);
+}
+
+std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint32_t>>>
+Reader::fragment_coverage_v4(const std::list<Region>& regions) const {
+  std::set<std::string> contigs;
+  for (const auto& r : regions)
+    contigs.insert(r.seq_name);
+
+  // A fragment covers every queried contig inside its contig range
+  std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint32_t>>>
+      result;
+  for (const auto* fragment : read_state_.sample_fragments) {
+    auto first = contigs.lower_bound(fragment->contigs.first);
+    auto last = contigs.upper_bound(fragment->contigs.second);
+    for (auto it = first; it != last; ++it)
+      result[*it].push_back(fragment->start_pos);
+  }
+
+  for (auto& contig_ranges : result) {
+    auto& ranges = contig_ranges.second;
+    std::sort(ranges.begin(), ranges.end());
+    size_t num_merged = 0;
+    for (const auto& range : ranges) {
+      if (num_merged > 0 && range.first <= ranges[num_merged - 1].second)
+        ranges[num_merged - 1].second =
+            std::max(ranges[num_merged - 1].second, range.second);
+      else
+        ranges[num_merged++] = range;
+    }
+    ranges.resize(num_merged);
+  }
+
+  return result;
+}
+
+void Reader::parse_bed_file(
+    const std::string& uri, std::list<Region>* result) const {
+  if (params_.region_index_cache_uri.empty()) {
+    Region::parse_bed_file_htslib(uri, result);
+    return;
+  }
+  RegionIndex::parse_bed_file_cached(
+      *vfs_, uri, params_.region_index_cache_uri, result);
+}
+
 void Reader::prepare_regions_v4(
     std::vector<Region>* regions,
     std::unordered_map<std::string, std::vector<size_t>>*
@@ -1942,7 +2465,6 @@ void Reader::prepare_regions_v4(
     std::vector<std::pair<std::string, std::vector<QueryRegion>>>*
         query_regions) {
   assert(dataset_->metadata().version == TileDBVCFDataset::Version::V4);
-  const uint32_t g = dataset_->metadata().anchor_gap;
   // Use a linked list for pre-partition regions to allow for parallel parsing
   // of BED file
   std::list<Region> pre_partition_regions_list;
@@ -1989,8 +2511,7 @@ void Reader::prepare_regions_v4(
     } else {
       // The URI is not an array, treat it as a BED file
       LOG_DEBUG("[Reader] Parsing BED file '{}'", params_.regions_file_uri);
-      Region::parse_bed_file_htslib(
-          params_.regions_file_uri, &pre_partition_regions_list);
+      parse_bed_file(params_.regions_file_uri, &pre_partition_regions_list);
     }
 
     LOG_INFO(fmt::format(
@@ -2011,23 +2532,44 @@ void Reader::prepare_regions_v4(
     pre_partition_regions_list = dataset_->all_contigs_list_v4();
   }
 
+  // Start position ranges covered by the fragments of the queried samples
+  std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint32_t>>>
+      fragment_coverage;
+  if (read_state_.fragment_pruning)
+    fragment_coverage = fragment_coverage_v4(pre_partition_regions_list);
+
   std::vector<Region> filtered_regions;
   // Loop through all contigs to query and pre-filter to ones which fall
-  // inside the nonEmptyDomain This will balance the partitioning better my
-  // removing empty regions
+  // inside the nonEmptyDomain and, per contig, inside a fragment holding the
+  // queried samples. This will balance the partitioning better by removing
+  // empty regions, and avoids queries with no results.
+  const uint64_t num_regions = pre_partition_regions_list.size();
   for (auto& r : pre_partition_regions_list) {
     r.seq_offset = 0;
     const uint32_t reg_min = r.min;
     const uint32_t reg_max = r.max;
 
-    // Widen the query region by the anchor gap value, avoiding overflow.
-    uint64_t widened_reg_min = g > reg_min ? 0 : reg_min - g;
-    if (widened_reg_min <= region_non_empty_domain.second &&
-        reg_max >= region_non_empty_domain.first) {
-      filtered_regions.emplace_back(std::move(r));
+    // Widen the query region by the contig's anchor gap, avoiding overflow.
+    const uint32_t g = dataset_->anchor_gap(r.seq_name);
+    uint32_t widened_reg_min = g > reg_min ? 0 : reg_min - g;
+    if (widened_reg_min > region_non_empty_domain.second ||
+        reg_max < region_non_empty_domain.first)
+      continue;
+
+    if (read_state_.fragment_pruning) {
+      auto it = fragment_coverage.find(r.seq_name);
+      if (it == fragment_coverage.end() ||
+          !intersects_any(it->second, widened_reg_min, reg_max))
+        continue;
     }
+
+    filtered_regions.emplace_back(std::move(r));
   }
   *regions = filtered_regions;
+  LOG_DEBUG(
+      "[Reader] Pruned {} of {} regions outside the data array fragments",
+      num_regions - regions->size(),
+      num_regions);
 
   // Sort all by contig.
   if (params_.sort_regions) {
@@ -2044,22 +2586,21 @@ void Reader::prepare_regions_v4(
   // Apply region partitioning before expanding.
   // If we have less regions than requested partitions, handle that by
   // allowing empty partitions
-  if (regions->size() < params_.region_partitioning.num_partitions) {
-    // Make sure that we are not trying to fetch a partition that is out of
-    // bounds
-    if (params_.region_partitioning.partition_index >=
-        params_.region_partitioning.num_partitions)
-      throw std::runtime_error(
-          "Error partitioning vector; partition index " +
-          std::to_string(params_.region_partitioning.partition_index) +
-          " >= num partitions " +
-          std::to_string(params_.region_partitioning.num_partitions) + ".");
-    std::vector<Region> tmp;
-    if (params_.region_partitioning.partition_index < regions->size())
-      tmp.emplace_back((*regions)[params_.region_partitioning.partition_index]);
-    *regions = tmp;
+  if (params_.balance_partitions &&
+      params_.region_partitioning.num_partitions > 1) {
+    auto start_estimate = std::chrono::steady_clock::now();
+    auto region_records = estimate_region_records_v4(*regions);
+    LOG_DEBUG(
+        "Estimated records of {} regions in {:.3f} seconds.",
+        regions->size(),
+        utils::chrono_duration(start_estimate));
+    utils::partition_vector_weighted(
+        params_.region_partitioning.partition_index,
+        params_.region_partitioning.num_partitions,
+        region_records,
+        regions);
   } else {
-    utils::partition_vector(
+    utils::partition_vector_allow_empty(
         params_.region_partitioning.partition_index,
         params_.region_partitioning.num_partitions,
         regions);
@@ -2083,7 +2624,8 @@ void Reader::prepare_regions_v4(
     const uint32_t reg_min = r.min;
     const uint32_t reg_max = r.max;
 
-    // Widen the query region by the anchor gap value, avoiding overflow.
+    // Widen the query region by the contig's anchor gap, avoiding overflow.
+    const uint32_t g = dataset_->anchor_gap(r.seq_name);
     uint64_t widened_reg_min = g > reg_min ? 0 : reg_min - g;
 
     bool new_region = true;
@@ -2225,6 +2767,76 @@ void Reader::prepare_regions_v4(
   }
 }
 
+std::vector<double> Reader::estimate_region_records_v4(
+    const std::vector<Region>& regions) const {
+  // Distinct queried contigs, to split fragments spanning several contigs.
+  std::vector<std::string> contigs;
+  for (const auto& r : regions)
+    contigs.push_back(r.seq_name);
+  std::sort(contigs.begin(), contigs.end());
+  contigs.erase(std::unique(contigs.begin(), contigs.end()), contigs.end());
+
+  // Per contig, the changes in estimated records per position along the
+  // start position axis.
+  std::unordered_map<std::string, std::map<uint64_t, double>> density_steps;
+  for (const auto& fragment : dataset_->fragment_domains_v4()) {
+    auto first = std::lower_bound(
+        contigs.begin(), contigs.end(), fragment.contigs.first);
+    auto last =
+        std::upper_bound(first, contigs.end(), fragment.contigs.second);
+    if (first == last)
+      continue;
+    const double span = static_cast<double>(fragment.start_pos.second) -
+                        fragment.start_pos.first + 1;
+    const double density = fragment.num_cells / span / (last - first);
+    for (auto it = first; it != last; ++it) {
+      auto& steps = density_steps[*it];
+      steps[fragment.start_pos.first] += density;
+      steps[uint64_t(fragment.start_pos.second) + 1] -= density;
+    }
+  }
+
+  // Per contig, the cumulative records at each step position, so the records
+  // in a region are the difference of two lookups.
+  struct Step {
+    uint64_t pos;
+    double records;
+    double density;
+  };
+  std::unordered_map<std::string, std::vector<Step>> cumulative;
+  for (const auto& it : density_steps) {
+    auto& steps = cumulative[it.first];
+    double records = 0, density = 0;
+    uint64_t prev_pos = 0;
+    for (const auto& step : it.second) {
+      records += density * (step.first - prev_pos);
+      density += step.second;
+      steps.push_back({step.first, records, density});
+      prev_pos = step.first;
+    }
+  }
+  auto records_before = [](const std::vector<Step>& steps, uint64_t pos) {
+    auto it = std::upper_bound(
+        steps.begin(), steps.end(), pos, [](uint64_t p, const Step& s) {
+          return p < s.pos;
+        });
+    if (it == steps.begin())
+      return 0.0;
+    --it;
+    return it->records + it->density * (pos - it->pos);
+  };
+
+  std::vector<double> records(regions.size(), 0);
+  for (size_t i = 0; i < regions.size(); i++) {
+    auto it = cumulative.find(regions[i].seq_name);
+    if (it == cumulative.end())
+      continue;
+    records[i] = records_before(it->second, uint64_t(regions[i].max) + 1) -
+                 records_before(it->second, regions[i].min);
+  }
+  return records;
+}
+
 void Reader::prepare_regions_v3(
     std::vector<Region>* regions,
     std::vector<QueryRegion>* query_regions) const {
@@ -2242,8 +2854,7 @@ void Reader::prepare_regions_v3(
   // Add BED file regions, if specified.
   if (!params_.regions_file_uri.empty()) {
     auto start_bed_file_parse = std::chrono::steady_clock::now();
-    Region::parse_bed_file_htslib(
-        params_.regions_file_uri, &pre_partition_regions_list);
+    parse_bed_file(params_.regions_file_uri, &pre_partition_regions_list);
     LOG_DEBUG(fmt::format(
         std::locale(""),
         "Parsed bed file into {:L} regions in {:.3f} seconds.",
@@ -2370,8 +2981,7 @@ void Reader::prepare_regions_v2(
   // Add BED file regions, if specified.
   if (!params_.regions_file_uri.empty()) {
     auto start_bed_file_parse = std::chrono::steady_clock::now();
-    Region::parse_bed_file_htslib(
-        params_.regions_file_uri, &pre_partition_regions_list);
+    parse_bed_file(params_.regions_file_uri, &pre_partition_regions_list);
     LOG_DEBUG(fmt::format(
         std::locale(""),
         "Parsed bed file into {:L} regions in {:.3f} seconds.",
@@ -2526,6 +3136,17 @@ void Reader::prepare_attribute_buffers() {
         "requirements.");
   }
 
+  // The record filter reads the attributes it does not push down to TileDB.
+  if (record_filter_ != nullptr) {
+    auto required = record_filter_->array_attributes_required(*dataset_);
+    attrs.insert(required.begin(), required.end());
+  }
+  if (skip_ref_blocks_by_alleles())
+    attrs.insert(TileDBVCFDataset::AttrNames::V4::alleles);
+  // The AF filter reads GT from the compact genotype attribute if it exists.
+  if (af_filter_enabled() && dataset_->has_compact_gt())
+    attrs.insert(TileDBVCFDataset::AttrNames::V4::genotype);
+
   // We get one-forth of the memory budget for the query buffers.
   // another one-forth goes to TileDB for `sm.memory_budget` and
   // `sm.memory_budget_var`
@@ -2717,10 +3338,42 @@ void Reader::set_af_filter(const std::string& af_filter) {
   }
 }
 
+void Reader::set_record_filter(const std::string& record_filter) {
+  record_filter_.reset(
+      record_filter.empty() ? nullptr : new RecordFilter(record_filter));
+  params_.record_filter = record_filter;
+}
+
+void Reader::set_variants_only(bool variants_only) {
+  params_.variants_only = variants_only;
+}
+
 void Reader::set_scan_all_samples(bool scan_all_samples) {
   params_.scan_all_samples = scan_all_samples;
 }
 
+void Reader::set_query_condition() {
+  std::unique_ptr<QueryCondition> condition;
+  if (record_filter_ != nullptr)
+    condition = record_filter_->query_condition(*ctx_);
+
+  if (params_.variants_only && dataset_->has_ref_block_flag()) {
+    auto qc = QueryCondition::create<uint8_t>(
+        *ctx_, TileDBVCFDataset::AttrNames::V4::is_ref_block, 0, TILEDB_EQ);
+    if (condition == nullptr)
+      condition.reset(new QueryCondition(qc));
+    else
+      condition.reset(new QueryCondition(condition->combine(qc, TILEDB_AND)));
+  }
+
+  if (condition != nullptr)
+    read_state_.query->set_condition(*condition);
+}
+
+bool Reader::skip_ref_blocks_by_alleles() const {
+  return params_.variants_only && !dataset_->has_ref_block_flag();
+}
+
 void Reader::set_tiledb_query_config() {
   assert(read_state_.query != nullptr);
   assert(buffers_a != nullptr);
@@ -2814,6 +3467,23 @@ void Reader::set_check_samples_exist(const bool check_samples_exist) {
   params_.check_samples_exist = check_samples_exist;
 }
 
+void Reader::set_buffer_autotune(bool buffer_autotune) {
+  params_.buffer_autotune = buffer_autotune;
+}
+
+void Reader::set_batch_queue_depth(int32_t queue_depth) {
+  if (queue_depth < 1)
+    throw std::runtime_error(
+        "Error setting batch queue depth; it must be at least 1.");
+  params_.batch_queue_depth = queue_depth;
+}
+
+void Reader::buffer_autotune_stats(const char** stats) {
+  buffer_autotune_stats_ =
+      buffers_a == nullptr ? "{}" : buffers_a->autotune_stats();
+  *stats = buffer_autotune_stats_.c_str();
+}
+
 void Reader::set_enable_progress_estimation(
     const bool& enable_progress_estimation) {
   LOG_DEBUG(
@@ -33,18 +33,23 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <htslib/vcf.h>
 #include <tiledb/tiledb>
 
 #include "dataset/attribute_buffer_set.h"
+#include "dataset/dataset_handle.h"
 #include "dataset/tiledbvcfdataset.h"
 #include "enums/attr_datatype.h"
 #include "enums/read_status.h"
+#include "read/arrow_export.h"
+#include "read/batch_stream.h"
 #include "read/exporter.h"
 #include "read/in_memory_exporter.h"
 #include "read/read_query_results.h"
+#include "read/record_filter.h"
 #include "stats/allele_count.h"
 #include "stats/variant_stats_reader.h"
 #include "tiledb/array_schema.h"
@@ -94,6 +99,9 @@ struct ExportParams {
   std::string log_file;
   std::string samples_file_uri;
   std::string regions_file_uri;
+  // Directory where the regions parsed from BED files are cached as binary
+  // region indexes. If empty, BED files are parsed by every reader.
+  std::string region_index_cache_uri;
   std::vector<std::string> sample_names;
   std::vector<std::string> regions;
   std::string output_dir;
@@ -108,6 +116,9 @@ struct ExportParams {
   bool export_combined_vcf = false;
   bool cli_count_only = false;
   bool sort_regions = true;
+  // Should partitions be balanced by the number of records estimated from the
+  // fragment metadata instead of by the number of regions/samples?
+  bool balance_partitions = false;
   uint64_t max_num_records = std::numeric_limits<uint64_t>::max();
   std::vector<std::string> tiledb_config;
   std::unordered_map<std::string, std::string> tiledb_config_map;
@@ -119,6 +130,14 @@ struct ExportParams {
   uint64_t memory_budget_mb = 2 * 1024;
   MemoryBudgetBreakdown memory_budget_breakdown;
 
+  // Should the query buffers be re-apportioned between submits in proportion
+  // to the bytes per cell observed for each attribute?
+  bool buffer_autotune = true;
+
+  // Maximum number of batches the producer thread of `next_batch` reads
+  // ahead of the consumer. The buffer memory budget is split between them.
+  unsigned batch_queue_depth = 2;
+
   // Should we check that the sample names passed for export exist in the array
   // and error out if not This can add latency which might not be cared about
   // because we have to fetch the list of samples from the VCF header array
@@ -147,8 +166,16 @@ struct ExportParams {
   // If empty, AF filtering is not applied
   std::string af_filter = "";
 
+  // Record filter with the format "FIELD OP VALUE [&& FIELD OP VALUE ...]"
+  //   where FIELD = qual | pos_start | pos_end | filters | info_* | fmt_*
+  // See RecordFilter. If empty, records are not filtered.
+  std::string record_filter = "";
+
   // Should all samples be scanned when computing internal allele frequency?
   bool scan_all_samples = false;
+
+  // Should gVCF reference blocks be skipped? (v4 only)
+  bool variants_only = false;
 };
 
 /* ********************************* */
@@ -184,9 +211,59 @@ class Reader {
   /** Initializes the reader for reading from the given dataset. */
   void open_dataset(const std::string& dataset_uri);
 
-  /** Performs a blocking read operation. */
+  /**
+   * Initializes the reader for reading from the current snapshot of a
+   * dataset shared with other readers. The reader uses the TileDB context
+   * and config of the handle instead of its own; the memory budget still
+   * sizes its query buffers.
+   */
+  void open_dataset(std::shared_ptr<DatasetHandle> handle);
+
+  /**
+   * Performs a blocking read operation. Throws if a batch stream is open,
+   * since its producer thread owns the read state.
+   */
   void read();
 
+  /**
+   * Reads the next batch of results into library-owned buffers and exports
+   * it as an Arrow struct array with one child per attribute. The buffers
+   * grow until at least one record fits, and are reused for the next batch
+   * once all arrays of the previous one have been released. A batch of zero
+   * records is returned once the read is complete.
+   *
+   * @param attributes Exportable attribute names, which must not change
+   *    while the read is incomplete
+   * @param array Set to the batch
+   * @param schema Set to the schema of the batch
+   */
+  void read_arrow(
+      const std::vector<std::string>& attributes,
+      ArrowArray* array,
+      ArrowSchema* schema);
+
+  /**
+   * Returns the next batch of a streaming export. The first call starts a
+   * producer thread that reads batches like `read_arrow` ahead of the
+   * consumer, up to the batch queue depth, so that reading overlaps with
+   * consuming. Each batch is capped to an equal share of the buffer memory
+   * budget and its buffers are recycled once the consumer releases it.
+   *
+   * The stream stays open, returning no more batches once exhausted, until
+   * the reader is reset. No other read operation may run while it is open.
+   *
+   * @param attributes Exportable attribute names, which must not change
+   *    while the stream is open
+   * @param array Set to the batch; its release callback is null once the
+   *    stream is exhausted
+   * @param schema Set to the schema of the batch; its release callback is
+   *    null once the stream is exhausted
+   */
+  void next_batch(
+      const std::vector<std::string>& attributes,
+      ArrowArray* array,
+      ArrowSchema* schema);
+
   /**
    * Resets the read state (but not the parameters), allowing another read
    * operation to occur without reopening the dataset.
@@ -209,12 +286,24 @@ class Reader {
   /** Sets the sort regionsparameter. */
   void set_sort_regions(bool sort_regions);
 
+  /**
+   * Sets whether region and sample partitions are balanced by the estimated
+   * number of records instead of by the number of regions or samples.
+   */
+  void set_balance_partitions(bool balance_partitions);
+
   /** Sets the samples file URI parameter. */
   void set_samples_file(const std::string& uri);
 
   /** Sets the BED file URI parameter. */
   void set_bed_file(const std::string& uri);
 
+  /**
+   * Sets the directory where regions parsed from BED files are cached, so
+   * that readers of the same BED file load them instead of parsing it.
+   */
+  void set_region_index_cache(const std::string& uri);
+
   /** Sets the region partitioning. */
   void set_region_partition(uint64_t partition_idx, uint64_t num_partitions);
 
@@ -278,10 +367,22 @@ class Reader {
   /** Fetches tiledb stats as a string */
   void tiledb_stats(char** stats);
 
-  /** Returns the read status of the last read operation. */
+  /**
+   * Fetches the TileDB-VCF metrics (phase timings and counters) as JSON. The
+   * returned string is owned by this object and valid until the next call.
+   */
+  void metrics(const char** metrics);
+
+  /**
+   * Returns the read status of the last read operation. Throws if a batch
+   * stream is open.
+   */
   ReadStatus read_status() const;
 
-  /** Returns the number of records last exported. */
+  /**
+   * Returns the number of records last exported. Throws if a batch stream is
+   * open.
+   */
   uint64_t num_records_exported() const;
 
   /** Gets the version number of the open dataset. */
@@ -453,6 +554,22 @@ class Reader {
    */
   void set_af_filter(const std::string& af_filter);
 
+  /**
+   * Sets the record filter expression. Throws if the expression is invalid.
+   * Only supported on v4 datasets.
+   * @param record_filter setting
+   */
+  void set_record_filter(const std::string& record_filter);
+
+  /**
+   * Sets whether gVCF reference blocks are skipped. On datasets with the
+   * `is_ref_block` attribute they are skipped by TileDB, otherwise they are
+   * recognized by their alleles after the read. Only supported on v4
+   * datasets.
+   * @param variants_only setting
+   */
+  void set_variants_only(bool variants_only);
+
   /**
    * Reads the contents of the stats array for the region, in preparation for
    * conversion of the map to a data frame
@@ -528,6 +645,26 @@ class Reader {
    */
   void set_enable_progress_estimation(const bool& enable_progress_estimation);
 
+  /**
+   * Sets whether the query buffers are re-apportioned between submits based
+   * on the observed bytes per cell of each attribute
+   * @param buffer_autotune setting
+   */
+  void set_buffer_autotune(bool buffer_autotune);
+
+  /**
+   * Returns a JSON summary of the query buffer autotuning decisions. The
+   * string is owned by the reader and valid until the next call.
+   * @param stats Set to the summary
+   */
+  void buffer_autotune_stats(const char** stats);
+
+  /**
+   * Sets the number of batches `next_batch` reads ahead of the consumer.
+   * @param queue_depth setting, at least 1
+   */
+  void set_batch_queue_depth(int32_t queue_depth);
+
   /**
    * Percentage of buffer size to tiledb memory budget
    * @param buffer_percentage
@@ -653,6 +790,21 @@ class Reader {
     /** current sample batch list */
     std::vector<SampleAndId> current_sample_batches;
 
+    /**
+     * Are regions and samples pruned using the non-empty domains of the data
+     * array fragments? (v4 only)
+     */
+    bool fragment_pruning = false;
+
+    /** Fragments whose sample range intersects the samples being exported. */
+    std::vector<const TileDBVCFDataset::FragmentDomain*> sample_fragments;
+
+    /**
+     * Samples being exported that are outside the sample range of every
+     * fragment. They have no data, so no query range is set for them.
+     */
+    std::unordered_set<std::string> uncovered_samples;
+
     /** Total number of records exported across all incomplete reads. */
     uint64_t total_num_records_exported = 0;
 
@@ -684,6 +836,12 @@ class Reader {
 
     /** Does the export need headers to be fetched. */
     bool need_headers = false;
+
+    /** Record filter result of each cell in the current query results. */
+    std::vector<uint8_t> record_filter_pass;
+
+    /** Export order of the current query results, if sorted. */
+    std::vector<size_t> sorted_indexes;
   };
 
   /* ********************************* */
@@ -700,20 +858,44 @@ class Reader {
   std::unique_ptr<tiledb::VFS> vfs_;
 
   /** Handle on the dataset being exported from. */
-  std::unique_ptr<TileDBVCFDataset> dataset_;
+  std::shared_ptr<TileDBVCFDataset> dataset_;
+
+  /** Shared handle the dataset was opened from, if any. */
+  std::shared_ptr<DatasetHandle> dataset_handle_;
 
   /** Exporter instance (BCF, TSV, in-mem, etc). May be null. */
   std::unique_ptr<Exporter> exporter_;
 
+  /**
+   * Pool of buffer sets backing the batches returned by `read_arrow` and
+   * `next_batch`, all for the same attributes.
+   */
+  std::vector<std::shared_ptr<ArrowExportBuffers>> arrow_buffers_;
+
+  /** Open stream of `next_batch`, if any. */
+  std::unique_ptr<BatchStream> batch_stream_;
+
+  /** Attributes of the open stream. */
+  std::vector<std::string> batch_stream_attributes_;
+
+  /** Last metrics JSON returned by `metrics`. */
+  std::string metrics_json_;
+
   /** The read state. */
   ReadState read_state_;
 
   /** Set of attribute buffers holding TileDB query results. */
   std::unique_ptr<AttributeBufferSet> buffers_a;
 
+  /** Last summary returned by `buffer_autotune_stats`. */
+  std::string buffer_autotune_stats_;
+
   /** Variant stats filter */
   std::unique_ptr<VariantStatsReader> af_filter_;
 
+  /** Record filter, if one is set */
+  std::unique_ptr<RecordFilter> record_filter_;
+
   std::unique_ptr<AlleleCountReader> ac_reader_;
 
   /* ********************************* */
@@ -729,6 +911,21 @@ class Reader {
   /** Set up stats reader just for exporting over Arrow */
   void init_allele_count_reader_for_export();
 
+  /**
+   * Implements `read`. Also run by the producer thread of a batch stream.
+   */
+  void read_records();
+
+  /**
+   * Implements `read_arrow`, reusing a pooled buffer set that the consumer
+   * has released, or allocating one with the given budget.
+   */
+  void read_arrow_batch(
+      const std::vector<std::string>& attributes,
+      uint64_t budget_bytes,
+      ArrowArray* array,
+      ArrowSchema* schema);
+
   /** Swaps any existing exporter with an InMemoryExporter, and returns it. */
   InMemoryExporter* set_in_memory_exporter();
 
@@ -775,6 +972,17 @@ class Reader {
   std::vector<std::vector<SampleAndId>> prepare_sample_batches_v4(
       bool* all_samples) const;
 
+  /**
+   * Estimates the number of records of each sample from the cell counts and
+   * sample ranges of the fragments. Cells of a fragment are spread evenly
+   * over the given samples inside its sample range.
+   *
+   * @param samples Samples, sorted by name
+   * @return Estimated records per sample
+   */
+  std::vector<double> estimate_sample_records_v4(
+      const std::vector<SampleAndId>& samples) const;
+
   /** Merges the list of sample names with the contents of the samples file. */
   std::vector<SampleAndId> prepare_sample_names() const;
 
@@ -787,6 +995,38 @@ class Reader {
    */
   std::vector<SampleAndId> prepare_sample_names_v4(bool* all_samples) const;
 
+  /**
+   * Selects the fragments that can hold data of the samples being exported,
+   * and the samples no fragment holds, from the cached fragment domains.
+   * Requires the sample batches to be prepared.
+   */
+  void prepare_fragment_pruning_v4();
+
+  /**
+   * Points the read at a data array handle that skips the fragments written
+   * before every fragment selected by `prepare_fragment_pruning_v4`, so TileDB
+   * does not consider them at all. Deletes are still applied, since the end
+   * of the open timestamp range is unchanged.
+   */
+  void prepare_data_array_v4();
+
+  /**
+   * Returns, for each contig of the given regions, the sorted and merged
+   * start position ranges of the fragments selected by
+   * `prepare_fragment_pruning_v4`. Contigs no fragment covers are absent.
+   *
+   * @param regions Regions being exported
+   * @return Map of contig -> disjoint start position ranges
+   */
+  std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint32_t>>>
+  fragment_coverage_v4(const std::list<Region>& regions) const;
+
+  /**
+   * Appends the regions of the given BED file to the list, through the
+   * region index cache if one is configured.
+   */
+  void parse_bed_file(const std::string& uri, std::list<Region>* result) const;
+
   /**
    * Prepares the regions to be queried and exported. This merges the list of
    * regions with the contents of the regions file, sorts, and performs the
@@ -799,6 +1039,18 @@ class Reader {
       std::vector<std::pair<std::string, std::vector<QueryRegion>>>*
           query_regions);
 
+  /**
+   * Estimates the number of records intersecting each region from the cell
+   * counts and non-empty domains of the fragments. Cells of a fragment are
+   * assumed to be spread uniformly over its start position range, and evenly
+   * over the queried contigs inside its contig range.
+   *
+   * @param regions Regions to estimate
+   * @return Estimated records per region
+   */
+  std::vector<double> estimate_region_records_v4(
+      const std::vector<Region>& regions) const;
+
   /**
    * Prepares the regions to be queried and exported. This merges the list of
    * regions with the contents of the regions file, sorts, and performs the
@@ -873,6 +1125,18 @@ class Reader {
    */
   void set_tiledb_query_config();
 
+  /**
+   * Sets the query condition of the record filter and of the variant-only
+   * mode on the current v4 query, if there is one.
+   */
+  void set_query_condition();
+
+  /**
+   * Returns true if reference blocks are skipped after the read, because the
+   * dataset does not flag them.
+   */
+  bool skip_ref_blocks_by_alleles() const;
+
   void compute_memory_budget_details();
 };
 
@@ -0,0 +1,573 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "read/record_filter.h"
+#include "utils/utils.h"
+
+namespace tiledb {
+namespace vcf {
+
+namespace {
+
+typedef RecordFilter::Op Op;
+typedef RecordFilter::Predicate Predicate;
+
+[[noreturn]] void parse_error(
+    const std::string& expression, const std::string& message) {
+  throw std::runtime_error(
+      "Error parsing record filter '" + expression + "'; " + message);
+}
+
+bool is_field_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+}
+
+std::string to_lower(std::string s) {
+  for (auto& c : s)
+    c = std::tolower(static_cast<unsigned char>(c));
+  return s;
+}
+
+bool parse_number(const std::string& s, double* result) {
+  if (s.empty())
+    return false;
+  char* end = nullptr;
+  *result = std::strtod(s.c_str(), &end);
+  return end == s.c_str() + s.size();
+}
+
+/** Returns the field name with the standard fields in lower case. */
+std::string normalize_field(
+    const std::string& expression, const std::string& field) {
+  const std::string lower = to_lower(field);
+  if (lower == "qual" || lower == "pos_start" || lower == "pos_end" ||
+      lower == "filters")
+    return lower;
+  if (lower == "filter")
+    return "filters";
+
+  std::string prefix;
+  if (utils::starts_with(lower, "info_"))
+    prefix = "info_";
+  else if (utils::starts_with(lower, "fmt_"))
+    prefix = "fmt_";
+  const std::string key = field.substr(prefix.size());
+  if (prefix.empty() || key.empty())
+    parse_error(expression, "unknown field '" + field + "'");
+  if (prefix == "fmt_" && key == "GT")
+    parse_error(expression, "filtering on fmt_GT is not supported");
+  return prefix + key;
+}
+
+Op parse_op(const std::string& s, size_t* pos) {
+  static const std::pair<const char*, Op> ops[] = {{"<=", Op::LE},
+                                                   {">=", Op::GE},
+                                                   {"==", Op::EQ},
+                                                   {"!=", Op::NE},
+                                                   {"<", Op::LT},
+                                                   {">", Op::GT},
+                                                   {"=", Op::EQ}};
+  for (const auto& op : ops) {
+    const size_t len = std::strlen(op.first);
+    if (s.compare(*pos, len, op.first) == 0) {
+      *pos += len;
+      return op.second;
+    }
+  }
+  parse_error(s, "expected an operator at offset " + std::to_string(*pos));
+}
+
+void validate(const std::string& expression, const Predicate& p) {
+  if (p.field == "qual" && !p.is_number) {
+    parse_error(expression, "qual must be compared with a number");
+  } else if (p.field == "pos_start" || p.field == "pos_end") {
+    if (!p.is_number || !std::isfinite(p.number))
+      parse_error(expression, p.field + " must be compared with a number");
+  } else if (p.field == "filters" && p.op != Op::EQ && p.op != Op::NE) {
+    parse_error(expression, "filters only supports == and !=");
+  }
+}
+
+/** Positions satisfying a position predicate. */
+enum class PositionBound { ALL, NONE, SOME };
+
+/**
+ * Rewrites a predicate on a 1-based position as a comparison of the 0-based
+ * position attribute with `value`, rounding fractional numbers in the
+ * direction of the operator. Returns ALL or NONE, without setting `op` and
+ * `value`, if every or no position satisfies the predicate.
+ */
+PositionBound position_bound(const Predicate& p, Op* op, uint32_t* value) {
+  const double max_pos = std::numeric_limits<uint32_t>::max() + 1.0;
+  double bound = p.number;
+  Op bound_op = p.op;
+  switch (p.op) {
+    case Op::LT:
+      bound_op = Op::LE;
+      bound = std::ceil(p.number) - 1;
+      break;
+    case Op::LE:
+      bound = std::floor(p.number);
+      break;
+    case Op::GT:
+      bound_op = Op::GE;
+      bound = std::floor(p.number) + 1;
+      break;
+    case Op::GE:
+      bound = std::ceil(p.number);
+      break;
+    default:
+      if (p.number != std::floor(p.number) || p.number < 1 ||
+          p.number > max_pos)
+        return p.op == Op::EQ ? PositionBound::NONE : PositionBound::ALL;
+  }
+
+  if (bound_op == Op::LE && bound < 1)
+    return PositionBound::NONE;
+  if (bound_op == Op::LE && bound >= max_pos)
+    return PositionBound::ALL;
+  if (bound_op == Op::GE && bound <= 1)
+    return PositionBound::ALL;
+  if (bound_op == Op::GE && bound > max_pos)
+    return PositionBound::NONE;
+
+  *op = bound_op;
+  *value = static_cast<uint32_t>(bound - 1);
+  return PositionBound::SOME;
+}
+
+tiledb_query_condition_op_t tiledb_op(Op op) {
+  switch (op) {
+    case Op::LT:
+      return TILEDB_LT;
+    case Op::LE:
+      return TILEDB_LE;
+    case Op::GT:
+      return TILEDB_GT;
+    case Op::GE:
+      return TILEDB_GE;
+    case Op::EQ:
+      return TILEDB_EQ;
+    default:
+      return TILEDB_NE;
+  }
+}
+
+template <typename T>
+bool compare(const T& a, const T& b, Op op) {
+  switch (op) {
+    case Op::LT:
+      return a < b;
+    case Op::LE:
+      return a <= b;
+    case Op::GT:
+      return a > b;
+    case Op::GE:
+      return a >= b;
+    case Op::EQ:
+      return a == b;
+    default:
+      return a != b;
+  }
+}
+
+/** Returns the bytes of a cell of a var-sized attribute. */
+const char* cell_value(
+    const Buffer& buffer,
+    uint64_t data_size,
+    uint64_t num_cells,
+    uint64_t cell_idx,
+    uint64_t* nbytes) {
+  const auto& offsets = buffer.offsets();
+  const uint64_t offset = offsets[cell_idx];
+  const uint64_t next_offset =
+      cell_idx == num_cells - 1 ? data_size : offsets[cell_idx + 1];
+  *nbytes = next_offset - offset;
+  return buffer.data<char>() + offset;
+}
+
+/**
+ * Finds the value of an info/fmt field in a cell of an extracted attribute or
+ * of the info/fmt blob attribute. Returns false if the value is missing.
+ */
+bool find_info_fmt_value(
+    const char* ptr,
+    uint64_t nbytes,
+    bool is_extracted_attr,
+    const std::string& key,
+    int* type,
+    int* num_values,
+    const char** values) {
+  // Check for null (dummy byte).
+  if (nbytes == 1 && *ptr == '\0')
+    return false;
+
+  if (is_extracted_attr) {
+    std::memcpy(type, ptr, sizeof(int));
+    std::memcpy(num_values, ptr + sizeof(int), sizeof(int));
+    *values = ptr + 2 * sizeof(int);
+    return true;
+  }
+
+  // Skip initial 'nfmt'/'ninfo' field.
+  const char* end = ptr + nbytes;
+  ptr += sizeof(uint32_t);
+  while (ptr < end) {
+    const bool match = std::strcmp(key.c_str(), ptr) == 0;
+    ptr += std::strlen(ptr) + 1;
+    std::memcpy(type, ptr, sizeof(int));
+    std::memcpy(num_values, ptr + sizeof(int), sizeof(int));
+    ptr += 2 * sizeof(int);
+    if (match) {
+      *values = ptr;
+      return true;
+    }
+    ptr += *num_values * utils::bcf_type_size(*type);
+  }
+  return false;
+}
+
+/** Returns true if any of the values of an info/fmt field match. */
+bool match_values(
+    const Predicate& p, int type, int num_values, const char* values) {
+  if (type == BCF_HT_STR) {
+    std::string_view str(values, strnlen(values, num_values));
+    return compare(str, std::string_view(p.value), p.op);
+  }
+  if (!p.is_number)
+    return false;
+
+  // A flag has no values; it is true if present.
+  if (type == BCF_HT_FLAG || num_values == 0)
+    return compare(1.0, p.number, p.op);
+
+  for (int j = 0; j < num_values; j++) {
+    double value;
+    if (type == BCF_HT_REAL) {
+      float f;
+      std::memcpy(&f, values + j * sizeof(float), sizeof(float));
+      if (bcf_float_is_missing(f) || bcf_float_is_vector_end(f))
+        continue;
+      value = f;
+    } else {
+      int32_t i;
+      std::memcpy(&i, values + j * sizeof(int32_t), sizeof(int32_t));
+      if (i == bcf_int32_missing || i == bcf_int32_vector_end)
+        continue;
+      value = i;
+    }
+    if (compare(value, p.number, p.op))
+      return true;
+  }
+  return false;
+}
+
+void evaluate_filters(
+    const Predicate& p,
+    const ReadQueryResults& results,
+    const RecordFilter::HeaderLookup& hdr_lookup,
+    std::vector<uint8_t>* pass) {
+  const uint64_t num_cells = results.num_cells();
+  const Buffer& src = results.buffers()->filter_ids();
+  const uint64_t data_size = results.filter_ids_size().second;
+
+  // PASS is always the first filter of a VCF header.
+  const bool is_pass = p.value == "PASS";
+  const bcf_hdr_t* last_hdr = nullptr;
+  int filter_id = 0;
+  for (uint64_t i = 0; i < num_cells; i++) {
+    if (!(*pass)[i])
+      continue;
+
+    if (!is_pass) {
+      const bcf_hdr_t* hdr = hdr_lookup(i);
+      if (hdr == nullptr)
+        throw std::runtime_error(
+            "Error evaluating record filter; no VCF header for filter '" +
+            p.value + "'");
+      if (hdr != last_hdr) {
+        filter_id = bcf_hdr_id2int(hdr, BCF_DT_ID, p.value.c_str());
+        if (!bcf_hdr_idinfo_exists(hdr, BCF_HL_FLT, filter_id))
+          filter_id = -1;
+        last_hdr = hdr;
+      }
+    }
+
+    // The filters are ingested as a list of int32 IDs, prefixed by its size.
+    uint64_t nbytes = 0;
+    const char* ptr = cell_value(src, data_size, num_cells, i, &nbytes);
+    int num_filters = 0;
+    std::memcpy(&num_filters, ptr, sizeof(int));
+    bool found = false;
+    for (int j = 0; j < num_filters && !found && filter_id >= 0; j++) {
+      int id;
+      std::memcpy(&id, ptr + (j + 1) * sizeof(int), sizeof(int));
+      found = id == filter_id;
+    }
+    (*pass)[i] = found == (p.op == Op::EQ);
+  }
+}
+
+void evaluate_info_fmt(
+    const Predicate& p,
+    const ReadQueryResults& results,
+    std::vector<uint8_t>* pass) {
+  const uint64_t num_cells = results.num_cells();
+  const bool is_info = utils::starts_with(p.field, "info_");
+  const std::string key = p.field.substr(is_info ? 5 : 4);
+
+  // Get either the extracted attribute buffer, or the info/fmt blob attribute.
+  const Buffer* src = nullptr;
+  uint64_t data_size = 0;
+  const bool is_extracted_attr = results.buffers()->extra_attr(p.field, &src);
+  if (is_extracted_attr) {
+    auto it = results.extra_attrs_size().find(p.field);
+    if (it == results.extra_attrs_size().end())
+      throw std::runtime_error(
+          "Error evaluating record filter; no size for attribute " + p.field);
+    data_size = it->second.second;
+  } else if (is_info) {
+    src = &results.buffers()->info();
+    data_size = results.info_size().second;
+  } else {
+    src = &results.buffers()->fmt();
+    data_size = results.fmt_size().second;
+  }
+  const Buffer* blob =
+      is_info ? &results.buffers()->info() : &results.buffers()->fmt();
+  const auto& blob_size = is_info ? results.info_size() : results.fmt_size();
+
+  for (uint64_t i = 0; i < num_cells; i++) {
+    if (!(*pass)[i])
+      continue;
+
+    uint64_t nbytes = 0;
+    const char* ptr = cell_value(*src, data_size, num_cells, i, &nbytes);
+    bool in_blob = !is_extracted_attr;
+    // Extracted attributes not backfilled yet are null, but the blob still
+    // holds the value
+    if (is_extracted_attr && nbytes == 1 && *ptr == '\0' &&
+        blob_size.first > 0) {
+      ptr = cell_value(*blob, blob_size.second, num_cells, i, &nbytes);
+      in_blob = true;
+    }
+    int type = 0, num_values = 0;
+    const char* values = nullptr;
+    (*pass)[i] = find_info_fmt_value(
+                     ptr,
+                     nbytes,
+                     !in_blob,
+                     key,
+                     &type,
+                     &num_values,
+                     &values) &&
+                 match_values(p, type, num_values, values);
+  }
+}
+
+}  // namespace
+
+RecordFilter::RecordFilter(const std::string& expression)
+    : expression_(expression) {
+  const std::string& s = expression;
+  size_t pos = 0;
+  auto skip_spaces = [&s, &pos]() {
+    while (pos < s.size() && std::isspace(static_cast<unsigned char>(s[pos])))
+      pos++;
+  };
+
+  while (true) {
+    skip_spaces();
+    size_t begin = pos;
+    while (pos < s.size() && is_field_char(s[pos]))
+      pos++;
+    if (pos == begin)
+      parse_error(s, "expected a field at offset " + std::to_string(begin));
+
+    Predicate p;
+    p.field = normalize_field(s, s.substr(begin, pos - begin));
+    skip_spaces();
+    p.op = parse_op(s, &pos);
+    skip_spaces();
+
+    if (pos < s.size() && (s[pos] == '"' || s[pos] == '\'')) {
+      const size_t end = s.find(s[pos], pos + 1);
+      if (end == std::string::npos)
+        parse_error(s, "unterminated quoted value");
+      p.value = s.substr(pos + 1, end - pos - 1);
+      pos = end + 1;
+    } else {
+      begin = pos;
+      while (pos < s.size() &&
+             !std::isspace(static_cast<unsigned char>(s[pos])) &&
+             s[pos] != '&')
+        pos++;
+      p.value = s.substr(begin, pos - begin);
+    }
+    if (p.value.empty())
+      parse_error(s, "missing value for " + p.field);
+    p.is_number = parse_number(p.value, &p.number);
+    validate(s, p);
+    predicates_.push_back(std::move(p));
+
+    skip_spaces();
+    if (pos == s.size())
+      break;
+    if (s.compare(pos, 2, "&&") == 0) {
+      pos += 2;
+    } else if (
+        to_lower(s.substr(pos, 3)) == "and" &&
+        (pos + 3 == s.size() || !is_field_char(s[pos + 3]))) {
+      pos += 3;
+    } else {
+      parse_error(s, "expected '&&' at offset " + std::to_string(pos));
+    }
+  }
+}
+
+const std::string& RecordFilter::expression() const {
+  return expression_;
+}
+
+const std::vector<RecordFilter::Predicate>& RecordFilter::predicates() const {
+  return predicates_;
+}
+
+bool RecordFilter::is_pushed_down(const Predicate& predicate) {
+  return predicate.field == "qual" || predicate.field == "pos_start" ||
+         predicate.field == "pos_end";
+}
+
+bool RecordFilter::has_post_filter() const {
+  for (const auto& p : predicates_) {
+    if (!is_pushed_down(p))
+      return true;
+  }
+  return false;
+}
+
+bool RecordFilter::need_headers() const {
+  for (const auto& p : predicates_) {
+    if (p.field == "filters" && p.value != "PASS")
+      return true;
+  }
+  return false;
+}
+
+std::unique_ptr<QueryCondition> RecordFilter::query_condition(
+    const Context& ctx) const {
+  std::unique_ptr<QueryCondition> condition;
+  for (const auto& p : predicates_) {
+    if (!is_pushed_down(p))
+      continue;
+
+    QueryCondition qc(ctx);
+    if (p.field == "qual") {
+      qc = QueryCondition::create<float>(
+          ctx,
+          TileDBVCFDataset::AttrNames::V4::qual,
+          static_cast<float>(p.number),
+          tiledb_op(p.op));
+    } else {
+      const std::string& attr =
+          p.field == "pos_start" ?
+              TileDBVCFDataset::AttrNames::V4::real_start_pos :
+              TileDBVCFDataset::AttrNames::V4::end_pos;
+      Op op = p.op;
+      uint32_t value = 0;
+      switch (position_bound(p, &op, &value)) {
+        case PositionBound::ALL:
+          continue;
+        case PositionBound::NONE:
+          // No position is below 0
+          qc = QueryCondition::create<uint32_t>(ctx, attr, 0, TILEDB_LT);
+          break;
+        default:
+          qc = QueryCondition::create<uint32_t>(
+              ctx, attr, value, tiledb_op(op));
+      }
+    }
+    if (condition == nullptr)
+      condition.reset(new QueryCondition(qc));
+    else
+      condition.reset(new QueryCondition(condition->combine(qc, TILEDB_AND)));
+  }
+
+  return condition;
+}
+
+std::set<std::string> RecordFilter::array_attributes_required(
+    const TileDBVCFDataset& dataset) const {
+  const std::set<std::string> extracted(
+      dataset.metadata().extra_attributes.begin(),
+      dataset.metadata().extra_attributes.end());
+
+  std::set<std::string> result;
+  for (const auto& p : predicates_) {
+    if (is_pushed_down(p))
+      continue;
+    if (p.field == "filters")
+      result.insert(TileDBVCFDataset::AttrNames::V4::filter_ids);
+    else if (extracted.count(p.field)) {
+      result.insert(p.field);
+      // Cells not backfilled yet hold the value in the info/fmt blob
+      if (dataset.attribute_needs_backfill(p.field))
+        result.insert(
+            utils::starts_with(p.field, "info_") ?
+                TileDBVCFDataset::AttrNames::V4::info :
+                TileDBVCFDataset::AttrNames::V4::fmt);
+    } else if (utils::starts_with(p.field, "info_"))
+      result.insert(TileDBVCFDataset::AttrNames::V4::info);
+    else
+      result.insert(TileDBVCFDataset::AttrNames::V4::fmt);
+  }
+  return result;
+}
+
+void RecordFilter::evaluate(
+    const ReadQueryResults& results,
+    const HeaderLookup& hdr_lookup,
+    std::vector<uint8_t>* pass) const {
+  pass->assign(results.num_cells(), 1);
+  for (const auto& p : predicates_) {
+    if (is_pushed_down(p))
+      continue;
+    if (p.field == "filters")
+      evaluate_filters(p, results, hdr_lookup, pass);
+    else
+      evaluate_info_fmt(p, results, pass);
+  }
+}
+
+}  // namespace vcf
+}  // namespace tiledb
@@ -0,0 +1,154 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_RECORD_FILTER_H
+#define TILEDB_VCF_RECORD_FILTER_H
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <htslib/vcf.h>
+#include <tiledb/tiledb>
+
+#include "dataset/tiledbvcfdataset.h"
+#include "read/read_query_results.h"
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * Record filter of an export, parsed from an expression of the form
+ *
+ *   FIELD OP VALUE [&& FIELD OP VALUE ...]
+ *
+ * where FIELD = qual | pos_start | pos_end | filters | info_<key> | fmt_<key>,
+ * OP = < | <= | > | >= | == | != and `and` may be used in place of `&&`.
+ *
+ * Predicates on materialized fixed-size attributes (qual, pos_start, pos_end)
+ * are compiled into a TileDB query condition, so TileDB drops the records
+ * before they are copied into the query buffers. The other predicates read
+ * blob-encoded or var-sized attributes and are evaluated on each batch of
+ * query results, before the records are exported. Positions are compared with
+ * any number, so `pos_start < 100.5` keeps position 100.
+ *
+ * A `filters` predicate only supports `==` and `!=`, which test whether the
+ * FILTER list of the record contains the given filter. A comparison with a
+ * missing info/fmt value is false. A multi-valued info/fmt field satisfies a
+ * predicate if any of its values does.
+ */
+class RecordFilter {
+ public:
+  /** Comparison operator of a predicate. */
+  enum class Op { LT, LE, GT, GE, EQ, NE };
+
+  /** A `FIELD OP VALUE` comparison. */
+  struct Predicate {
+    /** Field name, with the standard fields in lower case */
+    std::string field;
+    /** Comparison operator */
+    Op op;
+    /** Value, as written in the expression */
+    std::string value;
+    /** True if `value` is a number */
+    bool is_number;
+    /** Value as a number, if `is_number` */
+    double number;
+  };
+
+  /** Returns the VCF header of the sample of the given result cell. */
+  typedef std::function<const bcf_hdr_t*(uint64_t cell_idx)> HeaderLookup;
+
+  /**
+   * Parses the given expression. Throws if it is invalid.
+   *
+   * @param expression Filter expression
+   */
+  explicit RecordFilter(const std::string& expression);
+
+  /** Returns the expression the filter was parsed from. */
+  const std::string& expression() const;
+
+  /** Returns the predicates of the filter. */
+  const std::vector<Predicate>& predicates() const;
+
+  /** Returns true if the predicate is evaluated by TileDB. */
+  static bool is_pushed_down(const Predicate& predicate);
+
+  /** Returns true if some predicates are evaluated on the query results. */
+  bool has_post_filter() const;
+
+  /**
+   * Returns true if the VCF headers of the exported samples are needed to
+   * evaluate the filter, to map filter names other than PASS to their IDs.
+   */
+  bool need_headers() const;
+
+  /**
+   * Returns the query condition of the pushed-down predicates on the v4 data
+   * array, or null if there are none.
+   *
+   * @param ctx TileDB context
+   */
+  std::unique_ptr<QueryCondition> query_condition(const Context& ctx) const;
+
+  /**
+   * Returns the data array attributes read by the predicates evaluated on the
+   * query results.
+   *
+   * @param dataset Dataset being exported
+   */
+  std::set<std::string> array_attributes_required(
+      const TileDBVCFDataset& dataset) const;
+
+  /**
+   * Evaluates the predicates that are not pushed down on every cell of the
+   * query results, one predicate at a time.
+   *
+   * @param results Query results
+   * @param hdr_lookup Returns the VCF header of a cell; only called if
+   *     `need_headers()`
+   * @param pass Set to 1 for each cell passing the filter, 0 otherwise
+   */
+  void evaluate(
+      const ReadQueryResults& results,
+      const HeaderLookup& hdr_lookup,
+      std::vector<uint8_t>* pass) const;
+
+ private:
+  /** Expression the filter was parsed from */
+  std::string expression_;
+
+  /** Parsed predicates */
+  std::vector<Predicate> predicates_;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_RECORD_FILTER_H
@@ -27,6 +27,7 @@
 #include "allele_count.h"
 #include "managed_query.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/utils.h"
 
 namespace tiledb::vcf {
@@ -291,6 +292,8 @@ void AlleleCount::flush(bool finalize) {
   if (!enabled_) {
     return;
   }
+  static auto& flush_time = metrics::histogram("ingest.stats_flush");
+  metrics::ScopedTimer timer(flush_time);
 
   // Update results for the last locus before flushing
   update_results();
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include <stdexcept>
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/normalize.h"
 #include "utils/utils.h"
 #include "vcf/htslib_value.h"
@@ -388,6 +389,8 @@ void VariantStats::flush(bool finalize) {
   if (!enabled_) {
     return;
   }
+  static auto& flush_time = metrics::histogram("ingest.stats_flush");
+  metrics::ScopedTimer timer(flush_time);
 
   // Update results for the last locus before flushing
   update_results();
@@ -27,6 +27,7 @@
 #include <cstdlib>
 
 #include "utils/buffer.h"
+#include "utils/buffer_pool.h"
 
 namespace tiledb {
 namespace vcf {
@@ -41,7 +42,7 @@ Buffer::Buffer()
 }
 
 Buffer::~Buffer() {
-  std::free(data_);
+  buffer_pool::deallocate(data_, data_alloced_size_);
 }
 
 Buffer::Buffer(Buffer&& other)
@@ -149,13 +150,15 @@ void Buffer::realloc(uint64_t new_alloced_size, bool clear_new) {
 
   auto old_alloc = data_alloced_size_;
 
+  // Allocations go through the buffer pool, which reuses the allocations of
+  // freed buffers while the writer enables it.
   if (data_alloced_size_ == 0) {
-    data_alloced_size_ = new_alloced_size;
-    data_ = (char*)std::realloc(data_, data_alloced_size_);
+    data_ = buffer_pool::allocate(new_alloced_size, &data_alloced_size_);
   } else if (new_alloced_size > data_alloced_size_) {
-    while (new_alloced_size > data_alloced_size_)
-      data_alloced_size_ *= 2;
-    data_ = (char*)std::realloc(data_, data_alloced_size_);
+    uint64_t size = data_alloced_size_;
+    while (new_alloced_size > size)
+      size *= 2;
+    data_ = buffer_pool::reallocate(data_, &data_alloced_size_, size);
   }
 
   auto new_alloc = data_alloced_size_;
@@ -180,6 +183,8 @@ void Buffer::swap(Buffer& other) {
   std::swap(data_, other.data_);
   std::swap(data_alloced_size_, other.data_alloced_size_);
   std::swap(data_size_, other.data_size_);
+  std::swap(data_effective_size_, other.data_effective_size_);
+  std::swap(offset_nelts_, other.offset_nelts_);
   offsets_.swap(other.offsets_);
 }
 
@@ -0,0 +1,212 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "utils/buffer_pool.h"
+#include "utils/metrics.h"
+
+namespace tiledb {
+namespace vcf {
+namespace buffer_pool {
+
+namespace {
+
+/** Pooled allocations by size, and the high water marks of the buffers. */
+struct Pool {
+  std::mutex mtx;
+
+  /**
+   * Checked without the lock, so that allocations made while the pool is
+   * disabled go straight to malloc/realloc/free.
+   */
+  std::atomic<bool> enabled{false};
+  /** Number of `enable` calls not yet matched by `release`. */
+  unsigned users = 0;
+  bool huge_pages = false;
+  uint64_t max_pooled_bytes = 0;
+  uint64_t pooled_bytes = 0;
+  std::multimap<uint64_t, char*> allocations;
+  std::map<std::string, uint64_t> high_water;
+};
+
+Pool& pool() {
+  static Pool instance;
+  return instance;
+}
+
+/**
+ * Allocates `*size` bytes from the system. Huge page allocations are rounded
+ * up to a whole number of huge pages, and `*size` is set to the result.
+ */
+char* system_allocate(uint64_t* size, bool huge_pages) {
+#ifdef __linux__
+  if (huge_pages && *size >= huge_page_size) {
+    *size = (*size + huge_page_size - 1) / huge_page_size * huge_page_size;
+    void* data = nullptr;
+    if (posix_memalign(&data, huge_page_size, *size) != 0)
+      throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    // Advisory only, the allocation is still usable if THP are disabled
+    madvise(data, *size, MADV_HUGEPAGE);
+#endif
+    return static_cast<char*>(data);
+  }
+#endif
+  (void)huge_pages;
+  char* data = static_cast<char*>(std::malloc(*size));
+  if (data == nullptr)
+    throw std::bad_alloc();
+  return data;
+}
+
+}  // namespace
+
+void enable(uint64_t max_pooled_bytes, bool huge_pages) {
+  auto& p = pool();
+  std::lock_guard<std::mutex> lock(p.mtx);
+  p.users++;
+  p.enabled = true;
+  p.huge_pages |= huge_pages;
+  p.max_pooled_bytes += max_pooled_bytes;
+}
+
+void release() {
+  auto& p = pool();
+  std::multimap<uint64_t, char*> allocations;
+  {
+    std::lock_guard<std::mutex> lock(p.mtx);
+    if (p.users > 1) {
+      p.users--;
+      return;
+    }
+    p.users = 0;
+    p.enabled = false;
+    p.huge_pages = false;
+    p.max_pooled_bytes = 0;
+    p.pooled_bytes = 0;
+    p.allocations.swap(allocations);
+    p.high_water.clear();
+  }
+  for (auto& allocation : allocations)
+    std::free(allocation.second);
+}
+
+char* allocate(uint64_t size, uint64_t* alloced_size) {
+  static auto& reused_bytes = metrics::counter("buffer_pool.reused_bytes");
+  auto& p = pool();
+  *alloced_size = size;
+  if (!p.enabled.load(std::memory_order_relaxed))
+    return system_allocate(alloced_size, false);
+
+  bool huge_pages;
+  {
+    std::lock_guard<std::mutex> lock(p.mtx);
+    huge_pages = p.huge_pages;
+
+    // Reuse the smallest pooled allocation that fits, unless it is more than
+    // twice the requested size
+    auto it = p.allocations.lower_bound(size);
+    if (it != p.allocations.end() && it->first / 2 <= size) {
+      *alloced_size = it->first;
+      char* data = it->second;
+      p.pooled_bytes -= it->first;
+      p.allocations.erase(it);
+      reused_bytes.add(*alloced_size);
+      return data;
+    }
+  }
+
+  return system_allocate(alloced_size, huge_pages);
+}
+
+char* reallocate(char* data, uint64_t* alloced_size, uint64_t size) {
+  auto& p = pool();
+  if (!p.enabled.load(std::memory_order_relaxed)) {
+    char* grown = static_cast<char*>(std::realloc(data, size));
+    if (grown == nullptr)
+      throw std::bad_alloc();
+    *alloced_size = size;
+    return grown;
+  }
+
+  uint64_t grown_size = 0;
+  char* grown = allocate(size, &grown_size);
+  std::memcpy(grown, data, *alloced_size);
+  deallocate(data, *alloced_size);
+  *alloced_size = grown_size;
+  return grown;
+}
+
+void deallocate(char* data, uint64_t alloced_size) {
+  if (data == nullptr)
+    return;
+
+  auto& p = pool();
+  if (p.enabled.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(p.mtx);
+    if (p.enabled && p.pooled_bytes + alloced_size <= p.max_pooled_bytes) {
+      p.allocations.emplace(alloced_size, data);
+      p.pooled_bytes += alloced_size;
+      return;
+    }
+  }
+  std::free(data);
+}
+
+uint64_t high_water(const std::string& name) {
+  auto& p = pool();
+  if (!p.enabled.load(std::memory_order_relaxed))
+    return 0;
+  std::lock_guard<std::mutex> lock(p.mtx);
+  auto it = p.high_water.find(name);
+  return p.enabled && it != p.high_water.end() ? it->second : 0;
+}
+
+void update_high_water(const std::string& name, uint64_t size) {
+  auto& p = pool();
+  if (!p.enabled.load(std::memory_order_relaxed))
+    return;
+  std::lock_guard<std::mutex> lock(p.mtx);
+  if (!p.enabled)
+    return;
+  auto& value = p.high_water[name];
+  value = std::max(value, size);
+}
+
+}  // namespace buffer_pool
+}  // namespace vcf
+}  // namespace tiledb
@@ -0,0 +1,111 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * This file defines the process-wide pool of the allocations of `Buffer`
+ * instances. The pool is disabled by default, and `Buffer` then allocates
+ * with malloc/realloc. The writer enables it for the duration of an
+ * ingestion: the allocations of the workers of a sample batch are kept for
+ * the workers of the next batch, which also reserve their buffers to the
+ * largest sizes reached by earlier workers (the high water marks), so the
+ * buffers neither grow again through copies nor fault in fresh pages.
+ *
+ * The pool is sized for a single ingestion at a time per process. Enabling
+ * and releasing are reference counted so that concurrent ingestions do not
+ * release the pool under each other, but they share one pool: its budget is
+ * the sum of theirs, and each reserves to the high water marks of all.
+ *
+ * With huge pages enabled, allocations of at least `huge_page_size` bytes are
+ * aligned to it and advised for transparent huge pages (Linux only).
+ */
+
+#ifndef TILEDB_VCF_BUFFER_POOL_H
+#define TILEDB_VCF_BUFFER_POOL_H
+
+#include <cstdint>
+#include <string>
+
+namespace tiledb {
+namespace vcf {
+namespace buffer_pool {
+
+/** Size of a transparent huge page. */
+const uint64_t huge_page_size = 2 << 20;
+
+/**
+ * Enables the pool, or adds a user to the enabled pool. Freed allocations are
+ * kept for reuse while the pool holds at most the sum of the
+ * `max_pooled_bytes` of its users, and larger ones are returned to the
+ * system. Each call must be matched by a call to `release`.
+ *
+ * @param max_pooled_bytes Max total size of the pooled allocations
+ * @param huge_pages True to use transparent huge pages for large allocations
+ */
+void enable(uint64_t max_pooled_bytes, bool huge_pages);
+
+/**
+ * Removes a user of the pool. Once the last user is removed, disables the
+ * pool, frees the pooled allocations and forgets the high water marks.
+ */
+void release();
+
+/**
+ * Allocates at least `size` bytes, reusing a pooled allocation if one fits.
+ *
+ * @param size Requested size in bytes
+ * @param alloced_size Set to the size of the returned allocation
+ * @return The allocation
+ */
+char* allocate(uint64_t size, uint64_t* alloced_size);
+
+/**
+ * Grows an allocation to at least `size` bytes, keeping its contents like
+ * realloc.
+ *
+ * @param data Allocation to grow, which is invalidated
+ * @param alloced_size Size of the allocation, set to the new size
+ * @param size Requested size in bytes
+ * @return The grown allocation
+ */
+char* reallocate(char* data, uint64_t* alloced_size, uint64_t size);
+
+/** Frees an allocation, or keeps it for reuse if the pool is enabled. */
+void deallocate(char* data, uint64_t alloced_size);
+
+/**
+ * Returns the high water mark recorded for the given buffer name, 0 if none
+ * is recorded or the pool is disabled.
+ */
+uint64_t high_water(const std::string& name);
+
+/** Raises the high water mark of the given buffer name to `size`. */
+void update_high_water(const std::string& name, uint64_t size);
+
+}  // namespace buffer_pool
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_BUFFER_POOL_H
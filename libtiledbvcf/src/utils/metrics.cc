@@ -0,0 +1,160 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "utils/logger_public.h"
+#include "utils/metrics.h"
+
+namespace tiledb {
+namespace vcf {
+namespace metrics {
+
+namespace {
+
+std::atomic<bool> metrics_enabled{false};
+
+/** Named metrics. Entries are never removed, so references stay valid. */
+struct Registry {
+  std::mutex mtx;
+  std::map<std::string, std::unique_ptr<Counter>> counters;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms;
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+}  // namespace
+
+bool enabled() {
+  return metrics_enabled.load(std::memory_order_relaxed);
+}
+
+void enable(bool enabled) {
+  metrics_enabled = enabled;
+}
+
+void reset() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mtx);
+  for (auto& entry : r.counters)
+    entry.second->reset();
+  for (auto& entry : r.histograms)
+    entry.second->reset();
+}
+
+std::string to_json() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mtx);
+  std::string result = "{\"counters\": {";
+  bool first = true;
+  for (const auto& entry : r.counters) {
+    result += fmt::format(
+        "{}\"{}\": {}", first ? "" : ", ", entry.first, entry.second->value());
+    first = false;
+  }
+  result += "}, \"histograms\": {";
+  first = true;
+  for (const auto& entry : r.histograms) {
+    result += fmt::format(
+        "{}\"{}\": {}",
+        first ? "" : ", ",
+        entry.first,
+        entry.second->to_json());
+    first = false;
+  }
+  result += "}}";
+  return result;
+}
+
+void Histogram::record(uint64_t nanoseconds) {
+  if (!enabled())
+    return;
+  unsigned bucket = 0;
+  while (bucket + 1 < num_buckets && (uint64_t(1) << bucket) < nanoseconds)
+    bucket++;
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (nanoseconds > max &&
+         !max_.compare_exchange_weak(
+             max, nanoseconds, std::memory_order_relaxed)) {
+  }
+}
+
+std::string Histogram::to_json() const {
+  // Bucket i holds durations up to 2^i ns; only non-empty buckets are listed
+  std::string buckets;
+  for (unsigned i = 0; i < num_buckets; i++) {
+    const uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+    if (n == 0)
+      continue;
+    buckets += fmt::format(
+        "{}\"le_{}\": {}", buckets.empty() ? "" : ", ", uint64_t(1) << i, n);
+  }
+  return fmt::format(
+      "{{\"count\": {}, \"sum_ns\": {}, \"max_ns\": {}, \"buckets_ns\": "
+      "{{{}}}}}",
+      count_.load(std::memory_order_relaxed),
+      sum_.load(std::memory_order_relaxed),
+      max_.load(std::memory_order_relaxed),
+      buckets);
+}
+
+void Histogram::reset() {
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+  for (auto& bucket : buckets_)
+    bucket = 0;
+}
+
+Counter& counter(const std::string& name) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mtx);
+  auto& entry = r.counters[name];
+  if (entry == nullptr)
+    entry = std::make_unique<Counter>();
+  return *entry;
+}
+
+Histogram& histogram(const std::string& name) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mtx);
+  auto& entry = r.histograms[name];
+  if (entry == nullptr)
+    entry = std::make_unique<Histogram>();
+  return *entry;
+}
+
+}  // namespace metrics
+}  // namespace vcf
+}  // namespace tiledb
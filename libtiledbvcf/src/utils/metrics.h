@@ -0,0 +1,152 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @section DESCRIPTION
+ *
+ * This file defines a process-wide registry of performance metrics: monotonic
+ * counters and latency histograms, named by phase (e.g.
+ * "ingest.buffer_record"). Collection is disabled by default. Readers and
+ * writers never enable or reset the registry, since it is shared by every
+ * reader and writer of the process; the application does so explicitly
+ * (`tiledb_vcf_metrics_enable` and `tiledb_vcf_metrics_reset` in the C API).
+ *
+ * Call sites keep a reference to their metric in a function-local static, so
+ * hot paths never look up a name:
+ *
+ *   static auto& parse_time = metrics::histogram("ingest.parse");
+ *   metrics::ScopedTimer timer(parse_time);
+ */
+
+#ifndef TILEDB_VCF_METRICS_H
+#define TILEDB_VCF_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace tiledb {
+namespace vcf {
+namespace metrics {
+
+/** Returns true if metrics are being collected. */
+bool enabled();
+
+/** Enables or disables the collection of metrics. */
+void enable(bool enabled);
+
+/** Resets every metric to zero. */
+void reset();
+
+/**
+ * Returns every metric as JSON:
+ * `{"counters": {name: value}, "histograms": {name: {...}}}`.
+ */
+std::string to_json();
+
+/** A monotonic counter. */
+class Counter {
+ public:
+  /** Adds `n` to the counter, if metrics are enabled. */
+  void add(uint64_t n = 1) {
+    if (enabled())
+      value_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  void reset() {
+    value_ = 0;
+  }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+/** A histogram of durations, in power of two nanosecond buckets. */
+class Histogram {
+ public:
+  /** Number of buckets; the last one holds everything above 2^39 ns. */
+  static const unsigned num_buckets = 40;
+
+  /** Records a duration, if metrics are enabled. */
+  void record(uint64_t nanoseconds);
+
+  /** Returns the histogram as a JSON object. */
+  std::string to_json() const;
+
+  void reset();
+
+ private:
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+  std::array<std::atomic<uint64_t>, num_buckets> buckets_{};
+};
+
+/**
+ * Returns the counter with the given name, created on first use. The
+ * reference stays valid for the lifetime of the process.
+ */
+Counter& counter(const std::string& name);
+
+/**
+ * Returns the histogram with the given name, created on first use. The
+ * reference stays valid for the lifetime of the process.
+ */
+Histogram& histogram(const std::string& name);
+
+/** Records the lifetime of the object in a histogram. */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Histogram& histogram)
+      : histogram_(enabled() ? &histogram : nullptr) {
+    if (histogram_ != nullptr)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedTimer() {
+    if (histogram_ != nullptr)
+      histogram_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start_)
+                             .count());
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  Histogram* histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace metrics
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_METRICS_H
@@ -32,8 +32,11 @@
 #include <cerrno>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include <mutex>
 #include <random>
+#include <string_view>
+#include <unordered_map>
 
 #include "htslib_plugin/hfile_tiledb_vfs.h"
 #include "utils/logger_public.h"
@@ -592,6 +595,95 @@ uint32_t system_memory_mb() {
 #endif
 }
 
+void sort_indexes_radix(std::vector<uint64_t> keys, std::vector<size_t>* idx) {
+  const size_t n = keys.size();
+  idx->resize(n);
+  std::iota(idx->begin(), idx->end(), 0);
+  if (n < 2)
+    return;
+
+  uint64_t differing_bits = 0;
+  for (const auto key : keys)
+    differing_bits |= key ^ keys[0];
+
+  std::vector<uint64_t> sorted_keys(n);
+  std::vector<size_t> sorted_idx(n);
+  for (unsigned shift = 0; shift < 64; shift += 8) {
+    if (((differing_bits >> shift) & 0xff) == 0)
+      continue;
+
+    size_t offsets[257] = {0};
+    for (const auto key : keys)
+      offsets[((key >> shift) & 0xff) + 1]++;
+    for (unsigned d = 1; d < 257; d++)
+      offsets[d] += offsets[d - 1];
+
+    for (size_t i = 0; i < n; i++) {
+      const size_t dst = offsets[(keys[i] >> shift) & 0xff]++;
+      sorted_keys[dst] = keys[i];
+      sorted_idx[dst] = (*idx)[i];
+    }
+    keys.swap(sorted_keys);
+    idx->swap(sorted_idx);
+  }
+}
+
+void sort_indexes_pvcf(
+    const uint32_t* start_pos,
+    const Buffer& sample_names,
+    uint64_t num_cells,
+    std::vector<size_t>* idx) {
+  auto sample_name = [&sample_names](uint64_t i) {
+    uint64_t size = 0;
+    const char* name = sample_names.value<char>(i, &size);
+    return std::string_view(name, size);
+  };
+
+  // Results are returned in the order of the (anchor) start position, so they
+  // are often already sorted on the real start position.
+  bool sorted = true;
+  for (uint64_t i = 1; i < num_cells && sorted; i++) {
+    sorted = start_pos[i - 1] < start_pos[i] ||
+             (start_pos[i - 1] == start_pos[i] &&
+              sample_name(i - 1) <= sample_name(i));
+  }
+  if (sorted) {
+    idx->resize(num_cells);
+    std::iota(idx->begin(), idx->end(), 0);
+    return;
+  }
+
+  // Map the sample names to dense ranks
+  std::unordered_map<std::string_view, uint32_t> name_ids;
+  std::vector<uint32_t> ranks(num_cells);
+  uint32_t min_pos = std::numeric_limits<uint32_t>::max();
+  for (uint64_t i = 0; i < num_cells; i++) {
+    ranks[i] = name_ids.emplace(sample_name(i), name_ids.size()).first->second;
+    min_pos = std::min(min_pos, start_pos[i]);
+  }
+  std::vector<std::string_view> names(name_ids.size());
+  for (const auto& it : name_ids)
+    names[it.second] = it.first;
+  std::vector<uint32_t> order(names.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&names](uint32_t a, uint32_t b) {
+    return names[a] < names[b];
+  });
+  std::vector<uint32_t> name_ranks(names.size());
+  for (uint32_t rank = 0; rank < order.size(); rank++)
+    name_ranks[order[rank]] = rank;
+
+  unsigned rank_bits = 0;
+  while ((uint64_t(1) << rank_bits) < names.size())
+    rank_bits++;
+
+  std::vector<uint64_t> keys(num_cells);
+  for (uint64_t i = 0; i < num_cells; i++)
+    keys[i] = (uint64_t(start_pos[i] - min_pos) << rank_bits) |
+              name_ranks[ranks[i]];
+  sort_indexes_radix(std::move(keys), idx);
+}
+
 std::string memory_usage_str() {
 #ifdef __linux__
   std::string filename = "/proc/self/statm";
@@ -641,6 +733,15 @@ std::string temp_filename(const std::string& extension) {
   return path.string();
 }
 
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 }  // namespace utils
 }  // namespace vcf
 }  // namespace tiledb
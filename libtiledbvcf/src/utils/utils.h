@@ -196,6 +196,95 @@ void partition_vector(
   vec->swap(new_vec);
 }
 
+/**
+ * Partitions the given vector in-place like `partition_vector`, except that
+ * there may be more partitions than elements. In that case each of the first
+ * partitions holds a single element and the remaining ones are empty.
+ *
+ * @tparam T Vector element type
+ * @param partition_idx Index of partition
+ * @param num_partitions Total number of partitions
+ * @param vec Vector that will be partitioned.
+ */
+template <typename T>
+void partition_vector_allow_empty(
+    uint64_t partition_idx, uint64_t num_partitions, std::vector<T>* vec) {
+  if (vec->size() >= num_partitions) {
+    partition_vector(partition_idx, num_partitions, vec);
+    return;
+  }
+
+  // Make sure that we are not trying to fetch a partition that is out of
+  // bounds
+  if (partition_idx >= num_partitions)
+    throw std::runtime_error(
+        "Error partitioning vector; partition index " +
+        std::to_string(partition_idx) + " >= num partitions " +
+        std::to_string(num_partitions) + ".");
+  std::vector<T> new_vec;
+  if (partition_idx < vec->size())
+    new_vec.emplace_back(std::move((*vec)[partition_idx]));
+  vec->swap(new_vec);
+}
+
+/**
+ * Partitions the given vector in-place into contiguous runs of roughly equal
+ * total weight. An element goes to the partition containing the midpoint of
+ * its weight on the cumulative weight line, so partitions may be empty and
+ * an element heavier than the others gets a partition to itself. Falls back to
+ * `partition_vector_allow_empty` if the weights sum to zero.
+ *
+ * @tparam T Vector element type
+ * @param partition_idx Index of partition
+ * @param num_partitions Total number of partitions
+ * @param weights Non-negative weight of each element
+ * @param vec Vector that will be partitioned.
+ */
+template <typename T>
+void partition_vector_weighted(
+    uint64_t partition_idx,
+    uint64_t num_partitions,
+    const std::vector<double>& weights,
+    std::vector<T>* vec) {
+  if (weights.size() != vec->size())
+    throw std::runtime_error(
+        "Error partitioning vector; " + std::to_string(weights.size()) +
+        " weights for " + std::to_string(vec->size()) + " elements.");
+  if (num_partitions == 0)
+    throw std::runtime_error(
+        "Error partitioning vector; cannot partition into 0 partitions.");
+  if (partition_idx >= num_partitions)
+    throw std::runtime_error(
+        "Error partitioning vector; partition index " +
+        std::to_string(partition_idx) + " >= num partitions " +
+        std::to_string(num_partitions) + ".");
+
+  if (vec->empty())
+    return;
+
+  double total_weight = 0;
+  for (double w : weights)
+    total_weight += w;
+  if (total_weight <= 0) {
+    partition_vector_allow_empty(partition_idx, num_partitions, vec);
+    return;
+  }
+
+  std::vector<T> new_vec;
+  double cumulative_weight = 0;
+  for (size_t i = 0; i < vec->size(); i++) {
+    const double midpoint = cumulative_weight + weights[i] / 2;
+    cumulative_weight += weights[i];
+    const uint64_t partition = std::min<uint64_t>(
+        midpoint / total_weight * num_partitions, num_partitions - 1);
+    if (partition == partition_idx)
+      new_vec.emplace_back(std::move((*vec)[i]));
+    else if (partition > partition_idx)
+      break;
+  }
+  vec->swap(new_vec);
+}
+
 /**
  * @brief
  * Split a string into tokens with any delimiter in delims.
@@ -441,38 +530,32 @@ uint32_t system_memory_mb();
 std::string memory_usage_str();
 
 /**
+ * Sorts indexes on 64-bit keys with a stable LSD radix sort. Digits shared by
+ * all keys are skipped.
  *
- * Given a vector of T return an a vector if indexes, sorted by ascending values
+ * @param keys Key of each index
+ * @param idx Set to the indexes in ascending key order
+ */
+void sort_indexes_radix(std::vector<uint64_t> keys, std::vector<size_t>* idx);
+
+/**
+ * Orders pVCF query results on ascending start position, then sample name.
+ * Cells that compare equal keep their original order.
  *
- * inspired by: https://stackoverflow.com/a/12399290/11562375
- * @tparam T
- * @param v
- * @return
+ * Results that are already in order are detected with a linear scan.
+ * Otherwise the sample names are mapped to dense ranks and the packed
+ * (start position, sample rank) keys are radix sorted.
+ *
+ * @param start_pos Start position of each cell
+ * @param sample_names Var-sized sample name of each cell
+ * @param num_cells Number of cells
+ * @param idx Set to the cell indexes in sorted order
  */
-template <typename T, typename U>
-std::vector<size_t> sort_indexes_pvcf(
-    const T& start_pos, const U& sample_names) {
-  assert(start_pos.size() == sample_names.size());
-  // initialize original index locations
-  std::vector<size_t> idx(start_pos.size());
-  std::iota(idx.begin(), idx.end(), 0);
-
-  // sort indexes based on comparing values in v
-  // using std::stable_sort instead of std::sort
-  // to avoid unnecessary index re-orderings
-  // when v contains elements of equal values
-  std::stable_sort(
-      idx.begin(),
-      idx.end(),
-      [&start_pos, &sample_names](size_t i1, size_t i2) {
-        if (start_pos[i1] == start_pos[i2])
-          return sample_names[i1] < sample_names[i2];
-
-        return start_pos[i1] < start_pos[i2];
-      });
-
-  return idx;
-}
+void sort_indexes_pvcf(
+    const uint32_t* start_pos,
+    const Buffer& sample_names,
+    uint64_t num_cells,
+    std::vector<size_t>* idx);
 
 /**
  * @brief Search for item in vec. If not found push item to the back of vec.
@@ -520,6 +603,18 @@ bool query_buffers_set(tiledb::Query* query);
  */
 std::string temp_filename(const std::string& extension = "");
 
+/**
+ * FNV-1a hash of `size` bytes, continuing from `hash`. Unlike std::hash, the
+ * result is the same for all builds, so it may be persisted.
+ *
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param hash Hash to continue from, the FNV offset basis to start a hash
+ * @return Hash of the bytes
+ */
+uint64_t fnv1a(
+    const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL);
+
 }  // namespace utils
 }  // namespace vcf
 }  // namespace tiledb
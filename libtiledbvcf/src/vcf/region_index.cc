@@ -0,0 +1,330 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+
+#include "utils/logger_public.h"
+#include "utils/utils.h"
+#include "vcf/region_index.h"
+
+namespace tiledb {
+namespace vcf {
+
+namespace {
+
+/** Identifies a region index file. */
+const char magic[8] = {'T', 'V', 'C', 'F', 'R', 'I', 'D', 'X'};
+
+/** Version of the region index file format. */
+const uint32_t format_version = 1;
+
+/** Number of bytes of the BED file hashed per read. */
+const uint64_t key_chunk_bytes = 1024 * 1024;
+
+template <typename T>
+void write_value(std::vector<char>* out, const T& value) {
+  const char* p = reinterpret_cast<const char*>(&value);
+  out->insert(out->end(), p, p + sizeof(T));
+}
+
+template <typename T>
+void write_column(std::vector<char>* out, const std::vector<T>& values) {
+  const char* p = reinterpret_cast<const char*>(values.data());
+  out->insert(out->end(), p, p + values.size() * sizeof(T));
+}
+
+/** Bounds-checked reader over the bytes of an index file. */
+class ByteReader {
+ public:
+  explicit ByteReader(const std::vector<char>& bytes)
+      : bytes_(bytes)
+      , pos_(0) {
+  }
+
+  bool read(void* dst, uint64_t size) {
+    if (size > bytes_.size() - pos_)
+      return false;
+    std::memcpy(dst, bytes_.data() + pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  template <typename T>
+  bool read_column(std::vector<T>* values, uint64_t num) {
+    if (num > (bytes_.size() - pos_) / sizeof(T))
+      return false;
+    values->resize(num);
+    return read(values->data(), num * sizeof(T));
+  }
+
+  bool at_end() const {
+    return pos_ == bytes_.size();
+  }
+
+ private:
+  const std::vector<char>& bytes_;
+  uint64_t pos_;
+};
+
+/** Reads `size` bytes at `offset` of the file open in `is`. */
+void read_bytes(
+    std::istream& is,
+    uint64_t offset,
+    uint64_t size,
+    std::vector<char>* result) {
+  result->resize(size);
+  is.seekg(offset);
+  is.read(result->data(), size);
+  if (is.bad() || static_cast<uint64_t>(is.gcount()) != size)
+    throw std::runtime_error("Error reading file; short read");
+}
+
+}  // namespace
+
+RegionIndex::RegionIndex(const std::list<Region>& regions) {
+  std::unordered_map<std::string, uint32_t> contig_ids;
+  contig_ids_.reserve(regions.size());
+  mins_.reserve(regions.size());
+  maxs_.reserve(regions.size());
+  lines_.reserve(regions.size());
+  for (const auto& r : regions) {
+    auto it = contig_ids.find(r.seq_name);
+    if (it == contig_ids.end()) {
+      it = contig_ids.emplace(r.seq_name, contigs_.size()).first;
+      contigs_.push_back(r.seq_name);
+    }
+    contig_ids_.push_back(it->second);
+    mins_.push_back(r.min);
+    maxs_.push_back(r.max);
+    lines_.push_back(r.line);
+  }
+}
+
+uint64_t RegionIndex::size() const {
+  return contig_ids_.size();
+}
+
+const std::vector<std::string>& RegionIndex::contigs() const {
+  return contigs_;
+}
+
+void RegionIndex::regions(std::list<Region>* result) const {
+  for (uint64_t i = 0; i < size(); i++)
+    result->emplace_back(
+        contigs_[contig_ids_[i]],
+        mins_[i],
+        maxs_[i],
+        static_cast<int32_t>(lines_[i]));
+}
+
+void RegionIndex::save(
+    const tiledb::VFS& vfs,
+    const std::string& uri,
+    uint64_t source_key) const {
+  std::vector<char> bytes;
+  bytes.insert(bytes.end(), magic, magic + sizeof(magic));
+  write_value(&bytes, format_version);
+  write_value(&bytes, source_key);
+  write_value(&bytes, static_cast<uint32_t>(contigs_.size()));
+  write_value(&bytes, size());
+  for (const auto& contig : contigs_) {
+    write_value(&bytes, static_cast<uint32_t>(contig.size()));
+    bytes.insert(bytes.end(), contig.begin(), contig.end());
+  }
+  write_column(&bytes, contig_ids_);
+  write_column(&bytes, mins_);
+  write_column(&bytes, maxs_);
+  write_column(&bytes, lines_);
+
+  std::random_device rd;
+  const std::string temp_uri = uri + ".tmp_" + std::to_string(rd());
+  {
+    tiledb::VFS::filebuf sbuf(vfs);
+    sbuf.open(temp_uri, std::ios::out);
+    std::ostream os(&sbuf);
+    if (!os.good())
+      throw std::runtime_error(
+          "Error writing region index; cannot open '" + temp_uri + "'");
+    os.write(bytes.data(), bytes.size());
+    os.flush();
+    if (!os.good())
+      throw std::runtime_error(
+          "Error writing region index; write to '" + temp_uri + "' failed");
+  }
+
+  try {
+    vfs.move_file(temp_uri, uri);
+  } catch (...) {
+    if (vfs.is_file(temp_uri))
+      vfs.remove_file(temp_uri);
+    throw;
+  }
+}
+
+bool RegionIndex::load(
+    const tiledb::VFS& vfs, const std::string& uri, uint64_t source_key) {
+  if (!vfs.is_file(uri))
+    return false;
+
+  std::vector<char> bytes;
+  {
+    tiledb::VFS::filebuf sbuf(vfs);
+    sbuf.open(uri, std::ios::in);
+    std::istream is(&sbuf);
+    if (!is.good())
+      return false;
+    read_bytes(is, 0, vfs.file_size(uri), &bytes);
+  }
+
+  ByteReader reader(bytes);
+  char file_magic[sizeof(magic)];
+  uint32_t file_version = 0, num_contigs = 0;
+  uint64_t file_key = 0, num_regions = 0;
+  if (!reader.read(file_magic, sizeof(file_magic)) ||
+      std::memcmp(file_magic, magic, sizeof(magic)) != 0 ||
+      !reader.read(&file_version, sizeof(file_version)) ||
+      file_version != format_version ||
+      !reader.read(&file_key, sizeof(file_key)) || file_key != source_key ||
+      !reader.read(&num_contigs, sizeof(num_contigs)) ||
+      !reader.read(&num_regions, sizeof(num_regions)) ||
+      num_contigs > bytes.size())
+    return false;
+
+  std::vector<std::string> contigs(num_contigs);
+  for (auto& contig : contigs) {
+    uint32_t length = 0;
+    if (!reader.read(&length, sizeof(length)))
+      return false;
+    std::vector<char> name;
+    if (!reader.read_column(&name, length))
+      return false;
+    contig.assign(name.begin(), name.end());
+  }
+
+  std::vector<uint32_t> contig_ids, mins, maxs, lines;
+  if (!reader.read_column(&contig_ids, num_regions) ||
+      !reader.read_column(&mins, num_regions) ||
+      !reader.read_column(&maxs, num_regions) ||
+      !reader.read_column(&lines, num_regions) || !reader.at_end())
+    return false;
+  for (auto id : contig_ids) {
+    if (id >= num_contigs)
+      return false;
+  }
+
+  contigs_ = std::move(contigs);
+  contig_ids_ = std::move(contig_ids);
+  mins_ = std::move(mins);
+  maxs_ = std::move(maxs);
+  lines_ = std::move(lines);
+  return true;
+}
+
+uint64_t RegionIndex::source_key(
+    const tiledb::VFS& vfs, const std::string& bed_file_uri) {
+  uint64_t hash = utils::fnv1a(bed_file_uri.data(), bed_file_uri.size());
+
+  const uint64_t file_size = vfs.file_size(bed_file_uri);
+  hash = utils::fnv1a(&file_size, sizeof(file_size), hash);
+
+  tiledb::VFS::filebuf sbuf(vfs);
+  sbuf.open(bed_file_uri, std::ios::in);
+  std::istream is(&sbuf);
+  if (!is.good())
+    throw std::runtime_error(
+        "Error computing region index key; cannot open '" + bed_file_uri +
+        "'");
+
+  // Hash the whole file, so that any edit invalidates the cached index.
+  // Hashing is much cheaper than parsing, so a cache hit still pays off.
+  std::vector<char> bytes;
+  for (uint64_t offset = 0; offset < file_size; offset += key_chunk_bytes) {
+    const uint64_t size = std::min(key_chunk_bytes, file_size - offset);
+    read_bytes(is, offset, size, &bytes);
+    hash = utils::fnv1a(bytes.data(), bytes.size(), hash);
+  }
+  return hash;
+}
+
+void RegionIndex::parse_bed_file_cached(
+    const tiledb::VFS& vfs,
+    const std::string& bed_file_uri,
+    const std::string& cache_uri,
+    std::list<Region>* result) {
+  // Remote files read directly by htslib are not visible to the VFS.
+  if (utils::starts_with(bed_file_uri, "ftp://") ||
+      utils::starts_with(bed_file_uri, "http://") ||
+      utils::starts_with(bed_file_uri, "https://")) {
+    Region::parse_bed_file_htslib(bed_file_uri, result);
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  const uint64_t key = source_key(vfs, bed_file_uri);
+  const std::string index_uri =
+      utils::uri_join(cache_uri, fmt::format("{:016x}.regions", key));
+
+  RegionIndex index;
+  if (index.load(vfs, index_uri, key)) {
+    index.regions(result);
+    LOG_DEBUG(
+        "[RegionIndex] Loaded {} regions from '{}' in {:.3f} seconds",
+        index.size(),
+        index_uri,
+        utils::chrono_duration(start));
+    return;
+  }
+
+  std::list<Region> parsed;
+  Region::parse_bed_file_htslib(bed_file_uri, &parsed);
+
+  // Failing to populate the cache only costs the next reader a parse.
+  try {
+    if (!vfs.is_dir(cache_uri))
+      vfs.create_dir(cache_uri);
+    RegionIndex(parsed).save(vfs, index_uri, key);
+    LOG_DEBUG(
+        "[RegionIndex] Cached {} regions of '{}' in '{}'",
+        parsed.size(),
+        bed_file_uri,
+        index_uri);
+  } catch (const std::exception& e) {
+    LOG_WARN(
+        "[RegionIndex] Failed to cache regions of '{}' in '{}': {}",
+        bed_file_uri,
+        index_uri,
+        e.what());
+  }
+
+  result->splice(result->end(), parsed);
+}
+
+}  // namespace vcf
+}  // namespace tiledb
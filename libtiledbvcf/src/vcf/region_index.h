@@ -0,0 +1,143 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_REGION_INDEX_H
+#define TILEDB_VCF_REGION_INDEX_H
+
+#include <list>
+#include <string>
+#include <tiledb/tiledb>
+#include <vector>
+
+#include "vcf/region.h"
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * Compact, serializable copy of the regions parsed from a BED file.
+ *
+ * Contig names are interned in a table and each region is stored as packed
+ * uint32 columns (contig id, min, max, line). The index is written as a
+ * single binary file in a cache directory, keyed by the BED file URI, size
+ * and contents, so that every reader of a partitioned export can load the
+ * regions with one sequential read instead of parsing the BED file again.
+ */
+class RegionIndex {
+ public:
+  /** Constructs an empty index. */
+  RegionIndex() = default;
+
+  /** Constructs an index holding the given regions, in order. */
+  explicit RegionIndex(const std::list<Region>& regions);
+
+  /** Returns the number of regions. */
+  uint64_t size() const;
+
+  /** Returns the interned contig names. */
+  const std::vector<std::string>& contigs() const;
+
+  /**
+   * Appends the regions to the given list, in their original order.
+   *
+   * @param result List the regions are appended to
+   */
+  void regions(std::list<Region>* result) const;
+
+  /**
+   * Serializes the index to the given URI. The file is first written under
+   * a temporary name and then moved into place, so concurrent readers never
+   * see a partial index.
+   *
+   * @param vfs TileDB VFS instance to use
+   * @param uri URI of the index file
+   * @param source_key Key of the BED file the regions were parsed from
+   */
+  void save(
+      const tiledb::VFS& vfs,
+      const std::string& uri,
+      uint64_t source_key) const;
+
+  /**
+   * Loads the index from the given URI.
+   *
+   * @param vfs TileDB VFS instance to use
+   * @param uri URI of the index file
+   * @param source_key Expected key of the BED file
+   * @return False if the file does not exist, is not a region index, or was
+   *     built from a different BED file.
+   */
+  bool load(
+      const tiledb::VFS& vfs, const std::string& uri, uint64_t source_key);
+
+  /**
+   * Computes the cache key of a BED file from its URI, size and full
+   * contents.
+   *
+   * @param vfs TileDB VFS instance to use
+   * @param bed_file_uri URI of the BED file
+   * @return Cache key
+   */
+  static uint64_t source_key(
+      const tiledb::VFS& vfs, const std::string& bed_file_uri);
+
+  /**
+   * Parses a BED file like `Region::parse_bed_file_htslib`, reusing the
+   * region index cached in `cache_uri` if one exists for the file. On a cache
+   * miss the BED file is parsed and its index is written to the cache.
+   *
+   * @param vfs TileDB VFS instance to use
+   * @param bed_file_uri URI of the BED file
+   * @param cache_uri URI of the cache directory
+   * @param result List the regions are appended to
+   */
+  static void parse_bed_file_cached(
+      const tiledb::VFS& vfs,
+      const std::string& bed_file_uri,
+      const std::string& cache_uri,
+      std::list<Region>* result);
+
+ private:
+  /** Interned contig names */
+  std::vector<std::string> contigs_;
+
+  /** Index into `contigs_` of each region */
+  std::vector<uint32_t> contig_ids_;
+
+  /** Start position of each region (0-indexed, inclusive) */
+  std::vector<uint32_t> mins_;
+
+  /** End position of each region (0-indexed, inclusive) */
+  std::vector<uint32_t> maxs_;
+
+  /** BED line of each region */
+  std::vector<uint32_t> lines_;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_REGION_INDEX_H
@@ -29,6 +29,14 @@
 namespace tiledb {
 namespace vcf {
 
+namespace {
+
+bool is_non_ref_allele(std::string_view allele) {
+  return allele == "<NON_REF>" || allele == "<*>";
+}
+
+}  // namespace
+
 uint32_t VCFUtils::get_end_pos(
     const bcf_hdr_t* hdr, bcf1_t* rec, HtslibValueMem* val) {
   // Set the default value of END, in case it is not present in the VCF
@@ -60,6 +68,58 @@ uint32_t VCFUtils::get_end_pos(
   return end;
 }
 
+bool VCFUtils::is_ref_block(const bcf1_t* rec) {
+  for (unsigned i = 1; i < rec->n_allele; i++) {
+    if (!is_non_ref_allele(rec->d.allele[i]))
+      return false;
+  }
+  return true;
+}
+
+bool VCFUtils::is_ref_block(std::string_view csv_alleles) {
+  // Drop the null terminator stored with the alleles, if any.
+  while (!csv_alleles.empty() && csv_alleles.back() == '\0')
+    csv_alleles.remove_suffix(1);
+
+  size_t pos = csv_alleles.find(',');
+  while (pos != std::string_view::npos) {
+    // The last allele runs to the end; substr clamps the length.
+    const size_t next = csv_alleles.find(',', pos + 1);
+    if (!is_non_ref_allele(csv_alleles.substr(pos + 1, next - pos - 1)))
+      return false;
+    pos = next;
+  }
+  return true;
+}
+
+bool VCFUtils::encode_compact_gt(
+    const int32_t* gt, int num_values, uint32_t* packed) {
+  uint32_t result = 0;
+  int ploidy = 0;
+  for (; ploidy < num_values; ploidy++) {
+    // A shorter ploidy is padded with bcf_int32_vector_end.
+    const int32_t value = gt[ploidy];
+    if (value < 0)
+      break;
+    const uint32_t code = static_cast<uint32_t>(value) >> 1;
+    if (ploidy == 2 || code > compact_gt_max_allele + 1)
+      return false;
+    result |= (value & 1u) << (2 + ploidy);
+    result |= code << (4 + 13 * ploidy);
+  }
+  *packed = result | ploidy;
+  return true;
+}
+
+int VCFUtils::decode_compact_gt(uint32_t packed, int32_t* gt) {
+  const int ploidy = packed & 3;
+  for (int i = 0; i < ploidy; i++) {
+    const uint32_t code = (packed >> (4 + 13 * i)) & 0x1fff;
+    gt[i] = static_cast<int32_t>((code << 1) | ((packed >> (2 + i)) & 1));
+  }
+  return ploidy;
+}
+
 bcf_hdr_t* VCFUtils::hdr_read_header(const std::string& path) {
   auto fh = vcf_open(path.c_str(), "r");
   if (!fh)
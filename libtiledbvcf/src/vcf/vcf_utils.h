@@ -33,9 +33,11 @@
 
 #include <htslib/hts.h>
 #include <htslib/synced_bcf_reader.h>
+#include <htslib/thread_pool.h>
 #include <htslib/vcf.h>
 #include <htslib/vcfutils.h>
 #include <map>
+#include <string_view>
 
 #include "region.h"
 #include "vcf/htslib_value.h"
@@ -59,6 +61,10 @@ typedef std::unique_ptr<htsFile, decltype(&hts_close)> SafeBCFFh;
 typedef std::unique_ptr<bcf_sr_regions_t, decltype(&bcf_sr_regions_destroy)>
     SafeRegionFh;
 
+/** Alias for unique_ptr to hts_tpool. */
+typedef std::unique_ptr<hts_tpool, decltype(&hts_tpool_destroy)>
+    SafeHtsThreadPool;
+
 // Forward declare region
 struct Region;
 
@@ -80,6 +86,56 @@ class VCFUtils {
   static uint32_t get_end_pos(
       const bcf_hdr_t* hdr, bcf1_t* rec, HtslibValueMem* val);
 
+  /**
+   * Helper function that returns true if the given (unpacked) record is a
+   * gVCF reference block: it has no ALT allele other than the symbolic
+   * <NON_REF> or <*> allele.
+   *
+   * @param rec Record to check
+   * @return True if the record is a reference block
+   */
+  static bool is_ref_block(const bcf1_t* rec);
+
+  /**
+   * Helper function that returns true if the given alleles, as stored in the
+   * data array (comma-separated, REF first), are those of a gVCF reference
+   * block.
+   *
+   * @param csv_alleles Comma-separated alleles
+   * @return True if the alleles are those of a reference block
+   */
+  static bool is_ref_block(std::string_view csv_alleles);
+
+  /**
+   * Helper function that packs a single-sample genotype, as returned by
+   * bcf_get_genotypes(), into the 32-bit value of the compact genotype
+   * attribute. The packed value holds the ploidy (bits 0-1), the phase bit of
+   * each allele (bits 2-3) and the htslib allele code (allele index + 1, or
+   * 0 if missing) of each allele (bits 4-16 and 17-29). Values after a
+   * bcf_int32_vector_end are dropped.
+   *
+   * @param gt Genotype values encoded by htslib
+   * @param num_values Number of genotype values
+   * @param packed Set to the packed genotype
+   * @return False if the genotype cannot be packed: ploidy greater than 2 or
+   *     allele index greater than `compact_gt_max_allele`.
+   */
+  static bool encode_compact_gt(
+      const int32_t* gt, int num_values, uint32_t* packed);
+
+  /**
+   * Helper function that unpacks a compact genotype into the htslib
+   * encoding, the inverse of encode_compact_gt().
+   *
+   * @param packed Packed genotype
+   * @param gt Array of at least 2 values set to the htslib genotype values
+   * @return Ploidy of the genotype (0 if the sample had no GT value)
+   */
+  static int decode_compact_gt(uint32_t packed, int32_t* gt);
+
+  /** Largest allele index supported by the compact genotype encoding. */
+  static const int compact_gt_max_allele = 8190;
+
   /**
    * Helper function that reads an HTSlib header instance from the VCF/BCF file
    * at the given path.
@@ -26,14 +26,52 @@
 
 #include "vcf/vcf_v4.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 
 namespace tiledb {
 namespace vcf {
 
+namespace {
+
+/**
+ * Computes the range of compressed file offsets spanned by the index chunks
+ * overlapping [beg, end) on contig `tid`.
+ *
+ * @return False if no chunks overlap the interval.
+ */
+bool index_chunk_range(
+    const hts_idx_t* idx,
+    int tid,
+    hts_pos_t beg,
+    hts_pos_t end,
+    uint64_t* min_offset,
+    uint64_t* max_offset) {
+  hts_itr_t* itr = hts_itr_query(idx, tid, beg, end, nullptr);
+  if (itr == nullptr)
+    return false;
+
+  const bool found = itr->n_off > 0;
+  if (found) {
+    *min_offset = std::numeric_limits<uint64_t>::max();
+    *max_offset = 0;
+    for (int i = 0; i < itr->n_off; i++) {
+      // The upper 48 bits of a virtual offset are the BGZF block offset.
+      *min_offset = std::min(*min_offset, itr->off[i].u >> 16);
+      *max_offset = std::max(*max_offset, itr->off[i].v >> 16);
+    }
+  }
+
+  hts_itr_destroy(itr);
+  return found;
+}
+
+}  // namespace
+
 VCFV4::VCFV4()
     : open_(false)
     , inited_(false)
     , max_record_buffer_size_(10000)
+    , thread_pool_{nullptr, 0}
     , hdr_(nullptr)
     , index_tbx_(nullptr)
     , index_hts_(nullptr) {
@@ -44,6 +82,8 @@ VCFV4::~VCFV4() {
 }
 
 void VCFV4::open(const std::string& file, const std::string& index_file) {
+  static auto& open_time = metrics::histogram("vcf.open");
+  metrics::ScopedTimer timer(open_time);
   if (open_)
     close();
   if (file.empty())
@@ -216,10 +256,71 @@ size_t VCFV4::record_count(const std::string& contig_name) const {
   return records;
 }
 
+void VCFV4::estimate_records(
+    const std::string& contig_name,
+    uint32_t window_size,
+    uint32_t contig_len,
+    std::vector<double>* records) const {
+  if (!open_)
+    throw std::runtime_error(
+        "Error estimating contig records in VCF; file not open.");
+
+  const uint32_t nwindows = utils::ceil(contig_len, window_size);
+  if (records->size() < nwindows)
+    records->resize(nwindows, 0);
+
+  const size_t nrecords = record_count(contig_name);
+  if (nrecords == 0 || nwindows == 0)
+    return;
+
+  hts_idx_t* idx = index_tbx_ != nullptr ? index_tbx_->idx : index_hts_;
+  int region_id = index_tbx_ != nullptr ?
+                      tbx_name2id(index_tbx_, contig_name.c_str()) :
+                      bcf_hdr_name2id(hdr_, contig_name.c_str());
+
+  // Offset of the first chunk overlapping each window, followed by the end
+  // offset of the contig's last chunk.
+  std::vector<uint64_t> offsets(
+      nwindows + 1, std::numeric_limits<uint64_t>::max());
+  uint64_t min_offset, max_offset;
+  if (index_chunk_range(
+          idx, region_id, 0, contig_len, &min_offset, &max_offset)) {
+    offsets[nwindows] = max_offset;
+    for (uint32_t w = 0; w < nwindows; w++) {
+      const hts_pos_t beg = static_cast<hts_pos_t>(w) * window_size;
+      const hts_pos_t end =
+          std::min<hts_pos_t>(beg + window_size, contig_len);
+      if (index_chunk_range(
+              idx, region_id, beg, end, &min_offset, &max_offset))
+        offsets[w] = min_offset;
+    }
+
+    // Windows without chunks start where the next window starts.
+    for (uint32_t w = nwindows; w > 0; w--)
+      offsets[w - 1] = std::min(offsets[w - 1], offsets[w]);
+  }
+
+  // Fall back to a uniform split when the index does not resolve the contig
+  // to more than one BGZF block.
+  const uint64_t total_bytes = offsets[nwindows] - offsets[0];
+  for (uint32_t w = 0; w < nwindows; w++) {
+    if (total_bytes == 0) {
+      (*records)[w] += static_cast<double>(nrecords) / nwindows;
+    } else {
+      (*records)[w] += static_cast<double>(nrecords) *
+                       (offsets[w + 1] - offsets[w]) / total_bytes;
+    }
+  }
+}
+
 void VCFV4::set_max_record_buff_size(uint64_t max_record_buffer_size) {
   max_record_buffer_size_ = max_record_buffer_size;
 }
 
+void VCFV4::set_thread_pool(hts_tpool* pool, int queue_size) {
+  thread_pool_ = {pool, queue_size};
+}
+
 bcf_hdr_t* VCFV4::hdr() const {
   return hdr_;
 }
@@ -233,6 +334,14 @@ bool VCFV4::init(const std::string& contig_name, uint32_t pos) {
   if (fh == nullptr)
     throw std::runtime_error("Error seeking in VCF; bcf_open failed");
 
+  if (thread_pool_.pool != nullptr &&
+      hts_set_thread_pool(fh.get(), &thread_pool_) != 0) {
+    LOG_WARN(
+        "Failed to attach decompression thread pool to {}; decompressing on "
+        "the reading thread",
+        path_);
+  }
+
   record_iter_.reset();
   if (fh->format.format == bcf) {
     if (!record_iter_.init_bcf(
@@ -285,38 +394,38 @@ bool VCFV4::seek(const std::string& contig_name, uint32_t pos) {
   return !record_queue_.empty();
 }
 
+SafeSharedBCFRec VCFV4::free_record() {
+  if (record_queue_pool_.empty())
+    return SafeSharedBCFRec(bcf_init1(), bcf_destroy);
+
+  SafeSharedBCFRec r = std::move(record_queue_pool_.front());
+  record_queue_pool_.pop();
+  return r;
+}
+
 void VCFV4::read_records() {
   if (!record_queue_.empty())
     std::queue<SafeSharedBCFRec>().swap(record_queue_);
 
-  SafeBCFRec tmp_r(bcf_init1(), bcf_destroy);
+  // Parse directly into stale records from the pool, which htslib clears and
+  // refills in place, so steady-state reads neither allocate nor copy.
   size_t record_buffer_size = 0;
   while (record_buffer_size < max_record_buffer_size_) {
-    if (!record_iter_.next(tmp_r.get()))
+    SafeSharedBCFRec r = free_record();
+    if (!record_iter_.next(r.get())) {
+      return_record(r);
       break;
+    }
 
     // Iteration does not cross contigs.
-    std::string contig_name = bcf_seqname(hdr_, tmp_r.get());
-    if (seeked_contig_name_ != contig_name) {
+    if (seeked_contig_name_ != bcf_seqname(hdr_, r.get())) {
+      return_record(r);
       break;
     }
 
-    if (!record_queue_pool_.empty()) {
-      // Pop a stale record for re-use. Note that `bcf_copy`
-      // destroys (frees) the stale data to prevent a memory
-      // leak.
-      SafeSharedBCFRec r = record_queue_pool_.front();
-      record_queue_pool_.pop();
-      bcf_copy(r.get(), tmp_r.get());
-      bcf_unpack(r.get(), BCF_UN_ALL);
-      record_queue_.emplace(std::move(r));
-    } else {
-      SafeSharedBCFRec r(bcf_dup(tmp_r.get()), bcf_destroy);
-      bcf_unpack(r.get(), BCF_UN_ALL);
-      record_queue_.emplace(std::move(r));
-    }
-    record_buffer_size += sizeof(bcf1_t) + record_queue_.front()->shared.m +
-                          record_queue_.front()->indiv.m;
+    bcf_unpack(r.get(), BCF_UN_ALL);
+    record_buffer_size += sizeof(bcf1_t) + r->shared.m + r->indiv.m;
+    record_queue_.emplace(std::move(r));
   }
   if (record_buffer_size) {
     LOG_TRACE(
@@ -333,6 +442,7 @@ void VCFV4::swap(VCFV4& other) {
   std::swap(index_path_, other.index_path_);
   std::swap(record_queue_, other.record_queue_);
   std::swap(record_queue_pool_, other.record_queue_pool_);
+  std::swap(thread_pool_, other.thread_pool_);
   record_iter_.swap(other.record_iter_);
   std::swap(hdr_, other.hdr_);
   std::swap(index_tbx_, other.index_tbx_);
@@ -100,6 +100,24 @@ class VCFV4 {
    */
   size_t record_count(const std::string& contig_name) const;
 
+  /**
+   * Adds the estimated number of records in each `window_size` bases of the
+   * given contig to `records`, growing it to cover the contig if needed.
+   * The contig's record count is spread over the windows in proportion to
+   * the compressed bytes the index assigns to them, so dense regions get a
+   * larger share than a uniform split along the contig would give them.
+   *
+   * @param contig_name Name of contig
+   * @param window_size Width of each window in bases
+   * @param contig_len Length of the contig in bases
+   * @param records Per-window record estimates to accumulate into
+   */
+  void estimate_records(
+      const std::string& contig_name,
+      uint32_t window_size,
+      uint32_t contig_len,
+      std::vector<double>* records) const;
+
   /** Returns the header instance of the currently open file. */
   bcf_hdr_t* hdr() const;
 
@@ -134,6 +152,15 @@ class VCFV4 {
   /** Sets the max number of records that can be buffered in memory. */
   void set_max_record_buff_size(uint64_t max_record_buffer_size);
 
+  /**
+   * Sets a thread pool used for BGZF decompression. The pool is shared, not
+   * owned, and must outlive this instance. Takes effect on the next `init`.
+   *
+   * @param pool Thread pool, or null to decompress on the calling thread
+   * @param queue_size Max number of blocks decompressed ahead of the reader
+   */
+  void set_thread_pool(hts_tpool* pool, int queue_size);
+
  private:
   /** BCF/VCF iterator wrapper. */
   class Iter {
@@ -190,6 +217,9 @@ class VCFV4 {
   /** Number of records to buffer in memory. */
   unsigned max_record_buffer_size_;
 
+  /** Shared thread pool for BGZF decompression, if any. */
+  htsThreadPool thread_pool_;
+
   /** The HTSlib file header handle. */
   bcf_hdr_t* hdr_;
 
@@ -202,6 +232,9 @@ class VCFV4 {
   /** Reads records into the record buffer using `iter_`. */
   void read_records();
 
+  /** Returns a record from `record_queue_pool_`, or a new one if empty. */
+  SafeSharedBCFRec free_record();
+
   /** Swap all fields with the given VCFV3 instance. */
   void swap(VCFV4& other);
 
@@ -0,0 +1,236 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <sstream>
+
+#include "utils/logger_public.h"
+#include "utils/utils.h"
+#include "write/ingestion_checkpoints.h"
+
+namespace tiledb {
+namespace vcf {
+
+namespace {
+
+/** First line of a checkpoint file, with the format version. */
+const char* header = "tiledbvcf-checkpoint\t1";
+
+/** Extension of the checkpoint files. */
+const char* extension = ".checkpoint";
+
+}  // namespace
+
+IngestionCheckpoints::IngestionCheckpoints(
+    const tiledb::VFS& vfs, const std::string& uri)
+    : vfs_(vfs)
+    , uri_(uri)
+    , num_written_(0) {
+  std::random_device rd;
+  run_id_ = rd();
+  if (!vfs_.is_dir(uri_))
+    vfs_.create_dir(uri_);
+}
+
+void IngestionCheckpoints::write(const Checkpoint& checkpoint) {
+  const std::string name = fmt::format(
+      "{}{:08x}-{:06}{}",
+      batch_prefix(checkpoint.first_sample, checkpoint.last_sample),
+      run_id_,
+      num_written_++,
+      extension);
+  const std::string uri = utils::uri_join(uri_, name);
+  const std::string temp_uri = uri + ".tmp";
+  const std::string str = to_str(checkpoint);
+  {
+    tiledb::VFS::filebuf sbuf(vfs_);
+    sbuf.open(temp_uri, std::ios::out);
+    std::ostream os(&sbuf);
+    os.write(str.data(), str.size());
+    os.flush();
+    if (!os.good())
+      throw std::runtime_error(
+          "Error writing ingestion checkpoint; write to '" + temp_uri +
+          "' failed");
+  }
+  vfs_.move_file(temp_uri, uri);
+
+  LOG_DEBUG(
+      "[IngestionCheckpoints] Wrote checkpoint '{}' of {} records in {} "
+      "regions",
+      uri,
+      checkpoint.records,
+      checkpoint.regions.size());
+}
+
+std::vector<IngestionCheckpoints::Checkpoint> IngestionCheckpoints::load(
+    const std::string& first_sample, const std::string& last_sample) const {
+  std::vector<Checkpoint> result;
+  for (const auto& uri : batch_files(first_sample, last_sample)) {
+    std::string str;
+    {
+      tiledb::VFS::filebuf sbuf(vfs_);
+      sbuf.open(uri, std::ios::in);
+      std::istream is(&sbuf);
+      std::stringstream ss;
+      ss << is.rdbuf();
+      str = ss.str();
+    }
+
+    Checkpoint checkpoint;
+    if (!parse(str, &checkpoint)) {
+      LOG_WARN("[IngestionCheckpoints] Ignoring invalid checkpoint '{}'", uri);
+      continue;
+    }
+    // Batches whose file name prefixes collide are told apart here
+    if (checkpoint.first_sample != first_sample ||
+        checkpoint.last_sample != last_sample)
+      continue;
+    result.push_back(std::move(checkpoint));
+  }
+  return result;
+}
+
+void IngestionCheckpoints::remove(
+    const std::string& first_sample, const std::string& last_sample) {
+  for (const auto& uri : batch_files(first_sample, last_sample))
+    vfs_.remove_file(uri);
+}
+
+std::vector<Region> IngestionCheckpoints::uncovered(
+    const std::vector<Region>& regions,
+    const std::vector<Checkpoint>& checkpoints) {
+  // Merged covered intervals of each contig
+  std::map<std::string, std::vector<std::pair<uint32_t, uint32_t>>> covered;
+  for (const auto& checkpoint : checkpoints) {
+    for (const auto& r : checkpoint.regions)
+      covered[r.seq_name].emplace_back(r.min, r.max);
+  }
+  for (auto& entry : covered) {
+    auto& intervals = entry.second;
+    std::sort(intervals.begin(), intervals.end());
+    std::vector<std::pair<uint32_t, uint32_t>> merged;
+    for (const auto& interval : intervals) {
+      if (!merged.empty() &&
+          static_cast<uint64_t>(merged.back().second) + 1 >= interval.first)
+        merged.back().second = std::max(merged.back().second, interval.second);
+      else
+        merged.push_back(interval);
+    }
+    intervals = std::move(merged);
+  }
+
+  std::vector<Region> result;
+  for (const auto& region : regions) {
+    auto it = covered.find(region.seq_name);
+    if (it == covered.end()) {
+      result.push_back(region);
+      continue;
+    }
+
+    uint64_t next = region.min;
+    for (const auto& interval : it->second) {
+      if (interval.second < next || interval.first > region.max)
+        continue;
+      if (interval.first > next)
+        result.emplace_back(region.seq_name, next, interval.first - 1);
+      next = static_cast<uint64_t>(interval.second) + 1;
+      if (next > region.max)
+        break;
+    }
+    if (next <= region.max)
+      result.emplace_back(region.seq_name, next, region.max);
+  }
+  return result;
+}
+
+std::string IngestionCheckpoints::to_str(const Checkpoint& checkpoint) {
+  std::string result = fmt::format(
+      "{}\nsamples\t{}\t{}\nrecords\t{}\n",
+      header,
+      checkpoint.first_sample,
+      checkpoint.last_sample,
+      checkpoint.records);
+  for (const auto& r : checkpoint.regions)
+    result += fmt::format("region\t{}\t{}\t{}\n", r.seq_name, r.min, r.max);
+  return result;
+}
+
+bool IngestionCheckpoints::parse(
+    const std::string& str, Checkpoint* checkpoint) {
+  auto lines = utils::split(str, "\n");
+  if (lines.size() < 3 || lines[0] != header)
+    return false;
+
+  Checkpoint result;
+  try {
+    for (size_t i = 1; i < lines.size(); i++) {
+      // Keep empty fields: a sample name can be empty
+      auto fields = utils::split(lines[i], "\t", false);
+      if (fields[0] == "samples" && fields.size() == 3) {
+        result.first_sample = fields[1];
+        result.last_sample = fields[2];
+      } else if (fields[0] == "records" && fields.size() == 2) {
+        result.records = std::stoull(fields[1]);
+      } else if (fields[0] == "region" && fields.size() == 4) {
+        result.regions.emplace_back(
+            fields[1], std::stoul(fields[2]), std::stoul(fields[3]));
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::logic_error&) {
+    return false;
+  }
+
+  *checkpoint = std::move(result);
+  return true;
+}
+
+std::string IngestionCheckpoints::batch_prefix(
+    const std::string& first_sample, const std::string& last_sample) {
+  // The prefix is persisted, so the hash must not depend on the build
+  const std::string key = first_sample + '\0' + last_sample;
+  return fmt::format("{:016x}-", utils::fnv1a(key.data(), key.size()));
+}
+
+std::vector<std::string> IngestionCheckpoints::batch_files(
+    const std::string& first_sample, const std::string& last_sample) const {
+  const std::string prefix = batch_prefix(first_sample, last_sample);
+  std::vector<std::string> result;
+  for (const auto& uri : vfs_.ls(uri_)) {
+    const std::string name = utils::uri_filename(uri);
+    if (utils::starts_with(name, prefix) &&
+        utils::ends_with(name, extension))
+      result.push_back(uri);
+  }
+  return result;
+}
+
+}  // namespace vcf
+}  // namespace tiledb
@@ -0,0 +1,149 @@
+/**
+ * @section LICENSE
+ *
+ * The MIT License
+ *
+ * @copyright Copyright (c) 2024 TileDB, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TILEDB_VCF_INGESTION_CHECKPOINTS_H
+#define TILEDB_VCF_INGESTION_CHECKPOINTS_H
+
+#include <atomic>
+#include <string>
+#include <tiledb/tiledb>
+#include <vector>
+
+#include "vcf/region.h"
+
+namespace tiledb {
+namespace vcf {
+
+/**
+ * Records of the data array fragments committed by an ingestion.
+ *
+ * With checkpoints enabled, ingestion finalizes a fragment whenever it has
+ * written about a fixed number of records and reached a region boundary, and
+ * then writes a checkpoint listing the sample batch, the regions the fragment
+ * covers and the number of records it holds. A resumed ingestion skips
+ * exactly the regions of the committed fragments, instead of redoing every
+ * contig of the batch that was interrupted.
+ *
+ * Each checkpoint is a small text file in the checkpoint directory, written
+ * under a temporary name and moved into place.
+ */
+class IngestionCheckpoints {
+ public:
+  /** A committed data array fragment. */
+  struct Checkpoint {
+    /** First sample of the batch */
+    std::string first_sample;
+    /** Last sample of the batch */
+    std::string last_sample;
+    /** Regions covered by the fragment, in ingestion order */
+    std::vector<Region> regions;
+    /** Number of VCF records in the fragment */
+    uint64_t records = 0;
+  };
+
+  /**
+   * Constructor.
+   *
+   * @param vfs TileDB VFS instance to use
+   * @param uri URI of the checkpoint directory, created if missing
+   */
+  IngestionCheckpoints(const tiledb::VFS& vfs, const std::string& uri);
+
+  /**
+   * Writes a checkpoint. Thread-safe.
+   *
+   * @param checkpoint Checkpoint to write
+   */
+  void write(const Checkpoint& checkpoint);
+
+  /**
+   * Loads the checkpoints of a sample batch.
+   *
+   * @param first_sample First sample of the batch
+   * @param last_sample Last sample of the batch
+   * @return Checkpoints of the batch, in no particular order
+   */
+  std::vector<Checkpoint> load(
+      const std::string& first_sample, const std::string& last_sample) const;
+
+  /**
+   * Removes the checkpoints of a sample batch, so that a new ingestion of
+   * the batch does not resume from an older one.
+   *
+   * @param first_sample First sample of the batch
+   * @param last_sample Last sample of the batch
+   */
+  void remove(const std::string& first_sample, const std::string& last_sample);
+
+  /**
+   * Returns the parts of `regions` not covered by any of the checkpoints.
+   *
+   * @param regions Regions to ingest, in ingestion order
+   * @param checkpoints Checkpoints of the batch
+   * @return Uncovered regions, in ingestion order
+   */
+  static std::vector<Region> uncovered(
+      const std::vector<Region>& regions,
+      const std::vector<Checkpoint>& checkpoints);
+
+  /** Returns a checkpoint serialized as text. */
+  static std::string to_str(const Checkpoint& checkpoint);
+
+  /**
+   * Parses a checkpoint serialized by `to_str`.
+   *
+   * @param str Serialized checkpoint
+   * @param checkpoint Set to the parsed checkpoint
+   * @return False if `str` is not a valid checkpoint
+   */
+  static bool parse(const std::string& str, Checkpoint* checkpoint);
+
+ private:
+  /** TileDB VFS instance */
+  const tiledb::VFS& vfs_;
+
+  /** URI of the checkpoint directory */
+  std::string uri_;
+
+  /** Identifies the checkpoints written by this instance */
+  uint32_t run_id_;
+
+  /** Number of checkpoints written by this instance */
+  std::atomic<uint64_t> num_written_;
+
+  /** Returns the file name prefix of the checkpoints of a batch. */
+  static std::string batch_prefix(
+      const std::string& first_sample, const std::string& last_sample);
+
+  /** Returns the URIs of the checkpoint files of a batch. */
+  std::vector<std::string> batch_files(
+      const std::string& first_sample, const std::string& last_sample) const;
+};
+
+}  // namespace vcf
+}  // namespace tiledb
+
+#endif  // TILEDB_VCF_INGESTION_CHECKPOINTS_H
@@ -24,75 +24,294 @@
  * THE SOFTWARE.
  */
 
-#include "write/record_heap_v4.h"
+#include <algorithm>
+#include <numeric>
+
+#include "utils/metrics.h"
 #include "vcf/vcf_utils.h"
+#include "write/record_heap_v4.h"
 
 namespace tiledb {
 namespace vcf {
 
+namespace {
+
+/** Orders node indexes on their keys, largest first, for a min-heap. */
+struct KeyGreater {
+  const std::deque<RecordHeapV4::Node>& nodes;
+
+  bool operator()(uint32_t a, uint32_t b) const {
+    return nodes[a].key > nodes[b].key;
+  }
+};
+
+}  // namespace
+
+void RecordHeapV4::init(const std::vector<std::shared_ptr<VCFV4>>& vcfs) {
+  clear();
+  sample_names_.clear();
+  contig_names_.clear();
+  contig_ranks_.clear();
+
+  // Collect the contigs of every header, indexed by their contig ids.
+  std::vector<std::vector<std::string>> header_contigs;
+  for (const auto& vcf : vcfs) {
+    sample_names_.push_back(vcf->sample_name());
+    int nseq = 0;
+    const char** seqnames = bcf_hdr_seqnames(vcf->hdr(), &nseq);
+    header_contigs.emplace_back(seqnames, seqnames + nseq);
+    hts_free(seqnames);
+    contig_names_.insert(
+        contig_names_.end(),
+        header_contigs.back().begin(),
+        header_contigs.back().end());
+  }
+
+  // Ranks follow the string order of the contig and sample dimensions.
+  std::sort(contig_names_.begin(), contig_names_.end());
+  contig_names_.erase(
+      std::unique(contig_names_.begin(), contig_names_.end()),
+      contig_names_.end());
+  for (const auto& contigs : header_contigs) {
+    std::vector<uint32_t> ranks;
+    for (const auto& contig : contigs)
+      ranks.push_back(
+          std::lower_bound(contig_names_.begin(), contig_names_.end(), contig) -
+          contig_names_.begin());
+    contig_ranks_.push_back(std::move(ranks));
+  }
+
+  const uint32_t num_samples = vcfs.size();
+  std::vector<uint32_t> order(num_samples);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return sample_names_[a] < sample_names_[b];
+  });
+  sample_ranks_.assign(num_samples, 0);
+  for (uint32_t rank = 0; rank < num_samples; rank++)
+    sample_ranks_[order[rank]] = rank;
+
+  // The key packs [contig rank | start position | sample rank]. The contig
+  // rank gets the bits left over by the sample rank.
+  sample_bits_ = 0;
+  while ((uint64_t(1) << sample_bits_) < num_samples)
+    sample_bits_++;
+  if (sample_bits_ >= 32 ||
+      contig_names_.size() >= (uint64_t(1) << (32 - sample_bits_)))
+    throw std::runtime_error(
+        "Error initializing ingestion heap; " +
+        std::to_string(contig_names_.size()) + " contigs and " +
+        std::to_string(num_samples) + " samples do not fit in a sort key.");
+
+  cursors_.assign(num_samples, {});
+  tree_.assign(std::max<uint32_t>(num_samples, 1), 0);
+  dirty_ = true;
+}
+
 void RecordHeapV4::clear() {
-  while (!heap_.empty())
-    heap_.pop();
+  for (auto& cursor : cursors_) {
+    for (uint32_t idx : cursor)
+      release_node(idx);
+    cursor.clear();
+  }
+  size_ = 0;
+  dirty_ = true;
 }
 
 bool RecordHeapV4::empty() const {
-  return heap_.empty();
+  return size_ == 0;
 }
 
 void RecordHeapV4::insert(
     std::shared_ptr<VCFV4> vcf,
     NodeType type,
     SafeSharedBCFRec record,
-    const std::string& contig,
     uint32_t start_pos,
     uint32_t end_pos,
-    const std::string& sample_name) {
+    uint32_t sample,
+    uint32_t merged_records) {
+  if (sample >= cursors_.size())
+    throw std::runtime_error(
+        "Error inserting record into ingestion heap; invalid sample index " +
+        std::to_string(sample));
+  if (record->rid < 0 ||
+      static_cast<size_t>(record->rid) >= contig_ranks_[sample].size())
+    throw std::runtime_error(
+        "Error inserting record into ingestion heap from sample " +
+        sample_names_[sample] + "; contig is not in the VCF header.");
+  const uint32_t contig = contig_ranks_[sample][record->rid];
+
   // Sanity check start_pos is greater than the record start position.
   if (start_pos < (uint32_t)record->pos) {
     HtslibValueMem val;
     std::string str_type = type == NodeType::Record ? "record" : "anchor";
     throw std::runtime_error(
-        "Error inserting " + str_type + " '" + contig + ":" +
+        "Error inserting " + str_type + " '" + contig_names_[contig] + ":" +
         std::to_string(record->pos + 1) + "-" +
         std::to_string(
             VCFUtils::get_end_pos(vcf->hdr(), record.get(), &val) + 1) +
-        "' into ingestion heap from sample " + sample_name +
+        "' into ingestion heap from sample " + sample_names_[sample] +
         "; sort start position " + std::to_string(start_pos + 1) +
         " cannot be less than start.");
   }
 
-  auto node = std::unique_ptr<Node>(new Node);
-  node->vcf = vcf;
-  node->type = type;
-  node->record = std::move(record);
-  node->contig = contig;
-  node->start_pos = start_pos;
-  node->end_pos = end_pos;
-  node->sample_name = sample_name;
-  heap_.push(std::move(node));
+  uint32_t idx;
+  Node& node = acquire_node(&idx);
+  node.vcf = std::move(vcf);
+  node.type = type;
+  node.record = std::move(record);
+  node.contig = contig;
+  node.start_pos = start_pos;
+  node.end_pos = end_pos;
+  node.sample = sample;
+  node.key = (uint64_t(contig) << (32 + sample_bits_)) |
+             (uint64_t(start_pos) << sample_bits_) | sample_ranks_[sample];
+  node.merged_records = merged_records;
+  static auto& inserts = metrics::counter("ingest.heap_insert");
+  inserts.add();
+  push_node(idx);
 }
 
 void RecordHeapV4::insert(const Node& node) {
-  insert(
-      node.vcf,
-      node.type,
-      node.record,
-      node.contig,
-      node.start_pos,
-      node.end_pos,
-      node.sample_name);
+  if (node.sample >= cursors_.size())
+    throw std::runtime_error(
+        "Error inserting record into ingestion heap; invalid sample index " +
+        std::to_string(node.sample));
+
+  uint32_t idx;
+  acquire_node(&idx) = node;
+  static auto& inserts = metrics::counter("ingest.heap_insert");
+  inserts.add();
+  push_node(idx);
 }
 
-const RecordHeapV4::Node& RecordHeapV4::top() const {
-  return *heap_.top();
+const RecordHeapV4::Node& RecordHeapV4::top() {
+  if (empty())
+    throw std::runtime_error("Error reading ingestion heap; heap is empty.");
+  if (dirty_)
+    rebuild();
+  return nodes_[cursors_[tree_[0]].front()];
 }
 
 void RecordHeapV4::pop() {
-  heap_.pop();
+  if (empty())
+    throw std::runtime_error("Error popping ingestion heap; heap is empty.");
+  if (dirty_)
+    rebuild();
+
+  const uint32_t sample = tree_[0];
+  auto& cursor = cursors_[sample];
+  std::pop_heap(cursor.begin(), cursor.end(), KeyGreater{nodes_});
+  release_node(cursor.back());
+  cursor.pop_back();
+  size_--;
+  replay(sample);
+
+  static auto& pops = metrics::counter("ingest.heap_pop");
+  pops.add();
+}
+
+size_t RecordHeapV4::size() const {
+  return size_;
+}
+
+size_t RecordHeapV4::erase_records_from(uint32_t start_pos) {
+  size_t removed = 0;
+  for (auto& cursor : cursors_) {
+    size_t kept = 0;
+    for (uint32_t idx : cursor) {
+      const Node& node = nodes_[idx];
+      if (node.type == NodeType::Record && node.start_pos >= start_pos) {
+        release_node(idx);
+        removed++;
+      } else {
+        cursor[kept++] = idx;
+      }
+    }
+    cursor.resize(kept);
+    std::make_heap(cursor.begin(), cursor.end(), KeyGreater{nodes_});
+  }
+
+  size_ -= removed;
+  dirty_ = true;
+  return removed;
+}
+
+const std::string& RecordHeapV4::sample_name(uint32_t sample) const {
+  return sample_names_[sample];
+}
+
+const std::string& RecordHeapV4::contig_name(uint32_t contig) const {
+  return contig_names_[contig];
+}
+
+uint64_t RecordHeapV4::cursor_key(uint32_t sample) const {
+  const auto& cursor = cursors_[sample];
+  return cursor.empty() ? empty_key : nodes_[cursor.front()].key;
 }
 
-size_t RecordHeapV4::size() {
-  return heap_.size();
+RecordHeapV4::Node& RecordHeapV4::acquire_node(uint32_t* idx) {
+  if (free_nodes_.empty()) {
+    *idx = nodes_.size();
+    nodes_.emplace_back();
+  } else {
+    *idx = free_nodes_.back();
+    free_nodes_.pop_back();
+  }
+  return nodes_[*idx];
+}
+
+void RecordHeapV4::release_node(uint32_t idx) {
+  Node& node = nodes_[idx];
+  node.vcf.reset();
+  node.record.reset();
+  free_nodes_.push_back(idx);
+}
+
+void RecordHeapV4::push_node(uint32_t idx) {
+  const Node& node = nodes_[idx];
+  auto& cursor = cursors_[node.sample];
+  const bool new_head = node.key < cursor_key(node.sample);
+  cursor.push_back(idx);
+  std::push_heap(cursor.begin(), cursor.end(), KeyGreater{nodes_});
+  size_++;
+
+  // A new head keeps the winning cursor winning, but may change the matches
+  // on the path of any other cursor.
+  if (new_head && node.sample != tree_[0])
+    dirty_ = true;
+}
+
+void RecordHeapV4::rebuild() {
+  // Leaves are the cursors, at positions [k, 2k) of an implicit binary tree
+  // whose internal nodes are at positions [1, k).
+  const uint32_t k = cursors_.size();
+  std::vector<uint32_t> winners(2 * k);
+  for (uint32_t i = 0; i < k; i++)
+    winners[k + i] = i;
+  for (uint32_t p = k - 1; p > 0; p--) {
+    uint32_t winner = winners[2 * p], loser = winners[2 * p + 1];
+    if (cursor_key(loser) < cursor_key(winner))
+      std::swap(winner, loser);
+    winners[p] = winner;
+    tree_[p] = loser;
+  }
+  tree_[0] = k > 1 ? winners[1] : 0;
+  dirty_ = false;
+}
+
+void RecordHeapV4::replay(uint32_t sample) {
+  const uint32_t k = cursors_.size();
+  uint32_t winner = sample;
+  uint64_t winner_key = cursor_key(winner);
+  for (uint32_t p = (sample + k) / 2; p > 0; p /= 2) {
+    const uint64_t key = cursor_key(tree_[p]);
+    if (key < winner_key) {
+      std::swap(tree_[p], winner);
+      winner_key = key;
+    }
+  }
+  tree_[0] = winner;
 }
 
 }  // namespace vcf
@@ -28,13 +28,33 @@
 #define TILEDB_VCF_RECORD_HEAP_V4_H
 
 #include <htslib/vcf.h>
-#include <queue>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "vcf/vcf_v4.h"
 
 namespace tiledb {
 namespace vcf {
 
+/**
+ * Merges the records of the samples of an ingestion batch in the global order
+ * of the data array: contig, start position, then sample name.
+ *
+ * Every sample has a cursor: a small min-heap of its queued nodes (usually a
+ * record, its next anchor and the next record). A loser tree over the cursors
+ * picks the next node. Nodes are ordered on a 64-bit key packing the contig
+ * and sample ranks with the start position, so that selecting the next node
+ * compares integers only. Nodes are kept in a pool and reused.
+ *
+ * The tree is replayed along the path of the popped cursor. Inserting a node
+ * that sorts before the head of a cursor other than the current winner
+ * invalidates the tree, which is then rebuilt on the next access. Ingestion
+ * only inserts nodes of the sample being processed before popping its node,
+ * which never invalidates the tree.
+ */
 class RecordHeapV4 {
  public:
   enum class NodeType { Record, Anchor };
@@ -43,68 +63,142 @@ class RecordHeapV4 {
         : vcf(nullptr)
         , type(NodeType::Record)
         , record(nullptr)
+        , contig(0)
         , start_pos(std::numeric_limits<uint32_t>::max())
         , end_pos(std::numeric_limits<uint32_t>::max())
-        , sample_name() {
+        , sample(0)
+        , key(std::numeric_limits<uint64_t>::max())
+        , merged_records(0) {
     }
 
     std::shared_ptr<VCFV4> vcf;
     NodeType type;
     SafeSharedBCFRec record;
-    std::string contig;
+    /** Rank of the contig name among the contigs of the samples */
+    uint32_t contig;
     uint32_t start_pos;
     uint32_t end_pos;
-    std::string sample_name;
+    /** Index of the sample's cursor */
+    uint32_t sample;
+    /** Sort key packing the contig rank, start position and sample rank */
+    uint64_t key;
+    /** Number of gVCF reference blocks merged into the record */
+    uint32_t merged_records;
   };
 
+  /**
+   * Initializes the heap with one cursor per VCF file, in the given order.
+   * Heaps initialized with the same files can exchange nodes.
+   *
+   * @param vcfs Open VCF files of the samples
+   */
+  void init(const std::vector<std::shared_ptr<VCFV4>>& vcfs);
+
   void clear();
 
   bool empty() const;
 
+  /**
+   * Inserts a record or anchor of the given sample.
+   *
+   * @param vcf VCF file of the record
+   * @param type Node type
+   * @param record The record
+   * @param start_pos Sort start position of the node
+   * @param end_pos End position of the record
+   * @param sample Index of the sample's cursor
+   * @param merged_records Number of reference blocks merged into the record
+   */
   void insert(
       std::shared_ptr<VCFV4> vcf,
       NodeType type,
       SafeSharedBCFRec record,
-      const std::string& contig,
       uint32_t start_pos,
       uint32_t end_pos,
-      const std::string& sample_name);
+      uint32_t sample,
+      uint32_t merged_records = 0);
 
   void insert(const Node& node);
 
-  const Node& top() const;
+  const Node& top();
 
   void pop();
 
-  size_t size();
+  size_t size() const;
+
+  /**
+   * Removes all NodeType::Record nodes starting at or after the given
+   * position. Anchor nodes are kept, since they belong to records that
+   * started before it.
+   *
+   * @param start_pos First start position to remove
+   * @return Number of nodes removed
+   */
+  size_t erase_records_from(uint32_t start_pos);
+
+  /** Returns the name of the sample of the given cursor. */
+  const std::string& sample_name(uint32_t sample) const;
+
+  /** Returns the name of the contig of the given rank. */
+  const std::string& contig_name(uint32_t contig) const;
 
  private:
+  /** Key of a cursor with no node. */
+  static constexpr uint64_t empty_key = std::numeric_limits<uint64_t>::max();
+
+  /** Sample name of each cursor */
+  std::vector<std::string> sample_names_;
+
+  /** Rank of the sample name of each cursor */
+  std::vector<uint32_t> sample_ranks_;
+
+  /** Contig names of all samples, sorted */
+  std::vector<std::string> contig_names_;
+
+  /** Contig rank of each contig id (rid) of each cursor's VCF header */
+  std::vector<std::vector<uint32_t>> contig_ranks_;
+
+  /** Number of low key bits holding the sample rank */
+  unsigned sample_bits_ = 0;
+
+  /** Node pool. A deque keeps references to nodes valid as it grows. */
+  std::deque<Node> nodes_;
+
+  /** Indexes of the unused nodes of the pool */
+  std::vector<uint32_t> free_nodes_;
+
+  /** Min-heap of node indexes of each cursor */
+  std::vector<std::vector<uint32_t>> cursors_;
+
   /**
-   * Performs a greater-than comparison on two RecordHeapV4 Node structs. This
-   * results in a min-heap sorted on start position first, breaking ties by
-   * sample ID.
+   * Loser tree over the cursors. Entry 0 holds the winning cursor, entry i > 0
+   * the cursor that lost the match at internal node i.
    */
-  struct NodeCompareGT {
-    bool operator()(
-        const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) const {
-      auto a_start = a->start_pos, b_start = b->start_pos;
-      auto a_contig = a->contig, b_contig = b->contig;
-      return a_contig > b_contig ||
-             (a_contig == b_contig && a_start > b_start) ||
-             (a_contig == b_contig && a_start == b_start &&
-              a->sample_name > b->sample_name);
-    }
-  };
+  std::vector<uint32_t> tree_;
+
+  /** True if the loser tree must be rebuilt before its next use */
+  bool dirty_ = true;
+
+  /** Number of queued nodes */
+  size_t size_ = 0;
+
+  /** Returns the key of the head of the given cursor. */
+  uint64_t cursor_key(uint32_t sample) const;
+
+  /** Returns a pool node, and its index in `idx`. */
+  Node& acquire_node(uint32_t* idx);
+
+  /** Releases a node to the pool, dropping its record. */
+  void release_node(uint32_t idx);
+
+  /** Pushes a pool node onto its cursor's heap. */
+  void push_node(uint32_t idx);
 
-  /** A min-heap of BCF record structs, sorted on start pos. */
-  typedef std::priority_queue<
-      std::unique_ptr<Node>,
-      std::vector<std::unique_ptr<Node>>,
-      NodeCompareGT>
-      record_heap_t;
+  /** Rebuilds the loser tree from the cursor heads. */
+  void rebuild();
 
-  /** The heap. */
-  record_heap_t heap_;
+  /** Replays the matches on the path of the given cursor to the root. */
+  void replay(uint32_t sample);
 };
 
 }  // namespace vcf
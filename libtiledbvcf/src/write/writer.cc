@@ -27,11 +27,16 @@
 #if !defined _MSC_VER
 #include <sys/resource.h>
 #endif
+#include <cmath>
 #include <future>
+#include <limits>
+#include <numeric>
 
 #include "dataset/attribute_buffer_set.h"
 #include "dataset/tiledbvcfdataset.h"
+#include "utils/buffer_pool.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 #include "utils/sample_utils.h"
 #include "write/writer.h"
 #include "write/writer_worker.h"
@@ -333,12 +338,26 @@ void Writer::ingest_samples() {
         "Resume support only support for v4 or higher datasets");
   }
 
+  checkpoints_.reset();
+  if (!ingestion_params_.checkpoint_uri.empty()) {
+    if (dataset_->metadata().version != TileDBVCFDataset::Version::V4)
+      throw std::runtime_error(
+          "Ingestion checkpoints are only supported for v4 datasets");
+    if (ingestion_params_.checkpoint_records == 0)
+      throw std::runtime_error(
+          "Error setting up ingestion checkpoints; checkpoint records must be "
+          "greater than 0");
+    checkpoints_ = std::make_unique<IngestionCheckpoints>(
+        *vfs_, ingestion_params_.checkpoint_uri);
+  }
+
   std::unordered_map<
       std::pair<std::string, std::string>,
       std::vector<std::pair<std::string, std::string>>,
       tiledb::vcf::pair_hash>
       existing_fragments;
-  if (ingestion_params_.resume_sample_partial_ingestion) {
+  // With checkpoints, resumption does not need the fragment listing
+  if (ingestion_params_.resume_sample_partial_ingestion && !checkpoints_) {
     LOG_DEBUG(
         "Starting fetching of contig to sample list for resumption checking");
     existing_fragments = dataset_->fragment_sample_contig_list();
@@ -398,6 +417,20 @@ void Writer::ingest_samples() {
           batches[0],
           &scratch_space_a));
 
+  // Keep the buffers of the workers of a batch for the workers of the next
+  // one. Buffers grow by doubling, so a worker holds up to twice its flush
+  // threshold. The pool is released when the ingestion ends or fails, or
+  // when the last of concurrent ingestions does (see buffer_pool.h).
+  buffer_pool::enable(
+      2 * (uint64_t(ingestion_params_.num_threads) + 1) *
+          ingestion_params_.max_tiledb_buffer_size_mb * 1024 * 1024,
+      ingestion_params_.huge_pages);
+  struct BufferPoolRelease {
+    ~BufferPoolRelease() {
+      buffer_pool::release();
+    }
+  } buffer_pool_release;
+
   LOG_DEBUG(
       "Initialization completed in {:.3f} seconds.",
       utils::chrono_duration(start_all));
@@ -670,12 +703,25 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
     LOG_FATAL("Cannot set contigs_to_allow_merging with contig_mode != all");
   }
 
+  // Thread pool shared by all input VCF files for BGZF decompression. It is
+  // created before the workers so it outlives the files that use it.
+  SafeHtsThreadPool decompression_pool(nullptr, hts_tpool_destroy);
+  if (params.decompression_threads > 0) {
+    decompression_pool.reset(hts_tpool_init(params.decompression_threads));
+    if (decompression_pool == nullptr)
+      throw std::runtime_error(
+          "Error creating decompression thread pool with " +
+          std::to_string(params.decompression_threads) + " threads");
+  }
+
   // TODO: workers can be reused across space tiles
   // TODO: use multiple threads for vcf open, currenly serial with num_threads *
   // samples.size() vcf open calls
   std::vector<std::unique_ptr<WriterWorker>> workers(params.num_threads);
   for (size_t i = 0; i < workers.size(); ++i) {
-    workers[i] = std::unique_ptr<WriterWorker>(new WriterWorkerV4(i));
+    auto worker = new WriterWorkerV4(i);
+    worker->set_thread_pool(decompression_pool.get());
+    workers[i] = std::unique_ptr<WriterWorker>(worker);
 
     workers[i]->init(*dataset_, params, samples);
     workers[i]->set_max_total_buffer_size_mb(params.max_tiledb_buffer_size_mb);
@@ -695,6 +741,18 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
 
   // Total number of records in each contig for all samples.
   std::map<std::string, uint32_t> total_contig_records;
+
+  // Estimated number of records in each index window of each contig for all
+  // samples, used to cut regions of equal work.
+  const uint32_t index_window_size = 1 << 18;
+  std::map<std::string, std::vector<double>> contig_window_records;
+
+  // Record lengths of the contigs of the batch for a dataset with adaptive
+  // anchor gaps, sampled evenly from the samples of the batch.
+  const size_t anchor_gap_sample_records = 10000;
+  const size_t sample_records_per_file = std::max<size_t>(
+      anchor_gap_sample_records / std::max<size_t>(samples.size(), 1), 1);
+  std::map<std::string, std::vector<uint32_t>> contig_record_lengths;
   for (const auto& s : samples) {
     VCFV4 vcf;
     vcf.open(s.sample_uri, s.index_uri);
@@ -754,10 +812,31 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
       total_contig_records[contig_region.seq_name] +=
           vcf.record_count(contig_region.seq_name);
 
+      // Without a length in the header the contig would be estimated over
+      // the whole coordinate space, one index query per window. Such contigs
+      // are left to a single region that the workers split as they go.
+      const bool unknown_length =
+          contig_region.max >= std::numeric_limits<uint32_t>::max() - 1;
+      if (!params.use_legacy_thread_task_size && !unknown_length) {
+        vcf.estimate_records(
+            contig_region.seq_name,
+            index_window_size,
+            contig_region.max + 1,
+            &contig_window_records[contig_region.seq_name]);
+      }
+
       total_records_expected_ += vcf.record_count(contig_region.seq_name);
 
       nonempty_contigs.emplace(contig_region.seq_name);
 
+      if (dataset_->metadata().adaptive_anchor_gap) {
+        sample_record_lengths(
+            vcf,
+            contig_region,
+            sample_records_per_file,
+            &contig_record_lengths[contig_region.seq_name]);
+      }
+
       // regions
       bool region_found = false;
       for (auto& region : regions_v4) {
@@ -858,22 +937,60 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
         "Using legacy option: --thread-task-size={}", params.thread_task_size);
   }
 
-  // Set worker task size for each contig
-  std::map<std::string, uint32_t> contig_task_size;
-  for (auto& region : regions_v4) {
-    // convert total records to task size
-    uint32_t total_records = total_contig_records[region.seq_name];
-    uint32_t task_size = region.max + 1;
-    if (total_records > output_buffer_records) {
-      task_size = params.ratio_task_size * region.max * output_buffer_records /
-                  total_records;
-    }
-    contig_task_size[region.seq_name] = params.use_legacy_thread_task_size ?
-                                            params.thread_task_size :
-                                            task_size;
+  if (params.use_legacy_thread_task_size) {
+    std::map<std::string, uint32_t> contig_task_size;
+    for (auto& region : regions_v4)
+      contig_task_size[region.seq_name] = params.thread_task_size;
+    regions = prepare_region_list(regions_v4, contig_task_size);
+  } else {
+    // Cut each contig into regions of roughly equal estimated records, so
+    // dense regions are split finely and sparse regions are not split at all.
+    regions = prepare_region_list(
+        regions_v4,
+        contig_window_records,
+        index_window_size,
+        params.ratio_task_size * output_buffer_records);
+  }
+
+  // Samples of a v4 batch are sorted by name, like the header map
+  IngestionCheckpoints::Checkpoint checkpoint;
+  checkpoint.first_sample = sample_headers.begin()->first;
+  checkpoint.last_sample = sample_headers.rbegin()->first;
+  if (checkpoints_ && params.resume_sample_partial_ingestion) {
+    // Skip exactly the regions committed by the interrupted ingestion
+    uint64_t committed_records = 0;
+    const auto committed = checkpoints_->load(
+        checkpoint.first_sample, checkpoint.last_sample);
+    for (const auto& c : committed)
+      committed_records += c.records;
+    regions = IngestionCheckpoints::uncovered(regions, committed);
+    total_records_expected_ -= committed_records;
+    LOG_INFO(
+        "Resume: {} checkpoints cover {} records of sample_range=('{}', "
+        "'{}'), {} regions left",
+        committed.size(),
+        committed_records,
+        checkpoint.first_sample,
+        checkpoint.last_sample,
+        regions.size());
+    if (regions.empty())
+      return {0, 0};
+  } else if (checkpoints_) {
+    // Checkpoints of an earlier ingestion of the batch no longer apply
+    checkpoints_->remove(checkpoint.first_sample, checkpoint.last_sample);
   }
 
-  regions = prepare_region_list(regions_v4, contig_task_size);
+  // Record the anchor gaps of the batch before its anchors are written. The
+  // floor keeps a sample of short records from choosing a gap so small that
+  // a later long record is split into a great many anchors.
+  const uint32_t min_anchor_gap =
+      std::max<uint32_t>(dataset_->metadata().anchor_gap / 10, 1);
+  std::map<std::string, uint32_t> contig_anchor_gaps;
+  for (auto& contig_lengths : contig_record_lengths)
+    contig_anchor_gaps[contig_lengths.first] =
+        TileDBVCFDataset::choose_anchor_gap(
+            &contig_lengths.second, min_anchor_gap);
+  dataset_->record_contig_anchor_gaps(contig_anchor_gaps);
 
   // For V4 lets write the headers for this batch and also prepare the region
   // list specific to this batch
@@ -886,6 +1003,9 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
   // Keep track of the contigs that are currently being processed by the workers
   std::deque<std::string> active_contigs;
 
+  // Worker holding the last region in global order that has been assigned.
+  unsigned last_assigned_worker = 0;
+
   for (unsigned i = 0; i < workers.size(); i++) {
     WriterWorker* worker = workers[i].get();
     while (region_idx < nregions) {
@@ -896,6 +1016,7 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
             tasks.push_back(std::async(std::launch::async, [worker, reg]() {
               return worker->parse(reg);
             })));
+        last_assigned_worker = i;
         break;
       }
     }
@@ -905,6 +1026,10 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
   int last_merged_fragment_index = 0;
   std::string last_region_contig = regions[0].seq_name;
   std::string starting_region_contig_for_merge = regions[0].seq_name;
+  // Records ingested before the current fragment was started
+  uint64_t fragment_start_records = 0;
+  // False while the query of the current fragment has nothing to commit
+  bool fragment_open = true;
   bool finished = tasks.empty();
   WriterWorker* last_worker = nullptr;
   while (!finished) {
@@ -1000,8 +1125,10 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
                 // NOTE: Finalize after the stats arrays and anchor fragment
                 // are finalized to ensure a valid data fragment will have
                 // corresponding valid stats and anchor fragments.
-                TRY_CATCH_THROW(finalize_tasks_.emplace_back(std::async(
-                    std::launch::async, finalize_query, std::move(query_))));
+                checkpoint.records = records_ingested - fragment_start_records;
+                TRY_CATCH_THROW(finalize_data_fragment(checkpoint));
+                checkpoint.regions.clear();
+                fragment_start_records = records_ingested;
 
                 // End finalize of previous contig.
                 //=================================================================
@@ -1031,10 +1158,17 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
           worker->buffers().set_buffers(
               query_.get(), dataset_->metadata().version);
 
-          auto status = query_->submit();
+          Query::Status status;
+          {
+            static auto& submit_time =
+                metrics::histogram("ingest.tiledb_submit");
+            metrics::ScopedTimer timer(submit_time);
+            status = query_->submit();
+          }
           if (status == Query::Status::FAILED) {
             LOG_FATAL("Error submitting TileDB write query: status = FAILED");
           }
+          fragment_open = true;
 
           {
             auto first = worker->buffers().start_pos().value<uint32_t>(0);
@@ -1082,14 +1216,50 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
         }
       }
 
+      // The worker's region is written, so it belongs to the current
+      // fragment. Commit the fragment once it holds enough records.
+      bool commit_checkpoint = false;
+      if (checkpoints_) {
+        checkpoint.regions.push_back(worker->region());
+        commit_checkpoint = records_ingested - fragment_start_records >=
+                            params.checkpoint_records;
+      }
+
       // Finalize the stats arrays if we are moving to a new contig
       // and the current or next contig is not mergeable.
-      if (current_region_contig != next_region_contig &&
-          (!check_contig_mergeable(next_region_contig) ||
-           !check_contig_mergeable(current_region_contig))) {
+      if (commit_checkpoint ||
+          (current_region_contig != next_region_contig &&
+           (!check_contig_mergeable(next_region_contig) ||
+            !check_contig_mergeable(current_region_contig)))) {
         worker->flush_ingestion_tasks(true);
       }
 
+      if (commit_checkpoint) {
+        LOG_INFO(
+            "Committing checkpoint of {} records at {}:{}",
+            records_ingested - fragment_start_records,
+            current_region_contig,
+            worker->region().max);
+
+        // Same order as a contig batch: anchors and stats first, then data
+        anchors_ingested += write_anchors(anchor_worker);
+        worker->buffers().clear_query_buffers(
+            query_.get(), dataset_->metadata().version);
+        checkpoint.records = records_ingested - fragment_start_records;
+        TRY_CATCH_THROW(finalize_data_fragment(checkpoint));
+        checkpoint.regions.clear();
+        fragment_start_records = records_ingested;
+
+        query_.reset(new Query(*ctx_, *array_));
+        query_->set_layout(TILEDB_GLOBAL_ORDER);
+
+        // The next write starts a new fragment without finalizing this one
+        // again, whatever its contig
+        last_region_contig.clear();
+        starting_region_contig_for_merge = next_region_contig;
+        fragment_open = false;
+      }
+
       // Start next region parsing using the same worker.
       while (region_idx < nregions) {
         Region reg = regions[region_idx++];
@@ -1099,11 +1269,39 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
               tasks[i] = std::async(std::launch::async, [worker, reg]() {
                 return worker->parse(reg);
               }));
+          last_assigned_worker = i;
           finished = false;
           break;
         }
       }
 
+      // With no regions left, steal the upper part of the last assigned
+      // region instead of idling. That region is last in global order and
+      // its worker is drained right before this one, so the upper part is
+      // still written in order.
+      if (!tasks[i].valid() && last_assigned_worker != i &&
+          tasks[last_assigned_worker].valid()) {
+        auto victim = dynamic_cast<WriterWorkerV4*>(
+            workers[last_assigned_worker].get());
+        Region reg;
+        if (victim->split_region(&reg)) {
+          LOG_DEBUG(
+              "Worker {} stole {}:{}-{} from worker {}",
+              i,
+              reg.seq_name,
+              reg.min,
+              reg.max,
+              last_assigned_worker);
+          active_contigs.push_back(reg.seq_name);
+          TRY_CATCH_THROW(
+              tasks[i] = std::async(std::launch::async, [worker, reg]() {
+                return worker->parse(reg);
+              }));
+          last_assigned_worker = i;
+          finished = false;
+        }
+      }
+
       // When an ingestion worker is finished, clear its query buffers
       // only if the query buffers are not empty.
       if (finished && worker->records_buffered() > 0) {
@@ -1139,8 +1337,10 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
   // NOTE: Finalize after the stats arrays and anchor fragment
   // are finalized to ensure a valid data fragment will have
   // corresponding valid stats and anchor fragments.
-  TRY_CATCH_THROW(finalize_tasks_.emplace_back(
-      std::async(std::launch::async, finalize_query, std::move(query_))));
+  if (fragment_open) {
+    checkpoint.records = records_ingested - fragment_start_records;
+    TRY_CATCH_THROW(finalize_data_fragment(checkpoint));
+  }
 
   // End finalize of last contig.
   //=================================================================
@@ -1152,6 +1352,38 @@ std::pair<uint64_t, uint64_t> Writer::ingest_samples_v4(
   return {records_ingested, anchors_ingested};
 }
 
+void Writer::sample_record_lengths(
+    VCFV4& vcf,
+    const Region& contig,
+    size_t max_records,
+    std::vector<uint32_t>* lengths) {
+  // Spread the sample over windows along the contig, so that long records
+  // away from its start are seen too. Without a length in the header the
+  // extent of the contig is unknown, so only its first records are read.
+  const uint32_t sample_windows = 16;
+  const bool unknown_length =
+      contig.max >= std::numeric_limits<uint32_t>::max() - 1;
+  const uint32_t num_windows = unknown_length ? 1 : sample_windows;
+  const uint64_t contig_len = uint64_t(contig.max) + 1;
+  const size_t window_records = std::max<size_t>(max_records / num_windows, 1);
+
+  HtslibValueMem val;
+  for (uint32_t w = 0; w < num_windows; w++) {
+    const uint64_t window_end = contig_len * (w + 1) / num_windows;
+    if (!vcf.seek(contig.seq_name, contig_len * w / num_windows))
+      break;
+    for (size_t i = 0; i < window_records; i++) {
+      SafeSharedBCFRec r = vcf.front_record();
+      if (r == nullptr || uint64_t(r->pos) >= window_end)
+        break;
+      vcf.pop_record();
+      lengths->push_back(
+          VCFUtils::get_end_pos(vcf.hdr(), r.get(), &val) - r->pos);
+      vcf.return_record(r);
+    }
+  }
+}
+
 size_t Writer::write_anchors(WriterWorkerV4& worker) {
   // Buffer anchor records in the anchor worker
   int records = worker.buffer_anchors();
@@ -1294,6 +1526,81 @@ std::vector<Region> Writer::prepare_region_list(
   return result;
 }
 
+std::vector<Region> Writer::prepare_region_list(
+    const std::vector<Region>& all_contigs,
+    const std::map<std::string, std::vector<double>>& contig_window_records,
+    uint32_t window_size,
+    double task_records) {
+  std::vector<Region> result;
+
+  const std::vector<double> no_records;
+  for (const auto& r : all_contigs) {
+    auto it = contig_window_records.find(r.seq_name);
+    const std::vector<double>& window_records =
+        it != contig_window_records.end() ? it->second : no_records;
+    const double total_records =
+        std::accumulate(window_records.begin(), window_records.end(), 0.0);
+
+    // Spread the records evenly over the smallest number of tasks that keeps
+    // each task under the requested size.
+    const uint32_t ntasks =
+        std::max<uint32_t>(1, std::ceil(total_records / task_records));
+    const double target = total_records / ntasks;
+
+    uint32_t task_min = r.min;
+    uint32_t tasks_left = ntasks;
+    double task_records_acc = 0;
+    for (uint32_t w = 0; w < window_records.size() && tasks_left > 1; w++) {
+      const uint64_t window_min = static_cast<uint64_t>(w) * window_size;
+      const uint64_t window_max = window_min + window_size - 1;
+      if (window_min > r.max)
+        break;
+
+      if (window_max < task_min)
+        continue;
+      uint64_t remaining_min = std::max<uint64_t>(window_min, task_min);
+      double remaining_records = window_records[w];
+
+      // Records are assumed uniform within a window, so a dense window may be
+      // cut several times.
+      while (tasks_left > 1 &&
+             task_records_acc + remaining_records >= target) {
+        const double needed = target - task_records_acc;
+        const double fraction =
+            remaining_records > 0 ? needed / remaining_records : 1.0;
+        uint64_t cut = remaining_min +
+                       static_cast<uint64_t>(
+                           fraction * (window_max - remaining_min + 1));
+        cut = std::max<uint64_t>(cut, static_cast<uint64_t>(task_min) + 1);
+        if (cut > r.max)
+          break;
+
+        result.emplace_back(r.seq_name, task_min, cut - 1);
+        task_min = cut;
+        tasks_left--;
+        task_records_acc = 0;
+        remaining_records -= needed;
+        remaining_min = cut;
+        if (remaining_min > window_max)
+          break;
+      }
+      task_records_acc += std::max(remaining_records, 0.0);
+    }
+    result.emplace_back(r.seq_name, task_min, r.max);
+
+    LOG_DEBUG(fmt::format(
+        std::locale(""),
+        "Contig {}: estimated records = {:L} tasks = {:L}",
+        r.seq_name,
+        static_cast<uint64_t>(total_records),
+        ntasks - tasks_left + 1));
+  }
+
+  std::sort(result.begin(), result.end());
+
+  return result;
+}
+
 void Writer::set_num_threads(const unsigned threads) {
   ingestion_params_.num_threads = threads;
 }
@@ -1330,6 +1637,22 @@ void Writer::set_ratio_output_flush(const float ratio_output_flush) {
   ingestion_params_.ratio_output_flush = ratio_output_flush;
 }
 
+void Writer::set_decompression_threads(const unsigned threads) {
+  ingestion_params_.decompression_threads = threads;
+}
+
+void Writer::set_huge_pages(const bool enable) {
+  ingestion_params_.huge_pages = enable;
+}
+
+void Writer::set_merge_ref_blocks(const bool enable) {
+  ingestion_params_.merge_ref_blocks = enable;
+}
+
+void Writer::set_ref_block_gq_band(const unsigned band) {
+  ingestion_params_.ref_block_gq_band = band;
+}
+
 void Writer::set_thread_task_size(const unsigned size) {
   ingestion_params_.use_legacy_thread_task_size = true;
   ingestion_params_.thread_task_size = size;
@@ -1383,6 +1706,11 @@ void Writer::tiledb_stats(char** stats) {
     throw std::runtime_error("Error dumping tiledb statistics");
 }
 
+void Writer::metrics(const char** metrics) {
+  metrics_json_ = metrics::to_json();
+  *metrics = metrics_json_.c_str();
+}
+
 void Writer::dataset_version(int32_t* version) const {
   if (dataset_ == nullptr)
     throw std::runtime_error("Error getting dataset version");
@@ -1393,12 +1721,34 @@ void Writer::finalize_query(std::unique_ptr<tiledb::Query> query) {
   if (utils::query_buffers_set(query.get())) {
     LOG_FATAL("Cannot submit_and_finalize query with buffers set.");
   }
+  static auto& finalize_time = metrics::histogram("ingest.tiledb_finalize");
+  metrics::ScopedTimer timer(finalize_time);
   query->submit_and_finalize();
   if (query->query_status() == Query::Status::FAILED) {
     LOG_FATAL("Error submitting TileDB write query: status = FAILED");
   }
 }
 
+void Writer::finalize_data_fragment(
+    IngestionCheckpoints::Checkpoint checkpoint) {
+  if (checkpoints_ == nullptr || checkpoint.regions.empty()) {
+    finalize_tasks_.emplace_back(
+        std::async(std::launch::async, finalize_query, std::move(query_)));
+    return;
+  }
+
+  // The checkpoint is only written once the fragment is committed, so a
+  // checkpoint never covers data missing from the array.
+  finalize_tasks_.emplace_back(std::async(
+      std::launch::async,
+      [checkpoints = checkpoints_.get(),
+       checkpoint = std::move(checkpoint),
+       query = std::move(query_)]() mutable {
+        finalize_query(std::move(query));
+        checkpoints->write(checkpoint);
+      }));
+}
+
 void Writer::set_sample_batch_size(const uint64_t size) {
   ingestion_params_.sample_batch_size = size;
 }
@@ -1407,6 +1757,14 @@ void Writer::set_resume_sample_partial_ingestion(const bool resume) {
   ingestion_params_.resume_sample_partial_ingestion = resume;
 }
 
+void Writer::set_checkpoint_uri(const std::string& uri) {
+  ingestion_params_.checkpoint_uri = uri;
+}
+
+void Writer::set_checkpoint_records(const uint64_t records) {
+  ingestion_params_.checkpoint_records = records;
+}
+
 bool Writer::check_contig_mergeable(const std::string& contig) {
   // If merging is disabled always return false
   if (!ingestion_params_.contig_fragment_merging)
@@ -1476,6 +1834,22 @@ void Writer::set_compress_sample_dim(bool enable) {
   creation_params_.compress_sample_dim = enable;
 }
 
+void Writer::set_ref_block_flag(bool enable) {
+  creation_params_.ref_block_flag = enable;
+}
+
+void Writer::set_compact_gt(bool enable) {
+  creation_params_.compact_gt = enable;
+}
+
+void Writer::set_dictionary_encoding(bool enable) {
+  creation_params_.dictionary_encoding = enable;
+}
+
+void Writer::set_adaptive_anchor_gap(bool enable) {
+  creation_params_.adaptive_anchor_gap = enable;
+}
+
 void Writer::set_compression_level(int level) {
   creation_params_.compression_level = level;
 }
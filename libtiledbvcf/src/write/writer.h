@@ -41,6 +41,7 @@
 #include "dataset/tiledbvcfdataset.h"
 #include "utils/utils.h"
 #include "vcf/htslib_value.h"
+#include "write/ingestion_checkpoints.h"
 #include "write/writer_worker_v4.h"
 
 namespace tiledb {
@@ -112,6 +113,19 @@ struct IngestionParams {
   // Number of samples per batch for ingestion (default: 10).
   uint32_t sample_batch_size = 10;
 
+  // Number of htslib threads shared by all input VCF files for BGZF
+  // decompression. Zero decompresses on the ingestion worker threads.
+  unsigned decompression_threads = 0;
+
+  // Back the large attribute buffers of the workers with transparent huge
+  // pages (Linux only).
+  bool huge_pages = false;
+
+  // Merge the consecutive gVCF reference blocks of a sample that have the
+  // same GT and GQ band (GQ / ref_block_gq_band) into a single record.
+  bool merge_ref_blocks = false;
+  uint32_t ref_block_gq_band = 10;
+
   // Should the fragment info of data be loaded
   // This is used for resuming partial ingestions
   bool load_data_array_fragment_info = false;
@@ -120,6 +134,13 @@ struct IngestionParams {
   // This might have a significant performance penalty on large arrays
   bool resume_sample_partial_ingestion = false;
 
+  // Directory of ingestion checkpoints. When set, data fragments are
+  // committed every `checkpoint_records` records at a region boundary and a
+  // checkpoint is written for each, so that a resumed ingestion skips exactly
+  // the committed regions (see IngestionCheckpoints).
+  std::string checkpoint_uri;
+  uint64_t checkpoint_records = 10000000;
+
   // Enable merging of contigs into fragments which contain multiple. This is an
   // optimization to reduce fragment count when the list of contigs is very
   // large. This can improve performance due to slow s3/azure/gcs listings when
@@ -302,6 +323,18 @@ class Writer {
   /** Set the ratio of output buffer capacity that triggers a flush to TileDB */
   void set_ratio_output_flush(const float ratio_output_flush);
 
+  /** Set the number of threads used to decompress the input VCF files. */
+  void set_decompression_threads(const unsigned threads);
+
+  /** Set whether to use transparent huge pages for the worker buffers. */
+  void set_huge_pages(const bool enable);
+
+  /** Set whether to merge compatible consecutive gVCF reference blocks. */
+  void set_merge_ref_blocks(const bool enable);
+
+  /** Set the width of the GQ bands of mergeable gVCF reference blocks. */
+  void set_ref_block_gq_band(const unsigned band);
+
   /** Set the max length of an ingestion task. */
   void set_thread_task_size(const unsigned size);
 
@@ -335,6 +368,12 @@ class Writer {
   /** Fetches tiledb stats as a string */
   void tiledb_stats(char** stats);
 
+  /**
+   * Fetches the TileDB-VCF metrics (phase timings and counters) as JSON. The
+   * returned string is owned by this object and valid until the next call.
+   */
+  void metrics(const char** metrics);
+
   /** Gets the version number of the open dataset. */
   void dataset_version(int32_t* version) const;
 
@@ -344,6 +383,12 @@ class Writer {
   /** Set resume support for partial ingestion. */
   void set_resume_sample_partial_ingestion(const bool);
 
+  /** Set the directory of ingestion checkpoints. */
+  void set_checkpoint_uri(const std::string& uri);
+
+  /** Set the number of records between ingestion checkpoints. */
+  void set_checkpoint_records(const uint64_t records);
+
   /** Set contig fragment merging. */
   void set_contig_fragment_merging(const bool contig_fragment_merging);
 
@@ -376,12 +421,41 @@ class Writer {
   /** Enable sample dimension compression. */
   void set_compress_sample_dim(bool enable);
 
+  /** Enable the is_ref_block attribute flagging gVCF reference blocks. */
+  void set_ref_block_flag(bool enable);
+
+  /** Enable the genotype attribute holding GT packed into a uint32. */
+  void set_compact_gt(bool enable);
+
+  /** Enable dictionary encoding of the alleles and id attributes. */
+  void set_dictionary_encoding(bool enable);
+
+  /** Enable choosing the anchor gap of each contig from its record lengths. */
+  void set_adaptive_anchor_gap(bool enable);
+
   /** Set zstd compression level */
   void set_compression_level(int level);
 
   /** Set variant stats array version */
   void set_variant_stats_array_version(uint8_t version);
 
+  /**
+   * Prepares a list of disjoint genomic regions that cover the whole genome,
+   * cutting each contig so that every region holds roughly the same
+   * estimated number of records. A contig without estimates is covered by a
+   * single region.
+   *
+   * @param all_contigs Contigs to cover
+   * @param contig_window_records Estimated records per window of each contig
+   * @param window_size Width of each window in bases
+   * @param task_records Maximum estimated records per region
+   */
+  static std::vector<Region> prepare_region_list(
+      const std::vector<Region>& all_contigs,
+      const std::map<std::string, std::vector<double>>& contig_window_records,
+      uint32_t window_size,
+      double task_records);
+
   /**
    * @brief Delete samples from the writer's dataset.
    */
@@ -407,6 +481,10 @@ class Writer {
   RegistrationParams registration_params_;
   IngestionParams ingestion_params_;
   size_t total_records_expected_ = 0;
+  /** Checkpoints of the committed data fragments, if enabled. */
+  std::unique_ptr<IngestionCheckpoints> checkpoints_;
+  /** Last metrics JSON returned by `metrics`. */
+  std::string metrics_json_;
 
   /* ********************************* */
   /*           PRIVATE METHODS         */
@@ -483,8 +561,33 @@ class Writer {
           std::vector<std::pair<std::string, std::string>>,
           pair_hash> map);
 
+  /**
+   * Adds the lengths (END - POS) of records sampled from equal windows
+   * along a contig to `lengths`, from which the anchor gap of the contig is
+   * chosen.
+   *
+   * @param vcf Open VCF file
+   * @param contig Region of the contig, from its header line
+   * @param max_records Maximum number of records to read
+   * @param lengths Record lengths to append to
+   */
+  static void sample_record_lengths(
+      VCFV4& vcf,
+      const Region& contig,
+      size_t max_records,
+      std::vector<uint32_t>* lengths);
+
   static void finalize_query(std::unique_ptr<tiledb::Query> query);
 
+  /**
+   * Finalizes the current data array query asynchronously and, with
+   * checkpoints enabled, writes the checkpoint of the fragment once it is
+   * committed.
+   *
+   * @param checkpoint Checkpoint of the fragment
+   */
+  void finalize_data_fragment(IngestionCheckpoints::Checkpoint checkpoint);
+
   /**
    *
    * @param contig to check mergability on
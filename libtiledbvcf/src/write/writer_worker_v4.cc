@@ -26,6 +26,7 @@
 
 #include "write/writer_worker_v4.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
 
 namespace tiledb {
 namespace vcf {
@@ -33,8 +34,16 @@ namespace vcf {
 WriterWorkerV4::WriterWorkerV4(int id)
     : id_(id)
     , dataset_(nullptr)
+    , thread_pool_(nullptr)
     , records_buffered_(0)
-    , anchors_buffered_(0) {
+    , anchors_buffered_(0)
+    , split_requested_(false)
+    , running_(false)
+    , split_ok_(false)
+    , anchor_gap_(1)
+    , merge_ref_blocks_(false)
+    , ref_block_gq_band_(1)
+    , merge_frontier_(0) {
 }
 
 void WriterWorkerV4::init(
@@ -42,16 +51,33 @@ void WriterWorkerV4::init(
     const IngestionParams& params,
     const std::vector<SampleAndIndex>& samples) {
   dataset_ = &dataset;
+  merge_ref_blocks_ = params.merge_ref_blocks;
+  ref_block_gq_band_ = std::max<uint32_t>(params.ref_block_gq_band, 1);
+
+  // Split the read-ahead of the pool across the files of a batch, so a batch
+  // of a few large files can still keep every pool thread busy.
+  const int queue_size = std::max<int>(
+      2,
+      2 * params.decompression_threads /
+          std::max<size_t>(samples.size(), 1));
 
   for (const auto& s : samples) {
     auto vcf = std::make_shared<VCFV4>();
     vcf->set_max_record_buff_size(params.max_record_buffer_size);
+    vcf->set_thread_pool(thread_pool_, queue_size);
     vcf->open(s.sample_uri, s.index_uri);
     vcfs_.push_back(vcf);
   }
+  record_heap_.init(vcfs_);
+  anchor_heap_.init(vcfs_);
 
   for (const auto& attr : dataset.metadata().extra_attributes)
     buffers_.extra_attrs()[attr] = Buffer();
+  buffers_.reserve_high_water();
+}
+
+void WriterWorkerV4::set_thread_pool(hts_tpool* pool) {
+  thread_pool_ = pool;
 }
 
 const AttributeBufferSet& WriterWorkerV4::buffers() const {
@@ -67,72 +93,247 @@ uint64_t WriterWorkerV4::anchors_buffered() const {
 }
 
 void WriterWorkerV4::insert_record(
-    const SafeSharedBCFRec& record,
-    std::shared_ptr<VCFV4> vcf,
-    const std::string& contig,
-    const std::string& sample_name) {
+    const SafeSharedBCFRec& record, uint32_t sample) {
   // If a record starts outside the region max, skip it.
   const uint32_t start_pos = record->pos;
   if (start_pos > region_.max)
     return;
 
+  const auto& vcf = vcfs_[sample];
+  const uint32_t merged_records =
+      merge_ref_blocks_ ? merge_ref_blocks(record.get(), sample) : 0;
   const uint32_t end_pos =
       VCFUtils::get_end_pos(vcf->hdr(), record.get(), &val_);
   record_heap_.insert(
       vcf,
       RecordHeapV4::NodeType::Record,
       record,
-      contig,
       start_pos,
       end_pos,
-      sample_name);
+      sample,
+      merged_records);
 }
 
-bool WriterWorkerV4::parse(const Region& region) {
-  if (!record_heap_.empty())
-    throw std::runtime_error(
-        "Error in parsing; record heap unexpectedly not empty.");
+uint32_t WriterWorkerV4::merge_ref_blocks(bcf1_t* record, uint32_t sample) {
+  const auto& vcf = vcfs_[sample];
+  bcf_hdr_t* hdr = vcf->hdr();
 
-  region_ = region;
+  // The merged block is extended with END, which the header must define.
+  const int end_id = bcf_hdr_id2int(hdr, BCF_DT_ID, "END");
+  if (!bcf_hdr_idinfo_exists(hdr, BCF_HL_INFO, end_id) ||
+      record->n_allele < 2 || !VCFUtils::is_ref_block(record))
+    return 0;
+
+  int32_t* dst = nullptr;
+  int ndst = 0;
+  const auto get_values = [&](bcf1_t* r, const char* tag, auto* values) {
+    const int n = bcf_get_format_int32(hdr, r, tag, &dst, &ndst);
+    values->assign(dst, dst + std::max(n, 0));
+  };
+  const auto gq_band = [this](const std::vector<int32_t>& gq) -> int64_t {
+    return gq.empty() || gq[0] < 0 ? -1 : gq[0] / ref_block_gq_band_;
+  };
+
+  std::vector<int32_t> gt, gq, min_dp;
+  get_values(record, "GT", &gt);
+  get_values(record, "GQ", &gq);
+  get_values(record, "MIN_DP", &min_dp);
+  uint32_t end = VCFUtils::get_end_pos(hdr, record, &val_);
+
+  const std::string& sample_name = record_heap_.sample_name(sample);
+  const std::string contig = bcf_hdr_id2name(hdr, record->rid);
+  std::vector<int32_t> next_gt, next_gq, next_min_dp;
+  uint32_t merged = 0;
+  while (vcf->is_open()) {
+    SafeSharedBCFRec next = vcf->front_record();
+    if (next == nullptr || next->rid != record->rid ||
+        static_cast<uint32_t>(next->pos) != end + 1 ||
+        static_cast<uint32_t>(next->pos) > region_.max ||
+        next->n_allele < 2 || !VCFUtils::is_ref_block(next.get()))
+      break;
+
+    get_values(next.get(), "GT", &next_gt);
+    get_values(next.get(), "GQ", &next_gq);
+    if (next_gt != gt || gq_band(next_gq) != gq_band(gq))
+      break;
+    get_values(next.get(), "MIN_DP", &next_min_dp);
+
+    if (merged == 0)
+      ss_.process(hdr, sample_name, contig, record->pos, record);
+    ss_.process(hdr, sample_name, contig, next->pos, next.get());
+
+    end = VCFUtils::get_end_pos(hdr, next.get(), &val_);
+    if (!gq.empty() && !next_gq.empty())
+      gq[0] = std::min(gq[0], next_gq[0]);
+    if (!min_dp.empty() && !next_min_dp.empty() && next_min_dp[0] >= 0)
+      min_dp[0] = min_dp[0] < 0 ? next_min_dp[0] :
+                                  std::min(min_dp[0], next_min_dp[0]);
 
-  LOG_DEBUG(
-      "WriteWorker4: parse {}:{}-{}", region.seq_name, region.min, region.max);
-
-  // Initialize the record heap with the first record from each sample.
-  for (auto& vcf : vcfs_) {
-    // If seek returns false there is no records for this contig
-    if (!vcf->seek(region.seq_name, region.min))
-      continue;
-
-    SafeSharedBCFRec r = vcf->front_record();
-    if (r == nullptr) {
-      // Sample has no records at this region, skip it.
-      continue;
-    }
     vcf->pop_record();
-
-    insert_record(r, vcf, region.seq_name, vcf->sample_name());
+    vcf->return_record(next);
+    merged++;
+  }
+  hts_free(dst);
+
+  if (merged > 0) {
+    const int32_t vcf_end = end + 1;
+    bcf_update_info_int32(hdr, record, "END", &vcf_end, 1);
+    if (!gq.empty())
+      bcf_update_format_int32(hdr, record, "GQ", gq.data(), gq.size());
+    if (!min_dp.empty())
+      bcf_update_format_int32(
+          hdr, record, "MIN_DP", min_dp.data(), min_dp.size());
+    merge_frontier_ = std::max(merge_frontier_, end);
   }
+  return merged;
+}
 
-  // Start buffering records (which can possibly be incomplete if the buffers
-  // run out of space).
-  return resume();
+bool WriterWorkerV4::parse(const Region& region) {
+  return run([this, &region]() {
+    static auto& parse_time = metrics::histogram("ingest.parse");
+    metrics::ScopedTimer timer(parse_time);
+    if (!record_heap_.empty())
+      throw std::runtime_error(
+          "Error in parsing; record heap unexpectedly not empty.");
+
+    region_ = region;
+    anchor_gap_ = std::max<uint32_t>(dataset_->anchor_gap(region.seq_name), 1);
+    merge_frontier_ = 0;
+
+    LOG_DEBUG(
+        "WriteWorker4: parse {}:{}-{}",
+        region.seq_name,
+        region.min,
+        region.max);
+
+    // Initialize the record heap with the first record from each sample.
+    for (uint32_t sample = 0; sample < vcfs_.size(); sample++) {
+      auto& vcf = vcfs_[sample];
+      // If seek returns false there is no records for this contig
+      if (!vcf->seek(region.seq_name, region.min))
+        continue;
+
+      SafeSharedBCFRec r = vcf->front_record();
+      if (r == nullptr) {
+        // Sample has no records at this region, skip it.
+        continue;
+      }
+      vcf->pop_record();
+
+      insert_record(r, sample);
+    }
+
+    // Start buffering records (which can possibly be incomplete if the
+    // buffers run out of space).
+    return buffer_records();
+  });
 }
 
 bool WriterWorkerV4::resume() {
+  return run([this]() {
+    static auto& parse_time = metrics::histogram("ingest.parse");
+    metrics::ScopedTimer timer(parse_time);
+    return buffer_records();
+  });
+}
+
+bool WriterWorkerV4::split_region(Region* upper) {
+  std::unique_lock<std::mutex> lock(split_mutex_);
+  if (!running_)
+    return split_region_locked(upper);
+
+  split_requested_ = true;
+  split_cv_.wait(lock, [this]() { return !split_requested_; });
+  if (split_ok_)
+    *upper = split_upper_;
+  return split_ok_;
+}
+
+bool WriterWorkerV4::run(const std::function<bool()>& fn) {
+  {
+    std::lock_guard<std::mutex> lock(split_mutex_);
+    running_ = true;
+  }
+
+  bool complete = false;
+  std::exception_ptr error;
+  try {
+    complete = fn();
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(split_mutex_);
+    running_ = false;
+    if (error) {
+      split_ok_ = false;
+      split_requested_ = false;
+      split_cv_.notify_all();
+    } else {
+      answer_split_request();
+    }
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+  return complete;
+}
+
+void WriterWorkerV4::answer_split_request() {
+  if (!split_requested_)
+    return;
+  split_ok_ = split_region_locked(&split_upper_);
+  split_requested_ = false;
+  split_cv_.notify_all();
+}
+
+bool WriterWorkerV4::split_region_locked(Region* upper) {
+  if (record_heap_.empty())
+    return false;
+
+  // Every buffered record starts at or before the top of the heap, so the
+  // split point must come after it. Leave at least an anchor gap on each side
+  // so the split is worth the extra seeks.
+  const uint32_t next_pos =
+      std::max(record_heap_.top().start_pos, merge_frontier_);
+  if (next_pos >= region_.max ||
+      region_.max - next_pos < 2 * static_cast<uint64_t>(anchor_gap_))
+    return false;
+
+  static auto& splits = metrics::counter("ingest.region_splits");
+  splits.add();
+
+  const uint32_t split_pos = next_pos + (region_.max - next_pos) / 2 + 1;
+  *upper = Region(region_.seq_name, split_pos, region_.max);
+  region_.max = split_pos - 1;
+  size_t dropped = record_heap_.erase_records_from(split_pos);
+
+  LOG_DEBUG(
+      "Worker {}: split {}:{}-{} at {}, dropped {} queued records",
+      id_,
+      region_.seq_name,
+      region_.min,
+      upper->max,
+      split_pos,
+      dropped);
+  return true;
+}
+
+bool WriterWorkerV4::buffer_records() {
+  // The previous contents are written, record how far the buffers grew
+  buffers_.update_high_water();
   buffers_.clear();
   records_buffered_ = 0;
   anchors_buffered_ = 0;
 
-  const auto& metadata = dataset_->metadata();
-
   // Buffer VCF records in-memory for writing to the TileDB array. The records
   // are expected to be sorted in ascending order by there start position and
   // duplicate start positions are allowed. Record ranges may overlap. Records
   // are sorted on the `record_heap_` because anchor points may not be ordered
   // for overlapping records.
   //
-  // 1. Pop the top record from `record_heap_`. If the record is a
+  // 1. Take the top record from `record_heap_`. If the record is a
   //    NodeType::Record, add it to the attribute buffers.
   // 2. If there are no remaining bytes for the record (an "end node"):
   //     a. Pop the next record from the VCF reader and insert it on the heap.
@@ -144,7 +345,10 @@ bool WriterWorkerV4::resume() {
   //     c. front the next record from the VCF read. If it has a start position
   //        less than the start position of the anchor in step (a), insert it
   //        on the heap.
-  // 3. Repeat step (1) until the heap is empty.
+  // 3. Pop the top record. Nodes of the top record's sample are inserted
+  //    before it is popped, so the heap only replays the matches of that
+  //    sample instead of rebuilding its tournament tree.
+  // 4. Repeat step (1) until the heap is empty.
   //
   // When this worker is done processing the region, upstream logic will use an
   // "anchor worker" to:
@@ -157,9 +361,15 @@ bool WriterWorkerV4::resume() {
   //    fragment.
   //
   while (!record_heap_.empty()) {
+    // Hand off the upper part of the region if an idle worker asked for it.
+    if (split_requested_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(split_mutex_);
+      answer_split_request();
+    }
+
     RecordHeapV4::Node& top =
         const_cast<RecordHeapV4::Node&>(record_heap_.top());
-    const std::string sample_name = top.sample_name;
+    const uint32_t sample = top.sample;
     auto vcf = top.vcf;
 
     // If top is type Record and inside the region, copy the record into the
@@ -179,37 +389,35 @@ bool WriterWorkerV4::resume() {
     // Determine if this is the last node for the record.
     const bool is_end_node =
         top.end_pos == top.start_pos ||
-        (top.end_pos - top.start_pos - 1) < metadata.anchor_gap;
+        (top.end_pos - top.start_pos - 1) < anchor_gap_;
 
     if (is_end_node) {
-      // After buffering the end node, we're done with its record and it may
-      // returned to the vcf record pool for re-use. This is strictly an
-      // optimization.
-      vcf->return_record(top.record);
-
-      // We're done with the top node. Remove it from the heap.
-      record_heap_.pop();
-
       // If there is a next record, insert it on the heap.
       if (vcf->is_open()) {
         SafeSharedBCFRec next_r = vcf->front_record();
         if (next_r != nullptr) {
           vcf->pop_record();
-          insert_record(
-              next_r, vcf, vcf->contig_name(next_r.get()), sample_name);
+          insert_record(next_r, sample);
         }
       }
+
+      // After buffering the end node, we're done with its record and it may
+      // returned to the vcf record pool for re-use. This is strictly an
+      // optimization.
+      vcf->return_record(top.record);
+
+      // We're done with the top node. Remove it from the heap.
+      record_heap_.pop();
     } else {
       // Insert the next anchor for the current record.
-      const uint32_t anchor_start = top.start_pos + metadata.anchor_gap;
+      const uint32_t anchor_start = top.start_pos + anchor_gap_;
       record_heap_.insert(
           vcf,
           RecordHeapV4::NodeType::Anchor,
           top.record,
-          top.contig,
           anchor_start,
           top.end_pos,
-          sample_name);
+          sample);
 
       // Add the anchor to the anchor heap for buffering and writing at the end
       // of the contig. Duplicate top.record because the worker deletes the
@@ -220,13 +428,9 @@ bool WriterWorkerV4::resume() {
           vcf,
           RecordHeapV4::NodeType::Anchor,
           std::move(dup_record),
-          top.contig,
           anchor_start,
           top.end_pos,
-          sample_name);
-
-      // We're done with the top node. Remove it from the heap.
-      record_heap_.pop();
+          sample);
 
       if (vcf->is_open()) {
         // If there is a next record and it proceeds the anchor, insert it
@@ -235,10 +439,12 @@ bool WriterWorkerV4::resume() {
         if (next_r != nullptr &&
             static_cast<uint32_t>(next_r->pos) < anchor_start) {
           vcf->pop_record();
-          insert_record(
-              next_r, vcf, vcf->contig_name(next_r.get()), sample_name);
+          insert_record(next_r, sample);
         }
       }
+
+      // We're done with the top node. Remove it from the heap.
+      record_heap_.pop();
     }
 
     if (overflowed) {
@@ -277,6 +483,7 @@ void WriterWorkerV4::drain_anchors(WriterWorkerV4& anchor_worker) {
 }
 
 size_t WriterWorkerV4::buffer_anchors() {
+  buffers_.update_high_water();
   buffers_.clear();
   anchors_buffered_ = 0;
 
@@ -292,19 +499,23 @@ size_t WriterWorkerV4::buffer_anchors() {
 }
 
 bool WriterWorkerV4::buffer_record(const RecordHeapV4::Node& node) {
+  static auto& buffer_time = metrics::histogram("ingest.buffer_record");
+  metrics::ScopedTimer timer(buffer_time);
   auto vcf = node.vcf;
   bcf1_t* r = node.record.get();
   bcf_hdr_t* hdr = vcf->hdr();
-  const std::string contig = vcf->contig_name(r);
-  const std::string sample_name = node.sample_name;
+  const std::string& contig = record_heap_.contig_name(node.contig);
+  const std::string& sample_name = record_heap_.sample_name(node.sample);
   const uint32_t col = node.start_pos;
   const uint32_t pos = r->pos;
   const uint32_t end_pos = VCFUtils::get_end_pos(hdr, r, &val_);
 
-  // Ingestion tasks process only NodeType::Record
+  // Ingestion tasks process only NodeType::Record. The sample stats of
+  // merged reference blocks were computed on the original blocks.
   if (node.type == RecordHeapV4::NodeType::Record) {
     ac_.process(hdr, sample_name, contig, pos, r);
-    ss_.process(hdr, sample_name, contig, pos, r);
+    if (node.merged_records == 0)
+      ss_.process(hdr, sample_name, contig, pos, r);
     vs_.process(hdr, sample_name, contig, pos, r);
   }
 
@@ -317,6 +528,31 @@ bool WriterWorkerV4::buffer_record(const RecordHeapV4::Node& node) {
   buffers_.real_start_pos().append(&pos, sizeof(uint32_t));
   buffers_.end_pos().append(&end_pos, sizeof(uint32_t));
 
+  // Reference block flag, derived while the alleles are at hand
+  if (dataset_->has_ref_block_flag()) {
+    const uint8_t is_ref_block = VCFUtils::is_ref_block(r);
+    buffers_.is_ref_block().append(&is_ref_block, sizeof(uint8_t));
+  }
+
+  // Compact genotype; a record without GT is stored with ploidy 0
+  if (dataset_->has_compact_gt()) {
+    val_.ndst = HtslibValueMem::convert_ndst_for_type(
+        val_.ndst, BCF_HT_INT, &val_.type_for_ndst);
+    int num_gt = bcf_get_genotypes(hdr, r, &val_.dst, &val_.ndst);
+    uint32_t genotype = 0;
+    if (num_gt > 0 &&
+        !VCFUtils::encode_compact_gt(
+            static_cast<const int32_t*>(val_.dst), num_gt, &genotype))
+      throw std::runtime_error(
+          "Error buffering record of sample '" + sample_name + "' at " +
+          contig + ":" + std::to_string(pos + 1) +
+          "; GT does not fit the compact genotype attribute (ploidy above 2 "
+          "or more than " +
+          std::to_string(VCFUtils::compact_gt_max_allele) +
+          " ALT alleles). Create the dataset without compact GT.");
+    buffers_.genotype().append(&genotype, sizeof(uint32_t));
+  }
+
   // ID string (include null terminator)
   const size_t id_size = strlen(r->d.id) + 1;
   buffers_.id().offsets().push_back(buffers_.id().size());
@@ -398,8 +634,10 @@ bool WriterWorkerV4::buffer_record(const RecordHeapV4::Node& node) {
   for (auto& it : buffers_.extra_attrs())
     it.second.stop_expecting();
 
+  // Count merged reference blocks, so that the QACheck still matches the
+  // number of records in the VCF files
   if (node.type == RecordHeapV4::NodeType::Record)
-    records_buffered_++;
+    records_buffered_ += 1 + node.merged_records;
   else
     anchors_buffered_++;
 
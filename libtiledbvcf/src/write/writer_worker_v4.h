@@ -27,8 +27,12 @@
 #ifndef TILEDB_VCF_WRITER_WORKER_V4_H
 #define TILEDB_VCF_WRITER_WORKER_V4_H
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -92,6 +96,22 @@ class WriterWorkerV4 : public WriterWorker {
    */
   bool resume();
 
+  /**
+   * Splits off the untouched upper part of the region being parsed, so an
+   * idle worker can parse it. This worker's region then ends just before the
+   * split point, and records starting at or after it are dropped from the
+   * record heap. Records that start before the split point, and their
+   * anchors, stay with this worker.
+   *
+   * This may be called while parse() or resume() runs on another thread, in
+   * which case the split is done by that thread before it buffers its next
+   * record.
+   *
+   * @param upper Set to the region split off from this worker
+   * @return True if the region was split
+   */
+  bool split_region(Region* upper);
+
   /** Return a handle to the attribute buffers */
   const AttributeBufferSet& buffers() const;
 
@@ -101,6 +121,12 @@ class WriterWorkerV4 : public WriterWorker {
   /** Returns the number of anchors buffered by the last parse operation. */
   uint64_t anchors_buffered() const;
 
+  /**
+   * Sets the thread pool used to decompress the VCF files. Must be called
+   * before `init`.
+   */
+  void set_thread_pool(hts_tpool* pool);
+
   /** Initialize ingestion tasks, like allele count ingestion. */
   void init_ingestion_tasks(std::shared_ptr<Context> ctx, std::string uri);
 
@@ -127,6 +153,9 @@ class WriterWorkerV4 : public WriterWorker {
   /** Vector of VCF files being parsed. */
   std::vector<std::shared_ptr<VCFV4>> vcfs_;
 
+  /** Shared thread pool for decompressing the VCF files, if any. */
+  hts_tpool* thread_pool_;
+
   /** Reusable memory allocation for getting record field values from htslib. */
   HtslibValueMem val_;
 
@@ -151,20 +180,76 @@ class WriterWorkerV4 : public WriterWorker {
   // Sample stats ingestion task object
   SampleStats ss_;
 
+  /** Guards `running_` and the split request state. */
+  std::mutex split_mutex_;
+
+  /** Notified when a split request has been answered. */
+  std::condition_variable split_cv_;
+
+  /** True while a split request waits for the parsing thread. */
+  std::atomic<bool> split_requested_;
+
+  /** True while parse() or resume() is running. */
+  bool running_;
+
+  /** True if the last split request succeeded. */
+  bool split_ok_;
+
+  /** Region split off by the last successful split request. */
+  Region split_upper_;
+
+  /** Anchor gap of the contig of the current region. */
+  uint32_t anchor_gap_;
+
+  /** True to merge compatible gVCF reference blocks (IngestionParams). */
+  bool merge_ref_blocks_;
+
+  /** Width of the GQ bands of mergeable reference blocks. */
+  uint32_t ref_block_gq_band_;
+
+  /**
+   * End of the last merged reference block. The region is not split before
+   * it, since the blocks merged into it are gone from the VCF reader.
+   */
+  uint32_t merge_frontier_;
+
+  /**
+   * Runs `fn` with the worker marked as running, answering any split request
+   * left pending when it returns.
+   */
+  bool run(const std::function<bool()>& fn);
+
+  /** Buffers records from the record heap; the body of resume(). */
+  bool buffer_records();
+
+  /** Answers a pending split request. Requires `split_mutex_`. */
+  void answer_split_request();
+
+  /** Splits the region if it has enough left to share. Requires
+   * `split_mutex_` and that no thread is buffering records. */
+  bool split_region_locked(Region* upper);
+
   /**
    * Inserts a record (non-anchor) into the heap if it fits
    * in `region_`.
    *
    * @param record The record to insert
-   * @param vcf The VCF state that contains `record`.
-   * @param contig_offset The VCF contig offset
-   * @param sample_id The sample id for the record.
+   * @param sample Index in `vcfs_` of the VCF that contains `record`.
+   */
+  void insert_record(const SafeSharedBCFRec& record, uint32_t sample);
+
+  /**
+   * Merges into a gVCF reference block the blocks of its sample that follow
+   * it contiguously in `region_` with the same GT and GQ band (GATK-style
+   * banding). The merged block ends where the last one does and keeps their
+   * minimum GQ and MIN_DP. Sample stats are computed on the original blocks
+   * here, since the merged block no longer carries their values.
+   *
+   * @param record The next record of the sample, updated in place
+   * @param sample Index in `vcfs_` of the VCF that contains `record`.
+   * @return Number of blocks merged into the record
    */
-  void insert_record(
-      const SafeSharedBCFRec& record,
-      std::shared_ptr<VCFV4> vcf,
-      const std::string& contig,
-      const std::string& sample_name);
+  uint32_t merge_ref_blocks(bcf1_t* record, uint32_t sample);
 
   /**
    * Copies all fields of a VCF record or anchor into the attribute buffers.
@@ -29,10 +29,14 @@
 
 #include "c_api/tiledbvcf.h"
 #include "catch.hpp"
+#include "stats/carrow.h"
 #include "unit-helpers.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 static std::string INPUT_ARRAYS_DIR_V4 =
     TILEDB_VCF_TEST_INPUT_DIR + std::string("/arrays/v4");
@@ -3248,6 +3252,442 @@ TEST_CASE(
   tiledb_vcf_reader_free(&reader);
 }
 
+/** Returns the unsigned integer value of `key` in a flat JSON summary. */
+static uint64_t json_uint(const std::string& json, const std::string& key) {
+  const std::string field = "\"" + key + "\": ";
+  auto pos = json.find(field);
+  REQUIRE(pos != std::string::npos);
+  return std::stoull(json.substr(pos + field.size()));
+}
+
+TEST_CASE("C API: Reader buffer autotune", "[capi][reader]") {
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  const char* regions = "1:12100-13360,1:13500-17350";
+  const unsigned expected_num_records = 10;
+
+  // Reads the regions with autotuning set as given and returns the start
+  // positions and the autotune stats of the read.
+  auto read = [&](bool buffer_autotune, std::string* stats_str) {
+    tiledb_vcf_reader_t* reader = nullptr;
+    REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+    REQUIRE(
+        tiledb_vcf_reader_init(reader, dataset_uri.c_str()) == TILEDB_VCF_OK);
+    REQUIRE(
+        tiledb_vcf_reader_set_buffer_autotune(reader, buffer_autotune) ==
+        TILEDB_VCF_OK);
+    REQUIRE(tiledb_vcf_reader_set_memory_budget(reader, 1) == TILEDB_VCF_OK);
+    REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+
+    SET_BUFF_POS_START(reader, expected_num_records);
+    SET_BUFF_SAMPLE_NAME(reader, expected_num_records);
+    SET_BUFF_FMT_DP(reader, expected_num_records);
+
+    REQUIRE(tiledb_vcf_reader_read(reader) == TILEDB_VCF_OK);
+
+    tiledb_vcf_read_status_t status;
+    REQUIRE(tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_OK);
+    REQUIRE(status == TILEDB_VCF_COMPLETED);
+
+    int64_t num_records = ~0;
+    REQUIRE(
+        tiledb_vcf_reader_get_result_num_records(reader, &num_records) ==
+        TILEDB_VCF_OK);
+    REQUIRE(num_records == expected_num_records);
+
+    const char* stats = nullptr;
+    REQUIRE(
+        tiledb_vcf_reader_get_buffer_autotune_stats(reader, &stats) ==
+        TILEDB_VCF_OK);
+    REQUIRE(stats != nullptr);
+    *stats_str = stats;
+
+    tiledb_vcf_reader_free(&reader);
+    return pos_start;
+  };
+
+  std::string enabled_stats, disabled_stats;
+  auto enabled_pos = read(true, &enabled_stats);
+  auto disabled_pos = read(false, &disabled_stats);
+
+  // Autotuning resizes the buffers without changing the results
+  REQUIRE(json_uint(enabled_stats, "rebalances") > 0);
+  REQUIRE(json_uint(enabled_stats, "observed_cells") > 0);
+  REQUIRE(json_uint(disabled_stats, "rebalances") == 0);
+  REQUIRE(enabled_pos == disabled_pos);
+}
+
+TEST_CASE("C API: Reader read Arrow", "[capi][reader]") {
+  tiledb_vcf_reader_t* reader = nullptr;
+  REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  REQUIRE(tiledb_vcf_reader_init(reader, dataset_uri.c_str()) == TILEDB_VCF_OK);
+
+  const char* regions = "1:12100-13360,1:13500-17350";
+  REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+
+  unsigned memory_budget = 1024;
+  SECTION("- Default buffers") {
+    memory_budget = 1024;
+  }
+
+  SECTION("- Growing buffers") {
+    memory_budget = 0;
+  }
+  REQUIRE(
+      tiledb_vcf_reader_set_memory_budget(reader, memory_budget) ==
+      TILEDB_VCF_OK);
+
+  const char* attrs[] = {"sample_name", "pos_start", "alleles", "fmt_DP"};
+  int64_t total_records = 0;
+  tiledb_vcf_read_status_t status = TILEDB_VCF_UNINITIALIZED;
+  while (status != TILEDB_VCF_COMPLETED) {
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    REQUIRE(
+        tiledb_vcf_reader_read_arrow(reader, attrs, 4, &array, &schema) ==
+        TILEDB_VCF_OK);
+    REQUIRE(tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_OK);
+
+    REQUIRE(std::string(schema.format) == "+s");
+    REQUIRE(schema.n_children == 4);
+    REQUIRE(std::string(schema.children[0]->name) == "sample_name");
+    REQUIRE(std::string(schema.children[0]->format) == "u");
+    REQUIRE(std::string(schema.children[1]->format) == "i");
+    REQUIRE(std::string(schema.children[2]->format) == "+l");
+    REQUIRE(std::string(schema.children[2]->children[0]->format) == "u");
+    REQUIRE(std::string(schema.children[3]->format) == "+l");
+    REQUIRE(array.n_children == 4);
+    for (int64_t i = 0; i < array.n_children; i++)
+      REQUIRE(array.children[i]->length == array.length);
+
+    if (array.length > 0) {
+      auto pos_start =
+          static_cast<const int32_t*>(array.children[1]->buffers[1]);
+      REQUIRE(pos_start[0] > 12000);
+    }
+    total_records += array.length;
+
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(array.release == nullptr);
+    REQUIRE(schema.release == nullptr);
+  }
+  REQUIRE(total_records == 10);
+
+  tiledb_vcf_reader_free(&reader);
+}
+
+TEST_CASE("C API: Reader read Arrow held batches", "[capi][reader]") {
+  tiledb_vcf_reader_t* reader = nullptr;
+  REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  REQUIRE(tiledb_vcf_reader_init(reader, dataset_uri.c_str()) == TILEDB_VCF_OK);
+  const char* regions = "1:12100-13360,1:13500-17350";
+  REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+  REQUIRE(tiledb_vcf_reader_set_memory_budget(reader, 0) == TILEDB_VCF_OK);
+
+  // The first batch is held while the rest are read and released, so the
+  // reader must recycle other buffer sets and leave this one untouched.
+  const char* attrs[] = {"pos_start"};
+  struct ArrowArray first;
+  struct ArrowSchema first_schema;
+  REQUIRE(
+      tiledb_vcf_reader_read_arrow(reader, attrs, 1, &first, &first_schema) ==
+      TILEDB_VCF_OK);
+  REQUIRE(first.length > 0);
+  auto first_pos = static_cast<const int32_t*>(first.children[0]->buffers[1]);
+  const std::vector<int32_t> expected(first_pos, first_pos + first.length);
+
+  int64_t total_records = first.length;
+  tiledb_vcf_read_status_t status = TILEDB_VCF_UNINITIALIZED;
+  REQUIRE(tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_OK);
+  while (status != TILEDB_VCF_COMPLETED) {
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    REQUIRE(
+        tiledb_vcf_reader_read_arrow(reader, attrs, 1, &array, &schema) ==
+        TILEDB_VCF_OK);
+    REQUIRE(tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_OK);
+    total_records += array.length;
+    array.release(&array);
+    schema.release(&schema);
+  }
+  REQUIRE(total_records == 10);
+  REQUIRE(
+      std::vector<int32_t>(first_pos, first_pos + first.length) == expected);
+
+  first.release(&first);
+  first_schema.release(&first_schema);
+  tiledb_vcf_reader_free(&reader);
+}
+
+TEST_CASE("C API: Reader next batch", "[capi][reader]") {
+  tiledb_vcf_reader_t* reader = nullptr;
+  REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  REQUIRE(tiledb_vcf_reader_init(reader, dataset_uri.c_str()) == TILEDB_VCF_OK);
+
+  const char* regions = "1:12100-13360,1:13500-17350";
+  REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+  REQUIRE(tiledb_vcf_reader_set_batch_queue_depth(reader, 0) == TILEDB_VCF_ERR);
+
+  unsigned memory_budget = 1024;
+  SECTION("- Default buffers") {
+    memory_budget = 1024;
+    REQUIRE(
+        tiledb_vcf_reader_set_batch_queue_depth(reader, 4) == TILEDB_VCF_OK);
+  }
+
+  SECTION("- Growing buffers, one batch ahead") {
+    memory_budget = 0;
+    REQUIRE(
+        tiledb_vcf_reader_set_batch_queue_depth(reader, 1) == TILEDB_VCF_OK);
+  }
+  REQUIRE(
+      tiledb_vcf_reader_set_memory_budget(reader, memory_budget) ==
+      TILEDB_VCF_OK);
+
+  const char* attrs[] = {"sample_name", "pos_start", "alleles"};
+  int64_t total_records = 0;
+  std::vector<ArrowArray> held;
+  std::vector<ArrowSchema> held_schemas;
+  while (true) {
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    REQUIRE(
+        tiledb_vcf_reader_next_batch(reader, attrs, 3, &array, &schema) ==
+        TILEDB_VCF_OK);
+    if (array.release == nullptr) {
+      REQUIRE(schema.release == nullptr);
+      break;
+    }
+
+    REQUIRE(schema.n_children == 3);
+    REQUIRE(array.length > 0);
+    total_records += array.length;
+
+    // The producer thread owns the read state while the stream is open.
+    if (total_records == array.length) {
+      REQUIRE(tiledb_vcf_reader_read(reader) == TILEDB_VCF_ERR);
+      tiledb_vcf_read_status_t status;
+      REQUIRE(
+          tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_ERR);
+      int64_t num_records = 0;
+      REQUIRE(
+          tiledb_vcf_reader_get_result_num_records(reader, &num_records) ==
+          TILEDB_VCF_ERR);
+    }
+
+    // Holding on to a batch must not corrupt it while the stream moves on.
+    if (held.empty()) {
+      held.push_back(array);
+      held_schemas.push_back(schema);
+      continue;
+    }
+    array.release(&array);
+    schema.release(&schema);
+  }
+  REQUIRE(total_records == 10);
+
+  // The held batch still points at its own buffers.
+  auto pos_start =
+      static_cast<const int32_t*>(held[0].children[1]->buffers[1]);
+  REQUIRE(pos_start[0] > 12000);
+  held[0].release(&held[0]);
+  held_schemas[0].release(&held_schemas[0]);
+
+  // The stream stays exhausted, and blocks other reads, until a reset.
+  struct ArrowArray array;
+  struct ArrowSchema schema;
+  REQUIRE(
+      tiledb_vcf_reader_next_batch(reader, attrs, 3, &array, &schema) ==
+      TILEDB_VCF_OK);
+  REQUIRE(array.release == nullptr);
+  REQUIRE(
+      tiledb_vcf_reader_read_arrow(reader, attrs, 3, &array, &schema) ==
+      TILEDB_VCF_ERR);
+  REQUIRE(tiledb_vcf_reader_read(reader) == TILEDB_VCF_ERR);
+
+  REQUIRE(tiledb_vcf_reader_reset(reader) == TILEDB_VCF_OK);
+  total_records = 0;
+  while (true) {
+    REQUIRE(
+        tiledb_vcf_reader_next_batch(reader, attrs, 3, &array, &schema) ==
+        TILEDB_VCF_OK);
+    if (array.release == nullptr)
+      break;
+    total_records += array.length;
+    array.release(&array);
+    schema.release(&schema);
+  }
+  REQUIRE(total_records == 10);
+
+  tiledb_vcf_reader_free(&reader);
+}
+
+TEST_CASE("C API: Reader shared dataset handle", "[capi][reader]") {
+  tiledb_vcf_dataset_handle_t* handle = nullptr;
+  REQUIRE(tiledb_vcf_dataset_handle_alloc(&handle) == TILEDB_VCF_OK);
+
+  bool refreshed = true;
+  REQUIRE(
+      tiledb_vcf_dataset_handle_refresh(handle, &refreshed) == TILEDB_VCF_ERR);
+
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  REQUIRE(
+      tiledb_vcf_dataset_handle_open(
+          handle, dataset_uri.c_str(), "", 1024 * 1024) == TILEDB_VCF_OK);
+
+  // Count the records of a region with a reader initialized from the handle.
+  auto count_records = [handle](const char* regions) {
+    tiledb_vcf_reader_t* reader = nullptr;
+    if (tiledb_vcf_reader_alloc(&reader) != TILEDB_VCF_OK)
+      return int64_t(-1);
+    int64_t total_records = 0;
+    if (tiledb_vcf_reader_init_from_handle(reader, handle) != TILEDB_VCF_OK ||
+        tiledb_vcf_reader_set_regions(reader, regions) != TILEDB_VCF_OK)
+      total_records = -1;
+
+    const char* attrs[] = {"sample_name", "pos_start", "fmt_DP"};
+    while (total_records >= 0) {
+      struct ArrowArray array;
+      struct ArrowSchema schema;
+      if (tiledb_vcf_reader_next_batch(reader, attrs, 3, &array, &schema) !=
+          TILEDB_VCF_OK) {
+        total_records = -1;
+        break;
+      }
+      if (array.release == nullptr)
+        break;
+      total_records += array.length;
+      array.release(&array);
+      schema.release(&schema);
+    }
+    tiledb_vcf_reader_free(&reader);
+    return total_records;
+  };
+
+  const char* regions = "1:12100-13360,1:13500-17350";
+  REQUIRE(count_records(regions) == 10);
+
+  // Concurrent readers share the handle.
+  std::vector<int64_t> counts(4, 0);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < counts.size(); i++)
+    threads.emplace_back([&counts, &count_records, regions, i]() {
+      counts[i] = count_records(regions);
+    });
+  for (auto& thread : threads)
+    thread.join();
+  for (auto count : counts)
+    REQUIRE(count == 10);
+
+  // Nothing was written to the dataset since it was opened.
+  REQUIRE(
+      tiledb_vcf_dataset_handle_refresh(handle, &refreshed) == TILEDB_VCF_OK);
+  REQUIRE(!refreshed);
+
+  // Readers outlive the handle.
+  tiledb_vcf_reader_t* reader = nullptr;
+  REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+  REQUIRE(tiledb_vcf_reader_init_from_handle(reader, handle) == TILEDB_VCF_OK);
+  tiledb_vcf_dataset_handle_free(&handle);
+  REQUIRE(handle == nullptr);
+  REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+  const char* attrs[] = {"sample_name"};
+  struct ArrowArray array;
+  struct ArrowSchema schema;
+  REQUIRE(
+      tiledb_vcf_reader_next_batch(reader, attrs, 1, &array, &schema) ==
+      TILEDB_VCF_OK);
+  REQUIRE(array.release != nullptr);
+  REQUIRE(array.length > 0);
+  array.release(&array);
+  schema.release(&schema);
+  tiledb_vcf_reader_free(&reader);
+}
+
+TEST_CASE("C API: Reader record filter", "[capi][reader]") {
+  tiledb_vcf_reader_t* reader = nullptr;
+  REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  REQUIRE(tiledb_vcf_reader_init(reader, dataset_uri.c_str()) == TILEDB_VCF_OK);
+
+  const char* all_samples = "HG01762,HG00280";
+  REQUIRE(tiledb_vcf_reader_set_samples(reader, all_samples) == TILEDB_VCF_OK);
+  const char* regions = "1:12100-13360,1:13500-17350";
+  REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+  REQUIRE(
+      tiledb_vcf_reader_set_record_filter(reader, "fmt_DP >=") ==
+      TILEDB_VCF_ERR);
+
+  std::string filter;
+  std::vector<uint32_t> expected_pos_start;
+  SECTION("- Post-filter") {
+    filter = "fmt_DP >= 10";
+    expected_pos_start = {13354, 13354, 13452};
+  }
+
+  SECTION("- Pushdown and post-filter") {
+    filter = "fmt_DP>=10 and pos_start < 13400";
+    expected_pos_start = {13354, 13354};
+  }
+
+  SECTION("- Pushdown") {
+    filter = "pos_end <= 12771";
+    expected_pos_start = {12141, 12141, 12546, 12546};
+  }
+
+  SECTION("- Pushdown of positions below 1") {
+    filter = "fmt_DP >= 10 && pos_start > 0 && pos_end > -5";
+    expected_pos_start = {13354, 13354, 13452};
+  }
+
+  SECTION("- Pushdown of fractional positions") {
+    filter = "fmt_DP >= 10 && pos_start < 13354.5";
+    expected_pos_start = {13354, 13354};
+  }
+
+  SECTION("- Pushdown of fractional positions excluding every record") {
+    filter = "pos_start == 13354.5";
+  }
+
+  SECTION("- Filters") {
+    filter = "filters == PASS";
+  }
+  REQUIRE(
+      tiledb_vcf_reader_set_record_filter(reader, filter.c_str()) ==
+      TILEDB_VCF_OK);
+
+  const unsigned max_num_records = 10;
+  SET_BUFF_POS_START(reader, max_num_records);
+  SET_BUFF_SAMPLE_NAME(reader, max_num_records);
+
+  REQUIRE(tiledb_vcf_reader_read(reader) == TILEDB_VCF_OK);
+  tiledb_vcf_read_status_t status;
+  REQUIRE(tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_OK);
+  REQUIRE(status == TILEDB_VCF_COMPLETED);
+
+  int64_t num_records = ~0;
+  REQUIRE(
+      tiledb_vcf_reader_get_result_num_records(reader, &num_records) ==
+      TILEDB_VCF_OK);
+  REQUIRE(num_records == (int64_t)expected_pos_start.size());
+
+  std::vector<uint32_t> result_pos_start(
+      pos_start.begin(), pos_start.begin() + num_records);
+  std::sort(result_pos_start.begin(), result_pos_start.end());
+  REQUIRE(result_pos_start == expected_pos_start);
+
+  tiledb_vcf_reader_free(&reader);
+}
+
 TEST_CASE("C API: Reader get error message", "[capi][reader]") {
   tiledb_vcf_reader_t* reader = nullptr;
   REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
@@ -3766,6 +4206,58 @@ TEST_CASE("C API: Reader submit (partitioned)", "[capi][reader]") {
   tiledb_vcf_reader_free(&reader1);
 }
 
+TEST_CASE("C API: Reader submit (balanced partitions)", "[capi][reader]") {
+  std::string dataset_uri =
+      INPUT_ARRAYS_DIR_V4 + "/ingested_2samples_GT_DP_PL";
+  const char* regions = "1:12100-13360,1:13500-17350,1:17485-17485";
+
+  // Balanced region and sample partitions must still cover every record
+  // exactly once.
+  bool partition_samples = GENERATE(false, true);
+  const unsigned num_partitions = partition_samples ? 2 : 3;
+  const unsigned alloced_num_records = 20;
+  int64_t total_records = 0;
+  for (unsigned i = 0; i < num_partitions; i++) {
+    tiledb_vcf_reader_t* reader = nullptr;
+    REQUIRE(tiledb_vcf_reader_alloc(&reader) == TILEDB_VCF_OK);
+    REQUIRE(
+        tiledb_vcf_reader_init(reader, dataset_uri.c_str()) == TILEDB_VCF_OK);
+    REQUIRE(tiledb_vcf_reader_set_regions(reader, regions) == TILEDB_VCF_OK);
+    REQUIRE(
+        tiledb_vcf_reader_set_balance_partitions(reader, true) ==
+        TILEDB_VCF_OK);
+    if (partition_samples) {
+      REQUIRE(
+          tiledb_vcf_reader_set_samples(reader, "HG01762,HG00280") ==
+          TILEDB_VCF_OK);
+      REQUIRE(
+          tiledb_vcf_reader_set_sample_partition(reader, i, num_partitions) ==
+          TILEDB_VCF_OK);
+    } else {
+      REQUIRE(
+          tiledb_vcf_reader_set_region_partition(reader, i, num_partitions) ==
+          TILEDB_VCF_OK);
+    }
+
+    SET_BUFF_POS_START(reader, alloced_num_records);
+    SET_BUFF_SAMPLE_NAME(reader, alloced_num_records);
+    REQUIRE(tiledb_vcf_reader_read(reader) == TILEDB_VCF_OK);
+
+    tiledb_vcf_read_status_t status;
+    REQUIRE(tiledb_vcf_reader_get_status(reader, &status) == TILEDB_VCF_OK);
+    REQUIRE(status == TILEDB_VCF_COMPLETED);
+
+    int64_t num_records = ~0;
+    REQUIRE(
+        tiledb_vcf_reader_get_result_num_records(reader, &num_records) ==
+        TILEDB_VCF_OK);
+    total_records += num_records;
+
+    tiledb_vcf_reader_free(&reader);
+  }
+  REQUIRE(total_records == 11);
+}
+
 TEST_CASE("C API: Reader submit (partitioned samples)", "[capi][reader]") {
   tiledb_vcf_reader_t *reader0 = nullptr, *reader1 = nullptr;
   REQUIRE(tiledb_vcf_reader_alloc(&reader0) == TILEDB_VCF_OK);
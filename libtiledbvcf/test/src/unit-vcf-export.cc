@@ -36,10 +36,12 @@
 #include "read/reader.h"
 #include "write/writer.h"
 
+#include <chrono>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <regex>
+#include <thread>
 
 using namespace tiledb::vcf;
 
@@ -956,6 +958,40 @@ TEST_CASE(
     REQUIRE(reader->num_records_exported() == 2);
   }
 
+  // Balanced partitions of regions, including regions without records
+  {
+    auto num_records = [&](const std::vector<std::string>& regions,
+                           uint64_t num_partitions) {
+      uint64_t total = 0;
+      for (uint64_t i = 0; i < num_partitions; i++) {
+        Reader reader;
+        ExportParams params;
+        params.uri = dataset_uri;
+        params.output_dir = output_dir;
+        params.sample_names = {"HG01762", "HG00280"};
+        params.regions = regions;
+        params.balance_partitions = true;
+        params.region_partitioning.partition_index = i;
+        params.region_partitioning.num_partitions = num_partitions;
+        reader.set_all_params(params);
+        reader.open_dataset(dataset_uri);
+        reader.read();
+        REQUIRE(reader.read_status() == ReadStatus::COMPLETED);
+        total += reader.num_records_exported();
+      }
+      return total;
+    };
+
+    REQUIRE(num_records({"1:12000-13500", "1:17000-18000"}, 2) == 12);
+    REQUIRE(num_records({"1:12000-13500", "1:17000-18000"}, 3) == 12);
+
+    // Every region is pruned, leaving nothing to partition
+    REQUIRE(num_records({"2:1-100000", "1:10000000-10001000"}, 3) == 0);
+
+    // Regions inside the data array that hold no records
+    REQUIRE(num_records({"1:14000-14500", "1:15000-16000"}, 3) == 0);
+  }
+
   if (vfs.is_dir(dataset_uri))
     vfs.remove_dir(dataset_uri);
   if (vfs.is_dir(output_dir))
@@ -1019,6 +1055,158 @@ TEST_CASE("TileDB-VCF: Test export limit records", "[tiledbvcf][export]") {
     vfs.remove_dir(output_dir);
 }
 
+TEST_CASE(
+    "TileDB-VCF: Test export prunes regions and samples by fragment",
+    "[tiledbvcf][export]") {
+  tiledb::Context ctx;
+  tiledb::VFS vfs(ctx);
+
+  std::string dataset_uri = "test_dataset";
+  if (vfs.is_dir(dataset_uri))
+    vfs.remove_dir(dataset_uri);
+
+  std::string output_dir = "test_dataset_out";
+  if (vfs.is_dir(output_dir))
+    vfs.remove_dir(output_dir);
+
+  CreationParams create_args;
+  create_args.uri = dataset_uri;
+  create_args.tile_capacity = 10000;
+  TileDBVCFDataset::create(create_args);
+
+  // Ingest the samples separately, so each has its own fragment
+  for (const auto& sample : {"/small.bcf", "/small2.bcf"}) {
+    Writer writer;
+    IngestionParams params;
+    params.uri = dataset_uri;
+    params.sample_uris = {input_dir + sample};
+    writer.set_all_params(params);
+    writer.ingest_samples();
+  }
+
+  auto num_records = [&](const std::vector<std::string>& samples,
+                         const std::vector<std::string>& regions) {
+    Reader reader;
+    ExportParams params;
+    params.uri = dataset_uri;
+    params.output_dir = output_dir;
+    params.sample_names = samples;
+    params.regions = regions;
+    reader.set_all_params(params);
+    reader.open_dataset(dataset_uri);
+    reader.read();
+    REQUIRE(reader.read_status() == ReadStatus::COMPLETED);
+    return reader.num_records_exported();
+  };
+
+  const std::vector<std::string> regions = {"1:12000-13500", "1:17000-18000"};
+  const auto hg01762 = num_records({"HG01762"}, regions);
+  // Reading only the second sample skips the first sample's fragment
+  const auto hg00280 = num_records({"HG00280"}, regions);
+  REQUIRE(hg01762 > 0);
+  REQUIRE(hg00280 > 0);
+
+  // Regions on a contig without data are dropped without changing results
+  auto with_empty_contig = regions;
+  with_empty_contig.push_back("2:1-100000");
+  REQUIRE(num_records({"HG01762"}, with_empty_contig) == hg01762);
+  REQUIRE(
+      num_records({"HG01762", "HG00280"}, with_empty_contig) ==
+      hg01762 + hg00280);
+
+  // Regions past the end of the data are dropped
+  REQUIRE(num_records({"HG01762"}, {"1:10000000-10001000"}) == 0);
+
+  if (vfs.is_dir(dataset_uri))
+    vfs.remove_dir(dataset_uri);
+  if (vfs.is_dir(output_dir))
+    vfs.remove_dir(output_dir);
+}
+
+TEST_CASE(
+    "TileDB-VCF: Test export of time-bounded reads by fragment",
+    "[tiledbvcf][export]") {
+  tiledb::Context ctx;
+  tiledb::VFS vfs(ctx);
+
+  std::string dataset_uri = "test_dataset";
+  if (vfs.is_dir(dataset_uri))
+    vfs.remove_dir(dataset_uri);
+
+  std::string output_dir = "test_dataset_out";
+  if (vfs.is_dir(output_dir))
+    vfs.remove_dir(output_dir);
+
+  CreationParams create_args;
+  create_args.uri = dataset_uri;
+  create_args.tile_capacity = 10000;
+  TileDBVCFDataset::create(create_args);
+
+  auto now_ms = []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    return std::to_string(ms.count());
+  };
+
+  // Ingest two batches, noting a time between them
+  std::string t1;
+  for (const auto& sample : {"/small.bcf", "/small2.bcf"}) {
+    Writer writer;
+    IngestionParams params;
+    params.uri = dataset_uri;
+    params.sample_uris = {input_dir + sample};
+    writer.set_all_params(params);
+    writer.ingest_samples();
+    if (t1.empty())
+      t1 = now_ms();
+  }
+
+  const std::vector<std::string> regions = {"1:12000-13500", "1:17000-18000"};
+  auto num_records = [&](const std::vector<std::string>& samples,
+                         const std::vector<std::string>& tiledb_config,
+                         int visible_samples) {
+    Reader reader;
+    ExportParams params;
+    params.uri = dataset_uri;
+    params.output_dir = output_dir;
+    params.sample_names = samples;
+    params.regions = regions;
+    params.tiledb_config = tiledb_config;
+    reader.set_all_params(params);
+    reader.open_dataset(dataset_uri);
+    reader.read();
+    REQUIRE(reader.read_status() == ReadStatus::COMPLETED);
+    int sample_count;
+    reader.sample_count(&sample_count);
+    REQUIRE(sample_count == visible_samples);
+    return reader.num_records_exported();
+  };
+
+  const auto hg01762 = num_records({"HG01762"}, {}, 2);
+  const auto hg00280 = num_records({"HG00280"}, {}, 2);
+  REQUIRE(hg01762 > 0);
+  REQUIRE(hg00280 > 0);
+  REQUIRE(num_records({}, {}, 2) == hg01762 + hg00280);
+
+  // A read bounded before the second batch returns only the first batch
+  const std::string before_second = "vcf.end_timestamp=" + t1;
+  REQUIRE(num_records({}, {before_second}, 1) == hg01762);
+  REQUIRE(num_records({"HG01762"}, {before_second}, 1) == hg01762);
+
+  // Reading only the second sample narrows the data array to its batch,
+  // which matches a read bounded after the first batch.
+  const std::string after_first = "vcf.start_timestamp=" + t1;
+  REQUIRE(num_records({}, {after_first}, 1) == hg00280);
+  REQUIRE(num_records({"HG00280"}, {after_first}, 1) == hg00280);
+
+  if (vfs.is_dir(dataset_uri))
+    vfs.remove_dir(dataset_uri);
+  if (vfs.is_dir(output_dir))
+    vfs.remove_dir(output_dir);
+}
+
 TEST_CASE("TileDB-VCF: Test export incomplete queries", "[tiledbvcf][export]") {
   tiledb::Context ctx;
   tiledb::VFS vfs(ctx);
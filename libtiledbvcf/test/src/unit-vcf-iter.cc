@@ -36,9 +36,12 @@
 #include "vcf/vcf_v2.h"
 #include "vcf/vcf_v3.h"
 #include "vcf/vcf_v4.h"
+#include "write/record_heap_v4.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <numeric>
 
 using namespace tiledb::vcf;
 
@@ -351,3 +354,111 @@ TEST_CASE("VCF: Test V4 iterator", "[tiledbvcf][iter][v4]") {
   // Check iterator doesn't span to the next contig
   REQUIRE(!vcf.front_record());
 }
+
+TEST_CASE("VCF: Test V4 record heap", "[tiledbvcf][iter][v4]") {
+  std::vector<std::shared_ptr<VCFV4>> vcfs;
+  for (const auto& file : {"small.bcf", "small2.bcf"}) {
+    auto vcf = std::make_shared<VCFV4>();
+    vcf->open(input_dir + "/" + file);
+    REQUIRE(vcf->seek("1", 0));
+    vcfs.push_back(vcf);
+  }
+
+  RecordHeapV4 heap;
+  heap.init(vcfs);
+  REQUIRE(heap.empty());
+  REQUIRE(heap.sample_name(0) == "HG01762");
+  REQUIRE(heap.sample_name(1) == "HG00280");
+
+  // Insert whole samples one after the other
+  HtslibValueMem val;
+  for (uint32_t sample = 0; sample < vcfs.size(); sample++) {
+    auto& vcf = vcfs[sample];
+    while (SafeSharedBCFRec r = vcf->front_record()) {
+      vcf->pop_record();
+      const uint32_t end_pos = VCFUtils::get_end_pos(vcf->hdr(), r.get(), &val);
+      heap.insert(
+          vcf, RecordHeapV4::NodeType::Record, r, r->pos, end_pos, sample);
+    }
+  }
+  REQUIRE(heap.size() == 14);
+
+  SECTION("- Merge order") {
+    std::vector<std::pair<uint32_t, std::string>> popped;
+    while (!heap.empty()) {
+      const auto& top = heap.top();
+      REQUIRE(heap.contig_name(top.contig) == "1");
+      popped.emplace_back(top.start_pos, heap.sample_name(top.sample));
+      heap.pop();
+    }
+    REQUIRE(popped.size() == 14);
+    REQUIRE(std::is_sorted(popped.begin(), popped.end()));
+    REQUIRE(popped[0] == std::make_pair(12140u, std::string("HG00280")));
+    REQUIRE(popped[1] == std::make_pair(12140u, std::string("HG01762")));
+  }
+
+  SECTION("- Anchors and erase") {
+    // Re-insert the top record as an anchor, as ingestion does
+    const auto& top = heap.top();
+    REQUIRE(top.start_pos == 12140);
+    heap.insert(
+        top.vcf,
+        RecordHeapV4::NodeType::Anchor,
+        top.record,
+        13000,
+        top.end_pos,
+        top.sample);
+    heap.pop();
+    REQUIRE(heap.size() == 14);
+
+    // Records from 13000 on are dropped; the anchor is kept
+    REQUIRE(heap.erase_records_from(13000) == 9);
+    REQUIRE(heap.size() == 4);
+    std::vector<uint32_t> starts;
+    while (!heap.empty()) {
+      starts.push_back(heap.top().start_pos);
+      heap.pop();
+    }
+    REQUIRE(starts == std::vector<uint32_t>{12140, 12545, 12545, 13000});
+  }
+
+  SECTION("- Exchange nodes") {
+    RecordHeapV4 other;
+    other.init(vcfs);
+    while (!heap.empty()) {
+      other.insert(heap.top());
+      heap.pop();
+    }
+    REQUIRE(other.size() == 14);
+    REQUIRE(other.top().start_pos == 12140);
+    REQUIRE(other.sample_name(other.top().sample) == "HG00280");
+    other.clear();
+    REQUIRE(other.empty());
+  }
+}
+
+TEST_CASE("VCF: Test V4 record estimates", "[tiledbvcf][iter][v4]") {
+  VCFV4 vcf;
+  vcf.open(input_dir + "/random_synthetic/G1.bcf");
+  REQUIRE(vcf.is_open());
+
+  const uint32_t window_size = 1 << 18;
+  const uint32_t contig_len = 159138663;
+  const size_t nwindows = (contig_len + window_size - 1) / window_size;
+  std::vector<double> records;
+  vcf.estimate_records("7", window_size, contig_len, &records);
+  REQUIRE(records.size() == nwindows);
+
+  // The contig's records are spread over its windows
+  const double total = std::accumulate(records.begin(), records.end(), 0.0);
+  REQUIRE(total == Approx(vcf.record_count("7")));
+  REQUIRE(std::all_of(
+      records.begin(), records.end(), [](double r) { return r >= 0; }));
+
+  // Estimates of further files accumulate into the same windows
+  vcf.estimate_records("7", window_size, contig_len, &records);
+  REQUIRE(records.size() == nwindows);
+  REQUIRE(
+      std::accumulate(records.begin(), records.end(), 0.0) ==
+      Approx(2 * total));
+}
@@ -33,12 +33,17 @@
 #include "catch.hpp"
 
 #include "dataset/tiledbvcfdataset.h"
+#include "read/reader.h"
+#include "utils/metrics.h"
 #include "write/writer.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <htslib/vcf.h>
 #include <iostream>
 #include <regex>
+#include <tuple>
 
 using namespace tiledb::vcf;
 
@@ -349,6 +354,216 @@ TEST_CASE("TileDB-VCF: Test ingest 100", "[tiledbvcf][ingest]") {
     vfs.remove_dir(dataset_uri);
 }
 
+TEST_CASE("TileDB-VCF: Test density region list", "[tiledbvcf][ingest]") {
+  const uint32_t window_size = 1000;
+  const std::vector<Region> contigs = {
+      {"1", 0, 9999}, {"2", 0, 2499}, {"3", 0, 4999}};
+
+  // A dense window in the middle of contig 1, a uniform contig 2 whose last
+  // window runs past its end, and contig 3 without estimates.
+  std::map<std::string, std::vector<double>> window_records;
+  window_records["1"] = {10, 10, 10, 10, 500, 10, 10, 10, 10, 10};
+  window_records["2"] = {100, 100, 100};
+
+  auto regions =
+      Writer::prepare_region_list(contigs, window_records, window_size, 100);
+  REQUIRE(std::is_sorted(regions.begin(), regions.end()));
+
+  // Every contig is covered from its first to its last position, without
+  // gaps or overlaps.
+  std::map<std::string, std::vector<Region>> contig_regions;
+  for (const auto& r : regions) {
+    REQUIRE(r.min <= r.max);
+    contig_regions[r.seq_name].push_back(r);
+  }
+  REQUIRE(contig_regions.size() == contigs.size());
+  for (const auto& c : contigs) {
+    const auto& rs = contig_regions.at(c.seq_name);
+    REQUIRE(rs.front().min == c.min);
+    REQUIRE(rs.back().max == c.max);
+    for (size_t i = 1; i < rs.size(); i++)
+      REQUIRE(rs[i].min == rs[i - 1].max + 1);
+  }
+
+  // 600 records in 100-record tasks, with the dense window cut several times
+  const auto& dense = contig_regions.at("1");
+  REQUIRE(dense.size() == 6);
+  unsigned dense_window_regions = 0;
+  for (const auto& r : dense)
+    dense_window_regions += r.max >= 4000 && r.min < 5000;
+  REQUIRE(dense_window_regions >= 4);
+
+  REQUIRE(contig_regions.at("2").size() == 3);
+  REQUIRE(contig_regions.at("3").size() == 1);
+
+  // Fewer records than a task leave each contig whole
+  regions =
+      Writer::prepare_region_list(contigs, window_records, window_size, 1e6);
+  REQUIRE(regions.size() == contigs.size());
+  for (size_t i = 0; i < contigs.size(); i++) {
+    REQUIRE(regions[i].seq_name == contigs[i].seq_name);
+    REQUIRE(regions[i].min == contigs[i].min);
+    REQUIRE(regions[i].max == contigs[i].max);
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test ingest with region splits", "[tiledbvcf][ingest]") {
+  tiledb::Context ctx;
+  tiledb::VFS vfs(ctx);
+
+  // A sample with one record in the first half of contig 1 and a dense
+  // second half, with a long record every 5000 records for anchors.
+  const std::string sample_uri = "test_dataset_split_input.bcf";
+  const uint32_t contig_len = 1999999;
+  {
+    htsFile* fp = hts_open(sample_uri.c_str(), "wb");
+    REQUIRE(fp != nullptr);
+    bcf_hdr_t* hdr = bcf_hdr_init("w");
+    bcf_hdr_append(hdr, "##contig=<ID=1,length=1999999>");
+    bcf_hdr_append(
+        hdr, "##INFO=<ID=END,Number=1,Type=Integer,Description=\"End\">");
+    bcf_hdr_append(
+        hdr, "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"GT\">");
+    bcf_hdr_append(
+        hdr, "##FORMAT=<ID=DP,Number=1,Type=Integer,Description=\"DP\">");
+    bcf_hdr_add_sample(hdr, "S1");
+    bcf_hdr_add_sample(hdr, nullptr);
+    REQUIRE(bcf_hdr_write(fp, hdr) == 0);
+
+    std::vector<uint32_t> positions = {1000};
+    for (uint32_t pos = 1000000; pos < contig_len; pos += 10)
+      positions.push_back(pos);
+
+    bcf1_t* rec = bcf_init();
+    for (size_t i = 0; i < positions.size(); i++) {
+      rec->rid = 0;
+      rec->pos = positions[i];
+      bcf_update_alleles_str(hdr, rec, "A,C");
+      if (i % 5000 == 1) {
+        int32_t end = positions[i] + 5000;
+        bcf_update_info_int32(hdr, rec, "END", &end, 1);
+        rec->rlen = end - positions[i];
+      }
+      int32_t gt[2] = {bcf_gt_unphased(0), bcf_gt_unphased(1)};
+      bcf_update_genotypes(hdr, rec, gt, 2);
+      int32_t dp = i % 100;
+      bcf_update_format_int32(hdr, rec, "DP", &dp, 1);
+      REQUIRE(bcf_write(fp, hdr, rec) == 0);
+      bcf_clear(rec);
+    }
+    bcf_destroy(rec);
+    bcf_hdr_destroy(hdr);
+    REQUIRE(hts_close(fp) == 0);
+    REQUIRE(bcf_index_build(sample_uri.c_str(), 14) == 0);
+  }
+
+  // Ingests the sample with contig 1 cut into two regions. The dense region
+  // fills the output buffers many times over, so its worker is still busy
+  // when the other worker runs out of regions and splits the dense one.
+  // Returns the number of splits.
+  auto ingest = [&](const std::string& dataset_uri, unsigned num_threads) {
+    if (vfs.is_dir(dataset_uri))
+      vfs.remove_dir(dataset_uri);
+    CreationParams create_args;
+    create_args.uri = dataset_uri;
+    create_args.anchor_gap = 1000;
+    TileDBVCFDataset::create(create_args);
+
+    Writer writer;
+    IngestionParams params;
+    params.uri = dataset_uri;
+    params.sample_uris = {sample_uri};
+    params.num_threads = num_threads;
+    params.use_legacy_thread_task_size = true;
+    params.thread_task_size = (contig_len + 1) / 2;
+    params.use_legacy_max_tiledb_buffer_size_mb = true;
+    params.max_tiledb_buffer_size_mb = 1;
+    writer.set_all_params(params);
+    metrics::reset();
+    writer.ingest_samples();
+    return metrics::counter("ingest.region_splits").value();
+  };
+
+  // Coordinates of every cell of the data array, records and anchors alike
+  using Cell = std::tuple<std::string, uint32_t, std::string, uint32_t>;
+  auto read_cells = [&ctx](const std::string& dataset_uri) {
+    tiledb::Array array(
+        ctx, TileDBVCFDataset::data_array_uri(dataset_uri), TILEDB_READ);
+    tiledb::Query query(ctx, array);
+    std::vector<char> contigs(1 << 20), samples(8 << 20);
+    std::vector<uint64_t> contig_offsets(1 << 18), sample_offsets(1 << 18);
+    std::vector<uint32_t> start_pos(1 << 18), end_pos(1 << 18);
+    query.set_layout(TILEDB_GLOBAL_ORDER)
+        .set_data_buffer("contig", contigs)
+        .set_offsets_buffer("contig", contig_offsets)
+        .set_data_buffer("sample", samples)
+        .set_offsets_buffer("sample", sample_offsets)
+        .set_data_buffer("start_pos", start_pos)
+        .set_data_buffer("end_pos", end_pos);
+
+    std::vector<Cell> cells;
+    tiledb::Query::Status status;
+    do {
+      status = query.submit();
+      auto results = query.result_buffer_elements();
+      const uint64_t num_cells = results["start_pos"].second;
+      REQUIRE((num_cells > 0 || status == tiledb::Query::Status::COMPLETE));
+      auto str = [num_cells](
+                     const std::vector<char>& data,
+                     const std::vector<uint64_t>& offsets,
+                     uint64_t size,
+                     uint64_t i) {
+        const uint64_t end = i + 1 < num_cells ? offsets[i + 1] : size;
+        return std::string(data.data() + offsets[i], end - offsets[i]);
+      };
+      for (uint64_t i = 0; i < num_cells; i++)
+        cells.emplace_back(
+            str(contigs, contig_offsets, results["contig"].second, i),
+            start_pos[i],
+            str(samples, sample_offsets, results["sample"].second, i),
+            end_pos[i]);
+    } while (status == tiledb::Query::Status::INCOMPLETE);
+    std::sort(cells.begin(), cells.end());
+    return cells;
+  };
+
+  auto count = [](const std::string& dataset_uri, const std::string& region) {
+    Reader reader;
+    ExportParams params;
+    params.uri = dataset_uri;
+    params.regions = {region};
+    reader.set_all_params(params);
+    reader.open_dataset(dataset_uri);
+    reader.read();
+    REQUIRE(reader.read_status() == ReadStatus::COMPLETED);
+    return reader.num_records_exported();
+  };
+
+  const std::string single_uri = "test_dataset_single";
+  const std::string split_uri = "test_dataset_split";
+  metrics::enable(true);
+  REQUIRE(ingest(single_uri, 1) == 0);
+  REQUIRE(ingest(split_uri, 2) > 0);
+
+  // Splitting moves work between workers without changing what is written
+  const auto cells = read_cells(single_uri);
+  REQUIRE(!cells.empty());
+  REQUIRE(read_cells(split_uri) == cells);
+  for (const auto& region :
+       {"1:1-1999999", "1:1000000-1100000", "1:1500000-1999999"})
+    REQUIRE(count(split_uri, region) == count(single_uri, region));
+
+  metrics::enable(false);
+  for (const auto& uri : {single_uri, split_uri}) {
+    if (vfs.is_dir(uri))
+      vfs.remove_dir(uri);
+  }
+  for (const auto& uri : {sample_uri, sample_uri + ".csi"}) {
+    if (vfs.is_file(uri))
+      vfs.remove_file(uri);
+  }
+}
+
 TEST_CASE("TileDB-VCF: Write to existing V2 array", "[tiledbvcf][ingest][v2]") {
   tiledb::Context ctx;
   tiledb::VFS vfs(ctx);
@@ -771,3 +986,132 @@ TEST_CASE("TileDB-VCF: Test Resume Contig Merge", "[tiledbvcf][ingest]") {
   if (vfs.is_dir(dataset_uri))
     vfs.remove_dir(dataset_uri);
 }
+
+TEST_CASE("TileDB-VCF: Test Resume Checkpoints", "[tiledbvcf][ingest]") {
+  tiledb::Context ctx;
+  tiledb::VFS vfs(ctx);
+
+  std::string dataset_uri = "test_dataset_resume_checkpoints";
+  std::string checkpoint_uri = "test_dataset_resume_checkpoints_log";
+  for (const auto& uri : {dataset_uri, checkpoint_uri}) {
+    if (vfs.is_dir(uri))
+      vfs.remove_dir(uri);
+  }
+
+  CreationParams create_args;
+  create_args.uri = dataset_uri;
+  create_args.tile_capacity = 10000;
+  create_args.anchor_gap = 100000;
+  TileDBVCFDataset::create(create_args);
+
+  auto ingest = [&]() {
+    Writer writer;
+    IngestionParams params;
+    params.uri = dataset_uri;
+    params.sample_uris = {input_dir + "/v2-DjrIAzkP-downsampled.vcf.gz"};
+    params.resume_sample_partial_ingestion = true;
+    params.contig_fragment_merging = false;
+    params.checkpoint_uri = checkpoint_uri;
+    // Commit a fragment at every region boundary
+    params.checkpoint_records = 1;
+    writer.set_all_params(params);
+    // Throws if the QACheck fails
+    writer.ingest_samples();
+  };
+  auto num_fragments = [&]() {
+    tiledb::FragmentInfo fragment_info(ctx, dataset_uri + "/data");
+    fragment_info.load();
+    return fragment_info.fragment_num();
+  };
+
+  ingest();
+  const auto expected_fragments = num_fragments();
+  const auto checkpoint_files = vfs.ls(checkpoint_uri);
+  REQUIRE(checkpoint_files.size() == expected_fragments);
+
+  // Drop the last checkpoint and its fragment, as if the ingestion had been
+  // interrupted right before committing it
+  {
+    const std::string last_file =
+        *std::max_element(checkpoint_files.begin(), checkpoint_files.end());
+    std::string str;
+    {
+      tiledb::VFS::filebuf sbuf(vfs);
+      sbuf.open(last_file, std::ios::in);
+      std::istream is(&sbuf);
+      str.assign(std::istreambuf_iterator<char>(is), {});
+    }
+    IngestionCheckpoints::Checkpoint checkpoint;
+    REQUIRE(IngestionCheckpoints::parse(str, &checkpoint));
+    REQUIRE(!checkpoint.regions.empty());
+    vfs.remove_file(last_file);
+
+    const Region& last_region = checkpoint.regions.back();
+    tiledb::FragmentInfo fragment_info(ctx, dataset_uri + "/data");
+    fragment_info.load();
+    bool removed = false;
+    for (uint32_t i = 0; i < fragment_info.fragment_num() && !removed; i++) {
+      auto contigs = fragment_info.non_empty_domain_var(i, 0);
+      uint32_t start_pos[2];
+      fragment_info.get_non_empty_domain(i, 1, start_pos);
+      if (contigs.second == last_region.seq_name &&
+          start_pos[0] >= checkpoint.regions.front().min &&
+          start_pos[1] <= last_region.max) {
+        std::string uri = fragment_info.fragment_uri(i);
+        vfs.remove_dir(uri);
+        uri = std::regex_replace(uri, std::regex("__fragments"), "__commits");
+        vfs.remove_file(uri + ".wrt");
+        removed = true;
+      }
+    }
+    REQUIRE(removed);
+  }
+  REQUIRE(num_fragments() == expected_fragments - 1);
+
+  // Resuming only ingests the regions of the dropped checkpoint
+  ingest();
+  REQUIRE(num_fragments() == expected_fragments);
+  REQUIRE(vfs.ls(checkpoint_uri).size() == expected_fragments);
+
+  // Nothing is left to ingest
+  ingest();
+  REQUIRE(num_fragments() == expected_fragments);
+
+  for (const auto& uri : {dataset_uri, checkpoint_uri}) {
+    if (vfs.is_dir(uri))
+      vfs.remove_dir(uri);
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test checkpoint coverage", "[tiledbvcf][ingest]") {
+  IngestionCheckpoints::Checkpoint a, b;
+  a.first_sample = "";
+  a.last_sample = "HG00280";
+  a.records = 12;
+  a.regions = {Region("1", 0, 99), Region("1", 100, 199)};
+  b.regions = {Region("1", 500, 599), Region("2", 0, 49)};
+
+  // Serialization round trip, with an empty sample name
+  IngestionCheckpoints::Checkpoint parsed;
+  const std::string str = IngestionCheckpoints::to_str(a);
+  REQUIRE(IngestionCheckpoints::parse(str, &parsed));
+  REQUIRE(parsed.first_sample == "");
+  REQUIRE(parsed.last_sample == "HG00280");
+  REQUIRE(parsed.records == 12);
+  REQUIRE(parsed.regions.size() == 2);
+  REQUIRE(parsed.regions[1].to_str() == a.regions[1].to_str());
+  REQUIRE(!IngestionCheckpoints::parse("not a checkpoint", &parsed));
+
+  const std::vector<Region> regions = {
+      Region("1", 0, 999), Region("2", 0, 99), Region("3", 0, 99)};
+  auto uncovered = IngestionCheckpoints::uncovered(regions, {a, b});
+  std::vector<std::string> result;
+  for (const auto& r : uncovered)
+    result.push_back(r.to_str());
+  REQUIRE(
+      result == std::vector<std::string>{
+                    Region("1", 200, 499).to_str(),
+                    Region("1", 600, 999).to_str(),
+                    Region("2", 50, 99).to_str(),
+                    Region("3", 0, 99).to_str()});
+}
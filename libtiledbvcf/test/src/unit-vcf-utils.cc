@@ -32,14 +32,25 @@
 
 #include "catch.hpp"
 
+#include "dataset/attribute_backfill.h"
+#include "dataset/consolidation_planner.h"
 #include "dataset/tiledbvcfdataset.h"
 #include "read/reader.h"
+#include "read/record_filter.h"
+#include "utils/buffer_pool.h"
 #include "utils/logger_public.h"
+#include "utils/metrics.h"
+#include "utils/utils.h"
+#include "vcf/region_index.h"
+#include "vcf/vcf_utils.h"
 #include "write/writer.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <numeric>
+#include <random>
 
 using namespace tiledb::vcf;
 
@@ -343,3 +354,721 @@ TEST_CASE(
   if (vfs.is_dir(dataset_uri))
     vfs.remove_dir(dataset_uri);
 }
+
+TEST_CASE("TileDB-VCF: Test weighted partitioning", "[tiledbvcf][utils]") {
+  const std::vector<int> elements = {0, 1, 2, 3, 4, 5};
+
+  SECTION("- Heavy element gets its own partition") {
+    const std::vector<double> weights = {1, 1, 10, 1, 1, 1};
+    std::vector<std::vector<int>> partitions;
+    for (uint64_t i = 0; i < 3; i++) {
+      auto vec = elements;
+      utils::partition_vector_weighted(i, 3, weights, &vec);
+      partitions.push_back(vec);
+    }
+    REQUIRE(partitions[0] == std::vector<int>{0, 1});
+    REQUIRE(partitions[1] == std::vector<int>{2});
+    REQUIRE(partitions[2] == std::vector<int>{3, 4, 5});
+  }
+
+  SECTION("- Zero weights fall back to equal counts") {
+    const std::vector<double> weights(elements.size(), 0);
+    auto vec = elements;
+    utils::partition_vector_weighted(1, 2, weights, &vec);
+    REQUIRE(vec == std::vector<int>{3, 4, 5});
+  }
+
+  SECTION("- Zero weights with more partitions than elements") {
+    const std::vector<double> weights = {0, 0};
+    for (uint64_t i = 0; i < 4; i++) {
+      std::vector<int> vec = {7, 8};
+      utils::partition_vector_weighted(i, 4, weights, &vec);
+      if (i < 2)
+        REQUIRE(vec == std::vector<int>{static_cast<int>(7 + i)});
+      else
+        REQUIRE(vec.empty());
+    }
+    std::vector<int> vec = {7, 8};
+    REQUIRE_THROWS(utils::partition_vector_weighted(4, 4, weights, &vec));
+  }
+
+  SECTION("- Empty vector") {
+    std::vector<int> vec;
+    for (uint64_t i = 0; i < 3; i++) {
+      utils::partition_vector_weighted(i, 3, {}, &vec);
+      REQUIRE(vec.empty());
+    }
+    REQUIRE_THROWS(utils::partition_vector_weighted(3, 3, {}, &vec));
+  }
+
+  SECTION("- Mismatched weights") {
+    auto vec = elements;
+    REQUIRE_THROWS(utils::partition_vector_weighted(0, 2, {1, 2}, &vec));
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test cached region index", "[tiledbvcf][utils]") {
+  tiledb::Context ctx;
+  tiledb::VFS vfs(ctx);
+
+  const std::string cache_uri = "test_region_index_cache";
+  if (vfs.is_dir(cache_uri))
+    vfs.remove_dir(cache_uri);
+
+  const std::string bed_uri =
+      input_dir + "/E001_15_coreMarks_dense_filtered.bed.gz";
+  std::list<Region> expected;
+  Region::parse_bed_file_htslib(bed_uri, &expected);
+  REQUIRE(!expected.empty());
+
+  auto require_equal = [&expected](const std::list<Region>& regions) {
+    REQUIRE(regions.size() == expected.size());
+    auto it = expected.begin();
+    for (const auto& r : regions) {
+      REQUIRE(r.region_str == it->region_str);
+      ++it;
+    }
+  };
+
+  SECTION("- Serialization round trip") {
+    const uint64_t key = RegionIndex::source_key(vfs, bed_uri);
+    vfs.create_dir(cache_uri);
+    const std::string index_uri = cache_uri + "/index.regions";
+    RegionIndex(expected).save(vfs, index_uri, key);
+
+    RegionIndex index;
+    REQUIRE(index.load(vfs, index_uri, key));
+    REQUIRE(index.size() == expected.size());
+    std::list<Region> regions;
+    index.regions(&regions);
+    require_equal(regions);
+
+    // An index of a different BED file is not used
+    RegionIndex other;
+    REQUIRE(!other.load(vfs, index_uri, key + 1));
+    REQUIRE(!other.load(vfs, cache_uri + "/missing.regions", key));
+  }
+
+  SECTION("- Cache miss then hit") {
+    std::list<Region> first, second;
+    RegionIndex::parse_bed_file_cached(vfs, bed_uri, cache_uri, &first);
+    REQUIRE(vfs.is_dir(cache_uri));
+    require_equal(first);
+
+    RegionIndex::parse_bed_file_cached(vfs, bed_uri, cache_uri, &second);
+    require_equal(second);
+  }
+
+  SECTION("- Edits in the middle of the file change the key") {
+    const std::string edited_uri = "test_region_index_edited.bed";
+    std::string contents;
+    for (int i = 0; i < 20000; i++)
+      contents += "1\t" + std::to_string(i * 100) + "\t" +
+                  std::to_string(i * 100 + 50) + "\n";
+
+    auto key_of = [&](const std::string& text) {
+      std::ofstream(edited_uri, std::ios::trunc) << text;
+      return RegionIndex::source_key(vfs, edited_uri);
+    };
+    const uint64_t key = key_of(contents);
+    REQUIRE(key_of(contents) == key);
+    char& middle = contents[contents.size() / 2];
+    middle = middle == '1' ? '2' : '1';
+    REQUIRE(key_of(contents) != key);
+
+    vfs.remove_file(edited_uri);
+  }
+
+  if (vfs.is_dir(cache_uri))
+    vfs.remove_dir(cache_uri);
+}
+
+TEST_CASE("TileDB-VCF: Test consolidation planner", "[tiledbvcf][utils]") {
+  auto fragment = [](const std::string& contig_min,
+                     const std::string& contig_max,
+                     const std::string& sample_min,
+                     const std::string& sample_max,
+                     uint64_t timestamp,
+                     uint64_t size) {
+    ConsolidationPlanner::Fragment f;
+    f.uri = "__" + std::to_string(timestamp);
+    f.contigs = {contig_min, contig_max};
+    f.start_pos = {0, 1000};
+    f.samples = {sample_min, sample_max};
+    f.timestamps = {timestamp, timestamp};
+    f.size = size;
+    return f;
+  };
+
+  std::vector<ConsolidationPlanner::Fragment> fragments = {
+      // Four small sample batches of contig 1
+      fragment("1", "1", "C", "D", 1, 10),
+      fragment("1", "1", "A", "B", 2, 10),
+      fragment("1", "1", "G", "H", 3, 10),
+      fragment("1", "1", "E", "F", 4, 10),
+      // A fragment at the target size and a single small one
+      fragment("2", "2", "I", "J", 5, 100),
+      fragment("2", "2", "K", "L", 6, 5),
+      // Merging the contig 3 fragments would cover the contig 3-4 fragment
+      fragment("3", "3", "A", "B", 7, 10),
+      fragment("3", "4", "C", "D", 8, 10),
+      fragment("3", "3", "E", "F", 9, 10),
+  };
+
+  ConsolidationPlanner plan(fragments, 25);
+  REQUIRE(plan.groups().size() == 1);
+  const auto& group = plan.groups()[0];
+  REQUIRE(group.contigs.first == "1");
+  REQUIRE(group.merges.size() == 2);
+  REQUIRE(group.bytes == 40);
+
+  // Adjacent sample batches, in timestamp order
+  REQUIRE(group.merges[0].fragments == std::vector<size_t>{0, 1});
+  REQUIRE(group.merges[1].fragments == std::vector<size_t>{2, 3});
+
+  REQUIRE(plan.num_merges() == 2);
+  REQUIRE(plan.num_fragments_after() == 7);
+  REQUIRE(plan.bytes_rewritten() == 40);
+  REQUIRE(plan.total_bytes() == 175);
+  REQUIRE(plan.write_amplification() == Approx(40.0 / 175));
+
+  SECTION("- Larger target") {
+    ConsolidationPlanner large(fragments, 1000);
+    // Largest group first
+    REQUIRE(large.groups().size() == 2);
+    REQUIRE(large.groups()[0].contigs.first == "2");
+    REQUIRE(large.groups()[0].merges[0].fragments.size() == 2);
+    REQUIRE(large.groups()[1].merges[0].fragments.size() == 4);
+    REQUIRE(large.num_fragments_after() == 5);
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test metrics", "[tiledbvcf][utils]") {
+  auto& records = metrics::counter("test.records");
+  auto& latency = metrics::histogram("test.latency");
+  REQUIRE(&metrics::counter("test.records") == &records);
+  metrics::reset();
+
+  SECTION("- Disabled") {
+    metrics::enable(false);
+    records.add(5);
+    latency.record(100);
+    { metrics::ScopedTimer timer(latency); }
+    REQUIRE(records.value() == 0);
+    REQUIRE(
+        latency.to_json() ==
+        "{\"count\": 0, \"sum_ns\": 0, \"max_ns\": 0, \"buckets_ns\": {}}");
+  }
+
+  SECTION("- Enabled") {
+    metrics::enable(true);
+    records.add();
+    records.add(2);
+    latency.record(1);
+    latency.record(3);
+    latency.record(4);
+    latency.record(1000);
+    REQUIRE(records.value() == 3);
+    REQUIRE(
+        latency.to_json() ==
+        "{\"count\": 4, \"sum_ns\": 1008, \"max_ns\": 1000, "
+        "\"buckets_ns\": {\"le_1\": 1, \"le_4\": 2, \"le_1024\": 1}}");
+
+    auto json = metrics::to_json();
+    REQUIRE(json.find("\"test.records\": 3") != std::string::npos);
+    REQUIRE(json.find("\"test.latency\": {\"count\": 4") != std::string::npos);
+
+    metrics::reset();
+    REQUIRE(records.value() == 0);
+    metrics::enable(false);
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test record filter parsing", "[tiledbvcf][utils]") {
+  typedef RecordFilter::Op Op;
+
+  SECTION("- Predicates") {
+    RecordFilter filter(
+        "QUAL > 30 && FILTER == PASS and fmt_GQ>=20 && info_DB=='1' && "
+        "pos_start != 100");
+    const auto& predicates = filter.predicates();
+    REQUIRE(predicates.size() == 5);
+    REQUIRE(predicates[0].field == "qual");
+    REQUIRE(predicates[0].op == Op::GT);
+    REQUIRE(predicates[0].is_number);
+    REQUIRE(predicates[0].number == 30);
+    REQUIRE(predicates[1].field == "filters");
+    REQUIRE(predicates[1].op == Op::EQ);
+    REQUIRE(predicates[1].value == "PASS");
+    REQUIRE(!predicates[1].is_number);
+    REQUIRE(predicates[2].field == "fmt_GQ");
+    REQUIRE(predicates[2].op == Op::GE);
+    REQUIRE(predicates[3].field == "info_DB");
+    REQUIRE(predicates[3].value == "1");
+    REQUIRE(predicates[4].field == "pos_start");
+    REQUIRE(predicates[4].op == Op::NE);
+
+    REQUIRE(RecordFilter::is_pushed_down(predicates[0]));
+    REQUIRE(!RecordFilter::is_pushed_down(predicates[1]));
+    REQUIRE(!RecordFilter::is_pushed_down(predicates[2]));
+    REQUIRE(RecordFilter::is_pushed_down(predicates[4]));
+    REQUIRE(filter.has_post_filter());
+    REQUIRE(!filter.need_headers());
+  }
+
+  SECTION("- Pushdown only") {
+    RecordFilter filter("qual>=10 && pos_end<5000");
+    REQUIRE(!filter.has_post_filter());
+    REQUIRE(!filter.need_headers());
+  }
+
+  SECTION("- Positions") {
+    RecordFilter filter("pos_start > 0 && pos_end < 100.5 && pos_end != -1");
+    const auto& predicates = filter.predicates();
+    REQUIRE(predicates.size() == 3);
+    REQUIRE(predicates[0].number == 0);
+    REQUIRE(predicates[1].number == 100.5);
+    REQUIRE(predicates[2].number == -1);
+    REQUIRE(!filter.has_post_filter());
+
+    tiledb::Context ctx;
+    REQUIRE(filter.query_condition(ctx) != nullptr);
+    // Conditions every position satisfies are not pushed down
+    REQUIRE(RecordFilter("pos_start >= 0.5").query_condition(ctx) == nullptr);
+    REQUIRE(RecordFilter("pos_start != 1.5").query_condition(ctx) == nullptr);
+    REQUIRE(RecordFilter("pos_end < 5e9").query_condition(ctx) == nullptr);
+    REQUIRE(RecordFilter("pos_end > 5e9").query_condition(ctx) != nullptr);
+  }
+
+  SECTION("- Filter names") {
+    REQUIRE(RecordFilter("filters != LowQual").need_headers());
+  }
+
+  SECTION("- Invalid") {
+    REQUIRE_THROWS(RecordFilter(""));
+    REQUIRE_THROWS(RecordFilter("qual"));
+    REQUIRE_THROWS(RecordFilter("qual > "));
+    REQUIRE_THROWS(RecordFilter("qual > high"));
+    REQUIRE_THROWS(RecordFilter("qual ~ 30"));
+    REQUIRE_THROWS(RecordFilter("qual > 30 ||  fmt_DP > 1"));
+    REQUIRE_THROWS(RecordFilter("pos_start > first"));
+    REQUIRE_THROWS(RecordFilter("pos_end < inf"));
+    REQUIRE_THROWS(RecordFilter("filters < PASS"));
+    REQUIRE_THROWS(RecordFilter("alleles == A"));
+    REQUIRE_THROWS(RecordFilter("fmt_GT == 1"));
+    REQUIRE_THROWS(RecordFilter("info_ == 1"));
+    REQUIRE_THROWS(RecordFilter("info_DB == 'x"));
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test reference block detection", "[tiledbvcf][utils]") {
+  REQUIRE(VCFUtils::is_ref_block("C,<NON_REF>"));
+  REQUIRE(VCFUtils::is_ref_block(std::string_view("C,<*>\0", 6)));
+  REQUIRE(VCFUtils::is_ref_block("C,<*>,<NON_REF>"));
+  REQUIRE(VCFUtils::is_ref_block("C"));
+  REQUIRE(!VCFUtils::is_ref_block("A,G,<NON_REF>"));
+  REQUIRE(!VCFUtils::is_ref_block("T,C"));
+  REQUIRE(!VCFUtils::is_ref_block("G,<DEL>"));
+}
+
+TEST_CASE("TileDB-VCF: Test compact genotype encoding", "[tiledbvcf][utils]") {
+  auto round_trip = [](std::vector<int32_t> gt) {
+    uint32_t packed = 0;
+    REQUIRE(VCFUtils::encode_compact_gt(gt.data(), gt.size(), &packed));
+    int32_t decoded[2];
+    int ploidy = VCFUtils::decode_compact_gt(packed, decoded);
+    return std::vector<int32_t>(decoded, decoded + ploidy);
+  };
+
+  const int max_allele = VCFUtils::compact_gt_max_allele;
+  std::vector<std::vector<int32_t>> gts = {
+      {bcf_gt_unphased(0), bcf_gt_unphased(1)},
+      {bcf_gt_unphased(1), bcf_gt_phased(2)},
+      {bcf_gt_phased(0), bcf_gt_phased(0)},
+      {bcf_gt_missing, bcf_gt_missing},
+      {bcf_gt_unphased(0), bcf_gt_missing},
+      {bcf_gt_unphased(max_allele), bcf_gt_phased(max_allele)},
+      {bcf_gt_unphased(1)},
+      {bcf_gt_missing},
+      {}};
+  for (const auto& gt : gts)
+    REQUIRE(round_trip(gt) == gt);
+
+  // Ploidy padding is dropped
+  REQUIRE(
+      round_trip({bcf_gt_unphased(1), bcf_int32_vector_end}) ==
+      std::vector<int32_t>{bcf_gt_unphased(1)});
+
+  // Genotypes the encoding cannot hold
+  uint32_t packed = 0;
+  std::vector<int32_t> triploid = {
+      bcf_gt_unphased(0), bcf_gt_unphased(1), bcf_gt_unphased(1)};
+  REQUIRE(!VCFUtils::encode_compact_gt(triploid.data(), 3, &packed));
+  std::vector<int32_t> many_alleles = {bcf_gt_unphased(max_allele + 1)};
+  REQUIRE(!VCFUtils::encode_compact_gt(many_alleles.data(), 1, &packed));
+}
+
+TEST_CASE("TileDB-VCF: Test pVCF result ordering", "[tiledbvcf][utils]") {
+  const std::vector<std::string> names = {"s2", "s10", "s1", "HG00280"};
+  std::mt19937 gen(42);
+
+  auto check = [](const std::vector<uint32_t>& pos,
+                  const std::vector<std::string>& cell_names) {
+    Buffer buffer;
+    for (const auto& name : cell_names) {
+      buffer.offsets().push_back(buffer.size());
+      buffer.append(name.data(), name.size());
+    }
+    buffer.effective_size(buffer.size());
+    buffer.offset_nelts(cell_names.size());
+
+    std::vector<size_t> expected(pos.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    std::stable_sort(
+        expected.begin(), expected.end(), [&](size_t a, size_t b) {
+          return pos[a] < pos[b] ||
+                 (pos[a] == pos[b] && cell_names[a] < cell_names[b]);
+        });
+
+    std::vector<size_t> idx;
+    utils::sort_indexes_pvcf(pos.data(), buffer, pos.size(), &idx);
+    REQUIRE(idx == expected);
+  };
+
+  SECTION("- Unsorted") {
+    std::vector<uint32_t> pos;
+    std::vector<std::string> cell_names;
+    for (int i = 0; i < 1000; i++) {
+      pos.push_back(100000 + gen() % 70000);
+      cell_names.push_back(names[gen() % names.size()]);
+    }
+    check(pos, cell_names);
+  }
+
+  SECTION("- Sorted") {
+    check({1, 1, 2, 5}, {"a", "b", "a", "a"});
+  }
+
+  SECTION("- Anchors") {
+    check({10, 10, 3, 12, 12}, {"s2", "s1", "s1", "s1", "s1"});
+  }
+}
+
+TEST_CASE(
+    "TileDB-VCF: Test extracted attribute backfill", "[tiledbvcf][utils]") {
+  auto append = [](std::vector<char>* blob, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    blob->insert(blob->end(), bytes, bytes + size);
+  };
+  auto append_field = [&](std::vector<char>* blob,
+                          const std::string& key,
+                          int type,
+                          const std::vector<int32_t>& values) {
+    append(blob, key.c_str(), key.size() + 1);
+    int num_values = values.size();
+    append(blob, &type, sizeof(int));
+    append(blob, &num_values, sizeof(int));
+    append(blob, values.data(), values.size() * sizeof(int32_t));
+  };
+
+  std::vector<char> blob;
+  uint32_t num_fields = 2;
+  append(&blob, &num_fields, sizeof(uint32_t));
+  append_field(&blob, "DP", BCF_HT_INT, {17});
+  append_field(&blob, "AD", BCF_HT_INT, {10, 7});
+
+  std::vector<char> expected_blob;
+  num_fields = 1;
+  append(&expected_blob, &num_fields, sizeof(uint32_t));
+  append_field(&expected_blob, "DP", BCF_HT_INT, {17});
+
+  std::vector<char> expected_value;
+  int type = BCF_HT_INT, num_values = 2;
+  append(&expected_value, &type, sizeof(int));
+  append(&expected_value, &num_values, sizeof(int));
+  std::vector<int32_t> ad = {10, 7};
+  append(&expected_value, ad.data(), ad.size() * sizeof(int32_t));
+
+  std::vector<char> value;
+  REQUIRE(!AttributeBackfill::extract_field("D", &blob, &value));
+  REQUIRE(!AttributeBackfill::extract_field("MQ", &blob, &value));
+  REQUIRE(AttributeBackfill::extract_field("AD", &blob, &value));
+  REQUIRE(value == expected_value);
+  REQUIRE(blob == expected_blob);
+
+  std::vector<char> truncated(blob.begin(), blob.end() - 1);
+  REQUIRE_THROWS(AttributeBackfill::extract_field("DP", &truncated, &value));
+}
+
+TEST_CASE(
+    "TileDB-VCF: Test backfill of ingested fragments", "[tiledbvcf][utils]") {
+  tiledb::Context ctx;
+  tiledb::VFS vfs(ctx);
+
+  std::string dataset_uri = "test_dataset_backfill";
+  if (vfs.is_dir(dataset_uri))
+    vfs.remove_dir(dataset_uri);
+  const std::string data_uri = TileDBVCFDataset::data_array_uri(dataset_uri);
+
+  CreationParams create_args;
+  create_args.uri = dataset_uri;
+  TileDBVCFDataset::create(create_args);
+  {
+    Writer writer;
+    IngestionParams params;
+    params.uri = dataset_uri;
+    params.sample_uris = {
+        input_dir + "/small.vcf.gz", input_dir + "/small2.vcf.gz"};
+    writer.set_all_params(params);
+    writer.ingest_samples();
+  }
+
+  auto count = [&dataset_uri](const std::string& record_filter) {
+    Reader reader;
+    ExportParams params;
+    params.uri = dataset_uri;
+    params.sample_names = {"HG01762", "HG00280"};
+    params.regions = {"1:12000-20000"};
+    params.record_filter = record_filter;
+    reader.set_all_params(params);
+    reader.open_dataset(dataset_uri);
+    reader.read();
+    REQUIRE(reader.read_status() == ReadStatus::COMPLETED);
+    return reader.num_records_exported();
+  };
+
+  // Info blobs of all cells, read with the latest schema
+  auto read_info = [&ctx, &data_uri]() {
+    tiledb::Array array(ctx, data_uri, TILEDB_READ);
+    tiledb::Query query(ctx, array);
+    std::vector<uint8_t> data(1 << 20);
+    std::vector<uint64_t> offsets(1 << 16);
+    query.set_layout(TILEDB_UNORDERED)
+        .set_data_buffer("info", data)
+        .set_offsets_buffer("info", offsets);
+    REQUIRE(query.submit() == tiledb::Query::Status::COMPLETE);
+    const auto elements = query.result_buffer_elements()["info"];
+    std::vector<std::vector<char>> cells;
+    for (uint64_t i = 0; i < elements.first; i++) {
+      const uint64_t end =
+          i + 1 < elements.first ? offsets[i + 1] : elements.second;
+      cells.emplace_back(data.begin() + offsets[i], data.begin() + end);
+    }
+    return cells;
+  };
+  auto count_dp = [](std::vector<std::vector<char>> cells) {
+    uint64_t num = 0;
+    std::vector<char> value;
+    for (auto& cell : cells)
+      num += AttributeBackfill::extract_field("DP", &cell, &value);
+    return num;
+  };
+
+  const uint64_t num_records = count("");
+  const uint64_t num_filtered = count("info_DP > 100");
+  REQUIRE(num_filtered > 0);
+  REQUIRE(num_filtered < num_records);
+  const auto cells = read_info();
+  REQUIRE(count_dp(cells) > 0);
+
+  auto dataset_ctx = std::make_shared<tiledb::Context>(ctx);
+  {
+    TileDBVCFDataset dataset(dataset_ctx);
+    dataset.open(dataset_uri);
+    UtilsParams params;
+    params.uri = dataset_uri;
+    params.extract_attributes = {"info_DP"};
+    dataset.extract_attributes(params);
+  }
+
+  // Null extracted cells fall back to the blob until the backfill
+  REQUIRE(count("info_DP > 100") == num_filtered);
+
+  // A swap recorded without its rewritten fragment, as left by a crash
+  // before the commit, leaves the original fragments to be rewritten
+  {
+    tiledb::FragmentInfo fragment_info(ctx, data_uri);
+    fragment_info.load();
+    std::string value = "1";
+    for (uint32_t i = 0; i < fragment_info.fragment_num(); i++) {
+      const std::string uri = fragment_info.fragment_uri(i);
+      value += ',' + uri.substr(uri.find_last_of('/') + 1);
+    }
+    tiledb::Array array(ctx, data_uri, TILEDB_WRITE);
+    array.put_metadata(
+        "backfill_pending/test", TILEDB_CHAR, value.size(), value.data());
+  }
+
+  {
+    TileDBVCFDataset dataset(dataset_ctx);
+    dataset.open(dataset_uri);
+    UtilsParams params;
+    params.uri = dataset_uri;
+    dataset.consolidate_data_array_fragments(params);
+  }
+
+  // The field moved out of the blobs into the attribute
+  REQUIRE(count("") == num_records);
+  REQUIRE(count("info_DP > 100") == num_filtered);
+  const auto backfilled = read_info();
+  REQUIRE(backfilled.size() == cells.size());
+  REQUIRE(count_dp(backfilled) == 0);
+  {
+    tiledb::Array array(ctx, data_uri, TILEDB_READ);
+    tiledb_datatype_t dtype;
+    REQUIRE(!array.has_metadata("backfill_pending/test", &dtype));
+  }
+
+  if (vfs.is_dir(dataset_uri))
+    vfs.remove_dir(dataset_uri);
+}
+
+TEST_CASE("TileDB-VCF: Test adaptive anchor gap", "[tiledbvcf][utils]") {
+  std::vector<uint32_t> lengths;
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 1) == 1);
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 100) == 100);
+
+  // SNVs only
+  lengths.assign(1000, 0);
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 1) == 1);
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 100) == 100);
+
+  // 2% of the records are long deletions
+  lengths.assign(980, 0);
+  lengths.insert(lengths.end(), 20, 5000);
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 100) == 5000);
+
+  // Reference blocks of increasing lengths
+  lengths.clear();
+  for (uint32_t i = 1000; i > 0; i--)
+    lengths.push_back(i * 10);
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 100) == 9900);
+
+  // The gap is bounded
+  lengths.assign(10, 1 << 30);
+  REQUIRE(TileDBVCFDataset::choose_anchor_gap(&lengths, 1) == (1u << 20));
+  lengths.clear();
+  REQUIRE(
+      TileDBVCFDataset::choose_anchor_gap(&lengths, 1 << 30) == (1u << 20));
+
+  SECTION("- Gaps recorded by concurrent ingestions") {
+    auto ctx = std::make_shared<tiledb::Context>();
+    tiledb::VFS vfs(*ctx);
+    const std::string dataset_uri = "test_dataset_anchor_gaps";
+    if (vfs.is_dir(dataset_uri))
+      vfs.remove_dir(dataset_uri);
+
+    CreationParams create_args;
+    create_args.uri = dataset_uri;
+    create_args.adaptive_anchor_gap = true;
+    TileDBVCFDataset::create(create_args);
+
+    // Both ingestions open the dataset before either records its gaps
+    TileDBVCFDataset first(ctx), second(ctx);
+    first.open(dataset_uri);
+    second.open(dataset_uri);
+    first.record_contig_anchor_gaps({{"1", 500}, {"2", 10}});
+    second.record_contig_anchor_gaps({{"1", 200}, {"3", 30}});
+
+    TileDBVCFDataset dataset(ctx);
+    dataset.open(dataset_uri);
+    REQUIRE(dataset.anchor_gap("1") == 500);
+    REQUIRE(dataset.anchor_gap("2") == 10);
+    REQUIRE(dataset.anchor_gap("3") == 30);
+    REQUIRE(dataset.anchor_gap("4") == create_args.anchor_gap);
+
+    // Count the metadata keys holding anchor gaps
+    auto num_gap_keys = [&ctx, &dataset_uri]() {
+      tiledb::Array array(
+          *ctx, TileDBVCFDataset::data_array_uri(dataset_uri), TILEDB_READ);
+      uint64_t num_keys = 0;
+      for (uint64_t i = 0; i < array.metadata_num(); i++) {
+        std::string key;
+        tiledb_datatype_t dtype;
+        uint32_t value_num = 0;
+        const void* value = nullptr;
+        array.get_metadata_from_index(i, &key, &dtype, &value_num, &value);
+        num_keys += utils::starts_with(key, "contig_anchor_gaps");
+      }
+      return num_keys;
+    };
+    REQUIRE(num_gap_keys() == 2);
+
+    // Gaps no larger than the recorded ones are not written again
+    dataset.record_contig_anchor_gaps({{"1", 500}, {"2", 5}});
+    REQUIRE(num_gap_keys() == 2);
+    dataset.record_contig_anchor_gaps({{"1", 400}, {"2", 20}});
+    REQUIRE(num_gap_keys() == 3);
+    TileDBVCFDataset reopened(ctx);
+    reopened.open(dataset_uri);
+    REQUIRE(reopened.anchor_gap("1") == 500);
+    REQUIRE(reopened.anchor_gap("2") == 20);
+
+    if (vfs.is_dir(dataset_uri))
+      vfs.remove_dir(dataset_uri);
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test buffer pool", "[tiledbvcf][utils]") {
+  buffer_pool::enable(1 << 20, false);
+  const std::vector<char> bytes(1000, 'x');
+  const char* data = nullptr;
+  {
+    Buffer buffer;
+    buffer.append(bytes.data(), bytes.size());
+    buffer.append(bytes.data(), bytes.size());
+    REQUIRE(buffer.alloced_size() == 2000);
+    REQUIRE(std::string(buffer.data<char>(), 2000) == std::string(2000, 'x'));
+    data = buffer.data<char>();
+  }
+
+  // The freed allocation is reused by a buffer that fits it
+  {
+    Buffer buffer;
+    buffer.reserve(1500);
+    REQUIRE(buffer.data<char>() == data);
+    REQUIRE(buffer.alloced_size() == 2000);
+  }
+
+  // Pooled allocations more than twice the requested size are not reused
+  {
+    Buffer buffer;
+    buffer.reserve(400);
+    REQUIRE(buffer.alloced_size() == 400);
+  }
+
+  buffer_pool::update_high_water("info", 10);
+  buffer_pool::update_high_water("info", 5);
+  REQUIRE(buffer_pool::high_water("info") == 10);
+  REQUIRE(buffer_pool::high_water("fmt") == 0);
+
+  // The pool is only released by the release of its last user
+  buffer_pool::enable(1 << 20, false);
+  buffer_pool::release();
+  REQUIRE(buffer_pool::high_water("info") == 10);
+  {
+    Buffer buffer;
+    buffer.reserve(1500);
+    REQUIRE(buffer.data<char>() == data);
+  }
+
+  buffer_pool::release();
+  REQUIRE(buffer_pool::high_water("info") == 0);
+  {
+    Buffer buffer;
+    buffer.reserve(1500);
+    REQUIRE(buffer.alloced_size() == 1500);
+  }
+}
+
+TEST_CASE("TileDB-VCF: Test stable hash", "[tiledbvcf][utils]") {
+  // Published FNV-1a test vectors; the value must never change
+  REQUIRE(utils::fnv1a("", 0) == 0xcbf29ce484222325ULL);
+  REQUIRE(utils::fnv1a("a", 1) == 0xaf63dc4c8601ec8cULL);
+  REQUIRE(utils::fnv1a("foobar", 6) == 0x85944171f73967e8ULL);
+
+  // Hashing in pieces matches hashing the whole input
+  REQUIRE(
+      utils::fnv1a("bar", 3, utils::fnv1a("foo", 3)) ==
+      utils::fnv1a("foobar", 6));
+}